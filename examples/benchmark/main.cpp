@@ -0,0 +1,174 @@
+/*
+* Copyright (c) 2016-2019 Irlan Robson https://irlanrobson.github.io
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include <bounce/bounce.h>
+#include <stdio.h>
+
+// This example measures the time spent by the cloth force solver 
+// for an increasing number of particles.
+// Each cloth is solved on the calling thread and then on all hardware threads.
+
+// The scopes being measured.
+static const char* s_scopeNames[] = { "Cloth Solve Forces", "Cloth Solve MPCG" };
+static const u32 s_scopeCount = sizeof(s_scopeNames) / sizeof(const char*);
+
+// Accumulated time of each scope in milliseconds.
+static float64 s_scopeTimes[s_scopeCount];
+
+// Stack of open scopes.
+static const u32 s_maxScopeDepth = 64;
+static const char* s_scopeStack[s_maxScopeDepth];
+static b3Time s_scopeTimers[s_maxScopeDepth];
+static u32 s_scopeDepth = 0;
+
+void b3BeginProfileScope(const char* name)
+{
+	B3_ASSERT(s_scopeDepth < s_maxScopeDepth);
+	s_scopeStack[s_scopeDepth] = name;
+	s_scopeTimers[s_scopeDepth].Update();
+	++s_scopeDepth;
+}
+
+void b3EndProfileScope()
+{
+	B3_ASSERT(s_scopeDepth > 0);
+	--s_scopeDepth;
+	
+	b3Time& timer = s_scopeTimers[s_scopeDepth];
+	timer.Update();
+
+	for (u32 i = 0; i < s_scopeCount; ++i)
+	{
+		if (strcmp(s_scopeStack[s_scopeDepth], s_scopeNames[i]) == 0)
+		{
+			s_scopeTimes[i] += timer.GetElapsedMilis();
+		}
+	}
+}
+
+// A n x n grid cloth mesh created at run-time.
+struct GridClothMesh : public b3ClothMesh
+{
+	GridClothMesh(u32 n)
+	{
+		vertexCount = (n + 1) * (n + 1);
+		vertices = (b3Vec3*)malloc(vertexCount * sizeof(b3Vec3));
+		for (u32 i = 0; i <= n; ++i)
+		{
+			for (u32 j = 0; j <= n; ++j)
+			{
+				vertices[i * (n + 1) + j].Set(float32(j) - 0.5f * float32(n), 0.0f, float32(i) - 0.5f * float32(n));
+			}
+		}
+
+		triangleCount = 2 * n * n;
+		triangles = (b3ClothMeshTriangle*)malloc(triangleCount * sizeof(b3ClothMeshTriangle));
+		u32 t = 0;
+		for (u32 i = 0; i < n; ++i)
+		{
+			for (u32 j = 0; j < n; ++j)
+			{
+				u32 v1 = i * (n + 1) + j;
+				u32 v2 = (i + 1) * (n + 1) + j;
+				u32 v3 = (i + 1) * (n + 1) + (j + 1);
+				u32 v4 = i * (n + 1) + (j + 1);
+
+				triangles[t].v1 = v3;
+				triangles[t].v2 = v2;
+				triangles[t].v3 = v1;
+				++t;
+
+				triangles[t].v1 = v1;
+				triangles[t].v2 = v4;
+				triangles[t].v3 = v3;
+				++t;
+			}
+		}
+
+		mesh.startVertex = 0;
+		mesh.vertexCount = vertexCount;
+		mesh.startTriangle = 0;
+		mesh.triangleCount = triangleCount;
+
+		meshCount = 1;
+		meshes = &mesh;
+		sewingLineCount = 0;
+		sewingLines = nullptr;
+	}
+
+	~GridClothMesh()
+	{
+		free(vertices);
+		free(triangles);
+	}
+
+	b3ClothMeshMesh mesh;
+};
+
+int main()
+{
+	const float32 timeStep = 1.0f / 60.0f;
+	const u32 stepCount = 20;
+
+	b3ThreadPool threadPool;
+	
+	printf("%10s %10s %10s %22s %22s\n", "particles", "threads", "steps", "forces (ms/step)", "MPCG (ms/step)");
+
+	const u32 sizes[] = { 16, 32, 64, 100, 140 };
+	for (u32 k = 0; k < 2 * sizeof(sizes) / sizeof(u32); ++k)
+	{
+		u32 size = sizes[k / 2];
+		b3ThreadPool* pool = (k & 1) ? &threadPool : nullptr;
+		u32 threadCount = pool ? pool->GetThreadCount() : 1;
+
+		GridClothMesh mesh(size);
+
+		b3ClothDef def;
+		def.mesh = &mesh;
+		def.density = 0.2f;
+		def.streching = 100000.0f;
+		def.shearing = 1000.0f;
+		def.damping = 10.0f;
+
+		b3Cloth* cloth = new b3Cloth(def);
+		cloth->SetGravity(b3Vec3(0.0f, -9.8f, 0.0f));
+		cloth->SetThreadPool(pool);
+
+		// Pin one side
+		for (u32 i = 0; i <= size; ++i)
+		{
+			cloth->GetParticle(i)->SetType(e_staticParticle);
+		}
+
+		for (u32 i = 0; i < s_scopeCount; ++i)
+		{
+			s_scopeTimes[i] = 0.0;
+		}
+
+		for (u32 i = 0; i < stepCount; ++i)
+		{
+			cloth->Step(timeStep, 8, 2);
+		}
+
+		printf("%10u %10u %10u %22.3f %22.3f\n", mesh.vertexCount, threadCount, stepCount, s_scopeTimes[0] / stepCount, s_scopeTimes[1] / stepCount);
+
+		delete cloth;
+	}
+
+	return 0;
+}
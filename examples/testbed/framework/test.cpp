@@ -19,8 +19,9 @@
 #include <testbed/framework/test.h>
 #include <testbed/framework/profiler.h>
 #include <testbed/framework/profiler_st.h>
+#include <atomic>
 
-extern u32 b3_allocCalls, b3_maxAllocCalls;
+extern std::atomic<u32> b3_allocCalls, b3_maxAllocCalls;
 extern u32 b3_convexCalls, b3_convexCacheHits;
 extern u32 b3_gjkCalls, b3_gjkIters, b3_gjkMaxIters;
 extern bool b3_convexCache;
@@ -114,7 +115,7 @@ void Test::Step()
 
 		g_draw->DrawString(b3Color_white, "Convex Calls %d", b3_convexCalls);
 		g_draw->DrawString(b3Color_white, "Convex Cache Hits %d (%f)", b3_convexCacheHits, convexCacheHitRatio);
-		g_draw->DrawString(b3Color_white, "Frame Allocations %d (%d)", b3_allocCalls, b3_maxAllocCalls);
+		g_draw->DrawString(b3Color_white, "Frame Allocations %d (%d)", b3_allocCalls.load(), b3_maxAllocCalls.load());
 	}
 }
 
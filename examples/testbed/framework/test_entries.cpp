@@ -18,6 +18,7 @@
 
 #include <testbed/framework/test.h>
 #include <testbed/tests/convex_hull.h>
+#include <testbed/tests/hull_cooking.h>
 #include <testbed/tests/cluster.h>
 #include <testbed/tests/distance_test.h>
 #include <testbed/tests/shape_cast.h>
@@ -43,6 +44,7 @@
 #include <testbed/tests/newton_cradle.h>
 #include <testbed/tests/ragdoll.h>
 #include <testbed/tests/mesh_contact_test.h>
+#include <testbed/tests/height_field_test.h>
 #include <testbed/tests/hull_contact_test.h>
 #include <testbed/tests/sphere_stack.h>
 #include <testbed/tests/capsule_stack.h>
@@ -65,13 +67,16 @@
 #include <testbed/tests/tension_mapping.h>
 #include <testbed/tests/cloth_self_collision.h>
 #include <testbed/tests/rope_test.h>
+#include <testbed/tests/rope_group_test.h>
 #include <testbed/tests/beam.h>
 #include <testbed/tests/pinned_softbody.h>
 #include <testbed/tests/smash_softbody.h>
+#include <testbed/tests/embedded_softbody.h>
 
 TestEntry g_tests[] =
 {
 	{ "Convex Hull", &ConvexHull::Create },
+	{ "Hull Cooking", &HullCooking::Create },
 	{ "Cluster", &Cluster::Create },
 	{ "Distance", &Distance::Create },
 	{ "Shape Cast", &ShapeCast::Create },
@@ -84,6 +89,7 @@ TestEntry g_tests[] =
 	{ "Capsule Spin", &CapsuleSpin::Create },
 	{ "Hull Contact Test", &HullContactTest::Create },
 	{ "Mesh Contact Test", &MeshContactTest::Create },
+	{ "Height Field Test", &HeightFieldTest::Create },
 	{ "Linear Motion", &LinearMotion::Create },
 	{ "Angular Motion", &AngularMotion::Create },
 	{ "Gyroscopic Motion", &GyroMotion::Create },
@@ -120,7 +126,9 @@ TestEntry g_tests[] =
 	{ "Beam", &Beam::Create },
 	{ "Pinned Soft Body", &PinnedSoftBody::Create },
 	{ "Smash Soft Body", &SmashSoftBody::Create },
+	{ "Embedded Soft Body", &EmbeddedSoftBody::Create },
 	{ "Rope", &Rope::Create },
+	{ "Rope Group", &RopeGroup::Create },
 	{ NULL, NULL }
 };
 
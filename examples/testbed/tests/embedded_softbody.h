@@ -0,0 +1,266 @@
+/*
+* Copyright (c) 2016-2019 Irlan Robson https://irlanrobson.github.io
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef EMBEDDED_SOFTBODY_H
+#define EMBEDDED_SOFTBODY_H
+
+#include <testbed/framework/softbody_dragger.h>
+
+// This test fills a torus triangle mesh with tetrahedrons,
+// writes the soft body cache into a buffer, reads it back and
+// creates the soft body from the cache.
+// The torus is drawn by binding its vertices to the tetrahedrons.
+class EmbeddedSoftBody : public Test
+{
+public:
+	enum
+	{
+		e_ringCount = 32,
+		e_sideCount = 16,
+		e_resolution = 10
+	};
+
+	EmbeddedSoftBody()
+	{
+		// Create torus
+		float32 R = 2.0f;
+		float32 r = 0.75f;
+
+		m_renderMesh.vertexCount = e_ringCount * e_sideCount;
+		m_renderMesh.vertices = (b3Vec3*)b3Alloc(m_renderMesh.vertexCount * sizeof(b3Vec3));
+		m_renderMesh.triangleCount = 2 * e_ringCount * e_sideCount;
+		m_renderMesh.triangles = (b3Triangle*)b3Alloc(m_renderMesh.triangleCount * sizeof(b3Triangle));
+
+		for (u32 i = 0; i < e_ringCount; ++i)
+		{
+			float32 u = 2.0f * B3_PI * float32(i) / float32(e_ringCount);
+
+			for (u32 j = 0; j < e_sideCount; ++j)
+			{
+				float32 v = 2.0f * B3_PI * float32(j) / float32(e_sideCount);
+
+				b3Vec3* p = m_renderMesh.vertices + i * e_sideCount + j;
+				p->x = (R + r * cos(v)) * cos(u);
+				p->y = 5.0f + r * sin(v);
+				p->z = (R + r * cos(v)) * sin(u);
+			}
+		}
+
+		u32 triangleCount = 0;
+		for (u32 i = 0; i < e_ringCount; ++i)
+		{
+			u32 i2 = (i + 1) % e_ringCount;
+
+			for (u32 j = 0; j < e_sideCount; ++j)
+			{
+				u32 j2 = (j + 1) % e_sideCount;
+
+				u32 v1 = i * e_sideCount + j;
+				u32 v2 = i2 * e_sideCount + j;
+				u32 v3 = i2 * e_sideCount + j2;
+				u32 v4 = i * e_sideCount + j2;
+
+				b3Triangle* t1 = m_renderMesh.triangles + triangleCount++;
+				t1->v1 = v1;
+				t1->v2 = v2;
+				t1->v3 = v3;
+
+				b3Triangle* t2 = m_renderMesh.triangles + triangleCount++;
+				t2->v1 = v1;
+				t2->v2 = v3;
+				t2->v3 = v4;
+			}
+		}
+
+		// Fill the torus with tetrahedrons
+		m_bindings = (b3SoftBodyMeshBinding*)b3Alloc(m_renderMesh.vertexCount * sizeof(b3SoftBodyMeshBinding));
+		m_mesh.SetAsTriangleMesh(&m_renderMesh, e_resolution, m_bindings);
+
+		// Compute the soft body data once and write it into a cache
+		b3SoftBodyDef def;
+		def.mesh = &m_mesh;
+		def.density = 0.2f;
+		def.E = 200.0f;
+		def.nu = 0.33f;
+
+		{
+			b3SoftBody body(def);
+
+			u32 size = body.GetCacheBinarySize();
+
+			// The cache must be 16-byte aligned.
+			m_cacheBuffer = b3Alloc(size + 15);
+			void* cacheData = (void*)(((uintptr_t)m_cacheBuffer + 15) & ~uintptr_t(15));
+
+			body.WriteCacheBinary(cacheData);
+
+			bool ok = m_cache.ReadBinary(cacheData, size);
+			B3_ASSERT(ok);
+			B3_NOT_USED(ok);
+		}
+
+		// Create the soft body from the cache
+		b3SoftBodyDef cacheDef;
+		cacheDef.cache = &m_cache;
+
+		m_body = new b3SoftBody(cacheDef);
+
+		b3Vec3 gravity(0.0f, -9.8f, 0.0f);
+		m_body->SetGravity(gravity);
+		m_body->SetWorld(&m_world);
+
+		for (u32 i = 0; i < m_cache.mesh.vertexCount; ++i)
+		{
+			b3SoftBodyNode* n = m_body->GetVertexNode(i);
+
+			n->SetRadius(0.05f);
+			n->SetFriction(0.2f);
+		}
+
+		// Create ground
+		{
+			b3BodyDef bd;
+			bd.type = e_staticBody;
+
+			b3Body* b = m_world.CreateBody(bd);
+
+			b3HullShape groundShape;
+			groundShape.m_hull = &m_groundHull;
+
+			b3ShapeDef sd;
+			sd.shape = &groundShape;
+			sd.friction = 0.3f;
+
+			b->CreateShape(sd);
+		}
+
+		m_bodyDragger = new b3SoftBodyDragger(&m_ray, m_body);
+	}
+
+	~EmbeddedSoftBody()
+	{
+		delete m_bodyDragger;
+		delete m_body;
+		b3Free(m_cacheBuffer);
+		b3Free(m_bindings);
+		b3Free(m_renderMesh.triangles);
+		b3Free(m_renderMesh.vertices);
+	}
+
+	void Step()
+	{
+		Test::Step();
+
+		if (m_bodyDragger->IsDragging())
+		{
+			m_bodyDragger->Drag();
+		}
+
+		m_body->Step(g_testSettings->inv_hertz, g_testSettings->velocityIterations, g_testSettings->positionIterations);
+
+		// Move the torus vertices with the tetrahedrons
+		const b3SoftBodyMesh* mesh = &m_cache.mesh;
+		for (u32 i = 0; i < m_renderMesh.vertexCount; ++i)
+		{
+			const b3SoftBodyMeshBinding* binding = m_bindings + i;
+			const b3SoftBodyMeshTetrahedron* t = mesh->tetrahedrons + binding->tetrahedron;
+
+			b3Vec3 p1 = m_body->GetVertexNode(t->v1)->GetPosition();
+			b3Vec3 p2 = m_body->GetVertexNode(t->v2)->GetPosition();
+			b3Vec3 p3 = m_body->GetVertexNode(t->v3)->GetPosition();
+			b3Vec3 p4 = m_body->GetVertexNode(t->v4)->GetPosition();
+
+			m_renderMesh.vertices[i] = binding->weights[0] * p1 + binding->weights[1] * p2 + binding->weights[2] * p3 + binding->weights[3] * p4;
+		}
+
+		for (u32 i = 0; i < m_renderMesh.triangleCount; ++i)
+		{
+			const b3Triangle* t = m_renderMesh.triangles + i;
+
+			b3Vec3 v1 = m_renderMesh.vertices[t->v1];
+			b3Vec3 v2 = m_renderMesh.vertices[t->v2];
+			b3Vec3 v3 = m_renderMesh.vertices[t->v3];
+
+			b3Vec3 n = b3Cross(v2 - v1, v3 - v1);
+			n.Normalize();
+
+			g_draw->DrawTriangle(v1, v2, v3, b3Color_black);
+			g_draw->DrawSolidTriangle(n, v1, v2, v3, b3Color_blue);
+		}
+
+		if (m_bodyDragger->IsDragging())
+		{
+			b3Vec3 pA = m_bodyDragger->GetPointA();
+			b3Vec3 pB = m_bodyDragger->GetPointB();
+
+			g_draw->DrawPoint(pA, 2.0f, b3Color_green);
+
+			g_draw->DrawPoint(pB, 2.0f, b3Color_green);
+
+			g_draw->DrawSegment(pA, pB, b3Color_white);
+		}
+
+		g_draw->DrawString(b3Color_white, "Tetrahedrons = %d", m_cache.mesh.tetrahedronCount);
+
+		extern u32 b3_softBodySolverIterations;
+		g_draw->DrawString(b3Color_white, "Iterations = %d", b3_softBodySolverIterations);
+	}
+
+	void MouseMove(const b3Ray3& pw)
+	{
+		Test::MouseMove(pw);
+	}
+
+	void MouseLeftDown(const b3Ray3& pw)
+	{
+		Test::MouseLeftDown(pw);
+
+		if (m_bodyDragger->IsDragging() == false)
+		{
+			m_bodyDragger->StartDragging();
+		}
+	}
+
+	void MouseLeftUp(const b3Ray3& pw)
+	{
+		Test::MouseLeftUp(pw);
+
+		if (m_bodyDragger->IsDragging() == true)
+		{
+			m_bodyDragger->StopDragging();
+		}
+	}
+
+	static Test* Create()
+	{
+		return new EmbeddedSoftBody();
+	}
+
+	b3Mesh m_renderMesh;
+	b3SoftBodyMeshBinding* m_bindings;
+
+	b3QSoftBodyMesh m_mesh;
+
+	void* m_cacheBuffer;
+	b3SoftBodyCache m_cache;
+
+	b3SoftBody* m_body;
+	b3SoftBodyDragger* m_bodyDragger;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,122 @@
+/*
+* Copyright (c) 2016-2019 Irlan Robson https://irlanrobson.github.io
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef HEIGHT_FIELD_TEST_H
+#define HEIGHT_FIELD_TEST_H
+
+class HeightFieldTest : public Test
+{
+public:
+	enum
+	{
+		e_rowCount = 50,
+		e_columnCount = 50
+	};
+
+	HeightFieldTest()
+	{
+		// Transform grid into a terrain
+		for (u32 i = 0; i <= e_rowCount; ++i)
+		{
+			for (u32 j = 0; j <= e_columnCount; ++j)
+			{
+				float32 x = float32(j) / float32(e_columnCount);
+				float32 z = float32(i) / float32(e_rowCount);
+				
+				m_heights[i * (e_columnCount + 1) + j] = 2.0f * sin(4.0f * x) * cos(3.0f * z) + RandomFloat(0.0f, 0.25f);
+			}
+		}
+
+		m_heightField.rowCount = e_rowCount;
+		m_heightField.columnCount = e_columnCount;
+		m_heightField.heights = m_heights;
+		m_heightField.cellWidth = 1.0f;
+		m_heightField.cellDepth = 1.0f;
+		m_heightField.ComputeBounds();
+
+		{
+			b3BodyDef bd;
+			b3Body* ground = m_world.CreateBody(bd);
+
+			b3HeightFieldShape hs;
+			hs.m_heightField = &m_heightField;
+
+			b3ShapeDef sd;
+			sd.shape = &hs;
+
+			ground->CreateShape(sd);
+		}
+
+		for (u32 i = 0; i < 5; ++i)
+		{
+			for (u32 j = 0; j < 5; ++j)
+			{
+				b3BodyDef bd;
+				bd.type = b3BodyType::e_dynamicBody;
+				bd.position.Set(-10.0f + 5.0f * float32(j), 6.0f, -10.0f + 5.0f * float32(i));
+
+				b3Body* body = m_world.CreateBody(bd);
+
+				b3HullShape hull;
+				hull.m_hull = &b3BoxHull_identity;
+
+				b3SphereShape sphere;
+				sphere.m_center.SetZero();
+				sphere.m_radius = 1.0f;
+
+				b3ShapeDef sd;
+				sd.shape = (i + j) % 2 == 0 ? (b3Shape*)&hull : (b3Shape*)&sphere;
+				sd.density = 1.0f;
+				sd.friction = 0.5f;
+
+				body->CreateShape(sd);
+			}
+		}
+	}
+
+	void Step()
+	{
+		Test::Step();
+
+		// Cast a ray against the terrain.
+		b3Vec3 p1(-20.0f, 10.0f, -15.0f);
+		b3Vec3 p2(20.0f, -10.0f, 15.0f);
+
+		b3RayCastSingleOutput out;
+		if (m_world.RayCastSingle(&out, p1, p2))
+		{
+			g_draw->DrawSegment(p1, out.point, b3Color_green);
+			g_draw->DrawPoint(out.point, 4.0f, b3Color_red);
+			g_draw->DrawSegment(out.point, out.point + out.normal, b3Color_white);
+		}
+		else
+		{
+			g_draw->DrawSegment(p1, p2, b3Color_green);
+		}
+	}
+
+	static Test* Create()
+	{
+		return new HeightFieldTest();
+	}
+
+	float32 m_heights[(e_rowCount + 1) * (e_columnCount + 1)];
+	b3HeightField m_heightField;
+};
+
+#endif
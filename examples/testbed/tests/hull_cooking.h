@@ -0,0 +1,184 @@
+/*
+* Copyright (c) 2016-2019 Irlan Robson https://irlanrobson.github.io
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef HULL_COOKING_H
+#define HULL_COOKING_H
+
+// This test measures the time taken to cook convex hulls 
+// from large point clouds.
+class HullCooking : public Test
+{
+public:
+	enum
+	{
+		e_cloudCount = 3
+	};
+
+	enum Distribution
+	{
+		e_shell,
+		e_sphere,
+		e_cube,
+		e_distributionCount
+	};
+
+	HullCooking()
+	{
+		m_selection = 0;
+		m_distribution = e_shell;
+		
+		Generate();
+	}
+
+	void KeyDown(int button)
+	{
+		if (button == GLFW_KEY_LEFT)
+		{
+			m_selection = m_selection > 0 ? m_selection - 1 : e_cloudCount - 1;
+		}
+
+		if (button == GLFW_KEY_RIGHT)
+		{
+			m_selection = m_selection < e_cloudCount - 1 ? m_selection + 1 : 0;
+		}
+
+		if (button == GLFW_KEY_D)
+		{
+			m_distribution = Distribution((m_distribution + 1) % e_distributionCount);
+			Generate();
+		}
+
+		if (button == GLFW_KEY_G)
+		{
+			Generate();
+		}
+	}
+
+	void Generate()
+	{
+		const u32 kCounts[e_cloudCount] = { 1000, 10000, 100000 };
+
+		b3Vec3* points = (b3Vec3*)b3Alloc(kCounts[e_cloudCount - 1] * sizeof(b3Vec3));
+
+		for (u32 i = 0; i < e_cloudCount; ++i)
+		{
+			u32 count = kCounts[i];
+
+			for (u32 j = 0; j < count; ++j)
+			{
+				b3Vec3 p(RandomFloat(-1.0f, 1.0f), RandomFloat(-1.0f, 1.0f), RandomFloat(-1.0f, 1.0f));
+				
+				switch (m_distribution)
+				{
+				case e_shell:
+				{
+					// Scanned point clouds are dense near the surface.
+					points[j] = RandomFloat(2.8f, 3.0f) * b3Normalize(p);
+					break;
+				}
+				case e_sphere:
+				{
+					// Every point is in the hull.
+					points[j] = 3.0f * b3Normalize(p);
+					break;
+				}
+				default:
+				{
+					points[j] = 3.0f * p;
+					break;
+				}
+				}
+			}
+
+			b3Time time;
+			m_hulls[i].Set(sizeof(b3Vec3), points, count);
+			time.Update();
+
+			m_counts[i] = count;
+			m_times[i] = time.GetElapsedMilis();
+		}
+
+		b3Free(points);
+	}
+
+	void Step()
+	{
+		const b3QHull* hull = m_hulls + m_selection;
+
+		for (u32 i = 0; i < hull->edgeCount; i += 2)
+		{
+			const b3HalfEdge* edge = hull->GetEdge(i);
+			const b3HalfEdge* twin = hull->GetEdge(i + 1);
+
+			b3Vec3 v1 = hull->GetVertex(edge->origin);
+			b3Vec3 v2 = hull->GetVertex(twin->origin);
+
+			g_draw->DrawSegment(v1, v2, b3Color_black);
+		}
+
+		for (u32 i = 0; i < hull->faceCount; ++i)
+		{
+			const b3Face* face = hull->GetFace(i);
+			
+			b3Vec3 n = hull->GetPlane(i).normal;
+
+			const b3HalfEdge* begin = hull->GetEdge(face->edge);
+			const b3HalfEdge* edge = hull->GetEdge(begin->next);
+			do
+			{
+				const b3HalfEdge* next = hull->GetEdge(edge->next);
+
+				b3Vec3 v1 = hull->GetVertex(begin->origin);
+				b3Vec3 v2 = hull->GetVertex(edge->origin);
+				b3Vec3 v3 = hull->GetVertex(next->origin);
+
+				g_draw->DrawSolidTriangle(n, v1, v2, v3, b3Color(1.0f, 1.0f, 1.0f, 0.5f));
+
+				edge = next;
+			} while (hull->GetEdge(edge->next) != begin);
+		}
+
+		g_draw->Flush();
+
+		for (u32 i = 0; i < e_cloudCount; ++i)
+		{
+			g_draw->DrawString(i == m_selection ? b3Color_yellow : b3Color_white, "%d points: %.2f ms (%d vertices, %d faces)", 
+				m_counts[i], m_times[i], m_hulls[i].vertexCount, m_hulls[i].faceCount);
+		}
+
+		const char* kDistributionNames[e_distributionCount] = { "Shell", "Sphere", "Cube" };
+
+		g_draw->DrawString(b3Color_white, "Distribution = %s", kDistributionNames[m_distribution]);
+		g_draw->DrawString(b3Color_white, "D - Next distribution");
+		g_draw->DrawString(b3Color_white, "G - Generate new point clouds");
+		g_draw->DrawString(b3Color_white, "Left/Right Arrow - Select previous/next convex hull");
+	}
+
+	static Test* Create()
+	{
+		return new HullCooking();
+	}
+
+	b3QHull m_hulls[e_cloudCount];
+	u32 m_counts[e_cloudCount];
+	float64 m_times[e_cloudCount];
+	u32 m_selection;
+	Distribution m_distribution;
+};
+
+#endif
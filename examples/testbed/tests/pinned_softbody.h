@@ -37,6 +37,7 @@ public:
 		def.c_yield = 0.1f;
 		def.c_creep = 0.5f;
 		def.c_max = 1.0f;
+		def.reorderMesh = true;
 
 		m_body = new b3SoftBody(def);
 
@@ -58,7 +59,8 @@ public:
 			}
 		}
 
-		b3SoftBodyNode* pinNode = m_body->GetVertexNode(pinIndex);
+		// The nodes are numbered after the reordered mesh.
+		b3SoftBodyNode* pinNode = m_body->GetVertexNode(m_body->GetVertexIndex(pinIndex));
 		pinNode->SetType(e_staticSoftBodyNode);
 
 		b3Vec3 gravity(0.0f, -9.8f, 0.0f);
@@ -0,0 +1,130 @@
+/*
+* Copyright (c) 2016-2019 Irlan Robson https://irlanrobson.github.io
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be hebd liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation woubd be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef ROPE_GROUP_TEST_H
+#define ROPE_GROUP_TEST_H
+
+class RopeGroup : public Test
+{
+public:
+	enum
+	{
+		e_rowCount = 16,
+		e_columnCount = 16,
+		e_ropeCount = e_rowCount * e_columnCount,
+		e_maxLinkCount = 12
+	};
+
+	RopeGroup()
+	{
+		b3Vec3 vs[e_maxLinkCount];
+		float32 ms[e_maxLinkCount];
+
+		for (u32 i = 0; i < e_rowCount; ++i)
+		{
+			for (u32 j = 0; j < e_columnCount; ++j)
+			{
+				u32 index = i * e_columnCount + j;
+
+				// Vary the link counts so the lane groups must be sorted.
+				u32 count = 4 + index % (e_maxLinkCount - 3);
+
+				b3Vec3 base(2.0f * float32(j) - float32(e_columnCount), 10.0f, 2.0f * float32(i) - float32(e_rowCount));
+
+				vs[0] = base;
+				ms[0] = 0.0f;
+
+				for (u32 k = 1; k < count; ++k)
+				{
+					vs[k] = base + b3Vec3(0.5f * float32(k), 0.0f, 0.0f);
+					ms[k] = 1.0f;
+				}
+
+				b3RopeDef rd;
+				rd.gravity.Set(0.0f, -10.0f, 0.0f);
+				rd.masses = ms;
+				rd.vertices = vs;
+				rd.count = count;
+
+				m_ropes[index].Initialize(rd);
+
+				m_group.AddRope(m_ropes + index);
+			}
+		}
+
+		m_grouped = true;
+		m_ropesPerMs = 0.0f;
+	}
+
+	void KeyDown(int button)
+	{
+		if (button == GLFW_KEY_G)
+		{
+			m_grouped = !m_grouped;
+		}
+	}
+
+	void Step()
+	{
+		float32 dt = g_testSettings->inv_hertz;
+
+		b3Time time;
+
+		if (m_grouped)
+		{
+			m_group.Step(dt);
+		}
+		else
+		{
+			for (u32 i = 0; i < e_ropeCount; ++i)
+			{
+				m_ropes[i].Step(dt);
+			}
+		}
+
+		time.Update();
+
+		float32 ms = float32(time.GetElapsedMilis());
+		if (ms > 0.0f)
+		{
+			// Smooth the rate.
+			m_ropesPerMs = 0.9f * m_ropesPerMs + 0.1f * (float32(e_ropeCount) / ms);
+		}
+
+		for (u32 i = 0; i < e_ropeCount; ++i)
+		{
+			m_ropes[i].Draw();
+		}
+
+		g_draw->DrawString(b3Color_white, "G - Toggle Group");
+		g_draw->DrawString(b3Color_white, m_grouped ? "Grouped" : "Single");
+		g_draw->DrawString(b3Color_white, "Ropes per ms = %f", m_ropesPerMs);
+	}
+
+	static Test* Create()
+	{
+		return new RopeGroup();
+	}
+
+	b3Rope m_ropes[e_ropeCount];
+	b3RopeGroup m_group;
+	bool m_grouped;
+	float32 m_ropesPerMs;
+};
+
+#endif
\ No newline at end of file
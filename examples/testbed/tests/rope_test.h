@@ -32,13 +32,13 @@ public:
 		b3Vec3 vs[e_count];
 		float32 ms[e_count];
 		
-		vs[0].Set(0.0f, 0.0f, 0.0f);
+		vs[0].Set(0.0f, 8.0f, 0.0f);
 		ms[0] = 0.0f;
 		
 		for (u32 i = 1; i < e_count; ++i)
 		{
 			ms[i] = 1.0f;
-			vs[i].Set(float32(i), 0.0f, 0.0f);
+			vs[i].Set(float32(i), 8.0f, 0.0f);
 		}
 
 		b3RopeDef rd;
@@ -48,6 +48,43 @@ public:
 		rd.count = e_count;
 
 		m_rope.Initialize(rd);
+		m_rope.SetWorld(&m_world);
+
+		// Create ground
+		{
+			b3BodyDef bd;
+			bd.type = e_staticBody;
+
+			b3Body* b = m_world.CreateBody(bd);
+
+			b3HullShape groundShape;
+			groundShape.m_hull = &m_groundHull;
+
+			b3ShapeDef sd;
+			sd.shape = &groundShape;
+			sd.friction = 0.3f;
+
+			b->CreateShape(sd);
+		}
+
+		// Create an obstacle
+		{
+			b3BodyDef bd;
+			bd.type = e_staticBody;
+			bd.position.Set(3.0f, 3.0f, 0.0f);
+
+			b3Body* b = m_world.CreateBody(bd);
+
+			b3SphereShape sphere;
+			sphere.m_center.SetZero();
+			sphere.m_radius = 1.5f;
+
+			b3ShapeDef sd;
+			sd.shape = &sphere;
+			sd.friction = 0.3f;
+
+			b->CreateShape(sd);
+		}
 	}
 
 	void KeyDown(int button)
@@ -85,6 +122,8 @@ public:
 
 	void Step()
 	{
+		Test::Step();
+
 		m_rope.Step(g_testSettings->inv_hertz);
 		m_rope.Draw();
 	}
@@ -132,6 +132,9 @@ public:
 		extern u32 b3_softBodySolverIterations;
 		g_draw->DrawString(b3Color_white, "Iterations = %d", b3_softBodySolverIterations);
 
+		extern float32 b3_softBodyRotationIterations;
+		g_draw->DrawString(b3Color_white, "Rotation iterations = %f", b3_softBodyRotationIterations);
+
 		float32 E = m_body->GetEnergy();
 		g_draw->DrawString(b3Color_white, "E = %f", E);
 	}
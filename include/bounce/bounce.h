@@ -37,8 +37,10 @@
 #include <bounce/collision/shapes/hull.h>
 #include <bounce/collision/shapes/box_hull.h>
 #include <bounce/collision/shapes/qhull.h>
+#include <bounce/collision/shapes/hull_cooker.h>
 #include <bounce/collision/shapes/mesh.h>
 #include <bounce/collision/shapes/grid_mesh.h>
+#include <bounce/collision/shapes/height_field.h>
 
 #include <bounce/dynamics/joints/mouse_joint.h>
 #include <bounce/dynamics/joints/spring_joint.h>
@@ -51,6 +53,7 @@
 #include <bounce/dynamics/shapes/capsule_shape.h>
 #include <bounce/dynamics/shapes/hull_shape.h>
 #include <bounce/dynamics/shapes/mesh_shape.h>
+#include <bounce/dynamics/shapes/height_field_shape.h>
 
 #include <bounce/dynamics/contacts/contact.h>
 #include <bounce/dynamics/contacts/convex_contact.h>
@@ -62,6 +65,7 @@
 #include <bounce/dynamics/world_listeners.h>
 
 #include <bounce/rope/rope.h>
+#include <bounce/rope/rope_group.h>
 
 #include <bounce/cloth/cloth_mesh.h>
 #include <bounce/cloth/grid_cloth_mesh.h>
@@ -24,19 +24,22 @@
 #include <bounce/common/memory/block_pool.h>
 #include <bounce/common/math/transform.h>
 #include <bounce/cloth/cloth_contact_manager.h>
+#include <bounce/cloth/cloth_force_batch.h>
+#include <bounce/cloth/cloth_solver.h>
+#include <bounce/cloth/cloth_mesh.h>
+#include <bounce/cloth/particle.h>
+#include <bounce/sparse/dense_vec3.h>
+#include <bounce/sparse/csr_mat33.h>
+#include <bounce/sparse/mpcg.h>
 
 class b3World;
-
-struct b3ParticleDef;
-class b3Particle;
+class b3ThreadPool;
 
 struct b3ForceDef;
 class b3Force;
 
 class b3ClothTriangle;
 
-struct b3ClothMesh;
-
 class b3RayCastListener;
 
 struct b3RayCastInput;
@@ -64,6 +67,12 @@ struct b3ClothDef
 		damping = 0.0f;
 		thickness = 0.0f;
 		friction = 0.2f;
+		preconditioner = e_jacobiPreconditioner;
+		solver = e_implicitSolver;
+		positionBasedIterations = 8;
+		allowSleep = true;
+		refitBroadPhase = true;
+		reorderMesh = false;
 	}
 
 	// Cloth mesh 
@@ -92,6 +101,50 @@ struct b3ClothDef
 
 	// Cloth coefficient of friction
 	float32 friction;
+
+	// Preconditioner of the linear solver
+	b3MPCGPreconditioner preconditioner;
+
+	// Integrator of the internal dynamics.
+	// The position based solver is cheaper but less accurate than the implicit solver.
+	// It treats the strech, shear and spring stiffnesses as constraint compliances
+	// and ignores the preconditioner.
+	b3ClothSolverType solver;
+
+	// Number of constraint iterations per step of the position based solver
+	u32 positionBasedIterations;
+
+	// Can the resting regions of this cloth fall asleep?
+	bool allowSleep;
+
+	// If this is true then the particle and triangle AABBs are refitted in the 
+	// broad-phase tree instead of being reinserted when the cloth moves.
+	// The tree is rebuilt when its quality degrades.
+	bool refitBroadPhase;
+
+	// If this is true then the cloth keeps a copy of the mesh with the vertices in
+	// reverse Cuthill-McKee order and the triangles sorted by their vertices.
+	// This reduces the bandwidth of the force Jacobians and improves memory locality.
+	// The particles and the triangles are numbered after the copy.
+	// See b3Cloth::GetVertexIndex and b3Cloth::GetTriangleIndex.
+	// The sub-meshes are reordered independently, so they must partition the mesh.
+	// Otherwise the mesh is copied in its original order.
+	bool reorderMesh;
+};
+
+// A set of particles connected by forces or triangles.
+// A patch falls asleep when all of its particles come to rest.
+// The particles of a sleeping patch are not simulated.
+struct b3ClothPatch
+{
+	// Bounds of the patch particles when the patch fell asleep
+	b3AABB3 aabb;
+
+	// Time the patch has been resting
+	float32 sleepTime;
+
+	// Is this patch awake?
+	bool awake;
 };
 
 // A cloth represents a deformable surface as a collection of particles.
@@ -116,6 +169,27 @@ public:
 	const b3World* GetWorld() const;
 	b3World* GetWorld();
 
+	// Set the threads used by the linear solver. 
+	// The results are the same for any number of threads.
+	// If this is null then the solver runs on the calling thread.
+	void SetThreadPool(b3ThreadPool* threadPool);
+
+	// Get the threads used by the linear solver.
+	b3ThreadPool* GetThreadPool() const;
+
+	// Enable or disable sleeping for this cloth.
+	// If sleeping is disabled then the cloth is woken up.
+	void SetSleepingAllowed(bool flag);
+
+	// Can this cloth fall asleep?
+	bool IsSleepingAllowed() const;
+
+	// Wake up or put to sleep all the particles of this cloth.
+	void SetAwake(bool flag);
+
+	// Is any part of this cloth awake?
+	bool IsAwake() const;
+
 	// Create a particle.
 	b3Particle* CreateParticle(const b3ParticleDef& def);
 
@@ -135,8 +209,21 @@ public:
 	bool RayCast(b3RayCastOutput* output, const b3RayCastInput* input, u32 triangleIndex) const;
 
 	// Return the cloth mesh proxy.
+	// This is a reordered copy of the definition mesh if the mesh was reordered.
 	const b3ClothMesh* GetMesh() const;
 
+	// Return the index in the cloth mesh of a given vertex of the definition mesh.
+	u32 GetVertexIndex(u32 originalIndex) const;
+
+	// Return the index in the definition mesh of a given vertex of the cloth mesh.
+	u32 GetOriginalVertexIndex(u32 index) const;
+
+	// Return the index in the cloth mesh of a given triangle of the definition mesh.
+	u32 GetTriangleIndex(u32 originalIndex) const;
+
+	// Return the index in the definition mesh of a given triangle of the cloth mesh.
+	u32 GetOriginalTriangleIndex(u32 index) const;
+
 	// Return the cloth particle given the vertex index.
 	b3Particle* GetParticle(u32 i);
 
@@ -166,12 +253,49 @@ private:
 	friend class b3MouseForce;
 	friend class b3ClothContactManager;
 
+	// Set the number of particle states.
+	// The state arrays grow geometrically and never shrink.
+	// The state of the first particles is preserved.
+	void ResizeParticleState(u32 count);
+
+	// Copy a given mesh into the reordered mesh and build the index maps.
+	void ReorderMesh(const b3ClothMesh* mesh);
+
 	// Compute mass of each particle.
 	void ComputeMass();
 
+	// Build the sparsity pattern of the force Jacobians from the forces.
+	// The particles must have been added to the solver.
+	// This also rebuilds the patches and wakes them up.
+	void BuildJacobianPattern();
+
+	// Find the patches of the particles.
+	void BuildPatches();
+
+	// Wake up the patch containing a given particle.
+	void WakeParticle(u32 solverId);
+
+	// Is the patch containing a given particle awake?
+	bool IsParticleAwake(u32 solverId) const;
+
+	// Wake up a given patch.
+	void WakePatch(u32 patch);
+
+	// Wake up the sleeping patches touched by awake bodies or awake patches.
+	void WakePatches();
+
+	// Update the sleep timers of the awake patches and put the resting ones to sleep.
+	void UpdateSleep(float32 dt);
+
+	// Stop the particles of the patches that fell asleep and compute the patch bounds.
+	void PutToSleep(const bool* fellAsleep);
+
 	// Solve
 	void Solve(float32 dt, const b3Vec3& gravity, u32 velocityIterations, u32 positionIterations);
 
+	// Synchronize the particles and triangles of the awake patches.
+	void Synchronize(float32 dt);
+
 	// Stack allocator
 	b3StackAllocator m_stackAllocator;
 
@@ -183,6 +307,17 @@ private:
 
 	// Proxy mesh
 	const b3ClothMesh* m_mesh;
+
+	// Reordered copy of the definition mesh.
+	// The proxy mesh points to this if the mesh was reordered.
+	b3ClothMesh m_orderedMesh;
+
+	// Vertex and triangle index maps between the definition mesh and the proxy mesh.
+	// These are null if the mesh wasn't reordered.
+	u32* m_vertexIndices;
+	u32* m_originalVertices;
+	u32* m_triangleIndices;
+	u32* m_originalTriangles;
 	
 	// Particles
 	b3Particle** m_particles;
@@ -199,11 +334,61 @@ private:
 	// List of particles
 	b3List2<b3Particle> m_particleList;
 
+	// Particle state.
+	// A particle owns the entries at its solver index.
+	// The mesh particles are created first and never destroyed.
+	// Therefore the state of the mesh vertex i is at index i.
+	b3DenseVec3 m_positions;
+	b3DenseVec3 m_velocities;
+	b3DenseVec3 m_externalForces;
+	b3DenseVec3 m_translations;
+	b3DenseVec3 m_solutions;
+	float32* m_masses;
+	float32* m_invMasses;
+	b3ParticleType* m_types;
+
+	// Number of particle states the arrays can hold
+	u32 m_particleCapacity;
+
+	// Particle of each solver index
+	b3Particle** m_solverParticles;
+
 	// List of forces
 	b3List2<b3Force> m_forceList;
 
 	// Contact manager
 	b3ClothContactManager m_contactManager;
+
+	// Sparsity pattern of the force Jacobians.
+	// This must be rebuilt when a particle or a force is created or destroyed.
+	b3SparsePattern m_jacobianPattern;
+	bool m_jacobianPatternDirty;
+
+	// Force Jacobians
+	b3CSRMat33 m_dfdx;
+	b3CSRMat33 m_dfdv;
+
+	// Batched forces. 
+	// These are rebuilt with the Jacobian pattern.
+	b3ClothForceBatch m_forceBatch;
+
+	// Solver memory
+	b3MPCGWorkspace m_solverWorkspace;
+
+	// Integrator of the internal dynamics
+	b3ClothSolverType m_solverType;
+	u32 m_positionBasedIterations;
+
+	// Patches. These are rebuilt with the Jacobian pattern.
+	u32 m_patchCount;
+	u32 m_awakePatchCount;
+	b3ClothPatch* m_patches;
+
+	// Patch of each particle given the solver index
+	u32* m_particlePatches;
+
+	// Can this cloth fall asleep?
+	bool m_allowSleep;
 };
 
 inline void b3Cloth::SetGravity(const b3Vec3& gravity)
@@ -226,11 +411,85 @@ inline b3World* b3Cloth::GetWorld()
 	return m_world;
 }
 
+inline void b3Cloth::SetThreadPool(b3ThreadPool* threadPool)
+{
+	m_solverWorkspace.threadPool = threadPool;
+}
+
+inline b3ThreadPool* b3Cloth::GetThreadPool() const
+{
+	return m_solverWorkspace.threadPool;
+}
+
+inline bool b3Cloth::IsSleepingAllowed() const
+{
+	return m_allowSleep;
+}
+
+inline bool b3Cloth::IsAwake() const
+{
+	return m_jacobianPatternDirty || m_awakePatchCount > 0;
+}
+
+inline bool b3Cloth::IsParticleAwake(u32 solverId) const
+{
+	if (m_jacobianPatternDirty)
+	{
+		return true;
+	}
+	return m_patches[m_particlePatches[solverId]].awake;
+}
+
+inline void b3Cloth::WakePatch(u32 patch)
+{
+	b3ClothPatch* p = m_patches + patch;
+	p->sleepTime = 0.0f;
+	if (p->awake == false)
+	{
+		p->awake = true;
+		++m_awakePatchCount;
+	}
+}
+
+inline void b3Cloth::WakeParticle(u32 solverId)
+{
+	// The patches are rebuilt awake.
+	if (m_jacobianPatternDirty)
+	{
+		return;
+	}
+	WakePatch(m_particlePatches[solverId]);
+}
+
 inline const b3ClothMesh* b3Cloth::GetMesh() const
 {
 	return m_mesh;
 }
 
+inline u32 b3Cloth::GetVertexIndex(u32 originalIndex) const
+{
+	B3_ASSERT(originalIndex < m_mesh->vertexCount);
+	return m_vertexIndices ? m_vertexIndices[originalIndex] : originalIndex;
+}
+
+inline u32 b3Cloth::GetOriginalVertexIndex(u32 index) const
+{
+	B3_ASSERT(index < m_mesh->vertexCount);
+	return m_originalVertices ? m_originalVertices[index] : index;
+}
+
+inline u32 b3Cloth::GetTriangleIndex(u32 originalIndex) const
+{
+	B3_ASSERT(originalIndex < m_mesh->triangleCount);
+	return m_triangleIndices ? m_triangleIndices[originalIndex] : originalIndex;
+}
+
+inline u32 b3Cloth::GetOriginalTriangleIndex(u32 index) const
+{
+	B3_ASSERT(index < m_mesh->triangleCount);
+	return m_originalTriangles ? m_originalTriangles[index] : index;
+}
+
 inline const b3List2<b3Particle>& b3Cloth::GetParticleList() const
 {
 	return m_particleList;
@@ -241,4 +500,66 @@ inline const b3List2<b3Force>& b3Cloth::GetForceList() const
 	return m_forceList;
 }
 
+// The particle state accessors are defined here because they read the cloth arrays.
+
+inline b3ParticleType b3Particle::GetType() const
+{
+	return m_cloth->m_types[m_solverId];
+}
+
+inline void b3Particle::SetPosition(const b3Vec3& position)
+{
+	b3Vec3& x = m_cloth->m_positions[m_solverId];
+
+	b3Vec3 displacement = position - x;
+
+	x = position;
+	m_cloth->m_translations[m_solverId].SetZero();
+	m_cloth->WakeParticle(m_solverId);
+
+	Synchronize(displacement);
+	SynchronizeTriangles();
+}
+
+inline const b3Vec3& b3Particle::GetPosition() const
+{
+	return m_cloth->m_positions[m_solverId];
+}
+
+inline void b3Particle::SetVelocity(const b3Vec3& velocity)
+{
+	if (m_cloth->m_types[m_solverId] == e_staticParticle)
+	{
+		return;
+	}
+	m_cloth->m_velocities[m_solverId] = velocity;
+	m_cloth->WakeParticle(m_solverId);
+}
+
+inline const b3Vec3& b3Particle::GetVelocity() const
+{
+	return m_cloth->m_velocities[m_solverId];
+}
+
+inline float32 b3Particle::GetMass() const
+{
+	return m_cloth->m_masses[m_solverId];
+}
+
+inline void b3Particle::ApplyForce(const b3Vec3& force)
+{
+	if (m_cloth->m_types[m_solverId] != e_dynamicParticle)
+	{
+		return;
+	}
+	m_cloth->m_externalForces[m_solverId] += force;
+	m_cloth->WakeParticle(m_solverId);
+}
+
+inline void b3Particle::ApplyTranslation(const b3Vec3& translation)
+{
+	m_cloth->m_translations[m_solverId] += translation;
+	m_cloth->WakeParticle(m_solverId);
+}
+
 #endif
\ No newline at end of file
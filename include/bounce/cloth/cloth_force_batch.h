@@ -0,0 +1,172 @@
+/*
+* Copyright (c) 2016-2019 Irlan Robson https://irlanrobson.github.io
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+#ifndef B3_CLOTH_FORCE_BATCH_H
+#define B3_CLOTH_FORCE_BATCH_H
+
+#include <bounce/cloth/forces/force.h>
+
+class b3ThreadPool;
+
+struct b3SparsePattern;
+struct b3ClothForceSolverData;
+struct b3ClothPositionSolverData;
+
+// The maximum number of forces applied by a task.
+const u32 b3_forceBatchTaskSize = 64;
+
+// Strech or shear forces stored as a structure of arrays.
+struct b3TriangleForceBatch
+{
+	u32 count;
+	b3Force** forces;
+
+	// Solver indices of the triangle vertices
+	u32* v1;
+	u32* v2;
+	u32* v3;
+
+	// Indices of the 3x3 Jacobian blocks in the CSR matrices.
+	// There are 9 blocks per force stored in row-major order.
+	u32* blocks;
+
+	// Triangle rest state
+	float32* alpha;
+	float32* du1;
+	float32* dv1;
+	float32* du2;
+	float32* dv2;
+	float32* inv_det;
+
+	// Streching or shearing stiffness
+	float32* ks;
+
+	// Damping stiffness
+	float32* kd;
+
+	// Desired strechiness. These are only used by strech forces.
+	float32* bu;
+	float32* bv;
+
+	// Accumulated constraint multipliers of the position based solver.
+	// A strech force has one constraint per direction, a shear force has one constraint.
+	float32* lambda1;
+	float32* lambda2;
+
+	// Forces of the same color don't share particles.
+	// The forces of color i are in the range [colorOffsets[i], colorOffsets[i + 1]).
+	u32 colorCount;
+	u32* colorOffsets;
+};
+
+// Spring forces stored as a structure of arrays.
+struct b3SpringForceBatch
+{
+	u32 count;
+	b3Force** forces;
+
+	// Solver indices of the particles
+	u32* v1;
+	u32* v2;
+
+	// Indices of the 3x3 Jacobian blocks in the CSR matrices.
+	// There are 4 blocks per force stored in row-major order.
+	u32* blocks;
+
+	// Rest length
+	float32* L0;
+
+	// Streching stiffness
+	float32* ks;
+
+	// Damping stiffness
+	float32* kd;
+
+	// Accumulated constraint multipliers of the position based solver.
+	float32* lambda;
+
+	// See b3TriangleForceBatch.
+	u32 colorCount;
+	u32* colorOffsets;
+};
+
+// The strech, shear and spring forces of a cloth grouped by type.
+// The forces are applied by type and color. Forces of the same color
+// are applied in parallel without synchronization. 
+// The position based solver projects the same forces as constraints in the same order.
+// The results don't depend on the number of threads.
+class b3ClothForceBatch
+{
+public:
+	b3ClothForceBatch();
+	~b3ClothForceBatch();
+
+	// Create the batches from a list of forces.
+	// The particle solver indices and the Jacobian pattern must be up to date.
+	void Create(const b3List2<b3Force>& forces, u32 particleCount, const b3SparsePattern* pattern);
+
+	// Destroy the batches.
+	void Destroy();
+
+	// Apply the batched forces. 
+	// The forces are accumulated into the solver data.
+	// The thread pool can be null.
+	void Apply(const b3ClothForceSolverData* data, b3ThreadPool* threadPool) const;
+
+	// Clear the accumulated constraint multipliers.
+	void ResetMultipliers();
+
+	// Project the predicted positions onto the batched forces treated as compliant constraints.
+	// This performs one Gauss-Seidel iteration over the colors.
+	// The action forces of the forces are updated from the multipliers.
+	// The thread pool can be null.
+	void Project(const b3ClothPositionSolverData* data, b3ThreadPool* threadPool);
+
+	// Return true if forces of a given type are applied by this class.
+	static bool IsBatched(b3ForceType type);
+private:
+	static u32 GatherForces(b3Force** out, u32* particles, u32** colorOffsets, 
+		b3ForceType type, u32 particlesPerForce, u32 count, const b3List2<b3Force>& forces, u32 particleCount);
+
+	static void CreateBatch(b3TriangleForceBatch* batch, b3ForceType type, 
+		const b3List2<b3Force>& forces, u32 particleCount, const b3SparsePattern* pattern);
+	static void CreateBatch(b3SpringForceBatch* batch, 
+		const b3List2<b3Force>& forces, u32 particleCount, const b3SparsePattern* pattern);
+
+	// Apply the forces in the range [begin, end) of a batch.
+	static void ApplyStrechForces(const b3TriangleForceBatch* batch, const b3ClothForceSolverData* data, u32 begin, u32 end);
+	static void ApplyShearForces(const b3TriangleForceBatch* batch, const b3ClothForceSolverData* data, u32 begin, u32 end);
+	static void ApplySpringForces(const b3SpringForceBatch* batch, const b3ClothForceSolverData* data, u32 begin, u32 end);
+
+	// Project the constraints in the range [begin, end) of a batch.
+	static void ProjectStrechConstraints(b3TriangleForceBatch* batch, const b3ClothPositionSolverData* data, u32 begin, u32 end);
+	static void ProjectShearConstraints(b3TriangleForceBatch* batch, const b3ClothPositionSolverData* data, u32 begin, u32 end);
+	static void ProjectSpringConstraints(b3SpringForceBatch* batch, const b3ClothPositionSolverData* data, u32 begin, u32 end);
+
+	b3TriangleForceBatch m_strechBatch;
+	b3TriangleForceBatch m_shearBatch;
+	b3SpringForceBatch m_springBatch;
+};
+
+inline bool b3ClothForceBatch::IsBatched(b3ForceType type)
+{
+	return type == e_strechForce || type == e_shearForce || type == e_springForce;
+}
+
+#endif
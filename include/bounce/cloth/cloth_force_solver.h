@@ -21,24 +21,35 @@
 
 #include <bounce/common/math/mat22.h>
 #include <bounce/common/math/mat33.h>
+#include <bounce/cloth/particle.h>
 
 class b3StackAllocator;
 
-class b3Particle;
 class b3Force;
 
 struct b3DenseVec3;
 struct b3DiagMat33;
-struct b3SparseMat33;
-struct b3SparseMat33View;
+struct b3CSRMat33;
+class b3ClothForceBatch;
+struct b3MPCGWorkspace;
 
 struct b3ClothForceSolverDef
 {
 	b3StackAllocator* stack;
 	u32 particleCount;
-	b3Particle** particles;
+	b3DenseVec3* positions;
+	b3DenseVec3* velocities;
+	b3DenseVec3* externalForces;
+	b3DenseVec3* translations;
+	b3DenseVec3* solutions;
+	const float32* masses;
+	const b3ParticleType* types;
 	u32 forceCount;
 	b3Force** forces;
+	b3CSRMat33* dfdx;
+	b3CSRMat33* dfdv;
+	b3ClothForceBatch* forceBatch;
+	b3MPCGWorkspace* workspace;
 };
 
 struct b3ClothForceSolverData
@@ -47,8 +58,8 @@ struct b3ClothForceSolverData
 	b3DenseVec3* v;
 	b3DenseVec3* f;
 	b3DenseVec3* y;
-	b3SparseMat33* dfdx;
-	b3SparseMat33* dfdv;
+	b3CSRMat33* dfdx;
+	b3CSRMat33* dfdv;
 	b3DiagMat33* S;
 	b3DenseVec3* z;
 };
@@ -66,11 +77,24 @@ private:
 	b3StackAllocator* m_allocator;
 
 	u32 m_particleCount;
-	b3Particle** m_particles;
+	b3DenseVec3* m_positions;
+	b3DenseVec3* m_velocities;
+	b3DenseVec3* m_externalForces;
+	b3DenseVec3* m_translations;
+	b3DenseVec3* m_solutions;
+	const float32* m_masses;
+	const b3ParticleType* m_types;
 
 	u32 m_forceCount;
 	b3Force** m_forces;
 
+	b3CSRMat33* m_dfdx;
+	b3CSRMat33* m_dfdv;
+
+	b3ClothForceBatch* m_forceBatch;
+
+	b3MPCGWorkspace* m_workspace;
+
 	b3ClothForceSolverData m_solverData;
 };
 
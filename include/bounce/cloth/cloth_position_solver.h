@@ -0,0 +1,129 @@
+/*
+* Copyright (c) 2016-2019 Irlan Robson https://irlanrobson.github.io
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+#ifndef B3_CLOTH_POSITION_SOLVER_H
+#define B3_CLOTH_POSITION_SOLVER_H
+
+#include <bounce/common/math/mat33.h>
+#include <bounce/cloth/particle.h>
+
+class b3StackAllocator;
+class b3ThreadPool;
+
+class b3Force;
+
+struct b3DenseVec3;
+class b3ClothForceBatch;
+
+struct b3MPCGWorkspace;
+
+struct b3ClothPositionSolverDef
+{
+	b3StackAllocator* stack;
+	u32 particleCount;
+	b3DenseVec3* positions;
+	b3DenseVec3* velocities;
+	b3DenseVec3* externalForces;
+	b3DenseVec3* translations;
+	const float32* invMasses;
+	const b3ParticleType* types;
+	u32 forceCount;
+	b3Force** forces;
+	b3ClothForceBatch* forceBatch;
+	b3MPCGWorkspace* workspace;
+	b3ThreadPool* threadPool;
+	u32 iterations;
+};
+
+struct b3ClothPositionSolverData
+{
+	// Predicted positions
+	b3DenseVec3* x;
+	
+	// Positions at the beginning of the step
+	const b3DenseVec3* x0;
+	
+	// Inverse masses. These are zero for non-dynamic particles.
+	const float32* invMasses;
+	
+	// Time step
+	float32 h;
+};
+
+// Compute the multiplier increment of a compliant constraint with compliance 1 / ks
+// and damping kd, where 
+// C is the constraint value,
+// dCdt0 is the dot product of the constraint gradient with the displacements since the beginning of the step,
+// invMass is the dot product of the constraint gradient with its product by the inverse mass matrix, and
+// lambda is the accumulated multiplier.
+// See "XPBD: Position-Based Simulation of Compliant Constrained Dynamics - Macklin, Muller, Chentanez".
+inline float32 b3ComputeMultiplierIncrement(float32 C, float32 dCdt0, float32 invMass, float32 lambda,
+	float32 ks, float32 kd, float32 h)
+{
+	B3_ASSERT(ks > 0.0f);
+
+	float32 alpha = 1.0f / (ks * h * h);
+	float32 gamma = kd / (ks * h);
+
+	float32 den = (1.0f + gamma) * invMass + alpha;
+	if (den == 0.0f)
+	{
+		return 0.0f;
+	}
+
+	return -(C + alpha * lambda + gamma * dCdt0) / den;
+}
+
+// This solver integrates the internal dynamics using Extended Position Based Dynamics (XPBD).
+// The forces are treated as compliant constraints with compliance equal to the inverse stiffness.
+// It replaces b3ClothForceSolver when a cloth is created with the position based solver.
+// On output the positions are the ones at the beginning of the step and the velocities 
+// are the ones that move the particles to the projected positions.
+// Therefore the contact solver runs after this solver in the same way as after b3ClothForceSolver.
+class b3ClothPositionSolver
+{
+public:
+	b3ClothPositionSolver(const b3ClothPositionSolverDef& def);
+	~b3ClothPositionSolver();
+
+	void Solve(float32 dt, const b3Vec3& gravity);
+private:
+	b3StackAllocator* m_allocator;
+
+	u32 m_particleCount;
+	b3DenseVec3* m_positions;
+	b3DenseVec3* m_velocities;
+	b3DenseVec3* m_externalForces;
+	b3DenseVec3* m_translations;
+	const float32* m_invMasses;
+	const b3ParticleType* m_types;
+
+	u32 m_forceCount;
+	b3Force** m_forces;
+
+	b3ClothForceBatch* m_forceBatch;
+
+	b3MPCGWorkspace* m_workspace;
+
+	b3ThreadPool* m_threadPool;
+
+	u32 m_iterations;
+};
+
+#endif
@@ -21,21 +21,50 @@
 
 #include <bounce/common/math/mat22.h>
 #include <bounce/common/math/mat33.h>
+#include <bounce/cloth/particle.h>
 
 class b3StackAllocator;
 
-class b3Particle;
 class b3Force;
 class b3ParticleBodyContact;
 class b3ParticleTriangleContact;
 
+struct b3DenseVec3;
+struct b3CSRMat33;
+class b3ClothForceBatch;
+struct b3MPCGWorkspace;
+
+// The integrator of the internal cloth dynamics.
+enum b3ClothSolverType
+{
+	// Implicit Euler solved with MPCG. See b3ClothForceSolver.
+	e_implicitSolver,
+	
+	// Extended Position Based Dynamics. See b3ClothPositionSolver.
+	e_positionBasedSolver
+};
+
 struct b3ClothSolverDef
 {
+	b3ClothSolverType type;
+	u32 positionBasedIterations;
 	b3StackAllocator* stack;
-	u32 particleCapacity;
+	u32 particleCount;
+	b3DenseVec3* positions;
+	b3DenseVec3* velocities;
+	b3DenseVec3* externalForces;
+	b3DenseVec3* translations;
+	b3DenseVec3* solutions;
+	const float32* masses;
+	const float32* invMasses;
+	const b3ParticleType* types;
 	u32 forceCapacity;
 	u32 bodyContactCapacity;
 	u32 triangleContactCapacity;
+	b3CSRMat33* dfdx;
+	b3CSRMat33* dfdv;
+	b3ClothForceBatch* forceBatch;
+	b3MPCGWorkspace* workspace;
 };
 
 class b3ClothSolver
@@ -44,7 +73,6 @@ public:
 	b3ClothSolver(const b3ClothSolverDef& def);
 	~b3ClothSolver();
 	
-	void Add(b3Particle* p);
 	void Add(b3Force* f);
 	void Add(b3ParticleBodyContact* c);
 	void Add(b3ParticleTriangleContact* c);
@@ -53,9 +81,23 @@ public:
 private:
 	b3StackAllocator* m_allocator;
 
-	u32 m_particleCapacity;
+	b3ClothSolverType m_type;
+	u32 m_positionBasedIterations;
+
+	b3CSRMat33* m_dfdx;
+	b3CSRMat33* m_dfdv;
+	b3ClothForceBatch* m_forceBatch;
+	b3MPCGWorkspace* m_workspace;
+
 	u32 m_particleCount;
-	b3Particle** m_particles;
+	b3DenseVec3* m_positions;
+	b3DenseVec3* m_velocities;
+	b3DenseVec3* m_externalForces;
+	b3DenseVec3* m_translations;
+	b3DenseVec3* m_solutions;
+	const float32* m_masses;
+	const float32* m_invMasses;
+	const b3ParticleType* m_types;
 
 	u32 m_forceCapacity;
 	u32 m_forceCount;
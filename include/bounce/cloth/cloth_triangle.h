@@ -46,6 +46,7 @@ private:
 	friend class b3ShearForce;
 	friend class b3StrechForce;
 	friend class b3MouseForce;
+	friend class b3ClothForceBatch;
 	friend class b3ClothContactManager;
 	friend class b3ParticleTriangleContact;
 	friend class b3ClothSolver;
@@ -21,6 +21,7 @@
 
 #include <bounce/common/math/mat22.h>
 #include <bounce/common/math/mat33.h>
+#include <bounce/cloth/particle.h>
 
 class b3StackAllocator;
 
@@ -130,6 +131,8 @@ struct b3ClothContactSolverDef
 	
 	b3Vec3* positions;
 	b3Vec3* velocities;
+	const float32* invMasses;
+	const b3ParticleType* types;
 	
 	u32 bodyContactCount;
 	b3ParticleBodyContact** bodyContacts;
@@ -167,6 +170,8 @@ protected:
 
 	b3Vec3* m_positions;
 	b3Vec3* m_velocities;
+	const float32* m_invMasses;
+	const b3ParticleType* m_types;
 
 	u32 m_bodyContactCount;
 	b3ParticleBodyContact** m_bodyContacts;
@@ -26,6 +26,18 @@
 
 class b3Particle;
 class b3Shape;
+class b3ParticleBodyContact;
+
+// A contact edge for the particle-body contact graph, 
+// where a particle is a vertex and a contact an edge.
+struct b3ParticleBodyContactEdge
+{
+	b3Shape* other;
+	b3ParticleBodyContact* contact;
+	// Links to the particle contact edge list.
+	b3ParticleBodyContactEdge* m_prev;
+	b3ParticleBodyContactEdge* m_next;
+};
 
 // A contact between a particle and a body
 class b3ParticleBodyContact
@@ -48,6 +60,9 @@ private:
 	b3Particle* m_p1;
 	b3Shape* m_s2;
 
+	// To the particle edge list.
+	b3ParticleBodyContactEdge m_edge1;
+
 	bool m_active;
 	
 	// Contact constraint
@@ -23,6 +23,18 @@
 
 class b3Particle;
 class b3ClothTriangle;
+class b3ParticleTriangleContact;
+
+// A contact edge for the particle-triangle contact graph, 
+// where a particle is a vertex and a contact an edge.
+struct b3ParticleTriangleContactEdge
+{
+	b3ClothTriangle* other;
+	b3ParticleTriangleContact* contact;
+	// Links to the particle contact edge list.
+	b3ParticleTriangleContactEdge* m_prev;
+	b3ParticleTriangleContactEdge* m_next;
+};
 
 // Contact between particle and a triangle
 class b3ParticleTriangleContact
@@ -50,6 +62,9 @@ private:
 	b3Particle* m_p3;
 	b3Particle* m_p4;
 
+	// To the particle edge list.
+	b3ParticleTriangleContactEdge m_edge1;
+
 	float32 m_w2, m_w3, m_w4;
 
 	float32 m_normalImpulse;
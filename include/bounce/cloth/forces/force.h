@@ -23,9 +23,13 @@
 #include <bounce/common/template/list.h>
 
 struct b3ClothForceSolverData;
+struct b3ClothPositionSolverData;
 
 class b3Particle;
 
+// The maximum number of particles a force can act on.
+const u32 b3_maxForceParticles = 4;
+
 // Force types
 enum b3ForceType
 {
@@ -56,6 +60,8 @@ protected:
 	friend class b3List2<b3Force>;
 	friend class b3Cloth;
 	friend class b3ClothForceSolver;
+	friend class b3ClothPositionSolver;
+	friend class b3ClothForceBatch;
 	friend class b3Particle;
 
 	static b3Force* Create(const b3ForceDef* def);
@@ -64,7 +70,28 @@ protected:
 	b3Force() { }
 	virtual ~b3Force() { }
 
-	virtual void Apply(const b3ClothForceSolverData* data) = 0;
+	// Get the particles this force acts on and return the number of particles.
+	// This is used to compute the sparsity pattern of the force Jacobians.
+	virtual u32 GetParticles(b3Particle** particles) const = 0;
+
+	// Apply this force.
+	// The strech, shear and spring forces are applied by b3ClothForceBatch instead.
+	virtual void Apply(const b3ClothForceSolverData* data) 
+	{
+		B3_NOT_USED(data);
+		B3_ASSERT(false);
+	}
+
+	// Clear the accumulated constraint multipliers of this force.
+	virtual void ResetMultipliers() { }
+
+	// Project the predicted positions onto this force treated as a compliant constraint.
+	// The strech, shear and spring forces are projected by b3ClothForceBatch instead.
+	virtual void Project(const b3ClothPositionSolverData* data)
+	{
+		B3_NOT_USED(data);
+		B3_ASSERT(false);
+	}
 
 	// Force type
 	b3ForceType m_type;
@@ -74,8 +74,14 @@ private:
 	b3MouseForce(const b3MouseForceDef* def);
 	~b3MouseForce();
 
+	u32 GetParticles(b3Particle** particles) const;
+
 	void Apply(const b3ClothForceSolverData* data);
 
+	void ResetMultipliers();
+
+	void Project(const b3ClothPositionSolverData* data);
+
 	// Solver shared
 
 	// Particle
@@ -95,6 +101,9 @@ private:
 
 	// Action forces
 	b3Vec3 m_f1, m_f2, m_f3, m_f4;
+
+	// Accumulated constraint multiplier of the position based solver
+	float32 m_lambda;
 };
 
 inline b3Particle* b3MouseForce::GetParticle() const
@@ -60,11 +60,12 @@ public:
 private:
 	friend class b3Force;
 	friend class b3Cloth;
+	friend class b3ClothForceBatch;
 
 	b3ShearForce(const b3ShearForceDef* def);
 	~b3ShearForce();
 
-	void Apply(const b3ClothForceSolverData* data);
+	u32 GetParticles(b3Particle** particles) const;
 
 	// Solver shared
 
@@ -72,11 +72,12 @@ public:
 private:
 	friend class b3Force;
 	friend class b3Cloth;
+	friend class b3ClothForceBatch;
 
 	b3SpringForce(const b3SpringForceDef* def);
 	~b3SpringForce();
 
-	void Apply(const b3ClothForceSolverData* data);
+	u32 GetParticles(b3Particle** particles) const;
 
 	// Solver shared
 
@@ -134,4 +135,11 @@ inline bool b3SpringForce::HasParticle(const b3Particle* particle) const
 	return m_p1 == particle || m_p2 == particle;
 }
 
+inline u32 b3SpringForce::GetParticles(b3Particle** particles) const
+{
+	particles[0] = m_p1;
+	particles[1] = m_p2;
+	return 2;
+}
+
 #endif
\ No newline at end of file
@@ -66,11 +66,12 @@ public:
 private:
 	friend class b3Force;
 	friend class b3Cloth;
+	friend class b3ClothForceBatch;
 
 	b3StrechForce(const b3StrechForceDef* def);
 	~b3StrechForce();
 
-	void Apply(const b3ClothForceSolverData* data);
+	u32 GetParticles(b3Particle** particles) const;
 
 	// Solver shared
 
@@ -24,6 +24,9 @@
 
 class b3Cloth;
 
+struct b3ParticleTriangleContactEdge;
+struct b3ParticleBodyContactEdge;
+
 // Static particle: Can be moved manually.
 // Kinematic particle: Non-zero velocity, can be moved by the solver.
 // Dynamic particle: Non-zero velocity determined by force, can be moved by the solver.
@@ -60,6 +63,9 @@ struct b3ParticleDef
 };
 
 // A cloth particle.
+// The particle state is stored in arrays owned by the cloth. 
+// A particle is a handle to its entries in these arrays.
+// The state accessors are defined in cloth.h.
 class b3Particle
 {
 public:
@@ -78,12 +84,14 @@ public:
 	void SetPosition(const b3Vec3& position);
 
 	// Get the particle position.
+	// The reference is invalidated when a particle is created or destroyed.
 	const b3Vec3& GetPosition() const;
 
 	// Set the particle velocity.
 	void SetVelocity(const b3Vec3& velocity);
 
 	// Get the particle velocity.
+	// The reference is invalidated when a particle is created or destroyed.
 	const b3Vec3& GetVelocity() const;
 
 	// Get the particle mass.
@@ -107,6 +115,12 @@ public:
 	// Apply a translation.
 	void ApplyTranslation(const b3Vec3& translation);
 
+	// Is the cloth region containing this particle awake?
+	bool IsAwake() const;
+
+	// Wake up the cloth region containing this particle.
+	void SetAwake();
+
 	// Get the next particle.
 	b3Particle* GetNext();
 private:
@@ -115,6 +129,7 @@ private:
 	friend class b3ClothContactManager;
 	friend class b3ClothSolver;
 	friend class b3ClothForceSolver;
+	friend class b3ClothForceBatch;
 	friend class b3ClothTriangle;
 	friend class b3ParticleBodyContact;
 	friend class b3ParticleTriangleContact;
@@ -125,7 +140,7 @@ private:
 	friend class b3SpringForce;
 	friend class b3MouseForce;
 
-	b3Particle(const b3ParticleDef& def, b3Cloth* cloth);
+	b3Particle(const b3ParticleDef& def, b3Cloth* cloth, u32 solverId);
 	~b3Particle();
 
 	// Synchronize particle AABB
@@ -137,27 +152,6 @@ private:
 	// Destroy contacts.
 	void DestroyContacts();
 
-	// Type
-	b3ParticleType m_type;
-
-	// Position
-	b3Vec3 m_position;
-
-	// Velocity
-	b3Vec3 m_velocity;
-
-	// Applied external force
-	b3Vec3 m_force;
-
-	// Applied translation
-	b3Vec3 m_translation;
-
-	// Mass
-	float32 m_mass;
-
-	// Inverse mass
-	float32 m_invMass;
-
 	// Radius
 	float32 m_radius;
 
@@ -170,14 +164,10 @@ private:
 	// Cloth mesh vertex index.
 	u32 m_vertex;
 
-	// Solver temp
-
-	// Identifier
+	// Index of the particle state in the cloth arrays. 
+	// This is also the particle index in the solver.
 	u32 m_solverId;
 
-	// Solution
-	b3Vec3 m_x;
-
 	// Parent cloth
 	b3Cloth* m_cloth;
 
@@ -187,56 +177,20 @@ private:
 	// Broadphase ID
 	u32 m_broadPhaseId;
 
+	// Contacts where this particle is the colliding particle.
+	b3List2<b3ParticleTriangleContactEdge> m_triangleContactEdges;
+	b3List2<b3ParticleBodyContactEdge> m_bodyContactEdges;
+
 	// Links to the cloth particle list.
 	b3Particle* m_prev;
 	b3Particle* m_next;
 };
 
-inline b3ParticleType b3Particle::GetType() const
-{
-	return m_type;
-}
-
 inline u32 b3Particle::GetVertex() const
 {
 	return m_vertex;
 }
 
-inline void b3Particle::SetPosition(const b3Vec3& position)
-{
-	b3Vec3 displacement = position - m_position;
-
-	m_position = position;
-	m_translation.SetZero();
-
-	Synchronize(displacement);
-	SynchronizeTriangles();
-}
-
-inline const b3Vec3& b3Particle::GetPosition() const
-{
-	return m_position;
-}
-
-inline void b3Particle::SetVelocity(const b3Vec3& velocity)
-{
-	if (m_type == e_staticParticle)
-	{
-		return;
-	}
-	m_velocity = velocity;
-}
-
-inline const b3Vec3& b3Particle::GetVelocity() const
-{
-	return m_velocity;
-}
-
-inline float32 b3Particle::GetMass() const
-{
-	return m_mass;
-}
-
 inline void b3Particle::SetRadius(float32 radius)
 {
 	m_radius = radius;
@@ -259,20 +213,6 @@ inline float32 b3Particle::GetFriction() const
 	return m_friction;
 }
 
-inline void b3Particle::ApplyForce(const b3Vec3& force)
-{
-	if (m_type != e_dynamicParticle)
-	{
-		return;
-	}
-	m_force += force;
-}
-
-inline void b3Particle::ApplyTranslation(const b3Vec3& translation)
-{
-	m_translation += translation;
-}
-
 inline b3Particle* b3Particle::GetNext()
 {
 	return m_next;
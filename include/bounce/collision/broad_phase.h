@@ -54,6 +54,21 @@ public:
 	// Force move the proxy
 	void TouchProxy(u32 proxyId);
 
+	// Enable or disable tree refitting.
+	// When enabled, moved proxies update the tree AABBs in place instead of 
+	// being reinserted. Call UpdateTree after moving the proxies.
+	// This is faster for many proxies that move coherently, such as the 
+	// nodes of a deformable body.
+	void SetRefitEnabled(bool flag);
+
+	// Is tree refitting enabled?
+	bool IsRefitEnabled() const;
+
+	// Refit the tree if proxies have moved since the last call.
+	// Rebuild the tree if its quality has degraded too much since the last rebuild.
+	// Only needed when tree refitting is enabled.
+	void UpdateTree();
+
 	// Get the AABB of a given proxy.
 	const b3AABB3& GetAABB(u32 proxyId) const;
 
@@ -96,6 +111,11 @@ private :
 	// The dynamic tree.
 	b3DynamicTree m_tree;
 
+	// Tree refitting
+	bool m_refitEnabled;
+	bool m_treeDirty;
+	float32 m_rebuildAreaRatio;
+
 	// Number of proxies
 	u32 m_proxyCount;
 
@@ -124,6 +144,11 @@ inline void* b3BroadPhase::GetUserData(u32 proxyId) const
 	return m_tree.GetUserData(proxyId);
 }
 
+inline bool b3BroadPhase::IsRefitEnabled() const
+{
+	return m_refitEnabled;
+}
+
 inline u32 b3BroadPhase::GetProxyCount() const
 {
 	return m_proxyCount;
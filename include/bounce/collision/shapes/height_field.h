@@ -0,0 +1,220 @@
+/*
+* Copyright (c) 2016-2019 Irlan Robson https://irlanrobson.github.io
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef B3_HEIGHT_FIELD_H
+#define B3_HEIGHT_FIELD_H
+
+#include <bounce/collision/collision.h>
+
+// A height field is a (rowCount + 1) x (columnCount + 1) grid of heights
+// stored in row-major order.
+// The grid is centered at the origin and aligned with the world x-z axes.
+// The vertex and triangle layout is the same as the one of b3GridMesh.
+// Therefore, the vertex v(i, j) has index i * (columnCount + 1) + j, and
+// the cell (i, j) contains the triangles 2 * (i * columnCount + j) and
+// 2 * (i * columnCount + j) + 1.
+// Only the heights are stored. The triangles are never stored.
+struct b3HeightField
+{
+	u32 rowCount;
+	u32 columnCount;
+	float32* heights;
+
+	// The cell dimensions along the x and z axes.
+	float32 cellWidth;
+	float32 cellDepth;
+
+	// The height bounds. These are computed by ComputeBounds.
+	float32 minHeight;
+	float32 maxHeight;
+
+	u32 GetVertexCount() const;
+	u32 GetTriangleCount() const;
+
+	b3Vec3 GetVertex(u32 i, u32 j) const;
+	void GetTriangle(u32 index, b3Vec3& v1, b3Vec3& v2, b3Vec3& v3) const;
+	b3AABB3 GetTriangleAABB(u32 index) const;
+
+	b3AABB3 GetAABB() const;
+
+	u32 GetSize() const;
+
+	// Compute the height bounds.
+	// Call this function after the heights are set or modified.
+	void ComputeBounds();
+
+	// Report the client callback the index of all triangles of
+	// cells that are overlapping with the given AABB.
+	// The client callback must return true to keep looking for
+	// overlapping triangles or false to stop the query.
+	template<class T>
+	void QueryAABB(T* callback, const b3AABB3& aabb) const;
+
+	// Perform a ray cast against this height field by walking
+	// the cells overlapped by the ray.
+	// Return the closest intersection and the index of the intersected triangle.
+	bool RayCast(b3RayCastOutput* output, u32* triangleIndex, const b3RayCastInput& input) const;
+
+	// Perform a ray cast against the triangles of a given cell.
+	// Shrink the maximum fraction of the input if an intersection is found.
+	bool RayCastCell(b3RayCastOutput* output, u32* triangleIndex, b3RayCastInput* input, u32 i, u32 j) const;
+};
+
+inline u32 b3HeightField::GetVertexCount() const
+{
+	return (rowCount + 1) * (columnCount + 1);
+}
+
+inline u32 b3HeightField::GetTriangleCount() const
+{
+	return 2 * rowCount * columnCount;
+}
+
+inline b3Vec3 b3HeightField::GetVertex(u32 i, u32 j) const
+{
+	B3_ASSERT(i <= rowCount);
+	B3_ASSERT(j <= columnCount);
+
+	b3Vec3 v;
+	v.x = (float32(j) - 0.5f * float32(columnCount)) * cellWidth;
+	v.y = heights[i * (columnCount + 1) + j];
+	v.z = (float32(i) - 0.5f * float32(rowCount)) * cellDepth;
+	return v;
+}
+
+inline void b3HeightField::GetTriangle(u32 index, b3Vec3& v1, b3Vec3& v2, b3Vec3& v3) const
+{
+	B3_ASSERT(index < GetTriangleCount());
+
+	u32 cell = index / 2;
+	u32 i = cell / columnCount;
+	u32 j = cell % columnCount;
+
+	b3Vec3 c1 = GetVertex(i, j);
+	b3Vec3 c2 = GetVertex(i + 1, j);
+	b3Vec3 c3 = GetVertex(i + 1, j + 1);
+	b3Vec3 c4 = GetVertex(i, j + 1);
+
+	if ((index & 1) == 0)
+	{
+		v1 = c3;
+		v2 = c2;
+		v3 = c1;
+	}
+	else
+	{
+		v1 = c1;
+		v2 = c4;
+		v3 = c3;
+	}
+}
+
+inline b3AABB3 b3HeightField::GetTriangleAABB(u32 index) const
+{
+	b3Vec3 v1, v2, v3;
+	GetTriangle(index, v1, v2, v3);
+
+	b3AABB3 aabb;
+	aabb.Set(v1, v2, v3);
+	return aabb;
+}
+
+inline b3AABB3 b3HeightField::GetAABB() const
+{
+	b3AABB3 aabb;
+	aabb.m_lower.x = -0.5f * float32(columnCount) * cellWidth;
+	aabb.m_lower.y = minHeight;
+	aabb.m_lower.z = -0.5f * float32(rowCount) * cellDepth;
+	aabb.m_upper.x = 0.5f * float32(columnCount) * cellWidth;
+	aabb.m_upper.y = maxHeight;
+	aabb.m_upper.z = 0.5f * float32(rowCount) * cellDepth;
+	return aabb;
+}
+
+inline u32 b3HeightField::GetSize() const
+{
+	u32 size = 0;
+	size += sizeof(b3HeightField);
+	size += sizeof(float32) * GetVertexCount();
+	return size;
+}
+
+template<class T>
+inline void b3HeightField::QueryAABB(T* callback, const b3AABB3& aabb) const
+{
+	if (aabb.m_upper.y < minHeight || aabb.m_lower.y > maxHeight)
+	{
+		return;
+	}
+
+	// Compute the overlapping cell range directly from the AABB.
+	float32 x0 = -0.5f * float32(columnCount) * cellWidth;
+	float32 z0 = -0.5f * float32(rowCount) * cellDepth;
+
+	float32 lowerJ = (aabb.m_lower.x - x0) / cellWidth;
+	float32 upperJ = (aabb.m_upper.x - x0) / cellWidth;
+	float32 lowerI = (aabb.m_lower.z - z0) / cellDepth;
+	float32 upperI = (aabb.m_upper.z - z0) / cellDepth;
+
+	if (upperJ < 0.0f || lowerJ > float32(columnCount) || upperI < 0.0f || lowerI > float32(rowCount))
+	{
+		return;
+	}
+
+	u32 j1 = lowerJ > 0.0f ? u32(lowerJ) : 0;
+	u32 j2 = upperJ < float32(columnCount) ? u32(upperJ) : columnCount - 1;
+	u32 i1 = lowerI > 0.0f ? u32(lowerI) : 0;
+	u32 i2 = upperI < float32(rowCount) ? u32(upperI) : rowCount - 1;
+
+	j2 = b3Min(j2, columnCount - 1);
+	i2 = b3Min(i2, rowCount - 1);
+
+	for (u32 i = i1; i <= i2; ++i)
+	{
+		const float32* row1 = heights + i * (columnCount + 1);
+		const float32* row2 = row1 + (columnCount + 1);
+
+		for (u32 j = j1; j <= j2; ++j)
+		{
+			// Skip the cell if it is above or below the AABB.
+			float32 h1 = row1[j], h2 = row2[j], h3 = row2[j + 1], h4 = row1[j + 1];
+
+			float32 lower = b3Min(b3Min(h1, h2), b3Min(h3, h4));
+			float32 upper = b3Max(b3Max(h1, h2), b3Max(h3, h4));
+
+			if (upper < aabb.m_lower.y || lower > aabb.m_upper.y)
+			{
+				continue;
+			}
+
+			u32 cell = i * columnCount + j;
+
+			if (callback->Report(2 * cell) == false)
+			{
+				return;
+			}
+
+			if (callback->Report(2 * cell + 1) == false)
+			{
+				return;
+			}
+		}
+	}
+}
+
+#endif
@@ -0,0 +1,125 @@
+/*
+* Copyright (c) 2016-2019 Irlan Robson https://irlanrobson.github.io
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+#ifndef B3_HULL_COOKER_H
+#define B3_HULL_COOKER_H
+
+#include <bounce/collision/shapes/hull.h>
+#include <bounce/common/thread_pool.h>
+
+class b3FrameAllocator;
+
+// The hull pack format identifier ("B3HP") and version.
+// The version must be incremented whenever the layout of the 
+// pack or of b3Hull changes.
+#define B3_HULL_PACK_MAGIC (0x50483342)
+#define B3_HULL_PACK_VERSION (1)
+
+// The header of a hull pack. 
+// A hull pack is a single relocatable memory block containing 
+// this header followed by a record per hull, the hulls and the 
+// vertices, edges, faces and planes of every hull.
+// All offsets are in bytes relative to the beginning of the block 
+// and are 16-byte aligned. Data is stored in native byte order.
+struct b3HullPackHeader
+{
+	u32 magic;
+	u32 version;
+	u32 size;
+	u32 pointerSize;
+	u32 hullCount;
+	u32 recordOffset;
+	u32 hullOffset;
+};
+
+// The location of the features of a hull in a hull pack.
+struct b3HullPackRecord
+{
+	b3Vec3 centroid;
+	u32 vertexCount;
+	u32 vertexOffset;
+	u32 edgeCount;
+	u32 edgeOffset;
+	u32 faceCount;
+	u32 faceOffset;
+	u32 planeOffset;
+};
+
+// Set the hulls stored in a buffer containing a hull pack such as a file loaded into memory.
+// No data is copied. The hull pointers are patched in place to point into the buffer. 
+// Therefore the buffer must be writable, 16-byte aligned and remain valid while the hulls are used.
+// Return the hull array or NULL if the buffer doesn't contain a valid hull pack.
+b3Hull* b3ReadHullPack(void* buffer, u32 size, u32* hullCount);
+
+// Hull cooking input.
+struct b3HullCookDef
+{
+	b3HullCookDef()
+	{
+		vertexStride = sizeof(b3Vec3);
+		vertexBase = nullptr;
+		vertexCount = 0;
+		simplify = true;
+	}
+
+	u32 vertexStride;
+	const void* vertexBase;
+	u32 vertexCount;
+	bool simplify;
+};
+
+// A hull cooker builds many convex hulls in parallel and writes 
+// them into a single hull pack.
+// Each thread reuses its own memory across hulls and cook calls.
+// Therefore b3Alloc and b3Free must be thread-safe. The default ones are.
+class b3HullCooker
+{
+public:
+	// Create a cooker using a given number of threads.
+	// If the number of threads is zero then the number of hardware threads is used.
+	b3HullCooker(u32 threadCount = 0);
+	~b3HullCooker();
+
+	// Get the number of threads used by this cooker.
+	u32 GetThreadCount() const;
+
+	// Cook a hull for each definition and return a hull pack allocated using b3Alloc.
+	// The hulls in the pack are in the same order as the definitions. 
+	// A hull that couldn't be created, such as a hull of less than 4 vertices, 
+	// has no vertices, edges and faces.
+	// Use b3ReadHullPack to set the hulls and b3Free to free the pack.
+	void* Cook(u32* packSize, const b3HullCookDef* defs, u32 count);
+private:
+	b3ThreadPool m_threadPool;
+
+	// Temporary memory per thread. 
+	// This is reset after every hull.
+	b3FrameAllocator* m_scratchAllocators;
+	
+	// Hull memory per thread. 
+	// This is reset after every cook call.
+	b3FrameAllocator* m_hullAllocators;
+};
+
+inline u32 b3HullCooker::GetThreadCount() const
+{
+	return m_threadPool.GetThreadCount();
+}
+
+#endif
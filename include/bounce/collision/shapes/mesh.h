@@ -38,6 +38,30 @@ struct b3Triangle
 	u32 v1, v2, v3;
 };
 
+// The binary mesh format identifier ("B3MS") and version.
+// The version must be incremented whenever the layout of the 
+// binary data or the static tree nodes changes.
+#define B3_MESH_BINARY_MAGIC (0x534D3342)
+#define B3_MESH_BINARY_VERSION (1)
+
+// The header of a binary mesh. 
+// A binary mesh is a single relocatable memory block containing 
+// this header followed by the vertices, triangles and static tree nodes.
+// All offsets are in bytes relative to the beginning of the block 
+// and are 16-byte aligned. Data is stored in native byte order.
+struct b3MeshBinaryHeader
+{
+	u32 magic;
+	u32 version;
+	u32 size;
+	u32 vertexCount;
+	u32 vertexOffset;
+	u32 triangleCount;
+	u32 triangleOffset;
+	u32 nodeCount;
+	u32 nodeOffset;
+};
+
 struct b3Mesh 
 {
 	u32 vertexCount;
@@ -53,6 +77,21 @@ struct b3Mesh
 	b3AABB3 GetTriangleAABB(u32 index) const;
 
 	void BuildTree();
+
+	// Get the number of bytes required to write this mesh 
+	// and its static tree in the binary format.
+	u32 GetBinarySize() const;
+
+	// Write this mesh and its static tree into a given buffer in the binary format.
+	// The buffer must be at least GetBinarySize() bytes long.
+	// The tree must have been built.
+	void WriteBinary(void* buffer) const;
+
+	// Set this mesh from a buffer containing a binary mesh such as a memory mapped file.
+	// No data is copied and the tree is not rebuilt. This mesh points directly into the buffer.
+	// Therefore the buffer must be 16-byte aligned and remain valid while this mesh is used.
+	// Return false if the buffer doesn't contain a valid binary mesh.
+	bool ReadBinary(const void* buffer, u32 size);
 };
 
 inline const b3Vec3& b3Mesh::GetVertex(u32 index) const
@@ -20,18 +20,18 @@
 #define B3_Q_HULL_H
 
 #include <bounce/collision/shapes/hull.h>
-#include <bounce/common/template/array.h>
+
+class b3FrameAllocator;
 
 // This hull can be constructed from an array of points.
 struct b3QHull : public b3Hull
 {
-	b3StackArray<b3Vec3, 256> hullVertices;
-	b3StackArray<b3HalfEdge, 256> hullEdges;
-	b3StackArray<b3Face, 256> hullFaces;
-	b3StackArray<b3Plane, 256> hullPlanes;
+	// The features are stored in a single block sized to the hull.
+	void* buffer;
 
 	b3QHull()
 	{
+		buffer = nullptr;
 		vertices = nullptr;
 		vertexCount = 0;
 		edges = nullptr;
@@ -42,6 +42,11 @@ struct b3QHull : public b3Hull
 		centroid.SetZero();
 	}
 
+	~b3QHull()
+	{
+		b3Free(buffer);
+	}
+
 	// Create a convex hull from vertex data.
 	// If the creation has failed then this convex hull is not modified.
 	// vertexStride - size of bytes between vertices
@@ -61,6 +66,16 @@ struct b3QHull : public b3Hull
 	// Set this hull as a cone located at the origin 
 	// given the radius and extent along the y axis.
 	void SetAsCone(float32 radius = 1.0f, float32 ey = 1.0f);
+private:
+	// The buffer is owned by this hull. Therefore it can't be copied.
+	b3QHull(const b3QHull&);
+	b3QHull& operator=(const b3QHull&);
 };
 
+// Create a convex hull from vertex data.
+// The features of the hull and the temporary memory are allocated from the given allocator. 
+// Therefore, the features are valid until the allocator is reset.
+// Return true if the hull was created.
+bool b3CreateHull(b3Hull* hull, b3FrameAllocator* allocator, u32 vertexStride, const void* vertexBase, u32 vertexCount, bool simplify = true);
+
 #endif
\ No newline at end of file
@@ -41,6 +41,22 @@ public :
 	// Update a node AABB.
 	void UpdateNode(u32 proxyId, const b3AABB3& aabb);
 
+	// Set a node AABB without restructuring this tree.
+	// The ancestor AABBs are enlarged until one of them contains the new AABB.
+	// They aren't shrunk. Call Refit to shrink them.
+	void RefitNode(u32 proxyId, const b3AABB3& aabb);
+
+	// Recompute the AABBs of all internal nodes bottom-up from the leaf AABBs.
+	void Refit();
+
+	// Rebuild the hierarchy top-down from the leaves.
+	// The leaf IDs are kept.
+	void Rebuild();
+
+	// Get the sum of the internal node surface areas divided by the sum of the leaf surface areas.
+	// This is a measure of the tree quality. Lower is better.
+	float32 GetAreaRatio() const;
+
 	// Get the (fat) AABB of a given proxy.
 	const b3AABB3& GetAABB(u32 proxyId) const;
 
@@ -109,6 +125,16 @@ private :
 	// Find the best node that can be merged with a given AABB.
 	u32 FindBest(const b3AABB3& aabb) const;
 
+	// Build a subtree top-down from a list of leaves and return its root.
+	u32 BuildNode(u32* leaves, u32 count);
+
+	// Partition a list of leaves in place such that the leaf at the middle index 
+	// has the median centroid along a given axis.
+	void PartitionLeaves(u32* leaves, u32 count, u32 axis) const;
+
+	// Get the scratch buffer with room for at least a given number of node indices.
+	u32* GetScratch(u32 count);
+
 	// Peel a node from the free list and insert into the node array. 
 	// Allocate a new node if necessary. The function returns the new node index.
 	u32 AllocateNode();
@@ -127,6 +153,10 @@ private :
 	u32 m_nodeCount;
 	u32 m_nodeCapacity;
 	u32 m_freeList;
+
+	// A buffer of node indices reused by Refit and Rebuild.
+	u32* m_scratch;
+	u32 m_scratchCapacity;
 };
 
 inline const b3AABB3& b3DynamicTree::GetAABB(u32 proxyId) const
@@ -35,6 +35,32 @@ public:
 	// Build this tree from a list of AABBs.
 	void Build(const b3AABB3* aabbs, u32 count);
 
+	// Recompute the node AABBs bottom-up. 
+	// The client callback must return the new AABB of a given index 
+	// of the list of AABBs used to build this tree.
+	// The hierarchy is kept. This tree must own its nodes.
+	template<class T>
+	void Refit(T* callback);
+
+	// Get the number of nodes of this tree.
+	u32 GetNodeCount() const;
+
+	// Get the number of bytes required to store the nodes of this tree.
+	u32 GetNodeDataSize() const;
+
+	// Get the number of bytes required to store a given number of nodes.
+	static u32 GetNodeDataSize(u32 nodeCount);
+
+	// Copy the nodes of this tree into a given buffer.
+	// The buffer must be at least GetNodeDataSize() bytes long.
+	void WriteNodes(void* buffer) const;
+
+	// Make this tree reference a list of nodes previously written using WriteNodes.
+	// The nodes are not copied and this tree doesn't own the memory.
+	// Therefore the memory must be 4-byte aligned and remain valid while this tree is used.
+	// The nodes are read-only. Therefore this tree can't be refit.
+	void SetNodes(const void* nodes, u32 nodeCount);
+
 	// Get the AABB of a given proxy.
 	const b3AABB3& GetAABB(u32 proxyId) const;
 
@@ -82,6 +108,9 @@ private :
 	// The nodes of this tree stored in an array.
 	u32 m_nodeCount;
 	b3Node* m_nodes;
+
+	// Does this tree own the node array?
+	bool m_ownsNodes;
 };
 
 inline const b3AABB3& b3StaticTree::GetAABB(u32 proxyId) const
@@ -97,6 +126,28 @@ inline u32 b3StaticTree::GetUserData(u32 proxyId) const
 	return m_nodes[proxyId].index;
 }
 
+template<class T>
+inline void b3StaticTree::Refit(T* callback)
+{
+	B3_ASSERT(m_ownsNodes);
+
+	// The children of a node are always stored after the node.
+	// Therefore a reverse pass visits the children before their parent.
+	for (u32 i = m_nodeCount; i > 0; --i)
+	{
+		b3Node* node = m_nodes + i - 1;
+
+		if (node->IsLeaf())
+		{
+			node->aabb = callback->ComputeAABB(node->index);
+		}
+		else
+		{
+			node->aabb = b3Combine(m_nodes[node->child1].aabb, m_nodes[node->child2].aabb);
+		}
+	}
+}
+
 template<class T>
 inline void b3StaticTree::QueryAABB(T* callback, const b3AABB3& aabb) const
 {
@@ -201,6 +252,21 @@ inline void b3StaticTree::RayCast(T* callback, const b3RayCastInput& input) cons
 	}
 }
 
+inline u32 b3StaticTree::GetNodeCount() const
+{
+	return m_nodeCount;
+}
+
+inline u32 b3StaticTree::GetNodeDataSize() const
+{
+	return GetNodeDataSize(m_nodeCount);
+}
+
+inline u32 b3StaticTree::GetNodeDataSize(u32 nodeCount)
+{
+	return nodeCount * sizeof(b3Node);
+}
+
 inline u32 b3StaticTree::GetSize() const
 {
 	u32 size = 0;
@@ -0,0 +1,65 @@
+/*
+* Copyright (c) 2016-2019 Irlan Robson https://irlanrobson.github.io
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef B3_FRAME_ALLOCATOR_H
+#define B3_FRAME_ALLOCATOR_H
+
+#include <bounce/common/settings.h>
+
+// Default size of the first chunk.
+const u32 b3_frameChunkSize = B3_MiB(1);
+
+// A linear allocator.
+// Allocations are never freed individually. 
+// Call Reset to free all allocations at once. 
+// The memory is kept between resets so that it can be reused.
+class b3FrameAllocator
+{
+public:
+	b3FrameAllocator(u32 chunkSize = b3_frameChunkSize);
+	~b3FrameAllocator();
+
+	// Allocate 16-byte aligned memory.
+	void* Allocate(u32 size);
+
+	// Free all allocations. 
+	void Reset();
+
+	// Get the number of bytes allocated since the last reset.
+	u32 GetAllocatedSize() const;
+private:
+	struct b3Chunk
+	{
+		b3Chunk* next;
+		u32 size;
+	};
+
+	b3Chunk* AllocateChunk(u32 size);
+
+	b3Chunk* m_chunks;
+	u32 m_chunkSize;
+	u32 m_offset;
+	u32 m_allocatedSize;
+};
+
+inline u32 b3FrameAllocator::GetAllocatedSize() const
+{
+	return m_allocatedSize;
+}
+
+#endif
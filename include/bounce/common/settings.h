@@ -58,6 +58,11 @@ typedef float float32;
 // This is a dimensionless multiplier.
 #define B3_AABB_MULTIPLIER (2.0f)
 
+// A refitted broad-phase tree is rebuilt when its area ratio grows by 
+// more than this factor since the last rebuild.
+// This is a dimensionless multiplier.
+#define B3_AABB_REBUILD_RATIO (1.5f)
+
 // Collision and constraint tolerance.
 #define B3_LINEAR_SLOP (0.005f)
 #define B3_ANGULAR_SLOP (2.0f / 180.0f * B3_PI)
@@ -0,0 +1,259 @@
+/*
+* Copyright (c) 2016-2019 Irlan Robson https://irlanrobson.github.io
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef B3_HASH_MAP_H
+#define B3_HASH_MAP_H
+
+#include <bounce/common/settings.h>
+
+// Hash functions for the common key types.
+// Define a b3Hash overload and operator== for your own key type 
+// in order to use it as a key of a hash map.
+inline u32 b3Hash(u32 key)
+{
+	// Integer finalizer from MurmurHash3.
+	key ^= key >> 16;
+	key *= 0x85EBCA6B;
+	key ^= key >> 13;
+	key *= 0xC2B2AE35;
+	key ^= key >> 16;
+	return key;
+}
+
+inline u32 b3Hash(u64 key)
+{
+	return b3Hash(u32(key) ^ b3Hash(u32(key >> 32)));
+}
+
+inline u32 b3Hash(const void* key)
+{
+	return b3Hash(u64(size_t(key)));
+}
+
+// A hash map of key-value pairs (POD) using open addressing with linear probing.
+// The capacity is always a power of two and the load factor is kept below 1/2.
+template <typename K, typename V>
+class b3HashMap
+{
+public:
+	b3HashMap()
+	{
+		m_capacity = 0;
+		m_count = 0;
+		m_keys = NULL;
+		m_values = NULL;
+		m_used = NULL;
+	}
+
+	~b3HashMap()
+	{
+		b3Free(m_keys);
+	}
+
+	// Ensure the map can store a given number of pairs without growing.
+	void Reserve(u32 count)
+	{
+		u32 capacity = 16;
+		while (capacity < 2 * count)
+		{
+			capacity *= 2;
+		}
+
+		if (capacity > m_capacity)
+		{
+			Rehash(capacity);
+		}
+	}
+
+	// Remove all pairs. The memory is kept.
+	void Clear()
+	{
+		if (m_count > 0)
+		{
+			memset(m_used, 0, m_capacity * sizeof(u8));
+			m_count = 0;
+		}
+	}
+
+	// Find the value associated with a key. 
+	// Return NULL if the key is not in this map.
+	V* Find(const K& key)
+	{
+		if (m_count == 0)
+		{
+			return NULL;
+		}
+
+		u32 mask = m_capacity - 1;
+		for (u32 i = b3Hash(key) & mask; m_used[i]; i = (i + 1) & mask)
+		{
+			if (m_keys[i] == key)
+			{
+				return m_values + i;
+			}
+		}
+
+		return NULL;
+	}
+
+	const V* Find(const K& key) const
+	{
+		return ((b3HashMap<K, V>*)this)->Find(key);
+	}
+
+	// Insert a pair or replace the value associated with a key. 
+	// Return the value stored in this map.
+	V* Insert(const K& key, const V& value)
+	{
+		if (2 * (m_count + 1) > m_capacity)
+		{
+			Rehash(m_capacity == 0 ? 16 : 2 * m_capacity);
+		}
+
+		u32 mask = m_capacity - 1;
+		u32 i = b3Hash(key) & mask;
+		while (m_used[i])
+		{
+			if (m_keys[i] == key)
+			{
+				m_values[i] = value;
+				return m_values + i;
+			}
+			i = (i + 1) & mask;
+		}
+
+		m_used[i] = 1;
+		m_keys[i] = key;
+		m_values[i] = value;
+		++m_count;
+		return m_values + i;
+	}
+
+	// Remove the pair associated with a key.
+	// Return true if the key was in this map.
+	bool Remove(const K& key)
+	{
+		if (m_count == 0)
+		{
+			return false;
+		}
+
+		u32 mask = m_capacity - 1;
+		u32 i = b3Hash(key) & mask;
+		while (m_used[i])
+		{
+			if (m_keys[i] == key)
+			{
+				break;
+			}
+			i = (i + 1) & mask;
+		}
+
+		if (m_used[i] == 0)
+		{
+			return false;
+		}
+
+		// Shift the following pairs of the cluster back
+		// so that the probe sequences remain valid.
+		u32 hole = i;
+		for (u32 j = (i + 1) & mask; m_used[j]; j = (j + 1) & mask)
+		{
+			u32 home = b3Hash(m_keys[j]) & mask;
+			
+			// Can the pair at j be moved into the hole?
+			bool move = hole <= j ? (home <= hole || home > j) : (home <= hole && home > j);
+			if (move)
+			{
+				m_keys[hole] = m_keys[j];
+				m_values[hole] = m_values[j];
+				hole = j;
+			}
+		}
+
+		m_used[hole] = 0;
+		--m_count;
+		return true;
+	}
+
+	u32 Count() const
+	{
+		return m_count;
+	}
+
+	bool IsEmpty() const
+	{
+		return m_count == 0;
+	}
+private:
+	b3HashMap(const b3HashMap<K, V>& other);
+	void operator=(const b3HashMap<K, V>& other);
+
+	void Rehash(u32 capacity)
+	{
+		B3_ASSERT((capacity & (capacity - 1)) == 0);
+
+		u32 oldCapacity = m_capacity;
+		K* oldKeys = m_keys;
+		V* oldValues = m_values;
+		u8* oldUsed = m_used;
+
+		// Keys, values, and flags share a single block.
+		u32 keySize = capacity * sizeof(K);
+		u32 valueSize = capacity * sizeof(V);
+		u32 valueOffset = (keySize + 15) & ~15;
+		u32 usedOffset = (valueOffset + valueSize + 15) & ~15;
+
+		u8* block = (u8*)b3Alloc(usedOffset + capacity * sizeof(u8));
+		m_keys = (K*)block;
+		m_values = (V*)(block + valueOffset);
+		m_used = block + usedOffset;
+		memset(m_used, 0, capacity * sizeof(u8));
+		
+		m_capacity = capacity;
+		m_count = 0;
+
+		u32 mask = capacity - 1;
+		for (u32 i = 0; i < oldCapacity; ++i)
+		{
+			if (oldUsed[i])
+			{
+				u32 j = b3Hash(oldKeys[i]) & mask;
+				while (m_used[j])
+				{
+					j = (j + 1) & mask;
+				}
+
+				m_used[j] = 1;
+				m_keys[j] = oldKeys[i];
+				m_values[j] = oldValues[i];
+				++m_count;
+			}
+		}
+
+		b3Free(oldKeys);
+	}
+
+	u32 m_capacity;
+	u32 m_count;
+	K* m_keys;
+	V* m_values;
+	u8* m_used;
+};
+
+#endif
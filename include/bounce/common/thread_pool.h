@@ -0,0 +1,75 @@
+/*
+* Copyright (c) 2016-2019 Irlan Robson https://irlanrobson.github.io
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef B3_THREAD_POOL_H
+#define B3_THREAD_POOL_H
+
+#include <bounce/common/settings.h>
+
+// A task function. 
+// The index is the index of the task and the thread index is the index 
+// of the thread running the task. The calling thread has index 0.
+typedef void (*b3TaskFcn)(void* data, u32 index, u32 threadIndex);
+
+struct b3ThreadPoolData;
+
+// A pool of worker threads. 
+// The threads sleep while there are no tasks to run.
+class b3ThreadPool
+{
+public:
+	// Create a pool with a given number of threads including the calling thread.
+	// If the number of threads is zero then the number of hardware threads is used.
+	b3ThreadPool(u32 threadCount = 0);
+	~b3ThreadPool();
+
+	// Get the number of threads including the calling thread.
+	u32 GetThreadCount() const;
+
+	// Run count tasks and wait for all of them to finish.
+	// The tasks are distributed dynamically among the threads.
+	// This function must not be called by a task.
+	void Run(b3TaskFcn fcn, void* data, u32 count);
+
+	// Run count tasks using an object with the member function
+	// void Execute(u32 index, u32 threadIndex).
+	template<class T>
+	void Run(T* task, u32 count);
+private:
+	template<class T>
+	static void Execute(void* data, u32 index, u32 threadIndex)
+	{
+		((T*)data)->Execute(index, threadIndex);
+	}
+
+	b3ThreadPoolData* m_data;
+	u32 m_threadCount;
+};
+
+inline u32 b3ThreadPool::GetThreadCount() const
+{
+	return m_threadCount;
+}
+
+template<class T>
+inline void b3ThreadPool::Run(T* task, u32 count)
+{
+	Run(&Execute<T>, task, count);
+}
+
+#endif
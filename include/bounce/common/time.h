@@ -240,7 +240,7 @@ public:
 	{		
 		struct timespec c;
 		clock_gettime(CLOCK_MONOTONIC, &c);
-		double dt = (double)(c.tv_nsec - m_c0.tv_nsec) * 1.0e-6;
+		double dt = (double)(c.tv_sec - m_c0.tv_sec) * 1.0e3 + (double)(c.tv_nsec - m_c0.tv_nsec) * 1.0e-6;
 		m_c0 = c;
 		Add(dt);
 	}
@@ -50,6 +50,7 @@ private:
 	friend class b3ContactManager;
 	friend class b3List2<b3MeshContact>;
 	friend class b3StaticTree;
+	friend struct b3HeightFieldContactQueryCallback;
 
 	b3MeshContact(b3Shape* shapeA, b3Shape* shapeB);
 	~b3MeshContact();
@@ -69,6 +70,13 @@ private:
 	// Static tree callback. There is no midphase. 
 	bool Report(u32 proxyId);
 
+	// Add a triangle of the second shape to the overlapping buffer.
+	bool AddTriangle(u32 triangleIndex);
+
+	// Get the vertices of a triangle of the second shape.
+	// The second shape is either a mesh or a height field.
+	void GetTriangle(u32 index, b3Vec3& v1, b3Vec3& v2, b3Vec3& v3) const;
+
 	// Did the AABB move significantly?
 	bool m_aabbMoved;
 
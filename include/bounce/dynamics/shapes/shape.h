@@ -35,6 +35,7 @@ enum b3ShapeType
 	e_capsuleShape,
 	e_hullShape,
 	e_meshShape,
+	e_heightFieldShape,
 	e_maxShapes
 };
 
@@ -157,6 +158,7 @@ protected:
 	friend class b3Contact;
 	friend class b3ContactManager;
 	friend class b3MeshShape;
+	friend class b3HeightFieldShape;
 	friend class b3MeshContact;
 	friend class b3ContactSolver;
 	friend class b3List1<b3Shape>;
@@ -20,6 +20,9 @@
 #define QH_HULL_H
 
 #include <bounce/common/geometry.h>
+#include <bounce/common/template/hash_map.h>
+
+class b3FrameAllocator;
 
 #define B3_NULL_U32 B3_MAX_U32
 
@@ -51,6 +54,14 @@ struct qhFace
 
 	qhList<qhVertex> conflictList;
 
+	// The furthest conflict vertex and its distance to this face.
+	qhVertex* furthestVertex;
+	float32 furthestDistance;
+	
+	// Index of this face in the face heap. 
+	// B3_NULL_U32 if this face doesn't have a furthest conflict vertex.
+	u32 heapIndex;
+
 	b3Vec3 center;
 	b3Plane plane;
 	float32 area;
@@ -93,16 +104,38 @@ struct qhVertex
 	bool active;
 };
 
+// The key of a half-edge that doesn't have a face yet.
+struct qhEdgeKey
+{
+	bool operator==(const qhEdgeKey& other) const
+	{
+		return v1 == other.v1 && v2 == other.v2;
+	}
+
+	const qhVertex* v1;
+	const qhVertex* v2;
+};
+
+inline u32 b3Hash(const qhEdgeKey& key)
+{
+	return b3Hash(b3Hash(key.v1) ^ u32(size_t(key.v2)));
+}
+
 // A convex hull builder. 
 // Given a list of points constructs its convex hull. 
 class qhHull
 {
 public:
-	qhHull();
+	// If an allocator is given then the memory buffer of this hull
+	// is allocated from it and is not freed by this hull.
+	qhHull(b3FrameAllocator* allocator = NULL);
 	~qhHull();
 	
 	// Construct this convex hull from an array of points.
-	void Construct(const b3Vec3* vertices, u32 vertexCount);
+	// If prefilter is set to true then the points strictly inside the octahedron 
+	// formed by the extreme points along the canonical axes are discarded 
+	// before the construction.
+	void Construct(const b3Vec3* vertices, u32 vertexCount, bool prefilter = true);
 
 	// Get the list of vertices in this convex hull.
 	const qhList<qhVertex>& GetVertexList() const;
@@ -151,6 +184,16 @@ private:
 	
 	void ResolveOrphans();
 
+	// Find the furthest conflict vertex of a face and 
+	// insert the face into the face heap if it has one.
+	void AddConflictFace(qhFace* face);
+	
+	// Remove a face from the face heap if it is in the heap.
+	void RemoveConflictFace(qhFace* face);
+
+	void SiftUp(u32 index);
+	void SiftDown(u32 index);
+
 	// Validate convexity.
 	// Called at each iteration.
 	void ValidateConvexity() const;
@@ -187,6 +230,7 @@ private:
 	qhFace* AllocateFace();
 	void FreeFace(qhFace* p);
 	
+	b3FrameAllocator* m_allocator;
 	void* m_buffer;
 
 	u32 m_vertexCapacity;
@@ -210,6 +254,17 @@ private:
 	
 	qhFace** m_newFaces;
 	u32 m_newFaceCount;
+
+	qhFace** m_visibleFaces;
+	u32 m_visibleFaceCount;
+
+	// Max-heap of faces keyed on the distance of their furthest conflict vertex
+	qhFace** m_faceHeap;
+	u32 m_faceHeapCount;
+
+	// Half-edges that don't have a face yet, keyed on their vertices. 
+	// These only exist while new faces are being added.
+	b3HashMap<qhEdgeKey, qhHalfEdge*> m_freeEdgeMap;
 };
 
 #include <bounce/quickhull/qh_hull.inl>
@@ -21,6 +21,9 @@
 
 #include <bounce/common/math/transform.h>
 
+class b3World;
+class b3Shape;
+
 struct b3RopeBody;
 
 //
@@ -34,6 +37,10 @@ struct b3RopeDef
 		gravity.SetZero();
 		linearDamping = 0.6f;
 		angularDamping = 0.6f;
+		radius = 0.2f;
+		friction = 0.6f;
+		contactFrequencyHz = 5.0f;
+		contactDampingRatio = 1.0f;
 	}
 
 	//
@@ -53,6 +60,19 @@ struct b3RopeDef
 
 	//
 	float32 angularDamping;
+
+	// The radius of the link capsules used for collision.
+	float32 radius;
+
+	// The coefficient of friction of the links.
+	float32 friction;
+
+	// The contacts with the world are springs with this frequency
+	// relative to the link mass.
+	float32 contactFrequencyHz;
+
+	// The damping ratio of the contact springs.
+	float32 contactDampingRatio;
 };
 
 //
@@ -80,15 +100,53 @@ public:
 		m_gravity = gravity;
 	}
 
+	// Attach a world to this rope.
+	// The links will collide with the shapes of the attached world.
+	// The bodies of the world are not affected by the rope.
+	void SetWorld(b3World* world)
+	{
+		m_world = world;
+	}
+
+	// Get the world attached to this rope.
+	const b3World* GetWorld() const
+	{
+		return m_world;
+	}
+
+	b3World* GetWorld()
+	{
+		return m_world;
+	}
+
 	//
 	void Step(float32 dt);
 
 	//
 	void Draw() const;
 private:
+	friend class b3RopeGroup;
+	friend struct b3RopeQueryListener;
+
+	// Compute the contact forces of the links against the world
+	// using the link velocities of this step.
+	// Return true if a link is touching a shape.
+	bool UpdateContacts(float32 h);
+
+	// Add the contact forces of the links against a shape.
+	void CollideShape(const b3Shape* shape, float32 h);
+
 	//
 	float32 m_kd1, m_kd2;
 
+	// Contact
+	float32 m_radius;
+	float32 m_friction;
+	float32 m_contactFrequencyHz;
+	float32 m_contactDampingRatio;
+	b3World* m_world;
+	bool m_touching;
+
 	//
 	b3Vec3 m_gravity;
 
@@ -0,0 +1,115 @@
+/*
+* Copyright (c) 2016-2019 Irlan Robson https://irlanrobson.github.io
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef B3_ROPE_BODY_H
+#define B3_ROPE_BODY_H
+
+#include <bounce/rope/spatial.h>
+#include <bounce/common/math/transform.h>
+
+// A link of a rope.
+struct b3RopeBody
+{
+	b3RopeBody() { }
+
+	// J * v
+	b3MotionVec v_J() const
+	{
+		return m_S[0] * m_v[0] + m_S[1] * m_v[1] + m_S[2] * m_v[2];
+	}
+
+	//
+	b3Transform X_J() const
+	{
+		// Rigid Body Dynamics Algorithms p. 86
+		// E = mat33(inv(p))
+		b3Quat E = b3Conjugate(m_p);
+
+		b3Transform X;
+		X.rotation = b3QuatMat33(E);
+		X.position.SetZero();
+		return X;
+	}
+
+	// Shared
+
+	// Body
+
+	//
+	float32 m_m, m_I;
+
+	// Joint
+
+	//
+	b3MotionVec m_S[3];
+
+	//
+	b3Transform m_X_i_J;
+
+	//
+	b3Transform m_X_J_j;
+
+	//
+	b3Quat m_p;
+
+	//
+	b3Vec3 m_v;
+
+	// Temp
+
+	//
+	b3SpTransform m_X_i_j;
+
+	//
+	b3MotionVec m_sv;
+
+	//
+	b3MotionVec m_sc;
+
+	//
+	b3SpInertia m_I_A;
+
+	//
+	b3ForceVec m_F_A;
+
+	//
+	b3ForceVec m_U[3];
+
+	//
+	b3Mat33 m_invD;
+
+	//
+	b3Vec3 m_u;
+
+	//
+	b3Vec3 m_a;
+
+	//
+	b3MotionVec m_sa;
+
+	// Contact force in the link frame
+	b3ForceVec m_Fc;
+
+	//
+	b3Transform m_invX;
+
+	//
+	b3Transform m_X;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,125 @@
+/*
+* Copyright (c) 2016-2019 Irlan Robson https://irlanrobson.github.io
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+#ifndef B3_ROPE_GROUP_H
+#define B3_ROPE_GROUP_H
+
+#include <bounce/common/settings.h>
+
+class b3Rope;
+class b3ThreadPool;
+
+struct b3RopeLaneGroup;
+struct b3RopeLaneLink;
+struct b3RopeLaneLinkState;
+struct b3RopeLaneBase;
+struct b3RopeGroupTask;
+
+// A group of ropes that are stepped together.
+// The ropes are packed into lane groups of b3_spatialLaneCount ropes with similar link counts.
+// The links of a lane group are stored as a structure of arrays and the articulated body
+// recursion runs on all the ropes of a lane group at once.
+// Each rope gives the same results as if it was stepped alone.
+class b3RopeGroup
+{
+public:
+	b3RopeGroup();
+	~b3RopeGroup();
+
+	// Add an initialized rope to this group.
+	// A rope in a group must not be stepped alone.
+	// If a rope is initialized again then it must be removed and added again.
+	void AddRope(b3Rope* rope);
+
+	// Remove a rope from this group.
+	void RemoveRope(b3Rope* rope);
+
+	// Get the number of ropes in this group.
+	u32 GetRopeCount() const;
+
+	// Set the threads used to step the lane groups.
+	// The results are the same for any number of threads.
+	// If this is null then the ropes are stepped on the calling thread.
+	void SetThreadPool(b3ThreadPool* threadPool);
+
+	// Get the threads used to step the lane groups.
+	b3ThreadPool* GetThreadPool() const;
+
+	// Step all the ropes in this group.
+	void Step(float32 dt);
+private:
+	friend struct b3RopeGroupTask;
+
+	// Pack the ropes into lane groups.
+	void BuildLaneGroups();
+
+	// Gather the rope states of a lane group.
+	static void GatherLaneGroup(b3RopeLaneBase* base, b3RopeLaneLinkState* states, const b3RopeLaneGroup* group);
+
+	// Compute the link velocities used by the contacts of the ropes of a lane group 
+	// that are attached to a world.
+	static void ComputeContactVelocities(const b3RopeLaneGroup* group, const b3RopeLaneLink* links, b3RopeLaneLinkState* states);
+
+	// Step the ropes of a lane group using the solver state of a thread.
+	// The contact forces must have been computed.
+	static void StepLaneGroup(const b3RopeLaneGroup* group, const b3RopeLaneLink* links, b3RopeLaneLinkState* states, float32 h);
+
+	// Run a task over the threads or on the calling thread.
+	void RunTask(b3RopeGroupTask* task, u32 taskCount);
+
+	// Ropes
+	b3Rope** m_ropes;
+	u32 m_ropeCount;
+	u32 m_ropeCapacity;
+
+	// The lane groups must be rebuilt when a rope is added or removed.
+	bool m_laneGroupsDirty;
+
+	// Lane groups
+	b3RopeLaneGroup* m_laneGroups;
+	u32 m_laneGroupCount;
+
+	// Constant link data of the lane groups
+	b3RopeLaneLink* m_laneLinks;
+	u32 m_maxLinkCount;
+
+	// Solver state of the links of a lane group per thread
+	b3RopeLaneLinkState* m_laneStates;
+	u32 m_laneStateCapacity;
+
+	// Worker threads
+	b3ThreadPool* m_threadPool;
+};
+
+inline u32 b3RopeGroup::GetRopeCount() const
+{
+	return m_ropeCount;
+}
+
+inline void b3RopeGroup::SetThreadPool(b3ThreadPool* threadPool)
+{
+	m_threadPool = threadPool;
+}
+
+inline b3ThreadPool* b3RopeGroup::GetThreadPool() const
+{
+	return m_threadPool;
+}
+
+#endif
\ No newline at end of file
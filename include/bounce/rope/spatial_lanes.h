@@ -0,0 +1,790 @@
+/*
+* Copyright (c) 2016-2019 Irlan Robson https://irlanrobson.github.io
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+#ifndef B3_SPATIAL_LANES_H
+#define B3_SPATIAL_LANES_H
+
+#include <bounce/common/math/transform.h>
+
+// The number of lanes of the lane types.
+// The lanes run the same instructions. Therefore the compiler can map them to SIMD registers.
+// The operations follow the ones of the scalar types in the same order,
+// so every lane gives the same result as the scalar code.
+const u32 b3_spatialLaneCount = 4;
+
+// A scalar per lane.
+struct b3LaneFloat
+{
+	b3LaneFloat() { }
+
+	b3LaneFloat(float32 s)
+	{
+		for (u32 k = 0; k < b3_spatialLaneCount; ++k)
+		{
+			v[k] = s;
+		}
+	}
+
+	float32 operator[](u32 k) const
+	{
+		return v[k];
+	}
+
+	float32& operator[](u32 k)
+	{
+		return v[k];
+	}
+
+	float32 v[b3_spatialLaneCount];
+};
+
+inline b3LaneFloat operator+(const b3LaneFloat& a, const b3LaneFloat& b)
+{
+	b3LaneFloat r;
+	for (u32 k = 0; k < b3_spatialLaneCount; ++k)
+	{
+		r.v[k] = a.v[k] + b.v[k];
+	}
+	return r;
+}
+
+inline b3LaneFloat operator-(const b3LaneFloat& a, const b3LaneFloat& b)
+{
+	b3LaneFloat r;
+	for (u32 k = 0; k < b3_spatialLaneCount; ++k)
+	{
+		r.v[k] = a.v[k] - b.v[k];
+	}
+	return r;
+}
+
+inline b3LaneFloat operator*(const b3LaneFloat& a, const b3LaneFloat& b)
+{
+	b3LaneFloat r;
+	for (u32 k = 0; k < b3_spatialLaneCount; ++k)
+	{
+		r.v[k] = a.v[k] * b.v[k];
+	}
+	return r;
+}
+
+inline b3LaneFloat operator-(const b3LaneFloat& a)
+{
+	b3LaneFloat r;
+	for (u32 k = 0; k < b3_spatialLaneCount; ++k)
+	{
+		r.v[k] = -a.v[k];
+	}
+	return r;
+}
+
+// 1 / a where a isn't zero, zero elsewhere.
+inline b3LaneFloat b3SafeInverse(const b3LaneFloat& a)
+{
+	b3LaneFloat r;
+	for (u32 k = 0; k < b3_spatialLaneCount; ++k)
+	{
+		r.v[k] = a.v[k] != 0.0f ? 1.0f / a.v[k] : 0.0f;
+	}
+	return r;
+}
+
+inline b3LaneFloat b3Min(const b3LaneFloat& a, const b3LaneFloat& b)
+{
+	b3LaneFloat r;
+	for (u32 k = 0; k < b3_spatialLaneCount; ++k)
+	{
+		r.v[k] = a.v[k] < b.v[k] ? a.v[k] : b.v[k];
+	}
+	return r;
+}
+
+inline b3LaneFloat b3Max(const b3LaneFloat& a, const b3LaneFloat& b)
+{
+	b3LaneFloat r;
+	for (u32 k = 0; k < b3_spatialLaneCount; ++k)
+	{
+		r.v[k] = a.v[k] > b.v[k] ? a.v[k] : b.v[k];
+	}
+	return r;
+}
+
+// A 3D vector per lane.
+struct b3LaneVec3
+{
+	b3LaneVec3() { }
+
+	b3LaneVec3(const b3LaneFloat& _x, const b3LaneFloat& _y, const b3LaneFloat& _z) : x(_x), y(_y), z(_z) { }
+
+	void SetZero()
+	{
+		for (u32 k = 0; k < b3_spatialLaneCount; ++k)
+		{
+			x.v[k] = 0.0f;
+			y.v[k] = 0.0f;
+			z.v[k] = 0.0f;
+		}
+	}
+
+	// Set the vector of a lane.
+	void Set(u32 k, const b3Vec3& a)
+	{
+		x.v[k] = a.x;
+		y.v[k] = a.y;
+		z.v[k] = a.z;
+	}
+
+	// Get the vector of a lane.
+	b3Vec3 Get(u32 k) const
+	{
+		return b3Vec3(x.v[k], y.v[k], z.v[k]);
+	}
+
+	const b3LaneFloat& operator[](u32 i) const
+	{
+		return (&x)[i];
+	}
+
+	b3LaneFloat& operator[](u32 i)
+	{
+		return (&x)[i];
+	}
+
+	void operator+=(const b3LaneVec3& b)
+	{
+		for (u32 k = 0; k < b3_spatialLaneCount; ++k)
+		{
+			x.v[k] += b.x.v[k];
+			y.v[k] += b.y.v[k];
+			z.v[k] += b.z.v[k];
+		}
+	}
+
+	void operator-=(const b3LaneVec3& b)
+	{
+		for (u32 k = 0; k < b3_spatialLaneCount; ++k)
+		{
+			x.v[k] -= b.x.v[k];
+			y.v[k] -= b.y.v[k];
+			z.v[k] -= b.z.v[k];
+		}
+	}
+
+	b3LaneFloat x, y, z;
+};
+
+// The vector operations loop over the lanes once, which keeps them small enough to be inlined.
+
+inline b3LaneVec3 operator+(const b3LaneVec3& a, const b3LaneVec3& b)
+{
+	b3LaneVec3 r;
+	for (u32 k = 0; k < b3_spatialLaneCount; ++k)
+	{
+		r.x.v[k] = a.x.v[k] + b.x.v[k];
+		r.y.v[k] = a.y.v[k] + b.y.v[k];
+		r.z.v[k] = a.z.v[k] + b.z.v[k];
+	}
+	return r;
+}
+
+inline b3LaneVec3 operator-(const b3LaneVec3& a, const b3LaneVec3& b)
+{
+	b3LaneVec3 r;
+	for (u32 k = 0; k < b3_spatialLaneCount; ++k)
+	{
+		r.x.v[k] = a.x.v[k] - b.x.v[k];
+		r.y.v[k] = a.y.v[k] - b.y.v[k];
+		r.z.v[k] = a.z.v[k] - b.z.v[k];
+	}
+	return r;
+}
+
+inline b3LaneVec3 operator-(const b3LaneVec3& a)
+{
+	b3LaneVec3 r;
+	for (u32 k = 0; k < b3_spatialLaneCount; ++k)
+	{
+		r.x.v[k] = -a.x.v[k];
+		r.y.v[k] = -a.y.v[k];
+		r.z.v[k] = -a.z.v[k];
+	}
+	return r;
+}
+
+inline b3LaneVec3 operator*(const b3LaneFloat& s, const b3LaneVec3& a)
+{
+	b3LaneVec3 r;
+	for (u32 k = 0; k < b3_spatialLaneCount; ++k)
+	{
+		r.x.v[k] = s.v[k] * a.x.v[k];
+		r.y.v[k] = s.v[k] * a.y.v[k];
+		r.z.v[k] = s.v[k] * a.z.v[k];
+	}
+	return r;
+}
+
+inline b3LaneFloat b3Dot(const b3LaneVec3& a, const b3LaneVec3& b)
+{
+	b3LaneFloat r;
+	for (u32 k = 0; k < b3_spatialLaneCount; ++k)
+	{
+		r.v[k] = a.x.v[k] * b.x.v[k] + a.y.v[k] * b.y.v[k] + a.z.v[k] * b.z.v[k];
+	}
+	return r;
+}
+
+inline b3LaneVec3 b3Cross(const b3LaneVec3& a, const b3LaneVec3& b)
+{
+	b3LaneVec3 r;
+	for (u32 k = 0; k < b3_spatialLaneCount; ++k)
+	{
+		r.x.v[k] = a.y.v[k] * b.z.v[k] - a.z.v[k] * b.y.v[k];
+		r.y.v[k] = a.z.v[k] * b.x.v[k] - a.x.v[k] * b.z.v[k];
+		r.z.v[k] = a.x.v[k] * b.y.v[k] - a.y.v[k] * b.x.v[k];
+	}
+	return r;
+}
+
+inline b3LaneVec3 b3Min(const b3LaneVec3& a, const b3LaneVec3& b)
+{
+	return b3LaneVec3(b3Min(a.x, b.x), b3Min(a.y, b.y), b3Min(a.z, b.z));
+}
+
+inline b3LaneVec3 b3Max(const b3LaneVec3& a, const b3LaneVec3& b)
+{
+	return b3LaneVec3(b3Max(a.x, b.x), b3Max(a.y, b.y), b3Max(a.z, b.z));
+}
+
+// A 3-by-3 matrix per lane stored in column-major order.
+struct b3LaneMat33
+{
+	b3LaneMat33() { }
+
+	b3LaneMat33(const b3LaneVec3& _x, const b3LaneVec3& _y, const b3LaneVec3& _z) : x(_x), y(_y), z(_z) { }
+
+	void SetZero()
+	{
+		x.SetZero();
+		y.SetZero();
+		z.SetZero();
+	}
+
+	// Set the matrix of a lane.
+	void Set(u32 k, const b3Mat33& A)
+	{
+		x.Set(k, A.x);
+		y.Set(k, A.y);
+		z.Set(k, A.z);
+	}
+
+	// Get the matrix of a lane.
+	b3Mat33 Get(u32 k) const
+	{
+		return b3Mat33(x.Get(k), y.Get(k), z.Get(k));
+	}
+
+	const b3LaneVec3& operator[](u32 i) const
+	{
+		return (&x)[i];
+	}
+
+	b3LaneVec3& operator[](u32 i)
+	{
+		return (&x)[i];
+	}
+
+	void operator+=(const b3LaneMat33& B)
+	{
+		x += B.x;
+		y += B.y;
+		z += B.z;
+	}
+
+	void operator-=(const b3LaneMat33& B)
+	{
+		x -= B.x;
+		y -= B.y;
+		z -= B.z;
+	}
+
+	b3LaneVec3 x, y, z;
+};
+
+inline b3LaneMat33 operator+(const b3LaneMat33& A, const b3LaneMat33& B)
+{
+	return b3LaneMat33(A.x + B.x, A.y + B.y, A.z + B.z);
+}
+
+inline b3LaneMat33 operator-(const b3LaneMat33& A, const b3LaneMat33& B)
+{
+	return b3LaneMat33(A.x - B.x, A.y - B.y, A.z - B.z);
+}
+
+inline b3LaneMat33 operator*(const b3LaneFloat& s, const b3LaneMat33& A)
+{
+	return b3LaneMat33(s * A.x, s * A.y, s * A.z);
+}
+
+inline b3LaneMat33 operator-(const b3LaneMat33& A)
+{
+	return b3LaneFloat(-1.0f) * A;
+}
+
+inline b3LaneVec3 operator*(const b3LaneMat33& A, const b3LaneVec3& v)
+{
+	b3LaneVec3 r;
+	for (u32 k = 0; k < b3_spatialLaneCount; ++k)
+	{
+		r.x.v[k] = v.x.v[k] * A.x.x.v[k] + v.y.v[k] * A.y.x.v[k] + v.z.v[k] * A.z.x.v[k];
+		r.y.v[k] = v.x.v[k] * A.x.y.v[k] + v.y.v[k] * A.y.y.v[k] + v.z.v[k] * A.z.y.v[k];
+		r.z.v[k] = v.x.v[k] * A.x.z.v[k] + v.y.v[k] * A.y.z.v[k] + v.z.v[k] * A.z.z.v[k];
+	}
+	return r;
+}
+
+inline b3LaneMat33 operator*(const b3LaneMat33& A, const b3LaneMat33& B)
+{
+	return b3LaneMat33(A * B.x, A * B.y, A * B.z);
+}
+
+inline b3LaneVec3 b3MulT(const b3LaneMat33& A, const b3LaneVec3& v)
+{
+	return b3LaneVec3(b3Dot(A.x, v), b3Dot(A.y, v), b3Dot(A.z, v));
+}
+
+inline b3LaneMat33 b3Transpose(const b3LaneMat33& A)
+{
+	return b3LaneMat33(
+		b3LaneVec3(A.x.x, A.y.x, A.z.x),
+		b3LaneVec3(A.x.y, A.y.y, A.z.y),
+		b3LaneVec3(A.x.z, A.y.z, A.z.z));
+}
+
+inline b3LaneMat33 b3Diagonal(const b3LaneFloat& s)
+{
+	b3LaneFloat zero(0.0f);
+	return b3LaneMat33(
+		b3LaneVec3(s, zero, zero),
+		b3LaneVec3(zero, s, zero),
+		b3LaneVec3(zero, zero, s));
+}
+
+inline b3LaneMat33 b3Skew(const b3LaneVec3& v)
+{
+	b3LaneFloat zero(0.0f);
+	return b3LaneMat33(
+		b3LaneVec3(zero, v.z, -v.y),
+		b3LaneVec3(-v.z, zero, v.x),
+		b3LaneVec3(v.y, -v.x, zero));
+}
+
+inline b3LaneMat33 b3Outer(const b3LaneVec3& a, const b3LaneVec3& b)
+{
+	return b3LaneMat33(b.x * a, b.y * a, b.z * a);
+}
+
+// Cofactor method. A singular matrix gives the zero matrix.
+inline b3LaneMat33 b3Inverse(const b3LaneMat33& A)
+{
+	b3LaneFloat det = b3SafeInverse(b3Dot(A.x, b3Cross(A.y, A.z)));
+
+	b3LaneVec3 c1 = b3Cross(A.y, A.z);
+	b3LaneVec3 c2 = b3Cross(A.z, A.x);
+	b3LaneVec3 c3 = b3Cross(A.x, A.y);
+
+	b3LaneMat33 B;
+	B.x.x = c1.x; B.x.y = c2.x; B.x.z = c3.x;
+	B.y.x = c1.y; B.y.y = c2.y; B.y.z = c3.y;
+	B.z.x = c1.z; B.z.y = c2.z; B.z.z = c3.z;
+	return det * B;
+}
+
+// Invert a symmetric matrix. A singular matrix gives the zero matrix.
+inline b3LaneMat33 b3SymInverse(const b3LaneMat33& A)
+{
+	b3LaneFloat det = b3SafeInverse(b3Dot(A.x, b3Cross(A.y, A.z)));
+
+	b3LaneFloat a11 = A.x.x, a12 = A.y.x, a13 = A.z.x;
+	b3LaneFloat a22 = A.y.y, a23 = A.z.y;
+	b3LaneFloat a33 = A.z.z;
+
+	b3LaneMat33 M;
+
+	M.x.x = det * (a22 * a33 - a23 * a23);
+	M.x.y = det * (a13 * a23 - a12 * a33);
+	M.x.z = det * (a12 * a23 - a13 * a22);
+
+	M.y.x = M.x.y;
+	M.y.y = det * (a11 * a33 - a13 * a13);
+	M.y.z = det * (a13 * a12 - a11 * a23);
+
+	M.z.x = M.x.z;
+	M.z.y = M.y.z;
+	M.z.z = det * (a11 * a22 - a12 * a12);
+
+	return M;
+}
+
+// A quaternion per lane.
+struct b3LaneQuat
+{
+	b3LaneQuat() { }
+
+	b3LaneQuat(const b3LaneFloat& _x, const b3LaneFloat& _y, const b3LaneFloat& _z, const b3LaneFloat& _w) : x(_x), y(_y), z(_z), w(_w) { }
+
+	// Set the quaternion of a lane.
+	void Set(u32 k, const b3Quat& q)
+	{
+		x.v[k] = q.x;
+		y.v[k] = q.y;
+		z.v[k] = q.z;
+		w.v[k] = q.w;
+	}
+
+	// Get the quaternion of a lane.
+	b3Quat Get(u32 k) const
+	{
+		return b3Quat(x.v[k], y.v[k], z.v[k], w.v[k]);
+	}
+
+	void operator+=(const b3LaneQuat& q)
+	{
+		x = x + q.x;
+		y = y + q.y;
+		z = z + q.z;
+		w = w + q.w;
+	}
+
+	// Convert this quaternion to the unit quaternion.
+	// A lane whose length is too small isn't changed.
+	void Normalize()
+	{
+		b3LaneFloat s;
+		for (u32 k = 0; k < b3_spatialLaneCount; ++k)
+		{
+			float32 length = b3Sqrt(x.v[k] * x.v[k] + y.v[k] * y.v[k] + z.v[k] * z.v[k] + w.v[k] * w.v[k]);
+			s.v[k] = length > B3_EPSILON ? 1.0f / length : 1.0f;
+		}
+
+		x = x * s;
+		y = y * s;
+		z = z * s;
+		w = w * s;
+	}
+
+	b3LaneFloat x, y, z, w;
+};
+
+inline b3LaneQuat operator*(const b3LaneFloat& s, const b3LaneQuat& q)
+{
+	return b3LaneQuat(s * q.x, s * q.y, s * q.z, s * q.w);
+}
+
+inline b3LaneQuat operator*(const b3LaneQuat& a, const b3LaneQuat& b)
+{
+	return b3LaneQuat(
+		a.w * b.x + a.x * b.w + a.y * b.z - a.z * b.y,
+		a.w * b.y + a.y * b.w + a.z * b.x - a.x * b.z,
+		a.w * b.z + a.z * b.w + a.x * b.y - a.y * b.x,
+		a.w * b.w - a.x * b.x - a.y * b.y - a.z * b.z);
+}
+
+inline b3LaneQuat b3Conjugate(const b3LaneQuat& q)
+{
+	return b3LaneQuat(-q.x, -q.y, -q.z, q.w);
+}
+
+// Rotate a vector.
+inline b3LaneVec3 b3Mul(const b3LaneQuat& q, const b3LaneVec3& v)
+{
+	b3LaneVec3 qv(q.x, q.y, q.z);
+	b3LaneFloat qs = q.w;
+
+	b3LaneVec3 t = b3LaneFloat(2.0f) * b3Cross(qv, v);
+	return v + qs * t + b3Cross(qv, t);
+}
+
+// Convert a rotation quaternion to a 3-by-3 rotation matrix.
+inline b3LaneMat33 b3QuatMat33(const b3LaneQuat& q)
+{
+	b3LaneFloat x = q.x, y = q.y, z = q.z, w = q.w;
+	b3LaneFloat x2 = x + x, y2 = y + y, z2 = z + z;
+	b3LaneFloat xx = x * x2, xy = x * y2, xz = x * z2;
+	b3LaneFloat yy = y * y2, yz = y * z2, zz = z * z2;
+	b3LaneFloat wx = w * x2, wy = w * y2, wz = w * z2;
+	b3LaneFloat one(1.0f);
+
+	return b3LaneMat33(
+		b3LaneVec3(one - (yy + zz), xy + wz, xz - wy),
+		b3LaneVec3(xy - wz, one - (xx + zz), yz + wx),
+		b3LaneVec3(xz + wy, yz - wx, one - (xx + yy)));
+}
+
+// A transform per lane.
+struct b3LaneTransform
+{
+	// Set the transform of a lane.
+	void Set(u32 k, const b3Transform& X)
+	{
+		rotation.Set(k, X.rotation);
+		position.Set(k, X.position);
+	}
+
+	// Get the transform of a lane.
+	b3Transform Get(u32 k) const
+	{
+		b3Transform X;
+		X.rotation = rotation.Get(k);
+		X.position = position.Get(k);
+		return X;
+	}
+
+	b3LaneMat33 rotation;
+	b3LaneVec3 position;
+};
+
+inline b3LaneTransform operator*(const b3LaneTransform& A, const b3LaneTransform& B)
+{
+	b3LaneTransform C;
+	C.rotation = A.rotation * B.rotation;
+	C.position = A.rotation * B.position + A.position;
+	return C;
+}
+
+inline b3LaneTransform b3Inverse(const b3LaneTransform& T)
+{
+	b3LaneTransform B;
+	B.rotation = b3Transpose(T.rotation);
+	B.position = b3MulT(T.rotation, -T.position);
+	return B;
+}
+
+// A 6-by-1 motion vector per lane.
+struct b3LaneMotionVec
+{
+	b3LaneMotionVec() { }
+
+	b3LaneMotionVec(const b3LaneVec3& _w, const b3LaneVec3& _v) : w(_w), v(_v) { }
+
+	void SetZero()
+	{
+		w.SetZero();
+		v.SetZero();
+	}
+
+	b3LaneVec3 w, v;
+};
+
+inline b3LaneMotionVec operator+(const b3LaneMotionVec& a, const b3LaneMotionVec& b)
+{
+	return b3LaneMotionVec(a.w + b.w, a.v + b.v);
+}
+
+inline b3LaneMotionVec operator*(const b3LaneMotionVec& a, const b3LaneFloat& s)
+{
+	return b3LaneMotionVec(s * a.w, s * a.v);
+}
+
+// A 6-by-1 force vector per lane.
+struct b3LaneForceVec
+{
+	b3LaneForceVec() { }
+
+	b3LaneForceVec(const b3LaneVec3& _n, const b3LaneVec3& _f) : n(_n), f(_f) { }
+
+	void SetZero()
+	{
+		n.SetZero();
+		f.SetZero();
+	}
+
+	void operator+=(const b3LaneForceVec& b)
+	{
+		n += b.n;
+		f += b.f;
+	}
+
+	b3LaneVec3 n, f;
+};
+
+inline b3LaneForceVec operator+(const b3LaneForceVec& a, const b3LaneForceVec& b)
+{
+	return b3LaneForceVec(a.n + b.n, a.f + b.f);
+}
+
+inline b3LaneForceVec operator-(const b3LaneForceVec& a, const b3LaneForceVec& b)
+{
+	return b3LaneForceVec(a.n - b.n, a.f - b.f);
+}
+
+inline b3LaneForceVec operator-(const b3LaneForceVec& a)
+{
+	return b3LaneForceVec(-a.n, -a.f);
+}
+
+inline b3LaneForceVec operator*(const b3LaneForceVec& a, const b3LaneFloat& s)
+{
+	return b3LaneForceVec(s * a.n, s * a.f);
+}
+
+inline b3LaneForceVec operator*(const b3LaneFloat& s, const b3LaneForceVec& a)
+{
+	return b3LaneForceVec(s * a.n, s * a.f);
+}
+
+inline b3LaneFloat b3Dot(const b3LaneMotionVec& a, const b3LaneForceVec& b)
+{
+	return b3Dot(a.v, b.n) + b3Dot(a.w, b.f);
+}
+
+// A 6-by-6 spatial inertia matrix per lane. See b3SpInertia.
+struct b3LaneSpInertia
+{
+	b3LaneSpInertia() { }
+
+	void SetZero()
+	{
+		A.SetZero();
+		B.SetZero();
+		C.SetZero();
+	}
+
+	// Set this matrix from mass and rotational inertia
+	// about the local center of mass (zero vector).
+	void SetLocalInertia(const b3LaneFloat& m, const b3LaneMat33& I)
+	{
+		A.SetZero();
+		B = b3Diagonal(m);
+		C = I;
+	}
+
+	void operator-=(const b3LaneSpInertia& M)
+	{
+		A -= M.A;
+		B -= M.B;
+		C -= M.C;
+	}
+
+	void operator+=(const b3LaneSpInertia& M)
+	{
+		A += M.A;
+		B += M.B;
+		C += M.C;
+	}
+
+	// Solve Ax = b.
+	b3LaneMotionVec Solve(const b3LaneForceVec& b) const;
+
+	b3LaneMat33 A, B, C;
+};
+
+inline b3LaneMotionVec b3LaneSpInertia::Solve(const b3LaneForceVec& b) const
+{
+	// Block matrix inversion. See b3SpInertia::Solve.
+	b3LaneMat33 invA_A, invA_B, invA_C, invA_D;
+
+	b3LaneMat33 D = b3Transpose(A);
+	b3LaneMat33 NinvB = -b3Inverse(B);
+
+	invA_B = b3Inverse(D * NinvB * A + C);
+	invA_A = invA_B * D * NinvB;
+	invA_D = b3Transpose(invA_A);
+
+	b3LaneMat33 T = A * invA_A;
+	T.x.x = T.x.x - 1.0f;
+	T.y.y = T.y.y - 1.0f;
+	T.z.z = T.z.z - 1.0f;
+
+	invA_C = NinvB * T;
+
+	b3LaneMotionVec x;
+	x.w = invA_A * b.n + invA_B * b.f;
+	x.v = invA_C * b.n + invA_D * b.f;
+	return x;
+}
+
+// s * M
+inline b3LaneSpInertia operator*(const b3LaneFloat& s, const b3LaneSpInertia& M)
+{
+	b3LaneSpInertia result;
+	result.A = s * M.A;
+	result.B = s * M.B;
+	result.C = s * M.C;
+	return result;
+}
+
+// M * v
+inline b3LaneForceVec operator*(const b3LaneSpInertia& M, const b3LaneMotionVec& v)
+{
+	b3LaneForceVec result;
+	result.n = M.A * v.w + M.B * v.v;
+	result.f = M.C * v.w + b3MulT(M.A, v.v);
+	return result;
+}
+
+// a * b^T
+inline b3LaneSpInertia b3Outer(const b3LaneForceVec& a, const b3LaneForceVec& b)
+{
+	b3LaneSpInertia result;
+	result.A = b3Outer(a.n, b.f);
+	result.B = b3Outer(a.n, b.n);
+	result.C = b3Outer(a.f, b.f);
+	return result;
+}
+
+// A spatial transformation per lane. See b3SpTransform.
+struct b3LaneSpTransform
+{
+	b3LaneMat33 E;
+	b3LaneVec3 r;
+};
+
+// X * v
+inline b3LaneMotionVec b3Mul(const b3LaneSpTransform& X, const b3LaneMotionVec& v)
+{
+	b3LaneMotionVec result;
+	result.w = X.E * v.w;
+	result.v = -b3Cross(X.r, X.E * v.w) + X.E * v.v;
+	return result;
+}
+
+// X^-1 * v
+inline b3LaneForceVec b3MulT(const b3LaneSpTransform& X, const b3LaneForceVec& v)
+{
+	b3LaneForceVec result;
+	result.n = b3MulT(X.E, v.n);
+	result.f = b3MulT(X.E, v.f + b3Cross(X.r, v.n));
+	return result;
+}
+
+// X^-1 * I
+inline b3LaneSpInertia b3MulT(const b3LaneSpTransform& X, const b3LaneSpInertia& I)
+{
+	b3LaneMat33 E = X.E;
+	b3LaneMat33 ET = b3Transpose(X.E);
+	b3LaneMat33 rx = b3Skew(X.r);
+
+	b3LaneSpInertia result;
+	result.A = ET * (I.A - I.B * rx) * E;
+	result.B = ET * I.B * E;
+	result.C = ET * (rx * (I.A - I.B * rx) + I.C - b3Transpose(I.A) * rx) * E;
+	return result;
+}
+
+#endif
\ No newline at end of file
@@ -26,6 +26,18 @@
 
 struct b3SoftBodyNode;
 class b3Shape;
+class b3NodeBodyContact;
+
+// A contact edge for the node-body contact graph, 
+// where a node is a vertex and a contact an edge.
+struct b3NodeBodyContactEdge
+{
+	b3Shape* other;
+	b3NodeBodyContact* contact;
+	// Links to the node contact edge list.
+	b3NodeBodyContactEdge* m_prev;
+	b3NodeBodyContactEdge* m_next;
+};
 
 // A contact between a node and a body
 class b3NodeBodyContact
@@ -48,6 +60,9 @@ private:
 	b3SoftBodyNode* m_n1;
 	b3Shape* m_s2;
 
+	// To the node edge list.
+	b3NodeBodyContactEdge m_edge1;
+
 	// Is the contact active?
 	bool m_active;
 	
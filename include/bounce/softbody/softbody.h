@@ -20,11 +20,14 @@
 #define B3_SOFT_BODY_H
 
 #include <bounce/softbody/softbody_contact_manager.h>
+#include <bounce/softbody/softbody_mesh.h>
 #include <bounce/common/memory/stack_allocator.h>
+#include <bounce/sparse/csr_mat33.h>
+#include <bounce/sparse/mpcg.h>
+#include <bounce/collision/trees/static_tree.h>
 
 class b3World;
-
-struct b3SoftBodyMesh;
+class b3ThreadPool;
 
 struct b3SoftBodyNode;
 struct b3SoftBodyElement;
@@ -41,6 +44,7 @@ struct b3SoftBodyRayCastSingleOutput
 };
 
 // Soft body tetrahedron element
+// The data used by the solver on every step is stored in arrays in the soft body.
 struct b3SoftBodyElement
 {
 	float32 E;
@@ -50,14 +54,36 @@ struct b3SoftBodyElement
 	float32 c_creep;
 	float32 c_max;
 
-	b3Mat33 K[16]; // 12 x 12
-	b3Mat33 invE;
-	b3Quat q;
-	float32 B[72]; // 6 x 12
-	float32 P[72]; // V * BT * E -> 12 x 6
+	// Index of the plastic state of this element.
+	// This is B3_MAX_U32 if the element is elastic only.
+	u32 plasticIndex;
+};
+
+// Plastic state of a soft body element
+// The strain-displacement matrix B and the plastic force matrix P = V * BT * D 
+// are derived from the shape function gradients and the Lame parameters.
+struct b3SoftBodyElementPlasticity
+{
+	b3Vec3 gradients[4];
+	float32 volume;
+	float32 lambda;
+	float32 mu;
 	float32 epsilon_plastic[6]; // 6 x 1
 };
 
+// The element stiffness matrix is 12 x 12 and symmetric. 
+// Only its 10 upper triangle 3 x 3 blocks are stored, row by row.
+// Return the index of the block (i, j) for i <= j.
+inline u32 b3GetElementBlockIndex(u32 i, u32 j)
+{
+	B3_ASSERT(i <= j && j < 4);
+	static const u32 offsets[4] = { 0, 3, 5, 6 };
+	return offsets[i] + j;
+}
+
+// The number of stiffness blocks stored per element.
+const u32 b3_elementBlockCount = 10;
+
 // Soft body tetrahedron triangle
 struct b3SoftBodyTriangle
 {
@@ -65,6 +91,79 @@ struct b3SoftBodyTriangle
 	u32 tetrahedron;
 };
 
+// The binary soft body cache identifier ("B3SB") and version.
+// The version must be incremented whenever the layout of the
+// binary data or the element data changes.
+#define B3_SOFT_BODY_CACHE_BINARY_MAGIC (0x42533342)
+#define B3_SOFT_BODY_CACHE_BINARY_VERSION (2)
+
+// The header of a binary soft body cache.
+// A binary cache is a single relocatable memory block containing
+// this header followed by the mesh, the node masses, the element data 
+// and the index maps of a reordered mesh.
+// All offsets are in bytes relative to the beginning of the block
+// and are 16-byte aligned. Data is stored in native byte order.
+struct b3SoftBodyCacheBinaryHeader
+{
+	u32 magic;
+	u32 version;
+	u32 size;
+	u32 vertexCount;
+	u32 vertexOffset;
+	u32 tetrahedronCount;
+	u32 tetrahedronOffset;
+	u32 massOffset;
+	u32 elementOffset;
+	u32 stiffnessOffset;
+	u32 invEOffset;
+	u32 plasticElementCount;
+	u32 plasticityOffset;
+	u32 vertexIndexOffset;
+	u32 tetrahedronIndexOffset;
+	float32 density;
+};
+
+// The data of a soft body that only depends on its mesh and material.
+// This is the mesh, the node masses and the element data.
+// A soft body created from a cache copies this data instead of computing it.
+// A cache is written by a soft body. See b3SoftBody::WriteCacheBinary.
+struct b3SoftBodyCache
+{
+	// Set this cache from a buffer containing a binary cache such as a memory mapped file.
+	// No data is copied. This cache points directly into the buffer.
+	// Therefore the buffer must be 16-byte aligned and remain valid
+	// while this cache and the soft bodies created from it are used.
+	// Return false if the buffer doesn't contain a valid binary cache.
+	bool ReadBinary(const void* buffer, u32 size);
+
+	// Soft body mesh
+	b3SoftBodyMesh mesh;
+
+	// Density in kg/m^3
+	float32 density;
+
+	// Node masses
+	const float32* masses;
+
+	// Elements
+	const b3SoftBodyElement* elements;
+
+	// Element stiffness matrices. See b3SoftBody.
+	const b3Mat33* elementStiffness;
+
+	// Element inverse rest edge matrices
+	const b3Mat33* elementInvE;
+
+	// Rest plastic states of the elements that aren't elastic only
+	u32 plasticElementCount;
+	const b3SoftBodyElementPlasticity* elementPlasticity;
+
+	// Vertex and tetrahedron index maps from the definition mesh to the cache mesh.
+	// These are null if the mesh wasn't reordered.
+	const u32* vertexIndices;
+	const u32* tetrahedronIndices;
+};
+
 // Soft body definition
 // This requires defining a soft body mesh which is typically bound to a render mesh
 // and some uniform material parameters.
@@ -73,17 +172,30 @@ struct b3SoftBodyDef
 	b3SoftBodyDef()
 	{
 		mesh = nullptr;
+		cache = nullptr;
 		density = 0.1f;
 		E = 100.0f;
 		nu = 0.3f;
 		c_yield = B3_MAX_FLOAT;
 		c_creep = 0.0f;
 		c_max = 0.0f;
+		preconditioner = e_jacobiPreconditioner;
+		matrixFree = false;
+		refitBroadPhase = true;
+		allowSleep = true;
+		timeToSleep = B3_TIME_TO_SLEEP;
+		reorderMesh = false;
 	}
 
 	// Soft body mesh
 	const b3SoftBodyMesh* mesh;
 
+	// Precomputed soft body data.
+	// If this is set then the mesh, the density and the material
+	// parameters of the cache are used instead of the ones above.
+	// The cache must remain valid while the soft body is used.
+	const b3SoftBodyCache* cache;
+
 	// Density in kg/m^3
 	float32 density;
 
@@ -106,6 +218,35 @@ struct b3SoftBodyDef
 	// Material maximum plastic strain in [0, inf]
 	// This is a dimensionless value
 	float32 c_max;
+
+	// Preconditioner of the linear solver
+	b3MPCGPreconditioner preconditioner;
+
+	// If this is true then the stiffness matrix is never assembled.
+	// Instead the linear solver applies the element stiffness matrices directly.
+	// This uses less memory but each solver iteration does more work.
+	// The SSOR preconditioner is replaced by the block Jacobi preconditioner in this mode.
+	bool matrixFree;
+
+	// If this is true then the node AABBs are refitted in the broad-phase tree 
+	// instead of being reinserted when the nodes move.
+	// The tree is rebuilt when its quality degrades.
+	bool refitBroadPhase;
+
+	// Can this soft body fall asleep?
+	bool allowSleep;
+
+	// Time the nodes must be resting before this soft body falls asleep
+	float32 timeToSleep;
+
+	// If this is true then the soft body keeps a copy of the mesh with the vertices in
+	// reverse Cuthill-McKee order and the tetrahedrons sorted by their vertices.
+	// This reduces the bandwidth of the stiffness matrix and improves memory locality.
+	// The nodes and the elements are numbered after the copy.
+	// See b3SoftBody::GetVertexIndex and b3SoftBody::GetTetrahedronIndex.
+	// This is ignored if a cache is used. A cache written by a reordered soft body
+	// contains the reordered mesh and the index maps.
+	bool reorderMesh;
 };
 
 // A soft body represents a deformable volume as a collection of nodes and elements.
@@ -132,9 +273,50 @@ public:
 	const b3World* GetWorld() const;
 	b3World* GetWorld();
 
+	// Set the threads used by the linear solver. 
+	// The results are the same for any number of threads.
+	// If this is null then the solver runs on the calling thread.
+	void SetThreadPool(b3ThreadPool* threadPool);
+
+	// Get the threads used by the linear solver.
+	b3ThreadPool* GetThreadPool() const;
+
+	// Enable or disable sleeping for this soft body.
+	// If sleeping is disabled then the soft body is woken up.
+	void SetSleepingAllowed(bool flag);
+
+	// Can this soft body fall asleep?
+	bool IsSleepingAllowed() const;
+
+	// Set the time the nodes must be resting before this soft body falls asleep.
+	void SetTimeToSleep(float32 time);
+
+	// Get the time the nodes must be resting before this soft body falls asleep.
+	float32 GetTimeToSleep() const;
+
+	// Wake up or put to sleep this soft body.
+	// The nodes of a sleeping soft body aren't simulated.
+	void SetAwake(bool flag);
+
+	// Is this soft body awake?
+	bool IsAwake() const;
+
 	// Return the soft body mesh proxy.
+	// This is a reordered copy of the definition mesh if the mesh was reordered.
 	const b3SoftBodyMesh* GetMesh() const;
 
+	// Return the index in the soft body mesh of a given vertex of the definition mesh.
+	u32 GetVertexIndex(u32 originalIndex) const;
+
+	// Return the index in the definition mesh of a given vertex of the soft body mesh.
+	u32 GetOriginalVertexIndex(u32 index) const;
+
+	// Return the index in the soft body mesh of a given tetrahedron of the definition mesh.
+	u32 GetTetrahedronIndex(u32 originalIndex) const;
+
+	// Return the index in the definition mesh of a given tetrahedron of the soft body mesh.
+	u32 GetOriginalTetrahedronIndex(u32 index) const;
+
 	// Return the node associated with the given vertex.
 	b3SoftBodyNode* GetVertexNode(u32 i);
 
@@ -149,18 +331,45 @@ public:
 
 	// Debug draw the body using the associated mesh.
 	void Draw() const;
+
+	// Get the number of bytes required to write the cache of this soft body in the binary format.
+	u32 GetCacheBinarySize() const;
+
+	// Write the mesh, the node masses and the element data of this soft body
+	// into a given buffer in the binary cache format. See b3SoftBodyCache.
+	// The buffer must be at least GetCacheBinarySize() bytes long.
+	// The plastic strains are written as zero.
+	void WriteCacheBinary(void* buffer) const;
 private:
 	friend class b3SoftBodyContactManager;
 	friend class b3SoftBodySolver;
 	friend class b3SoftBodyForceSolver;
 	friend struct b3SoftBodyNode;
 
+	// Copy a given mesh into the reordered mesh and build the index maps.
+	void ReorderMesh(const b3SoftBodyMesh* mesh);
+
 	// Compute mass of each node.
 	void ComputeMass();
 
+	// Compute the element data from the material of a definition.
+	void ComputeElements(const b3SoftBodyDef& def);
+
+	// Copy the precomputed element data of a cache.
+	void CopyElements(const b3SoftBodyCache* cache);
+
 	// Solve
 	void Solve(float32 dt, const b3Vec3& gravity, u32 velocityIterations, u32 positionIterations);
 
+	// Wake up this soft body if an awake body touches its sleeping bounds.
+	void WakeUp();
+
+	// Update the sleep timer and put this soft body to sleep if its nodes are resting.
+	void UpdateSleep(float32 dt);
+
+	// Stop the nodes and compute the sleeping bounds.
+	void PutToSleep();
+
 	// Stack allocator
 	b3StackAllocator m_stackAllocator;
 
@@ -170,6 +379,17 @@ private:
 	// Proxy mesh
 	const b3SoftBodyMesh* m_mesh;
 
+	// Reordered copy of the definition mesh.
+	// The proxy mesh points to this if the mesh was reordered.
+	b3SoftBodyMesh m_orderedMesh;
+
+	// Vertex and tetrahedron index maps between the definition mesh and the proxy mesh.
+	// These are null if the mesh wasn't reordered.
+	u32* m_vertexIndices;
+	u32* m_originalVertices;
+	u32* m_tetrahedronIndices;
+	u32* m_originalTetrahedrons;
+
 	// Soft body density
 	float32 m_density;
 
@@ -179,19 +399,74 @@ private:
 	// Soft body elements
 	b3SoftBodyElement* m_elements;
 
-	// Soft body triangles
+	// Element stiffness matrices. 
+	// There are b3_elementBlockCount blocks per element. See b3GetElementBlockIndex.
+	b3Mat33* m_elementStiffness;
+
+	// Element inverse rest edge matrices
+	b3Mat33* m_elementInvE;
+
+	// Element rotations of the last step.
+	// These are the initial guesses for the rotation extraction.
+	b3Quat* m_elementRotations;
+
+	// Plastic states of the elements that aren't elastic only
+	u32 m_plasticElementCount;
+	b3SoftBodyElementPlasticity* m_elementPlasticity;
+
+	// Refit the surface triangle tree to the node positions.
+	void RefitTriangleTree() const;
+
+	// Soft body boundary triangles.
+	// These are the tetrahedron faces that aren't shared by two tetrahedrons.
+	u32 m_triangleCount;
 	b3SoftBodyTriangle* m_triangles;
 
+	// Tree over the boundary triangles. 
+	// The hierarchy is built once and refit when the nodes move. 
+	// The tree is refit lazily, so it can be refit by a const query.
+	mutable b3StaticTree m_triangleTree;
+	mutable bool m_triangleTreeDirty;
+
 	// Contact manager
 	b3SoftBodyContactManager m_contactManager;
 
 	// Attached world
 	b3World* m_world;
+
+	// Sparsity pattern of the stiffness matrix. 
+	// This is built from the tetrahedrons.
+	b3SparsePattern m_stiffnessPattern;
+
+	// Stiffness matrix
+	b3CSRMat33 m_K;
+
+	// Is the stiffness matrix never assembled?
+	bool m_matrixFree;
+
+	// Elements incident to each node in the matrix-free mode.
+	// The incidences of node i are in the range [m_nodeElementOffsets[i], m_nodeElementOffsets[i + 1]).
+	// An incidence is stored as 4 * element + local node index.
+	u32* m_nodeElementOffsets;
+	u32* m_nodeElements;
+
+	// Solver memory
+	b3MPCGWorkspace m_solverWorkspace;
+
+	// Sleeping
+	bool m_allowSleep;
+	bool m_awake;
+	float32 m_sleepTime;
+	float32 m_timeToSleep;
+
+	// Bounds of the nodes when this soft body fell asleep
+	b3AABB3 m_sleepAABB;
 };
 
 inline void b3SoftBody::SetGravity(const b3Vec3& gravity)
 {
 	m_gravity = gravity;
+	SetAwake(true);
 }
 
 inline b3Vec3 b3SoftBody::GetGravity() const
@@ -209,9 +484,64 @@ inline b3World* b3SoftBody::GetWorld()
 	return m_world;
 }
 
+inline void b3SoftBody::SetThreadPool(b3ThreadPool* threadPool)
+{
+	m_solverWorkspace.threadPool = threadPool;
+}
+
+inline b3ThreadPool* b3SoftBody::GetThreadPool() const
+{
+	return m_solverWorkspace.threadPool;
+}
+
+inline bool b3SoftBody::IsSleepingAllowed() const
+{
+	return m_allowSleep;
+}
+
+inline void b3SoftBody::SetTimeToSleep(float32 time)
+{
+	B3_ASSERT(time >= 0.0f);
+	m_timeToSleep = time;
+}
+
+inline float32 b3SoftBody::GetTimeToSleep() const
+{
+	return m_timeToSleep;
+}
+
+inline bool b3SoftBody::IsAwake() const
+{
+	return m_awake;
+}
+
 inline const b3SoftBodyMesh* b3SoftBody::GetMesh() const
 {
 	return m_mesh;
 }
 
+inline u32 b3SoftBody::GetVertexIndex(u32 originalIndex) const
+{
+	B3_ASSERT(originalIndex < m_mesh->vertexCount);
+	return m_vertexIndices ? m_vertexIndices[originalIndex] : originalIndex;
+}
+
+inline u32 b3SoftBody::GetOriginalVertexIndex(u32 index) const
+{
+	B3_ASSERT(index < m_mesh->vertexCount);
+	return m_originalVertices ? m_originalVertices[index] : index;
+}
+
+inline u32 b3SoftBody::GetTetrahedronIndex(u32 originalIndex) const
+{
+	B3_ASSERT(originalIndex < m_mesh->tetrahedronCount);
+	return m_tetrahedronIndices ? m_tetrahedronIndices[originalIndex] : originalIndex;
+}
+
+inline u32 b3SoftBody::GetOriginalTetrahedronIndex(u32 index) const
+{
+	B3_ASSERT(index < m_mesh->tetrahedronCount);
+	return m_originalTetrahedrons ? m_originalTetrahedrons[index] : index;
+}
+
 #endif
\ No newline at end of file
@@ -30,6 +30,8 @@ class b3SoftBodyMesh;
 struct b3SoftBodyNode;
 struct b3SoftBodyElement;
 
+struct b3DenseVec3;
+
 struct b3SoftBodyForceSolverDef
 {
 	b3SoftBody* body;
@@ -43,6 +45,10 @@ public:
 
 	void Solve(float32 dt, const b3Vec3& gravity);
 private:
+	// Extract the rotation of each element from the deformed node positions.
+	// The extraction is warm-started from the rotation of the previous step.
+	void ComputeRotations(b3Mat33* rotations, const b3DenseVec3& p);
+
 	b3SoftBody* m_body;
 	b3StackAllocator* m_allocator;
 	const b3SoftBodyMesh* m_mesh;
@@ -21,11 +21,15 @@
 
 #include <bounce/common/math/vec3.h>
 
+struct b3Mesh;
+
 struct b3SoftBodyMeshTetrahedron
 {
 	u32 v1, v2, v3, v4;
 };
 
+// A tetrahedral mesh.
+// The mesh must be manifold. A face can be shared by at most two tetrahedrons.
 struct b3SoftBodyMesh
 {
 	u32 vertexCount;
@@ -34,6 +38,15 @@ struct b3SoftBodyMesh
 	b3SoftBodyMeshTetrahedron* tetrahedrons;
 };
 
+// The location of a point inside a soft body mesh.
+// This binds a vertex of a render mesh to a tetrahedron.
+// The vertex position is the weighted sum of the tetrahedron vertices.
+struct b3SoftBodyMeshBinding
+{
+	u32 tetrahedron;
+	float32 weights[4];
+};
+
 struct b3QSoftBodyMesh : public b3SoftBodyMesh
 {
 	b3QSoftBodyMesh();
@@ -42,6 +55,14 @@ struct b3QSoftBodyMesh : public b3SoftBodyMesh
 	void SetAsSphere(float32 radius, u32 subdivisions);
 	
 	void SetAsCylinder(float32 radius, float32 ey, u32 segments);
+
+	// Fill the volume enclosed by a closed triangle mesh with tetrahedrons.
+	// The mesh bounds are divided into a grid of cubic cells with resolution cells along the longest axis.
+	// Every cell that is inside the mesh or touches its surface is split into six tetrahedrons.
+	// Therefore the surface is embedded in the tetrahedrons.
+	// If bindings isn't null then it receives the binding of each mesh vertex.
+	// The mesh doesn't need a tree.
+	void SetAsTriangleMesh(const b3Mesh* mesh, u32 resolution, b3SoftBodyMeshBinding* bindings = nullptr);
 };
 
 #endif
\ No newline at end of file
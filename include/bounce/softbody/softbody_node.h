@@ -22,9 +22,12 @@
 #include <bounce/common/math/vec2.h>
 #include <bounce/common/math/vec3.h>
 #include <bounce/common/math/transform.h>
+#include <bounce/common/template/list.h>
 
 class b3SoftBody;
 
+struct b3NodeBodyContactEdge;
+
 // Static node: Can be moved manually.
 // Kinematic node: Non-zero velocity, can be moved by the solver.
 // Dynamic node: Non-zero velocity determined by force, can be moved by the solver.
@@ -85,6 +88,12 @@ public:
 	
 	// Apply a force.
 	void ApplyForce(const b3Vec3& force);
+
+	// Is the soft body containing this node awake?
+	bool IsAwake() const;
+
+	// Wake up the soft body containing this node.
+	void SetAwake();
 private:
 	friend class b3SoftBody;
 	friend class b3SoftBodyContactManager;
@@ -139,6 +148,9 @@ private:
 	// Broadphase proxy
 	u32 m_broadPhaseId;
 
+	// Body contacts of this node.
+	b3List2<b3NodeBodyContactEdge> m_contactEdges;
+
 	// Soft body
 	b3SoftBody* m_body;
 };
@@ -153,6 +165,8 @@ inline void b3SoftBodyNode::SetType(b3SoftBodyNodeType type)
 	m_type = type;
 	m_force.SetZero();
 
+	SetAwake();
+
 	if (type == e_staticSoftBodyNode)
 	{
 		m_velocity.SetZero();
@@ -179,6 +193,8 @@ inline void b3SoftBodyNode::SetPosition(const b3Vec3& position)
 	m_position = position;
 
 	Synchronize(displacement);
+
+	SetAwake();
 }
 
 inline const b3Vec3& b3SoftBodyNode::GetPosition() const
@@ -193,6 +209,8 @@ inline void b3SoftBodyNode::SetVelocity(const b3Vec3& velocity)
 		return;
 	}
 	m_velocity = velocity;
+
+	SetAwake();
 }
 
 inline const b3Vec3& b3SoftBodyNode::GetVelocity() const
@@ -220,6 +238,8 @@ inline void b3SoftBodyNode::SetRadius(float32 radius)
 	m_radius = radius;
 	
 	Synchronize(b3Vec3_zero);
+
+	SetAwake();
 }
 
 inline float32 b3SoftBodyNode::GetRadius() const
@@ -244,6 +264,8 @@ inline void b3SoftBodyNode::ApplyForce(const b3Vec3& force)
 		return;
 	}
 	m_force += force;
+
+	SetAwake();
 }
 
 #endif
\ No newline at end of file
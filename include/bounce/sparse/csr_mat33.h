@@ -0,0 +1,359 @@
+/*
+* Copyright (c) 2016-2019 Irlan Robson https://irlanrobson.github.io
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+#ifndef B3_CSR_MAT_33_H
+#define B3_CSR_MAT_33_H
+
+#include <bounce/common/math/mat33.h>
+#include <bounce/sparse/dense_vec3.h>
+
+// The coordinates of a block in a block sparse matrix.
+struct b3SparseEntry
+{
+	u32 row;
+	u32 column;
+};
+
+// The sparsity pattern of a square block sparse matrix 
+// stored in compressed sparse row (CSR) format.
+// The blocks of row i are the blocks rowOffsets[i] to rowOffsets[i + 1] - 1.
+// The columns of each row are sorted in increasing order.
+// The diagonal blocks are always in the pattern.
+struct b3SparsePattern
+{
+	//
+	b3SparsePattern();
+	
+	//
+	~b3SparsePattern();
+
+	// Create this pattern from a list of block coordinates.
+	// The list may contain duplicates.
+	void Create(u32 rowCount, const b3SparseEntry* entries, u32 entryCount);
+
+	//
+	void Destroy();
+
+	// Get the index of the block (i, j). 
+	// Return B3_MAX_U32 if the block is not in the pattern.
+	u32 GetBlock(u32 i, u32 j) const;
+
+	u32 rowCount;
+	u32 blockCount;
+	u32* rowOffsets;
+	u32* columns;
+};
+
+// A square block sparse matrix of 3x3 blocks with a fixed sparsity pattern.
+// Blocks can only be accumulated in place. 
+// Therefore setting the matrix doesn't allocate memory.
+struct b3CSRMat33
+{
+	//
+	b3CSRMat33();
+
+	//
+	~b3CSRMat33();
+
+	// Create the blocks of this matrix for a given pattern.
+	// The pattern must remain valid while this matrix is used.
+	void Create(const b3SparsePattern* pattern);
+
+	//
+	void Destroy();
+
+	//
+	void SetZero();
+
+	// Get the block (i, j). The block must be in the pattern.
+	b3Mat33& operator()(u32 i, u32 j);
+
+	// Get the block (i, j) or zero if the block is not in the pattern.
+	const b3Mat33& operator()(u32 i, u32 j) const;
+
+	const b3SparsePattern* pattern;
+	u32 rowCount;
+	b3Mat33* values;
+};
+
+inline b3SparsePattern::b3SparsePattern()
+{
+	rowCount = 0;
+	blockCount = 0;
+	rowOffsets = nullptr;
+	columns = nullptr;
+}
+
+inline b3SparsePattern::~b3SparsePattern()
+{
+	Destroy();
+}
+
+inline void b3SparsePattern::Destroy()
+{
+	b3Free(rowOffsets);
+	rowCount = 0;
+	blockCount = 0;
+	rowOffsets = nullptr;
+	columns = nullptr;
+}
+
+inline void b3SparsePattern::Create(u32 _rowCount, const b3SparseEntry* entries, u32 entryCount)
+{
+	Destroy();
+
+	rowCount = _rowCount;
+
+	// Bucket the columns by row including the diagonal.
+	u32 capacity = rowCount + entryCount;
+	rowOffsets = (u32*)b3Alloc((rowCount + 1 + capacity) * sizeof(u32));
+	columns = rowOffsets + rowCount + 1;
+
+	for (u32 i = 0; i <= rowCount; ++i)
+	{
+		rowOffsets[i] = 0;
+	}
+
+	for (u32 i = 0; i < rowCount; ++i)
+	{
+		++rowOffsets[i + 1];
+	}
+
+	for (u32 k = 0; k < entryCount; ++k)
+	{
+		B3_ASSERT(entries[k].row < rowCount);
+		B3_ASSERT(entries[k].column < rowCount);
+		++rowOffsets[entries[k].row + 1];
+	}
+
+	for (u32 i = 0; i < rowCount; ++i)
+	{
+		rowOffsets[i + 1] += rowOffsets[i];
+	}
+
+	for (u32 i = 0; i < rowCount; ++i)
+	{
+		columns[rowOffsets[i]++] = i;
+	}
+
+	for (u32 k = 0; k < entryCount; ++k)
+	{
+		columns[rowOffsets[entries[k].row]++] = entries[k].column;
+	}
+
+	// The offsets were advanced to the end of each row.
+	for (u32 i = rowCount; i > 0; --i)
+	{
+		rowOffsets[i] = rowOffsets[i - 1];
+	}
+	rowOffsets[0] = 0;
+
+	// Sort and remove duplicates in place.
+	// Rows are short so insertion sort is used.
+	blockCount = 0;
+	for (u32 i = 0; i < rowCount; ++i)
+	{
+		u32 begin = rowOffsets[i];
+		u32 end = rowOffsets[i + 1];
+
+		for (u32 k = begin + 1; k < end; ++k)
+		{
+			u32 column = columns[k];
+			u32 l = k;
+			while (l > begin && columns[l - 1] > column)
+			{
+				columns[l] = columns[l - 1];
+				--l;
+			}
+			columns[l] = column;
+		}
+
+		rowOffsets[i] = blockCount;
+
+		for (u32 k = begin; k < end; ++k)
+		{
+			if (k == begin || columns[k] != columns[k - 1])
+			{
+				columns[blockCount++] = columns[k];
+			}
+		}
+	}
+	rowOffsets[rowCount] = blockCount;
+}
+
+inline u32 b3SparsePattern::GetBlock(u32 i, u32 j) const
+{
+	B3_ASSERT(i < rowCount);
+	B3_ASSERT(j < rowCount);
+
+	// Binary search
+	u32 low = rowOffsets[i];
+	u32 high = rowOffsets[i + 1];
+	while (low < high)
+	{
+		u32 mid = (low + high) / 2;
+		if (columns[mid] < j)
+		{
+			low = mid + 1;
+		}
+		else
+		{
+			high = mid;
+		}
+	}
+
+	if (low < rowOffsets[i + 1] && columns[low] == j)
+	{
+		return low;
+	}
+
+	return B3_MAX_U32;
+}
+
+inline b3CSRMat33::b3CSRMat33()
+{
+	pattern = nullptr;
+	rowCount = 0;
+	values = nullptr;
+}
+
+inline b3CSRMat33::~b3CSRMat33()
+{
+	Destroy();
+}
+
+inline void b3CSRMat33::Destroy()
+{
+	b3Free(values);
+	pattern = nullptr;
+	rowCount = 0;
+	values = nullptr;
+}
+
+inline void b3CSRMat33::Create(const b3SparsePattern* _pattern)
+{
+	Destroy();
+
+	pattern = _pattern;
+	rowCount = pattern->rowCount;
+	values = (b3Mat33*)b3Alloc(pattern->blockCount * sizeof(b3Mat33));
+}
+
+inline void b3CSRMat33::SetZero()
+{
+	for (u32 i = 0; i < pattern->blockCount; ++i)
+	{
+		values[i].SetZero();
+	}
+}
+
+inline b3Mat33& b3CSRMat33::operator()(u32 i, u32 j)
+{
+	u32 block = pattern->GetBlock(i, j);
+	B3_ASSERT(block != B3_MAX_U32);
+	return values[block];
+}
+
+inline const b3Mat33& b3CSRMat33::operator()(u32 i, u32 j) const
+{
+	u32 block = pattern->GetBlock(i, j);
+	if (block == B3_MAX_U32)
+	{
+		return b3Mat33_zero;
+	}
+	return values[block];
+}
+
+// out = A * v 
+// Only the rows in the range [begin, end) are computed.
+inline void b3Mul(b3DenseVec3& out, const b3CSRMat33& A, const b3DenseVec3& v, u32 begin, u32 end)
+{
+	B3_ASSERT(A.rowCount == out.n);
+	B3_ASSERT(A.rowCount == v.n);
+	B3_ASSERT(out.v != v.v);
+	B3_ASSERT(begin <= end && end <= A.rowCount);
+
+	const u32* rowOffsets = A.pattern->rowOffsets;
+	const u32* columns = A.pattern->columns;
+
+	for (u32 i = begin; i < end; ++i)
+	{
+		b3Vec3 sum(0.0f, 0.0f, 0.0f);
+		
+		for (u32 k = rowOffsets[i]; k < rowOffsets[i + 1]; ++k)
+		{
+			sum += A.values[k] * v[columns[k]];
+		}
+
+		out[i] = sum;
+	}
+}
+
+inline void b3Mul(b3DenseVec3& out, const b3CSRMat33& A, const b3DenseVec3& v)
+{
+	b3Mul(out, A, v, 0, A.rowCount);
+}
+
+// out = A * v 
+// Only the rows in the range [begin, end) are computed.
+// Return the dot product of v and out over the range.
+inline float32 b3MulDot(b3DenseVec3& out, const b3CSRMat33& A, const b3DenseVec3& v, u32 begin, u32 end)
+{
+	B3_ASSERT(A.rowCount == out.n);
+	B3_ASSERT(A.rowCount == v.n);
+	B3_ASSERT(out.v != v.v);
+	B3_ASSERT(begin <= end && end <= A.rowCount);
+
+	const u32* rowOffsets = A.pattern->rowOffsets;
+	const u32* columns = A.pattern->columns;
+
+	float32 result = 0.0f;
+
+	for (u32 i = begin; i < end; ++i)
+	{
+		b3Vec3 sum(0.0f, 0.0f, 0.0f);
+		
+		for (u32 k = rowOffsets[i]; k < rowOffsets[i + 1]; ++k)
+		{
+			sum += A.values[k] * v[columns[k]];
+		}
+
+		out[i] = sum;
+		
+		result += b3Dot(v[i], sum);
+	}
+
+	return result;
+}
+
+// out = A * v 
+// Return v * out.
+inline float32 b3MulDot(b3DenseVec3& out, const b3CSRMat33& A, const b3DenseVec3& v)
+{
+	return b3MulDot(out, A, v, 0, A.rowCount);
+}
+
+inline b3DenseVec3 operator*(const b3CSRMat33& A, const b3DenseVec3& v)
+{
+	b3DenseVec3 result(v.n);
+	b3Mul(result, A, v);
+	return result;
+}
+
+#endif
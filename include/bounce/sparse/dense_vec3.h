@@ -97,6 +97,22 @@ struct b3DenseVec3
 		}
 	}
 
+	// Set the number of elements. 
+	// Memory is only reallocated if the number of elements changes.
+	// The elements are undefined after a reallocation.
+	void Resize(u32 _n)
+	{
+		if (n == _n)
+		{
+			return;
+		}
+
+		b3Free(v);
+
+		n = _n;
+		v = (b3Vec3*)b3Alloc(n * sizeof(b3Vec3));
+	}
+
 	b3Vec3* v;
 	u32 n;
 };
@@ -136,19 +152,26 @@ inline void b3Negate(b3DenseVec3& out, const b3DenseVec3& v)
 	b3Mul(out, -1.0f, v);
 }
 
-inline float32 b3Dot(const b3DenseVec3& a, const b3DenseVec3& b)
-{
-	B3_ASSERT(a.n == b.n);
+// The following kernels work in place and don't allocate memory.
+// They are vectorized if SIMD instructions are available.
+// The overloads taking a range [begin, end) only touch the elements in that range.
 
-	float32 result = 0.0f;
+// Return a * b.
+float32 b3Dot(const b3DenseVec3& a, const b3DenseVec3& b);
+float32 b3Dot(const b3DenseVec3& a, const b3DenseVec3& b, u32 begin, u32 end);
 
-	for (u32 i = 0; i < a.n; ++i)
-	{
-		result += b3Dot(a[i], b[i]);
-	}
-	
-	return result;
-}
+// y = y + a * x
+void b3Axpy(b3DenseVec3& y, float32 a, const b3DenseVec3& x);
+void b3Axpy(b3DenseVec3& y, float32 a, const b3DenseVec3& x, u32 begin, u32 end);
+
+// y = x + a * y
+void b3Xpay(b3DenseVec3& y, const b3DenseVec3& x, float32 a);
+
+// Multiply each component of a vector by the corresponding component of a scaling vector.
+// out = diag(d) * v
+// Return v * out.
+float32 b3ScaleDot(b3DenseVec3& out, const b3DenseVec3& d, const b3DenseVec3& v);
+float32 b3ScaleDot(b3DenseVec3& out, const b3DenseVec3& d, const b3DenseVec3& v, u32 begin, u32 end);
 
 inline b3DenseVec3 operator+(const b3DenseVec3& a, const b3DenseVec3& b)
 {
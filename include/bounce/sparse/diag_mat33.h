@@ -92,6 +92,22 @@ struct b3DiagMat33
 		memcpy(v, _v.v, n * sizeof(b3Mat33));
 	}
 
+	// Set the number of elements. 
+	// Memory is only reallocated if the number of elements changes.
+	// The elements are undefined after a reallocation.
+	void Resize(u32 _n)
+	{
+		if (n == _n)
+		{
+			return;
+		}
+
+		b3Free(v);
+
+		n = _n;
+		v = (b3Mat33*)b3Alloc(n * sizeof(b3Mat33));
+	}
+
 	void SetZero()
 	{
 		for (u32 i = 0; i < n; ++i)
@@ -152,6 +168,28 @@ inline void b3Mul(b3DenseVec3& out, const b3DiagMat33& a, const b3DenseVec3& b)
 	}
 }
 
+// out = A * (a - b)
+inline void b3MulSub(b3DenseVec3& out, const b3DiagMat33& A, const b3DenseVec3& a, const b3DenseVec3& b)
+{
+	B3_ASSERT(out.n == A.n && A.n == a.n && a.n == b.n);
+
+	for (u32 i = 0; i < A.n; ++i)
+	{
+		out[i] = A[i] * (a[i] - b[i]);
+	}
+}
+
+// y = A * (x + s * y)
+inline void b3MulXpay(b3DenseVec3& y, const b3DiagMat33& A, const b3DenseVec3& x, float32 s)
+{
+	B3_ASSERT(y.n == A.n && A.n == x.n);
+
+	for (u32 i = 0; i < A.n; ++i)
+	{
+		y[i] = A[i] * (x[i] + s * y[i]);
+	}
+}
+
 inline void b3Negate(b3DiagMat33& out, const b3DiagMat33& v)
 {
 	b3Mul(out, -1.0f, v);
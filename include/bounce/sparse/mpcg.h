@@ -0,0 +1,139 @@
+/*
+* Copyright (c) 2016-2019 Irlan Robson https://irlanrobson.github.io
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+#ifndef B3_MPCG_H
+#define B3_MPCG_H
+
+#include <bounce/sparse/diag_mat33.h>
+
+class b3ThreadPool;
+struct b3CSRMat33;
+
+// The number of rows in a partition of the parallel kernels.
+// The partitions don't depend on the number of threads and their partial sums 
+// are added in order. Therefore the results are the same for any number of threads.
+const u32 b3_mpcgPartitionSize = 512;
+
+// The preconditioners of the MPCG solver.
+enum b3MPCGPreconditioner
+{
+	// Inverse of the diagonal elements.
+	e_jacobiPreconditioner,
+	
+	// Inverse of the 3x3 diagonal blocks.
+	e_blockJacobiPreconditioner,
+
+	// Symmetric successive over-relaxation on the 3x3 blocks.
+	// This usually needs the least iterations but it isn't run in parallel.
+	e_ssorPreconditioner
+};
+
+// A matrix that is applied to vectors without being stored.
+// The SSOR preconditioner needs the off-diagonal blocks of the matrix.
+// Therefore the block Jacobi preconditioner is used instead of it for an operator.
+class b3MPCGOperator
+{
+public:
+	virtual ~b3MPCGOperator() { }
+
+	// out = A * v
+	virtual void Mul(b3DenseVec3& out, const b3DenseVec3& v) const = 0;
+};
+
+// The relaxation weight of the SSOR preconditioner in (0, 2).
+const float32 b3_ssorWeight = 1.0f;
+
+// The vectors used by a Modified Preconditioned Conjugate Gradient (MPCG) solver.
+// These are kept between solves so that solving doesn't allocate memory.
+struct b3MPCGWorkspace
+{
+	b3MPCGWorkspace();
+	~b3MPCGWorkspace();
+
+	// Set the number of unknowns.
+	void Resize(u32 n);
+
+	// The threads used by the kernels. 
+	// If this is null then the kernels run on the calling thread.
+	b3ThreadPool* threadPool;
+
+	// The preconditioner type
+	b3MPCGPreconditioner preconditioner;
+
+	// The matrix of the preconditioner. 
+	// This is null if the preconditioner was computed from the diagonal blocks only.
+	const b3CSRMat33* A;
+
+	// Inverse diagonal of the Jacobi preconditioner
+	b3DenseVec3 invP;
+	
+	// Inverse diagonal blocks of the block Jacobi and SSOR preconditioners
+	b3DiagMat33 invD;
+	
+	// Residual
+	b3DenseVec3 r;
+	
+	// Search direction
+	b3DenseVec3 p;
+
+	// Temporaries
+	b3DenseVec3 s;
+	b3DenseVec3 h;
+
+	// One partial sum per partition
+	u32 partitionCount;
+	u32 partitionCapacity;
+	float32* partialSums;
+};
+
+// out = A * v
+// The rows are partitioned among the threads of the workspace.
+void b3ParallelMul(b3MPCGWorkspace* workspace, b3DenseVec3& out, const b3CSRMat33& A, const b3DenseVec3& v);
+
+// Return a * b.
+// The partitions are shared among the threads of the workspace.
+float32 b3ParallelDot(b3MPCGWorkspace* workspace, const b3DenseVec3& a, const b3DenseVec3& b);
+
+// Compute the preconditioner of a given matrix.
+// The matrix must be kept while the preconditioner is used.
+void b3ComputePreconditioner(b3MPCGWorkspace* workspace, const b3CSRMat33& A);
+
+// Compute the preconditioner of a matrix given its diagonal blocks.
+// This is used with a b3MPCGOperator.
+void b3ComputePreconditioner(b3MPCGWorkspace* workspace, const b3DiagMat33& D);
+
+// Apply the preconditioner to the residual. 
+// h = inv(P) * r
+// Return r * h.
+float32 b3ApplyPreconditioner(b3MPCGWorkspace* workspace);
+
+// Run the MPCG iterations for the filtered system S * A * x = S * b.
+// On input x must contain the initial guess and r the filtered residual S * (b - A * x).
+// The preconditioner must have been computed for A.
+// Stop when r * (inv(P) * r) <= tolerance or after the maximum number of iterations.
+// Return the number of iterations.
+u32 b3IterateMPCG(b3MPCGWorkspace* workspace, b3DenseVec3& x, 
+	const b3CSRMat33& A, const b3DiagMat33& S, float32 tolerance, u32 maxIterations);
+
+// Run the MPCG iterations for a matrix given as an operator.
+// The preconditioner must have been computed from the diagonal blocks of the matrix.
+u32 b3IterateMPCG(b3MPCGWorkspace* workspace, b3DenseVec3& x, 
+	const b3MPCGOperator& A, const b3DiagMat33& S, float32 tolerance, u32 maxIterations);
+
+#endif
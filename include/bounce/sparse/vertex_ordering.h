@@ -0,0 +1,37 @@
+/*
+* Copyright (c) 2016-2019 Irlan Robson https://irlanrobson.github.io
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef B3_VERTEX_ORDERING_H
+#define B3_VERTEX_ORDERING_H
+
+#include <bounce/common/settings.h>
+
+// Compute a reverse Cuthill-McKee ordering of the vertices of a mesh.
+// The mesh is given as elementCount elements of elementSize vertex indices each.
+// Two vertices are adjacent if they share an element.
+// This ordering reduces the bandwidth of the sparse matrices built from the elements.
+// Therefore the vertices of an element are close in memory.
+// The vertex order[i] becomes the vertex i.
+void b3ComputeVertexOrder(u32* order, u32 vertexCount, const u32* elements, u32 elementCount, u32 elementSize);
+
+// Sort the elements of a mesh by their lowest vertex index after a vertex ordering.
+// The vertex i becomes the vertex vertexIndices[i].
+// The element order[i] becomes the element i.
+void b3ComputeElementOrder(u32* order, u32 vertexCount, const u32* vertexIndices, const u32* elements, u32 elementCount, u32 elementSize);
+
+#endif
\ No newline at end of file
@@ -89,6 +89,12 @@ workspace(solution_name)
 			bounce_inc_dir .. "/bounce/**.inl", 
 			bounce_src_dir .. "/bounce/**.cpp" 
 		}
+
+		filter "system:linux" 
+			buildoptions { "-pthread" }
+		
+		filter {}
+
 	project "glad"
 		kind "StaticLib"
 		language "C"
@@ -335,6 +341,31 @@ workspace(solution_name)
 
 		links { "bounce" }
 
+		filter "system:linux" 
+			links { "pthread" }
+		
+		filter {}
+
+	project "benchmark"
+		kind "ConsoleApp"
+		language "C++"
+		location ( solution_dir .. action )
+		includedirs { bounce_inc_dir, examples_inc_dir }
+		vpaths { ["Headers"] = "**.h", ["Sources"] = "**.cpp" }
+
+		files 
+		{ 
+			examples_inc_dir .. "/benchmark/**.h", 
+			examples_src_dir .. "/benchmark/**.cpp" 
+		}
+
+		links { "bounce" }
+
+		filter "system:linux" 
+			links { "pthread" }
+		
+		filter {}
+
 -- build
 if os.istarget("windows") then
 	
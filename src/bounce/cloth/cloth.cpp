@@ -24,6 +24,11 @@
 #include <bounce/cloth/forces/shear_force.h>
 #include <bounce/cloth/forces/spring_force.h>
 #include <bounce/cloth/cloth_solver.h>
+#include <bounce/sparse/vertex_ordering.h>
+#include <bounce/dynamics/world.h>
+#include <bounce/dynamics/world_listeners.h>
+#include <bounce/dynamics/shapes/shape.h>
+#include <bounce/dynamics/body.h>
 #include <bounce/common/draw.h>
 
 static B3_FORCE_INLINE u32 b3NextIndex(u32 i)
@@ -101,10 +106,43 @@ b3Cloth::b3Cloth(const b3ClothDef& def) :
 
 	m_mesh = def.mesh;
 	m_density = def.density;
+	m_orderedMesh.vertexCount = 0;
+	m_orderedMesh.vertices = nullptr;
+	m_orderedMesh.triangleCount = 0;
+	m_orderedMesh.triangles = nullptr;
+	m_orderedMesh.meshCount = 0;
+	m_orderedMesh.meshes = nullptr;
+	m_orderedMesh.sewingLineCount = 0;
+	m_orderedMesh.sewingLines = nullptr;
+	m_vertexIndices = nullptr;
+	m_originalVertices = nullptr;
+	m_triangleIndices = nullptr;
+	m_originalTriangles = nullptr;
 	m_contactManager.m_cloth = this;
+	m_contactManager.m_broadPhase.SetRefitEnabled(def.refitBroadPhase);
+	m_jacobianPatternDirty = true;
+	m_patchCount = 0;
+	m_awakePatchCount = 0;
+	m_patches = nullptr;
+	m_particlePatches = nullptr;
+	m_allowSleep = def.allowSleep;
+
+	if (def.reorderMesh)
+	{
+		ReorderMesh(def.mesh);
+		m_mesh = &m_orderedMesh;
+	}
 
 	const b3ClothMesh* m = m_mesh;
 
+	// Allocate the state of the mesh particles at once
+	m_masses = nullptr;
+	m_invMasses = nullptr;
+	m_types = nullptr;
+	m_solverParticles = nullptr;
+	m_particleCapacity = 0;
+	ResizeParticleState(m->vertexCount);
+
 	// Initialize particles
 	m_particles = (b3Particle**)b3Alloc(m->vertexCount * sizeof(b3Particle*));
 	for (u32 i = 0; i < m->vertexCount; ++i)
@@ -263,12 +301,29 @@ b3Cloth::b3Cloth(const b3ClothDef& def) :
 
 	m_gravity.SetZero();
 	m_world = nullptr;
+	m_solverWorkspace.preconditioner = def.preconditioner;
+	m_solverType = def.solver;
+	m_positionBasedIterations = def.positionBasedIterations;
 }
 
 b3Cloth::~b3Cloth()
 {
 	b3Free(m_particles);
 	b3Free(m_triangles);
+	b3Free(m_masses);
+	b3Free(m_invMasses);
+	b3Free(m_types);
+	b3Free(m_solverParticles);
+	b3Free(m_patches);
+	b3Free(m_particlePatches);
+	b3Free(m_orderedMesh.vertices);
+	b3Free(m_orderedMesh.triangles);
+	b3Free(m_orderedMesh.meshes);
+	b3Free(m_orderedMesh.sewingLines);
+	b3Free(m_vertexIndices);
+	b3Free(m_originalVertices);
+	b3Free(m_triangleIndices);
+	b3Free(m_originalTriangles);
 
 	b3Particle* p = m_particleList.m_head;
 	while (p)
@@ -287,6 +342,215 @@ b3Cloth::~b3Cloth()
 	}
 }
 
+// Return true if the sub-meshes partition the mesh and 
+// each triangle only references the vertices of its sub-mesh.
+static bool b3IsMeshPartition(const b3ClothMesh* mesh, const b3ClothMeshMesh* subMeshes, u32 subMeshCount)
+{
+	u32 vertexCount = mesh->vertexCount;
+	u32 triangleCount = mesh->triangleCount;
+
+	u32 coveredVertexCount = 0;
+	u32 coveredTriangleCount = 0;
+	for (u32 i = 0; i < subMeshCount; ++i)
+	{
+		const b3ClothMeshMesh* subMesh = subMeshes + i;
+
+		if (subMesh->startVertex > vertexCount || subMesh->vertexCount > vertexCount - subMesh->startVertex)
+		{
+			return false;
+		}
+
+		if (subMesh->startTriangle > triangleCount || subMesh->triangleCount > triangleCount - subMesh->startTriangle)
+		{
+			return false;
+		}
+
+		for (u32 j = 0; j < subMesh->triangleCount; ++j)
+		{
+			const b3ClothMeshTriangle* t = mesh->triangles + subMesh->startTriangle + j;
+
+			if (t->v1 - subMesh->startVertex >= subMesh->vertexCount ||
+				t->v2 - subMesh->startVertex >= subMesh->vertexCount ||
+				t->v3 - subMesh->startVertex >= subMesh->vertexCount)
+			{
+				return false;
+			}
+		}
+
+		coveredVertexCount += subMesh->vertexCount;
+		coveredTriangleCount += subMesh->triangleCount;
+	}
+
+	if (coveredVertexCount != vertexCount || coveredTriangleCount != triangleCount)
+	{
+		return false;
+	}
+
+	// The ranges are inside the mesh and their sizes add up to the mesh size.
+	// Therefore they partition the mesh if they don't overlap.
+	bool* covered = (bool*)b3Alloc(b3Max(vertexCount, triangleCount) * sizeof(bool));
+
+	bool partition = true;
+
+	memset(covered, 0, vertexCount * sizeof(bool));
+	for (u32 i = 0; i < subMeshCount && partition; ++i)
+	{
+		const b3ClothMeshMesh* subMesh = subMeshes + i;
+		for (u32 j = 0; j < subMesh->vertexCount; ++j)
+		{
+			u32 v = subMesh->startVertex + j;
+			if (covered[v])
+			{
+				partition = false;
+				break;
+			}
+			covered[v] = true;
+		}
+	}
+
+	memset(covered, 0, triangleCount * sizeof(bool));
+	for (u32 i = 0; i < subMeshCount && partition; ++i)
+	{
+		const b3ClothMeshMesh* subMesh = subMeshes + i;
+		for (u32 j = 0; j < subMesh->triangleCount; ++j)
+		{
+			u32 t = subMesh->startTriangle + j;
+			if (covered[t])
+			{
+				partition = false;
+				break;
+			}
+			covered[t] = true;
+		}
+	}
+
+	b3Free(covered);
+
+	return partition;
+}
+
+void b3Cloth::ReorderMesh(const b3ClothMesh* mesh)
+{
+	u32 vertexCount = mesh->vertexCount;
+	u32 triangleCount = mesh->triangleCount;
+
+	m_vertexIndices = (u32*)b3Alloc(vertexCount * sizeof(u32));
+	m_originalVertices = (u32*)b3Alloc(vertexCount * sizeof(u32));
+	m_triangleIndices = (u32*)b3Alloc(triangleCount * sizeof(u32));
+	m_originalTriangles = (u32*)b3Alloc(triangleCount * sizeof(u32));
+
+	// Reorder each sub-mesh independently so that the sub-mesh ranges stay valid.
+	b3ClothMeshMesh wholeMesh;
+	wholeMesh.vertexCount = vertexCount;
+	wholeMesh.startVertex = 0;
+	wholeMesh.triangleCount = triangleCount;
+	wholeMesh.startTriangle = 0;
+
+	u32 subMeshCount = mesh->meshCount > 0 ? mesh->meshCount : 1;
+	const b3ClothMeshMesh* subMeshes = mesh->meshCount > 0 ? mesh->meshes : &wholeMesh;
+
+	if (b3IsMeshPartition(mesh, subMeshes, subMeshCount) == false)
+	{
+		// Keep the mesh order.
+		subMeshCount = 0;
+
+		for (u32 i = 0; i < vertexCount; ++i)
+		{
+			m_vertexIndices[i] = i;
+			m_originalVertices[i] = i;
+		}
+
+		for (u32 i = 0; i < triangleCount; ++i)
+		{
+			m_triangleIndices[i] = i;
+			m_originalTriangles[i] = i;
+		}
+	}
+
+	u32* localTriangles = (u32*)b3Alloc(3 * triangleCount * sizeof(u32));
+	u32* localOrder = (u32*)b3Alloc(b3Max(vertexCount, triangleCount) * sizeof(u32));
+	u32* localIndices = (u32*)b3Alloc(vertexCount * sizeof(u32));
+
+	for (u32 i = 0; i < subMeshCount; ++i)
+	{
+		const b3ClothMeshMesh* subMesh = subMeshes + i;
+		u32 startVertex = subMesh->startVertex;
+		u32 startTriangle = subMesh->startTriangle;
+
+		// Make the vertex indices relative to the sub-mesh.
+		const b3ClothMeshTriangle* triangles = mesh->triangles + startTriangle;
+		for (u32 j = 0; j < subMesh->triangleCount; ++j)
+		{
+			const b3ClothMeshTriangle* t = triangles + j;
+
+			localTriangles[3 * j + 0] = t->v1 - startVertex;
+			localTriangles[3 * j + 1] = t->v2 - startVertex;
+			localTriangles[3 * j + 2] = t->v3 - startVertex;
+		}
+
+		b3ComputeVertexOrder(localOrder, subMesh->vertexCount, localTriangles, subMesh->triangleCount, 3);
+
+		for (u32 j = 0; j < subMesh->vertexCount; ++j)
+		{
+			localIndices[localOrder[j]] = j;
+
+			m_originalVertices[startVertex + j] = startVertex + localOrder[j];
+			m_vertexIndices[startVertex + localOrder[j]] = startVertex + j;
+		}
+
+		b3ComputeElementOrder(localOrder, subMesh->vertexCount, localIndices, localTriangles, subMesh->triangleCount, 3);
+
+		for (u32 j = 0; j < subMesh->triangleCount; ++j)
+		{
+			m_originalTriangles[startTriangle + j] = startTriangle + localOrder[j];
+			m_triangleIndices[startTriangle + localOrder[j]] = startTriangle + j;
+		}
+
+	}
+
+	b3Free(localIndices);
+	b3Free(localOrder);
+	b3Free(localTriangles);
+
+	// Copy the mesh.
+	m_orderedMesh.vertexCount = vertexCount;
+	m_orderedMesh.vertices = (b3Vec3*)b3Alloc(vertexCount * sizeof(b3Vec3));
+	for (u32 i = 0; i < vertexCount; ++i)
+	{
+		m_orderedMesh.vertices[i] = mesh->vertices[m_originalVertices[i]];
+	}
+
+	m_orderedMesh.triangleCount = triangleCount;
+	m_orderedMesh.triangles = (b3ClothMeshTriangle*)b3Alloc(triangleCount * sizeof(b3ClothMeshTriangle));
+	for (u32 i = 0; i < triangleCount; ++i)
+	{
+		const b3ClothMeshTriangle* t = mesh->triangles + m_originalTriangles[i];
+
+		b3ClothMeshTriangle* orderedTriangle = m_orderedMesh.triangles + i;
+		orderedTriangle->v1 = m_vertexIndices[t->v1];
+		orderedTriangle->v2 = m_vertexIndices[t->v2];
+		orderedTriangle->v3 = m_vertexIndices[t->v3];
+	}
+
+	m_orderedMesh.meshCount = mesh->meshCount;
+	m_orderedMesh.meshes = (b3ClothMeshMesh*)b3Alloc(mesh->meshCount * sizeof(b3ClothMeshMesh));
+	for (u32 i = 0; i < mesh->meshCount; ++i)
+	{
+		m_orderedMesh.meshes[i] = mesh->meshes[i];
+	}
+
+	m_orderedMesh.sewingLineCount = mesh->sewingLineCount;
+	m_orderedMesh.sewingLines = (b3ClothMeshSewingLine*)b3Alloc(mesh->sewingLineCount * sizeof(b3ClothMeshSewingLine));
+	for (u32 i = 0; i < mesh->sewingLineCount; ++i)
+	{
+		b3ClothMeshSewingLine line = mesh->sewingLines[i];
+		line.v1 = m_vertexIndices[line.v1];
+		line.v2 = m_vertexIndices[line.v2];
+
+		m_orderedMesh.sewingLines[i] = line;
+	}
+}
+
 void b3Cloth::SetWorld(b3World* world)
 {
 	if (!world && m_world)
@@ -304,13 +568,62 @@ void b3Cloth::SetWorld(b3World* world)
 	m_world = world;
 }
 
+template<class T>
+static T* b3ResizeArray(T* elements, u32 oldCount, u32 newCount)
+{
+	T* newElements = (T*)b3Alloc(newCount * sizeof(T));
+	if (elements)
+	{
+		memcpy(newElements, elements, b3Min(oldCount, newCount) * sizeof(T));
+		b3Free(elements);
+	}
+	return newElements;
+}
+
+void b3Cloth::ResizeParticleState(u32 count)
+{
+	u32 oldCount = m_positions.n;
+
+	if (count > m_particleCapacity)
+	{
+		u32 capacity = b3Max(count, 2 * m_particleCapacity);
+
+		m_positions.v = b3ResizeArray(m_positions.v, oldCount, capacity);
+		m_velocities.v = b3ResizeArray(m_velocities.v, oldCount, capacity);
+		m_externalForces.v = b3ResizeArray(m_externalForces.v, oldCount, capacity);
+		m_translations.v = b3ResizeArray(m_translations.v, oldCount, capacity);
+		m_solutions.v = b3ResizeArray(m_solutions.v, oldCount, capacity);
+		m_masses = b3ResizeArray(m_masses, oldCount, capacity);
+		m_invMasses = b3ResizeArray(m_invMasses, oldCount, capacity);
+		m_types = b3ResizeArray(m_types, oldCount, capacity);
+		m_solverParticles = b3ResizeArray(m_solverParticles, oldCount, capacity);
+
+		m_particleCapacity = capacity;
+	}
+
+	// The vectors only span the used states.
+	m_positions.n = count;
+	m_velocities.n = count;
+	m_externalForces.n = count;
+	m_translations.n = count;
+	m_solutions.n = count;
+}
+
 b3Particle* b3Cloth::CreateParticle(const b3ParticleDef& def)
 {
+	// Grow the state arrays if the particle is not a preallocated mesh particle.
+	u32 solverId = m_particleList.m_count;
+	if (solverId == m_positions.n)
+	{
+		ResizeParticleState(solverId + 1);
+	}
+
 	void* mem = m_particleBlocks.Allocate();
-	b3Particle* p = new(mem) b3Particle(def, this);
+	b3Particle* p = new(mem) b3Particle(def, this, solverId);
+	m_solverParticles[solverId] = p;
 
 	b3AABB3 aabb;
-	aabb.Set(p->m_position, p->m_radius);
+	aabb.Set(m_positions[solverId], p->m_radius);
 
 	p->m_aabbProxy.type = e_particleProxy;
 	p->m_aabbProxy.owner = p;
@@ -318,6 +631,8 @@ b3Particle* b3Cloth::CreateParticle(const b3ParticleDef& def)
 
 	m_particleList.PushFront(p);
 
+	m_jacobianPatternDirty = true;
+
 	return p;
 }
 
@@ -345,15 +660,41 @@ void b3Cloth::DestroyParticle(b3Particle* particle)
 	// Destroy AABB proxy
 	m_contactManager.m_broadPhase.DestroyProxy(particle->m_broadPhaseId);
 
+	// Move the state of the last particle into the slot of the destroyed particle.
+	// The mesh particles are never moved because they are created first.
+	u32 index = particle->m_solverId;
+	u32 lastIndex = m_particleList.m_count - 1;
+	if (index != lastIndex)
+	{
+		b3Particle* last = m_solverParticles[lastIndex];
+
+		m_positions[index] = m_positions[lastIndex];
+		m_velocities[index] = m_velocities[lastIndex];
+		m_externalForces[index] = m_externalForces[lastIndex];
+		m_translations[index] = m_translations[lastIndex];
+		m_solutions[index] = m_solutions[lastIndex];
+		m_masses[index] = m_masses[lastIndex];
+		m_invMasses[index] = m_invMasses[lastIndex];
+		m_types[index] = m_types[lastIndex];
+
+		last->m_solverId = index;
+		m_solverParticles[index] = last;
+	}
+
+	ResizeParticleState(lastIndex);
+
 	m_particleList.Remove(particle);
 	particle->~b3Particle();
 	m_particleBlocks.Free(particle);
+
+	m_jacobianPatternDirty = true;
 }
 
 b3Force* b3Cloth::CreateForce(const b3ForceDef& def)
 {
 	b3Force* f = b3Force::Create(&def);
 	m_forceList.PushFront(f);
+	m_jacobianPatternDirty = true;
 	return f;
 }
 
@@ -361,14 +702,15 @@ void b3Cloth::DestroyForce(b3Force* force)
 {
 	m_forceList.Remove(force);
 	b3Force::Destroy(force);
+	m_jacobianPatternDirty = true;
 }
 
 float32 b3Cloth::GetEnergy() const
 {
 	float32 E = 0.0f;
-	for (b3Particle* p = m_particleList.m_head; p; p = p->m_next)
+	for (u32 i = 0; i < m_particleList.m_count; ++i)
 	{
-		E += p->m_mass * b3Dot(p->m_velocity, p->m_velocity);
+		E += m_masses[i] * b3Dot(m_velocities[i], m_velocities[i]);
 	}
 	return 0.5f * E;
 }
@@ -387,10 +729,12 @@ b3ClothTriangle* b3Cloth::GetTriangle(u32 i)
 
 void b3Cloth::ComputeMass()
 {
-	for (b3Particle* p = m_particleList.m_head; p; p = p->m_next)
+	u32 particleCount = m_particleList.m_count;
+
+	for (u32 i = 0; i < particleCount; ++i)
 	{
-		p->m_mass = 0.0f;
-		p->m_invMass = 0.0f;
+		m_masses[i] = 0.0f;
+		m_invMasses[i] = 0.0f;
 	}
 
 	const float32 inv3 = 1.0f / 3.0f;
@@ -409,20 +753,16 @@ void b3Cloth::ComputeMass()
 
 		float32 mass = rho * area;
 
-		b3Particle* p1 = m_particles[triangle->v1];
-		b3Particle* p2 = m_particles[triangle->v2];
-		b3Particle* p3 = m_particles[triangle->v3];
-
-		p1->m_mass += inv3 * mass;
-		p2->m_mass += inv3 * mass;
-		p3->m_mass += inv3 * mass;
+		m_masses[triangle->v1] += inv3 * mass;
+		m_masses[triangle->v2] += inv3 * mass;
+		m_masses[triangle->v3] += inv3 * mass;
 	}
 
 	// Invert
-	for (b3Particle* p = m_particleList.m_head; p; p = p->m_next)
+	for (u32 i = 0; i < particleCount; ++i)
 	{
-		B3_ASSERT(p->m_mass > 0.0f);
-		p->m_invMass = 1.0f / p->m_mass;
+		B3_ASSERT(m_masses[i] > 0.0f);
+		m_invMasses[i] = 1.0f / m_masses[i];
 	}
 }
 
@@ -497,81 +837,450 @@ bool b3Cloth::RayCast(b3RayCastOutput* output, const b3RayCastInput* input, u32
 	B3_ASSERT(triangleIndex < m_mesh->triangleCount);
 	b3ClothMeshTriangle* triangle = m_mesh->triangles + triangleIndex;
 
-	b3Vec3 v1 = m_particles[triangle->v1]->m_position;
-	b3Vec3 v2 = m_particles[triangle->v2]->m_position;
-	b3Vec3 v3 = m_particles[triangle->v3]->m_position;
+	b3Vec3 v1 = m_positions[triangle->v1];
+	b3Vec3 v2 = m_positions[triangle->v2];
+	b3Vec3 v3 = m_positions[triangle->v3];
 
 	return b3RayCast(output, input, v1, v2, v3);
 }
 
-void b3Cloth::Solve(float32 dt, const b3Vec3& gravity, u32 velocityIterations, u32 positionIterations)
+void b3Cloth::BuildJacobianPattern()
 {
-	B3_PROFILE("Cloth Solve");
+	u32 entryCapacity = 0;
+	for (b3Force* f = m_forceList.m_head; f; f = f->m_next)
+	{
+		entryCapacity += b3_maxForceParticles * b3_maxForceParticles;
+	}
 
-	// Solve
-	b3ClothSolverDef solverDef;
-	solverDef.stack = &m_stackAllocator;
-	solverDef.particleCapacity = m_particleList.m_count;
-	solverDef.forceCapacity = m_forceList.m_count;
-	solverDef.bodyContactCapacity = m_contactManager.m_particleBodyContactList.m_count;
-	solverDef.triangleContactCapacity = m_contactManager.m_particleTriangleContactList.m_count;
+	b3SparseEntry* entries = (b3SparseEntry*)m_stackAllocator.Allocate(entryCapacity * sizeof(b3SparseEntry));
+	u32 entryCount = 0;
 
-	b3ClothSolver solver(solverDef);
+	for (b3Force* f = m_forceList.m_head; f; f = f->m_next)
+	{
+		b3Particle* ps[b3_maxForceParticles];
+		u32 count = f->GetParticles(ps);
+		B3_ASSERT(count <= b3_maxForceParticles);
 
-	for (b3Particle* p = m_particleList.m_head; p; p = p->m_next)
+		for (u32 i = 0; i < count; ++i)
+		{
+			for (u32 j = 0; j < count; ++j)
+			{
+				if (i != j)
+				{
+					b3SparseEntry* entry = entries + entryCount++;
+					entry->row = ps[i]->m_solverId;
+					entry->column = ps[j]->m_solverId;
+				}
+			}
+		}
+	}
+
+	m_jacobianPattern.Create(m_particleList.m_count, entries, entryCount);
+
+	m_stackAllocator.Free(entries);
+
+	m_dfdx.Create(&m_jacobianPattern);
+	m_dfdv.Create(&m_jacobianPattern);
+
+	m_forceBatch.Create(m_forceList, m_particleList.m_count, &m_jacobianPattern);
+
+	BuildPatches();
+
+	m_jacobianPatternDirty = false;
+}
+
+static u32 b3FindRoot(u32* parents, u32 i)
+{
+	while (parents[i] != i)
+	{
+		parents[i] = parents[parents[i]];
+		i = parents[i];
+	}
+	return i;
+}
+
+static void b3Union(u32* parents, u32 i, u32 j)
+{
+	u32 ri = b3FindRoot(parents, i);
+	u32 rj = b3FindRoot(parents, j);
+	if (ri != rj)
+	{
+		parents[rj] = ri;
+	}
+}
+
+void b3Cloth::BuildPatches()
+{
+	u32 particleCount = m_particleList.m_count;
+
+	b3Free(m_patches);
+	b3Free(m_particlePatches);
+
+	m_particlePatches = (u32*)b3Alloc(particleCount * sizeof(u32));
+
+	// Connect the particles sharing a force or a triangle
+	u32* parents = (u32*)m_stackAllocator.Allocate(particleCount * sizeof(u32));
+	for (u32 i = 0; i < particleCount; ++i)
 	{
-		solver.Add(p);
+		parents[i] = i;
 	}
 
 	for (b3Force* f = m_forceList.m_head; f; f = f->m_next)
 	{
-		solver.Add(f);
+		b3Particle* ps[b3_maxForceParticles];
+		u32 count = f->GetParticles(ps);
+
+		for (u32 i = 1; i < count; ++i)
+		{
+			b3Union(parents, ps[0]->m_solverId, ps[i]->m_solverId);
+		}
+	}
+
+	for (u32 i = 0; i < m_mesh->triangleCount; ++i)
+	{
+		b3ClothMeshTriangle* t = m_mesh->triangles + i;
+
+		b3Union(parents, t->v1, t->v2);
+		b3Union(parents, t->v1, t->v3);
+	}
+
+	// Number the patches
+	m_patchCount = 0;
+	for (u32 i = 0; i < particleCount; ++i)
+	{
+		if (b3FindRoot(parents, i) == i)
+		{
+			m_particlePatches[i] = m_patchCount++;
+		}
+	}
+
+	for (u32 i = 0; i < particleCount; ++i)
+	{
+		m_particlePatches[i] = m_particlePatches[b3FindRoot(parents, i)];
+	}
+
+	m_stackAllocator.Free(parents);
+
+	m_patches = (b3ClothPatch*)b3Alloc(m_patchCount * sizeof(b3ClothPatch));
+	for (u32 i = 0; i < m_patchCount; ++i)
+	{
+		b3ClothPatch* patch = m_patches + i;
+		patch->aabb.m_lower.SetZero();
+		patch->aabb.m_upper.SetZero();
+		patch->sleepTime = 0.0f;
+		patch->awake = true;
+	}
+	m_awakePatchCount = m_patchCount;
+}
+
+void b3Cloth::SetSleepingAllowed(bool flag)
+{
+	m_allowSleep = flag;
+	if (flag == false)
+	{
+		SetAwake(true);
+	}
+}
+
+void b3Cloth::SetAwake(bool flag)
+{
+	if (m_jacobianPatternDirty)
+	{
+		BuildJacobianPattern();
+	}
+
+	if (flag)
+	{
+		for (u32 i = 0; i < m_patchCount; ++i)
+		{
+			WakePatch(i);
+		}
+		return;
+	}
+
+	for (u32 i = 0; i < m_patchCount; ++i)
+	{
+		b3ClothPatch* patch = m_patches + i;
+		patch->sleepTime = 0.0f;
+		patch->awake = false;
+	}
+	m_awakePatchCount = 0;
+
+	bool* fellAsleep = (bool*)m_stackAllocator.Allocate(m_patchCount * sizeof(bool));
+	for (u32 i = 0; i < m_patchCount; ++i)
+	{
+		fellAsleep[i] = true;
+	}
+
+	PutToSleep(fellAsleep);
+
+	m_stackAllocator.Free(fellAsleep);
+}
+
+void b3Cloth::PutToSleep(const bool* fellAsleep)
+{
+	bool* empty = (bool*)m_stackAllocator.Allocate(m_patchCount * sizeof(bool));
+	for (u32 i = 0; i < m_patchCount; ++i)
+	{
+		empty[i] = true;
+	}
+
+	for (u32 i = 0; i < m_particleList.m_count; ++i)
+	{
+		u32 patchIndex = m_particlePatches[i];
+		if (fellAsleep[patchIndex] == false)
+		{
+			continue;
+		}
+
+		m_velocities[i].SetZero();
+
+		b3ClothPatch* patch = m_patches + patchIndex;
+		if (empty[patchIndex])
+		{
+			patch->aabb.m_lower = m_positions[i];
+			patch->aabb.m_upper = m_positions[i];
+			empty[patchIndex] = false;
+		}
+		else
+		{
+			patch->aabb.m_lower = b3Min(patch->aabb.m_lower, m_positions[i]);
+			patch->aabb.m_upper = b3Max(patch->aabb.m_upper, m_positions[i]);
+		}
+	}
+
+	m_stackAllocator.Free(empty);
+
+	// Account for the particle radii
+	float32 maxRadius = 0.0f;
+	for (b3Particle* p = m_particleList.m_head; p; p = p->m_next)
+	{
+		maxRadius = b3Max(maxRadius, p->m_radius);
+	}
+
+	for (u32 i = 0; i < m_patchCount; ++i)
+	{
+		if (fellAsleep[i])
+		{
+			m_patches[i].aabb.Extend(maxRadius);
+		}
+	}
+}
+
+class b3ClothWakePatchesQueryListener : public b3QueryListener
+{
+public:
+	virtual bool ReportShape(b3Shape* s)
+	{
+		b3Body* b = s->GetBody();
+
+		if (b->GetType() != e_staticBody && b->IsAwake())
+		{
+			touching = true;
+
+			// Stop the query
+			return false;
+		}
+
+		// Keep looking for overlaps
+		return true;
+	}
+
+	bool touching;
+};
+
+void b3Cloth::WakePatches()
+{
+	if (m_awakePatchCount == m_patchCount)
+	{
+		return;
 	}
 
+	// Wake up the sleeping patches touching awake patches
 	for (b3ParticleTriangleContact* c = m_contactManager.m_particleTriangleContactList.m_head; c; c = c->m_next)
 	{
-		if (c->m_active)
+		if (c->m_active == false)
+		{
+			continue;
+		}
+
+		u32 patch1 = m_particlePatches[c->m_p1->m_solverId];
+		u32 patch2 = m_particlePatches[c->m_p2->m_solverId];
+
+		if (m_patches[patch1].awake != m_patches[patch2].awake)
 		{
-			solver.Add(c);
+			WakePatch(patch1);
+			WakePatch(patch2);
 		}
 	}
 
-	for (b3ParticleBodyContact* c = m_contactManager.m_particleBodyContactList.m_head; c; c = c->m_next)
+	if (m_world == nullptr)
+	{
+		return;
+	}
+
+	// Wake up the sleeping patches touching awake bodies
+	for (u32 i = 0; i < m_patchCount; ++i)
 	{
-		if (c->m_active)
+		b3ClothPatch* patch = m_patches + i;
+		if (patch->awake)
+		{
+			continue;
+		}
+
+		b3ClothWakePatchesQueryListener listener;
+		listener.touching = false;
+
+		m_world->QueryAABB(&listener, patch->aabb);
+
+		if (listener.touching)
 		{
-			solver.Add(c);
+			WakePatch(i);
 		}
 	}
-	
-	// Solve	
-	solver.Solve(dt, gravity, velocityIterations, positionIterations);
 }
 
-void b3Cloth::Step(float32 dt, u32 velocityIterations, u32 positionIterations)
+void b3Cloth::UpdateSleep(float32 dt)
 {
-	B3_PROFILE("Cloth Step");
+	u32 particleCount = m_particleList.m_count;
 
-	// Update contacts
-	m_contactManager.UpdateContacts();
+	bool* resting = (bool*)m_stackAllocator.Allocate(m_patchCount * sizeof(bool));
+	for (u32 i = 0; i < m_patchCount; ++i)
+	{
+		resting[i] = m_allowSleep;
+	}
 
-	// Integrate state, solve constraints. 
-	if (dt > 0.0f)
+	for (u32 i = 0; i < particleCount; ++i)
 	{
-		Solve(dt, m_gravity, velocityIterations, positionIterations);
+		if (b3LengthSquared(m_velocities[i]) > B3_SLEEP_LINEAR_TOL)
+		{
+			resting[m_particlePatches[i]] = false;
+		}
 	}
 
-	// Clear external applied forces and translations
-	for (b3Particle* p = m_particleList.m_head; p; p = p->m_next)
+	bool sleep = false;
+	for (u32 i = 0; i < m_patchCount; ++i)
+	{
+		b3ClothPatch* patch = m_patches + i;
+		
+		if (patch->awake == false)
+		{
+			resting[i] = false;
+			continue;
+		}
+
+		if (resting[i] == false)
+		{
+			patch->sleepTime = 0.0f;
+			continue;
+		}
+
+		patch->sleepTime += dt;
+
+		if (patch->sleepTime >= B3_TIME_TO_SLEEP)
+		{
+			patch->awake = false;
+			--m_awakePatchCount;
+			sleep = true;
+		}
+		else
+		{
+			resting[i] = false;
+		}
+	}
+
+	if (sleep)
+	{
+		PutToSleep(resting);
+	}
+
+	m_stackAllocator.Free(resting);
+}
+
+void b3Cloth::Solve(float32 dt, const b3Vec3& gravity, u32 velocityIterations, u32 positionIterations)
+{
+	B3_PROFILE("Cloth Solve");
+
+	// The particles of the sleeping patches are fixed.
+	b3ParticleType* types = m_types;
+	if (m_awakePatchCount < m_patchCount)
 	{
-		p->m_force.SetZero();
-		p->m_translation.SetZero();
+		types = (b3ParticleType*)m_stackAllocator.Allocate(m_particleList.m_count * sizeof(b3ParticleType));
+		for (u32 i = 0; i < m_particleList.m_count; ++i)
+		{
+			types[i] = m_patches[m_particlePatches[i]].awake ? m_types[i] : e_staticParticle;
+		}
 	}
 
+	{
+		// Solve
+		b3ClothSolverDef solverDef;
+		solverDef.type = m_solverType;
+		solverDef.positionBasedIterations = m_positionBasedIterations;
+		solverDef.stack = &m_stackAllocator;
+		solverDef.particleCount = m_particleList.m_count;
+		solverDef.positions = &m_positions;
+		solverDef.velocities = &m_velocities;
+		solverDef.externalForces = &m_externalForces;
+		solverDef.translations = &m_translations;
+		solverDef.solutions = &m_solutions;
+		solverDef.masses = m_masses;
+		solverDef.invMasses = m_invMasses;
+		solverDef.types = types;
+		solverDef.forceCapacity = m_forceList.m_count;
+		solverDef.bodyContactCapacity = m_contactManager.m_particleBodyContactList.m_count;
+		solverDef.triangleContactCapacity = m_contactManager.m_particleTriangleContactList.m_count;
+		solverDef.dfdx = &m_dfdx;
+		solverDef.dfdv = &m_dfdv;
+		solverDef.forceBatch = &m_forceBatch;
+		solverDef.workspace = &m_solverWorkspace;
+
+		b3ClothSolver solver(solverDef);
+
+		for (b3Force* f = m_forceList.m_head; f; f = f->m_next)
+		{
+			solver.Add(f);
+		}
+
+		for (b3ParticleTriangleContact* c = m_contactManager.m_particleTriangleContactList.m_head; c; c = c->m_next)
+		{
+			if (c->m_active)
+			{
+				solver.Add(c);
+			}
+		}
+
+		for (b3ParticleBodyContact* c = m_contactManager.m_particleBodyContactList.m_head; c; c = c->m_next)
+		{
+			if (c->m_active)
+			{
+				solver.Add(c);
+			}
+		}
+
+		// Solve	
+		solver.Solve(dt, gravity, velocityIterations, positionIterations);
+	}
+
+	if (types != m_types)
+	{
+		m_stackAllocator.Free(types);
+	}
+}
+
+void b3Cloth::Synchronize(float32 dt)
+{
 	// Synchronize particles
 	for (b3Particle* p = m_particleList.m_head; p; p = p->m_next)
 	{
-		b3Vec3 displacement = dt * p->m_velocity;
+		u32 i = p->m_solverId;
+
+		if (m_patches[m_particlePatches[i]].awake == false)
+		{
+			continue;
+		}
+
+		b3Vec3 displacement = dt * m_velocities[i];
 
 		p->Synchronize(displacement);
 	}
@@ -581,13 +1290,14 @@ void b3Cloth::Step(float32 dt, u32 velocityIterations, u32 positionIterations)
 	{
 		b3ClothMeshTriangle* triangle = m_mesh->triangles + i;
 
-		b3Particle* p1 = m_particles[triangle->v1];
-		b3Particle* p2 = m_particles[triangle->v2];
-		b3Particle* p3 = m_particles[triangle->v3];
+		if (m_patches[m_particlePatches[triangle->v1]].awake == false)
+		{
+			continue;
+		}
 
-		b3Vec3 v1 = p1->m_velocity;
-		b3Vec3 v2 = p2->m_velocity;
-		b3Vec3 v3 = p3->m_velocity;
+		b3Vec3 v1 = m_velocities[triangle->v1];
+		b3Vec3 v2 = m_velocities[triangle->v2];
+		b3Vec3 v3 = m_velocities[triangle->v3];
 
 		b3Vec3 velocity = (v1 + v2 + v3) / 3.0f;
 
@@ -596,27 +1306,72 @@ void b3Cloth::Step(float32 dt, u32 velocityIterations, u32 positionIterations)
 		m_triangles[i].Synchronize(displacement);
 	}
 
+	// Refit the broad-phase tree
+	m_contactManager.m_broadPhase.UpdateTree();
+}
+
+void b3Cloth::Step(float32 dt, u32 velocityIterations, u32 positionIterations)
+{
+	B3_PROFILE("Cloth Step");
+
+	// The particle solver indices and the patches only change when the lists change.
+	if (m_jacobianPatternDirty)
+	{
+		BuildJacobianPattern();
+	}
+
+	// Wake up the patches touched by moving bodies or other patches
+	WakePatches();
+
+	// A sleeping cloth costs nothing.
+	if (m_awakePatchCount == 0)
+	{
+		return;
+	}
+
+	// Update contacts
+	m_contactManager.UpdateContacts();
+
+	// Integrate state, solve constraints. 
+	if (dt > 0.0f)
+	{
+		Solve(dt, m_gravity, velocityIterations, positionIterations);
+	}
+
+	// Clear external applied forces and translations
+	m_externalForces.SetZero();
+	m_translations.SetZero();
+
+	// Synchronize particles and triangles
+	Synchronize(dt);
+
+	// Put the resting patches to sleep
+	if (dt > 0.0f)
+	{
+		UpdateSleep(dt);
+	}
+
 	// Find new contacts
 	m_contactManager.FindNewContacts();
 }
 
 void b3Cloth::Draw() const
 {
-	for (b3Particle* p = m_particleList.m_head; p; p = p->m_next)
+	for (u32 i = 0; i < m_particleList.m_count; ++i)
 	{
-		if (p->m_type == e_staticParticle)
+		if (m_types[i] == e_staticParticle)
 		{
-			b3Draw_draw->DrawPoint(p->m_position, 4.0f, b3Color_white);
+			b3Draw_draw->DrawPoint(m_positions[i], 4.0f, b3Color_white);
 		}
 
-		if (p->m_type == e_kinematicParticle)
+		if (m_types[i] == e_kinematicParticle)
 		{
-			b3Draw_draw->DrawPoint(p->m_position, 4.0f, b3Color_blue);
+			b3Draw_draw->DrawPoint(m_positions[i], 4.0f, b3Color_blue);
 		}
 
-		if (p->m_type == e_dynamicParticle)
+		if (m_types[i] == e_dynamicParticle)
 		{
-			b3Draw_draw->DrawPoint(p->m_position, 4.0f, b3Color_green);
+			b3Draw_draw->DrawPoint(m_positions[i], 4.0f, b3Color_green);
 		}
 	}
 
@@ -625,10 +1380,10 @@ void b3Cloth::Draw() const
 		if (f->m_type == e_springForce)
 		{
 			b3SpringForce* s = (b3SpringForce*)f;
-			b3Particle* p1 = s->m_p1;
-			b3Particle* p2 = s->m_p2;
+			b3Vec3 x1 = m_positions[s->m_p1->m_solverId];
+			b3Vec3 x2 = m_positions[s->m_p2->m_solverId];
 
-			b3Draw_draw->DrawSegment(p1->m_position, p2->m_position, b3Color_black);
+			b3Draw_draw->DrawSegment(x1, x2, b3Color_black);
 		}
 	}
 
@@ -637,23 +1392,17 @@ void b3Cloth::Draw() const
 	for (u32 i = 0; i < m->sewingLineCount; ++i)
 	{
 		b3ClothMeshSewingLine* s = m->sewingLines + i;
-		b3Particle* p1 = m_particles[s->v1];
-		b3Particle* p2 = m_particles[s->v2];
 
-		b3Draw_draw->DrawSegment(p1->m_position, p2->m_position, b3Color_white);
+		b3Draw_draw->DrawSegment(m_positions[s->v1], m_positions[s->v2], b3Color_white);
 	}
 
 	for (u32 i = 0; i < m->triangleCount; ++i)
 	{
 		b3ClothMeshTriangle* t = m->triangles + i;
 
-		b3Particle* p1 = m_particles[t->v1];
-		b3Particle* p2 = m_particles[t->v2];
-		b3Particle* p3 = m_particles[t->v3];
-
-		b3Vec3 v1 = p1->m_position;
-		b3Vec3 v2 = p2->m_position;
-		b3Vec3 v3 = p3->m_position;
+		b3Vec3 v1 = m_positions[t->v1];
+		b3Vec3 v2 = m_positions[t->v2];
+		b3Vec3 v3 = m_positions[t->v3];
 
 		b3Draw_draw->DrawTriangle(v1, v2, v3, b3Color_black);
 
@@ -21,6 +21,7 @@
 #include <bounce/cloth/cloth_mesh.h>
 #include <bounce/cloth/particle.h>
 #include <bounce/cloth/cloth_triangle.h>
+#include <bounce/common/template/array.h>
 #include <bounce/dynamics/world.h>
 #include <bounce/dynamics/world_listeners.h>
 #include <bounce/dynamics/shapes/shape.h>
@@ -49,16 +50,39 @@ void b3ClothContactManager::FindNewClothContacts()
 class b3ClothContactManagerFindNewBodyContactsQueryListener : public b3QueryListener
 {
 public:
-	virtual bool ReportShape(b3Shape* s2)
+	virtual bool ReportShape(b3Shape* s)
 	{
-		cm->AddPSPair(p1, s2);
-		
+		shapes->PushBack(s);
+
 		// Keep looking for overlaps
 		return true;
 	}
-	
+
+	b3Array<b3Shape*>* shapes;
+};
+
+struct b3ClothContactManagerFindNewBodyContactsQueryCallback
+{
+	bool Report(u32 proxyId)
+	{
+		b3ClothAABBProxy* proxy = (b3ClothAABBProxy*)cm->m_broadPhase.GetUserData(proxyId);
+
+		if (proxy->type == e_particleProxy)
+		{
+			b3Particle* p1 = (b3Particle*)proxy->owner;
+
+			if (p1->GetType() == e_dynamicParticle && p1->IsAwake())
+			{
+				cm->AddPSPair(p1, s2);
+			}
+		}
+
+		// Keep looking for overlaps
+		return true;
+	}
+
 	b3ClothContactManager* cm;
-	b3Particle* p1;
+	b3Shape* s2;
 };
 
 void b3ClothContactManager::FindNewBodyContacts()
@@ -71,36 +95,70 @@ void b3ClothContactManager::FindNewBodyContacts()
 		return;
 	}
 
+	// Compute the bounds of the awake dynamic particles.
+	// The sleeping particles are woken up by the cloth when a moving body touches them.
+	bool empty = true;
+	b3AABB3 clothAABB;
 	for (b3Particle* p = m_cloth->m_particleList.m_head; p; p = p->m_next)
 	{
-		if (p->m_type != e_dynamicParticle)
+		if (p->GetType() != e_dynamicParticle || p->IsAwake() == false)
 		{
 			continue;
 		}
 
-		b3AABB3 aabb = m_broadPhase.GetAABB(p->m_broadPhaseId);
+		const b3AABB3& aabb = m_broadPhase.GetAABB(p->m_broadPhaseId);
 
-		b3ClothContactManagerFindNewBodyContactsQueryListener listener;
-		listener.cm = this;
-		listener.p1 = p;
+		if (empty)
+		{
+			clothAABB = aabb;
+			empty = false;
+		}
+		else
+		{
+			clothAABB = b3Combine(clothAABB, aabb);
+		}
+	}
+
+	if (empty)
+	{
+		return;
+	}
 
-		m_cloth->m_world->QueryAABB(&listener, aabb);
+	// Gather the shapes overlapping the cloth with a single world query.
+	b3StackArray<b3Shape*, 256> shapes;
+
+	b3ClothContactManagerFindNewBodyContactsQueryListener listener;
+	listener.shapes = &shapes;
+
+	m_cloth->m_world->QueryAABB(&listener, clothAABB);
+
+	// Find the particles overlapping each shape using the cloth tree.
+	for (u32 i = 0; i < shapes.Count(); ++i)
+	{
+		b3Shape* s2 = shapes[i];
+
+		b3ClothContactManagerFindNewBodyContactsQueryCallback callback;
+		callback.cm = this;
+		callback.s2 = s2;
+
+		m_broadPhase.QueryAABB(&callback, s2->GetAABB());
 	}
 }
 
 void b3ClothContactManager::AddPSPair(b3Particle* p1, b3Shape* s2)
 {
 	// Check if there is a contact between the two entities.
-	for (b3ParticleBodyContact* c = m_particleBodyContactList.m_head; c; c = c->m_next)
+	// Only the contacts of the particle need to be searched.
+	for (b3ParticleBodyContactEdge* ce = p1->m_bodyContactEdges.m_head; ce; ce = ce->m_next)
 	{
-		if (c->m_p1 == p1 && c->m_s2 == s2)
+		if (ce->other == s2)
 		{
 			// A contact already exists.
 			return;
 		}
 	}
 
-	bool isntDynamic1 = p1->m_type != e_dynamicParticle;
+	bool isntDynamic1 = p1->GetType() != e_dynamicParticle;
 	bool isntDynamic2 = s2->GetBody()->GetType() != e_dynamicBody;
 
 	if (isntDynamic1 && isntDynamic2)
@@ -120,6 +178,11 @@ void b3ClothContactManager::AddPSPair(b3Particle* p1, b3Shape* s2)
 
 	// Add the contact to the body contact list.
 	m_particleBodyContactList.PushFront(c);
+
+	// Add the contact to the particle contact list.
+	c->m_edge1.other = s2;
+	c->m_edge1.contact = c;
+	p1->m_bodyContactEdges.PushFront(&c->m_edge1);
 }
 
 void b3ClothContactManager::AddPair(void* data1, void* data2)
@@ -157,17 +220,18 @@ void b3ClothContactManager::AddPair(void* data1, void* data2)
 	b3Particle* p4 = m_cloth->m_particles[triangle->v3];
 
 	// Check if there is a contact between the two entities.
-	for (b3ParticleTriangleContact* c = m_particleTriangleContactList.m_head; c; c = c->m_next)
+	// Only the contacts of the particle need to be searched.
+	for (b3ParticleTriangleContactEdge* ce = p1->m_triangleContactEdges.m_head; ce; ce = ce->m_next)
 	{
-		if (c->m_p1 == p1 && c->m_t2 == t2)
+		if (ce->other == t2)
 		{
 			// A contact already exists.
 			return;
 		}
 	}
 
-	bool isntDynamic1 = p1->m_type != e_dynamicParticle;
-	bool isntDynamic2 = p2->m_type != e_dynamicParticle && p3->m_type != e_dynamicParticle && p4->m_type != e_dynamicParticle;
+	bool isntDynamic1 = p1->GetType() != e_dynamicParticle;
+	bool isntDynamic2 = p2->GetType() != e_dynamicParticle && p3->GetType() != e_dynamicParticle && p4->GetType() != e_dynamicParticle;
 
 	if (isntDynamic1 && isntDynamic2)
 	{
@@ -196,6 +260,11 @@ void b3ClothContactManager::AddPair(void* data1, void* data2)
 
 	// Add the contact to the cloth contact list.
 	m_particleTriangleContactList.PushFront(c);
+
+	// Add the contact to the particle contact list.
+	c->m_edge1.other = t2;
+	c->m_edge1.contact = c;
+	p1->m_triangleContactEdges.PushFront(&c->m_edge1);
 }
 
 b3ParticleTriangleContact* b3ClothContactManager::CreateParticleTriangleContact()
@@ -207,6 +276,7 @@ b3ParticleTriangleContact* b3ClothContactManager::CreateParticleTriangleContact(
 void b3ClothContactManager::Destroy(b3ParticleTriangleContact* c)
 {
 	m_particleTriangleContactList.Remove(c);
+	c->m_p1->m_triangleContactEdges.Remove(&c->m_edge1);
 
 	c->~b3ParticleTriangleContact();
 	
@@ -222,6 +292,7 @@ b3ParticleBodyContact* b3ClothContactManager::CreateParticleBodyContact()
 void b3ClothContactManager::Destroy(b3ParticleBodyContact* c)
 {
 	m_particleBodyContactList.Remove(c);
+	c->m_p1->m_bodyContactEdges.Remove(&c->m_edge1);
 
 	c->~b3ParticleBodyContact();
 
@@ -242,8 +313,8 @@ void b3ClothContactManager::UpdateClothContacts()
 	b3ParticleTriangleContact* c = m_particleTriangleContactList.m_head;
 	while (c)
 	{
-		bool isntDynamic1 = c->m_p1->m_type != e_dynamicParticle;
-		bool isntDynamic2 = c->m_p2->m_type != e_dynamicParticle && c->m_p3->m_type != e_dynamicParticle && c->m_p4->m_type != e_dynamicParticle;
+		bool isntDynamic1 = c->m_p1->GetType() != e_dynamicParticle;
+		bool isntDynamic2 = c->m_p2->GetType() != e_dynamicParticle && c->m_p3->GetType() != e_dynamicParticle && c->m_p4->GetType() != e_dynamicParticle;
 
 		// Destroy the contact if primitives must not collide with each other.
 		if (isntDynamic1 && isntDynamic2)
@@ -282,7 +353,7 @@ void b3ClothContactManager::UpdateBodyContacts()
 	b3ParticleBodyContact* c = m_particleBodyContactList.m_head;
 	while (c)
 	{
-		bool isntDynamic1 = c->m_p1->m_type != e_dynamicParticle;
+		bool isntDynamic1 = c->m_p1->GetType() != e_dynamicParticle;
 		bool isntDynamic2 = c->m_s2->GetBody()->GetType() != e_dynamicBody;
 
 		// Cease the contact if entities must not collide with each other.
@@ -0,0 +1,1091 @@
+/*
+* Copyright (c) 2016-2019 Irlan Robson https://irlanrobson.github.io
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+#include <bounce/cloth/cloth_force_batch.h>
+#include <bounce/cloth/cloth_force_solver.h>
+#include <bounce/cloth/cloth_position_solver.h>
+#include <bounce/cloth/cloth_triangle.h>
+#include <bounce/cloth/particle.h>
+#include <bounce/cloth/forces/strech_force.h>
+#include <bounce/cloth/forces/shear_force.h>
+#include <bounce/cloth/forces/spring_force.h>
+#include <bounce/sparse/dense_vec3.h>
+#include <bounce/sparse/csr_mat33.h>
+#include <bounce/common/thread_pool.h>
+
+template<class T>
+static inline T* b3AllocArray(u32 count)
+{
+	return (T*)b3Alloc(count * sizeof(T));
+}
+
+// Color the forces so that forces of the same color don't share particles.
+// Each force acts on particlesPerForce particles.
+// The colors are assigned greedily in rounds of 64 colors.
+// Return the number of colors.
+static u32 b3ColorForces(u32* colors, const u32* particles, u32 particlesPerForce, u32 forceCount, u32 particleCount)
+{
+	u64* masks = b3AllocArray<u64>(particleCount);
+
+	for (u32 i = 0; i < forceCount; ++i)
+	{
+		colors[i] = B3_MAX_U32;
+	}
+
+	u32 colorCount = 0;
+	u32 baseColor = 0;
+	u32 remaining = forceCount;
+	while (remaining > 0)
+	{
+		memset(masks, 0, particleCount * sizeof(u64));
+
+		for (u32 i = 0; i < forceCount; ++i)
+		{
+			if (colors[i] != B3_MAX_U32)
+			{
+				continue;
+			}
+
+			const u32* ps = particles + particlesPerForce * i;
+
+			u64 used = 0;
+			for (u32 j = 0; j < particlesPerForce; ++j)
+			{
+				used |= masks[ps[j]];
+			}
+
+			if (used == ~u64(0))
+			{
+				// Try again in the next round
+				continue;
+			}
+
+			u32 color = 0;
+			while (used & (u64(1) << color))
+			{
+				++color;
+			}
+
+			for (u32 j = 0; j < particlesPerForce; ++j)
+			{
+				masks[ps[j]] |= u64(1) << color;
+			}
+
+			colors[i] = baseColor + color;
+			colorCount = b3Max(colorCount, colors[i] + 1);
+			--remaining;
+		}
+
+		baseColor += 64;
+	}
+
+	b3Free(masks);
+
+	return colorCount;
+}
+
+// Sort the forces by color. 
+// Return the sorted force indices and the first force of each color.
+static void b3SortByColor(u32* order, u32* colorOffsets, const u32* colors, u32 forceCount, u32 colorCount)
+{
+	for (u32 i = 0; i <= colorCount; ++i)
+	{
+		colorOffsets[i] = 0;
+	}
+
+	for (u32 i = 0; i < forceCount; ++i)
+	{
+		++colorOffsets[colors[i] + 1];
+	}
+
+	for (u32 i = 0; i < colorCount; ++i)
+	{
+		colorOffsets[i + 1] += colorOffsets[i];
+	}
+
+	// Keep the list order within a color
+	u32* next = b3AllocArray<u32>(colorCount);
+	memcpy(next, colorOffsets, colorCount * sizeof(u32));
+
+	for (u32 i = 0; i < forceCount; ++i)
+	{
+		order[next[colors[i]]++] = i;
+	}
+
+	b3Free(next);
+}
+
+// Gather the forces of a given type, color them and return the number of colors.
+// The forces and their particle solver indices are returned in color order.
+u32 b3ClothForceBatch::GatherForces(b3Force** out, u32* particles, u32** colorOffsets, 
+	b3ForceType type, u32 particlesPerForce, u32 count, const b3List2<b3Force>& forces, u32 particleCount)
+{
+	b3Force** listForces = b3AllocArray<b3Force*>(count);
+	u32* listParticles = b3AllocArray<u32>(particlesPerForce * count);
+
+	u32 index = 0;
+	for (b3Force* f = forces.m_head; f; f = f->GetNext())
+	{
+		if (f->GetType() != type)
+		{
+			continue;
+		}
+
+		b3Particle* ps[b3_maxForceParticles];
+		u32 psCount = f->GetParticles(ps);
+		B3_ASSERT(psCount == particlesPerForce);
+		B3_NOT_USED(psCount);
+
+		for (u32 j = 0; j < particlesPerForce; ++j)
+		{
+			listParticles[particlesPerForce * index + j] = ps[j]->m_solverId;
+		}
+
+		listForces[index++] = f;
+	}
+
+	B3_ASSERT(index == count);
+
+	u32* colors = b3AllocArray<u32>(count);
+	u32 colorCount = b3ColorForces(colors, listParticles, particlesPerForce, count, particleCount);
+
+	u32* order = b3AllocArray<u32>(count);
+	*colorOffsets = b3AllocArray<u32>(colorCount + 1);
+	b3SortByColor(order, *colorOffsets, colors, count, colorCount);
+
+	for (u32 i = 0; i < count; ++i)
+	{
+		u32 j = order[i];
+
+		out[i] = listForces[j];
+		for (u32 k = 0; k < particlesPerForce; ++k)
+		{
+			particles[particlesPerForce * i + k] = listParticles[particlesPerForce * j + k];
+		}
+	}
+
+	b3Free(order);
+	b3Free(colors);
+	b3Free(listParticles);
+	b3Free(listForces);
+
+	return colorCount;
+}
+
+// Get the Jacobian blocks of all particle pairs of each force.
+static void b3GatherBlocks(u32* blocks, const u32* particles, u32 particlesPerForce, u32 count, const b3SparsePattern* pattern)
+{
+	for (u32 i = 0; i < count; ++i)
+	{
+		const u32* ps = particles + particlesPerForce * i;
+		u32* bs = blocks + particlesPerForce * particlesPerForce * i;
+
+		for (u32 j = 0; j < particlesPerForce; ++j)
+		{
+			for (u32 k = 0; k < particlesPerForce; ++k)
+			{
+				u32 block = pattern->GetBlock(ps[j], ps[k]);
+				B3_ASSERT(block != B3_MAX_U32);
+				bs[particlesPerForce * j + k] = block;
+			}
+		}
+	}
+}
+
+static u32 b3CountForces(b3ForceType type, const b3List2<b3Force>& forces)
+{
+	u32 count = 0;
+	for (b3Force* f = forces.m_head; f; f = f->GetNext())
+	{
+		if (f->GetType() == type)
+		{
+			++count;
+		}
+	}
+	return count;
+}
+
+static void b3SetEmpty(b3TriangleForceBatch* batch)
+{
+	memset(batch, 0, sizeof(b3TriangleForceBatch));
+}
+
+static void b3SetEmpty(b3SpringForceBatch* batch)
+{
+	memset(batch, 0, sizeof(b3SpringForceBatch));
+}
+
+void b3ClothForceBatch::CreateBatch(b3TriangleForceBatch* batch, b3ForceType type, 
+	const b3List2<b3Force>& forces, u32 particleCount, const b3SparsePattern* pattern)
+{
+	B3_ASSERT(type == e_strechForce || type == e_shearForce);
+
+	u32 count = b3CountForces(type, forces);
+	if (count == 0)
+	{
+		return;
+	}
+
+	batch->count = count;
+	batch->forces = b3AllocArray<b3Force*>(count);
+
+	u32* particles = b3AllocArray<u32>(3 * count);
+	batch->colorCount = GatherForces(batch->forces, particles, &batch->colorOffsets, type, 3, count, forces, particleCount);
+
+	batch->blocks = b3AllocArray<u32>(9 * count);
+	b3GatherBlocks(batch->blocks, particles, 3, count, pattern);
+
+	batch->v1 = b3AllocArray<u32>(count);
+	batch->v2 = b3AllocArray<u32>(count);
+	batch->v3 = b3AllocArray<u32>(count);
+	batch->alpha = b3AllocArray<float32>(count);
+	batch->du1 = b3AllocArray<float32>(count);
+	batch->dv1 = b3AllocArray<float32>(count);
+	batch->du2 = b3AllocArray<float32>(count);
+	batch->dv2 = b3AllocArray<float32>(count);
+	batch->inv_det = b3AllocArray<float32>(count);
+	batch->ks = b3AllocArray<float32>(count);
+	batch->kd = b3AllocArray<float32>(count);
+	batch->lambda1 = b3AllocArray<float32>(count);
+
+	if (type == e_strechForce)
+	{
+		batch->bu = b3AllocArray<float32>(count);
+		batch->bv = b3AllocArray<float32>(count);
+		batch->lambda2 = b3AllocArray<float32>(count);
+	}
+
+	for (u32 i = 0; i < count; ++i)
+	{
+		batch->v1[i] = particles[3 * i + 0];
+		batch->v2[i] = particles[3 * i + 1];
+		batch->v3[i] = particles[3 * i + 2];
+
+		b3ClothTriangle* triangle;
+		if (type == e_strechForce)
+		{
+			b3StrechForce* force = (b3StrechForce*)batch->forces[i];
+
+			triangle = force->m_triangle;
+			batch->ks[i] = force->m_ks;
+			batch->kd[i] = force->m_kd;
+			batch->bu[i] = force->m_bu;
+			batch->bv[i] = force->m_bv;
+		}
+		else
+		{
+			b3ShearForce* force = (b3ShearForce*)batch->forces[i];
+
+			triangle = force->m_triangle;
+			batch->ks[i] = force->m_ks;
+			batch->kd[i] = force->m_kd;
+		}
+
+		batch->alpha[i] = triangle->m_alpha;
+		batch->du1[i] = triangle->m_du1;
+		batch->dv1[i] = triangle->m_dv1;
+		batch->du2[i] = triangle->m_du2;
+		batch->dv2[i] = triangle->m_dv2;
+		batch->inv_det[i] = triangle->m_inv_det;
+	}
+
+	b3Free(particles);
+}
+
+void b3ClothForceBatch::CreateBatch(b3SpringForceBatch* batch, 
+	const b3List2<b3Force>& forces, u32 particleCount, const b3SparsePattern* pattern)
+{
+	u32 count = b3CountForces(e_springForce, forces);
+	if (count == 0)
+	{
+		return;
+	}
+
+	batch->count = count;
+	batch->forces = b3AllocArray<b3Force*>(count);
+
+	u32* particles = b3AllocArray<u32>(2 * count);
+	batch->colorCount = GatherForces(batch->forces, particles, &batch->colorOffsets, e_springForce, 2, count, forces, particleCount);
+
+	batch->blocks = b3AllocArray<u32>(4 * count);
+	b3GatherBlocks(batch->blocks, particles, 2, count, pattern);
+
+	batch->v1 = b3AllocArray<u32>(count);
+	batch->v2 = b3AllocArray<u32>(count);
+	batch->L0 = b3AllocArray<float32>(count);
+	batch->ks = b3AllocArray<float32>(count);
+	batch->kd = b3AllocArray<float32>(count);
+	batch->lambda = b3AllocArray<float32>(count);
+
+	for (u32 i = 0; i < count; ++i)
+	{
+		b3SpringForce* force = (b3SpringForce*)batch->forces[i];
+
+		batch->v1[i] = particles[2 * i + 0];
+		batch->v2[i] = particles[2 * i + 1];
+		batch->L0[i] = force->m_L0;
+		batch->ks[i] = force->m_ks;
+		batch->kd[i] = force->m_kd;
+	}
+
+	b3Free(particles);
+}
+
+static void b3DestroyBatch(b3TriangleForceBatch* batch)
+{
+	b3Free(batch->forces);
+	b3Free(batch->v1);
+	b3Free(batch->v2);
+	b3Free(batch->v3);
+	b3Free(batch->blocks);
+	b3Free(batch->alpha);
+	b3Free(batch->du1);
+	b3Free(batch->dv1);
+	b3Free(batch->du2);
+	b3Free(batch->dv2);
+	b3Free(batch->inv_det);
+	b3Free(batch->ks);
+	b3Free(batch->kd);
+	b3Free(batch->bu);
+	b3Free(batch->bv);
+	b3Free(batch->lambda1);
+	b3Free(batch->lambda2);
+	b3Free(batch->colorOffsets);
+	b3SetEmpty(batch);
+}
+
+static void b3DestroyBatch(b3SpringForceBatch* batch)
+{
+	b3Free(batch->forces);
+	b3Free(batch->v1);
+	b3Free(batch->v2);
+	b3Free(batch->blocks);
+	b3Free(batch->L0);
+	b3Free(batch->ks);
+	b3Free(batch->kd);
+	b3Free(batch->lambda);
+	b3Free(batch->colorOffsets);
+	b3SetEmpty(batch);
+}
+
+// Add the 3x3 blocks of a force derivative to the values of a CSR matrix.
+template<u32 N>
+static B3_FORCE_INLINE void b3AddBlocks(b3Mat33* values, const u32* blocks, const b3Mat33 (&K)[N][N])
+{
+	for (u32 i = 0; i < N; ++i)
+	{
+		for (u32 j = 0; j < N; ++j)
+		{
+			values[blocks[N * i + j]] += K[i][j];
+		}
+	}
+}
+
+void b3ClothForceBatch::ApplyStrechForces(const b3TriangleForceBatch* batch, const b3ClothForceSolverData* data, u32 begin, u32 end)
+{
+	const b3DenseVec3& x = *data->x;
+	const b3DenseVec3& v = *data->v;
+	b3DenseVec3& f = *data->f;
+	b3Mat33* dfdx = data->dfdx->values;
+	b3Mat33* dfdv = data->dfdv->values;
+
+	b3Mat33 I; I.SetIdentity();
+
+	for (u32 index = begin; index < end; ++index)
+	{
+		u32 i1 = batch->v1[index];
+		u32 i2 = batch->v2[index];
+		u32 i3 = batch->v3[index];
+
+		const u32* blocks = batch->blocks + 9 * index;
+
+		float32 alpha = batch->alpha[index];
+		float32 du1 = batch->du1[index];
+		float32 dv1 = batch->dv1[index];
+		float32 du2 = batch->du2[index];
+		float32 dv2 = batch->dv2[index];
+		float32 inv_det = batch->inv_det[index];
+
+		float32 ks = batch->ks[index];
+		float32 kd = batch->kd[index];
+		float32 bu = batch->bu[index];
+		float32 bv = batch->bv[index];
+
+		b3Vec3 x1 = x[i1];
+		b3Vec3 x2 = x[i2];
+		b3Vec3 x3 = x[i3];
+
+		b3Vec3 vs[3] = { v[i1], v[i2], v[i3] };
+
+		b3Vec3 dx1 = x2 - x1;
+		b3Vec3 dx2 = x3 - x1;
+
+		// The u and v directions are handled in the same way
+		b3Vec3 ws[2];
+		ws[0] = inv_det * (dv2 * dx1 - dv1 * dx2);
+		ws[1] = inv_det * (-du2 * dx1 + du1 * dx2);
+
+		b3Vec3 dwdxs[2];
+		dwdxs[0].Set(inv_det * (dv1 - dv2), inv_det * dv2, -inv_det * dv1);
+		dwdxs[1].Set(inv_det * (du2 - du1), -inv_det * du2, inv_det * du1);
+
+		float32 bs[2] = { bu, bv };
+
+		b3Vec3 fs[3];
+		fs[0].SetZero();
+		fs[1].SetZero();
+		fs[2].SetZero();
+
+		for (u32 k = 0; k < 2; ++k)
+		{
+			const b3Vec3& w = ws[k];
+			const b3Vec3& dwdx = dwdxs[k];
+
+			float32 len_w = b3Length(w);
+			if (len_w == 0.0f)
+			{
+				continue;
+			}
+
+			float32 inv_len_w = 1.0f / len_w;
+			b3Vec3 n_w = inv_len_w * w;
+
+			// Jacobian
+			b3Vec3 dCdx[3];
+			for (u32 i = 0; i < 3; ++i)
+			{
+				dCdx[i] = alpha * dwdx[i] * n_w;
+			}
+
+			if (ks > 0.0f && len_w > bs[k])
+			{
+				float32 C = alpha * (len_w - bs[k]);
+
+				// Force
+				for (u32 i = 0; i < 3; ++i)
+				{
+					fs[i] += -ks * C * dCdx[i];
+				}
+
+				// Force derivative
+				b3Mat33 P = I - b3Outer(n_w, n_w);
+
+				b3Mat33 K[3][3];
+				for (u32 i = 0; i < 3; ++i)
+				{
+					for (u32 j = 0; j < 3; ++j)
+					{
+						b3Mat33 d2Cxij = (alpha * inv_len_w * dwdx[i] * dwdx[j]) * P;
+
+						K[i][j] = -ks * (b3Outer(dCdx[i], dCdx[j]) + C * d2Cxij);
+					}
+				}
+
+				b3AddBlocks(dfdx, blocks, K);
+			}
+
+			if (kd > 0.0f)
+			{
+				float32 dCdt = 0.0f;
+				for (u32 i = 0; i < 3; ++i)
+				{
+					dCdt += b3Dot(dCdx[i], vs[i]);
+				}
+
+				// Force
+				for (u32 i = 0; i < 3; ++i)
+				{
+					fs[i] += -kd * dCdt * dCdx[i];
+				}
+
+				// Force derivative
+				b3Mat33 K[3][3];
+				for (u32 i = 0; i < 3; ++i)
+				{
+					for (u32 j = 0; j < 3; ++j)
+					{
+						K[i][j] = -kd * b3Outer(dCdx[i], dCdx[j]);
+					}
+				}
+
+				b3AddBlocks(dfdv, blocks, K);
+			}
+		}
+
+		b3StrechForce* force = (b3StrechForce*)batch->forces[index];
+		force->m_f1 = fs[0];
+		force->m_f2 = fs[1];
+		force->m_f3 = fs[2];
+
+		f[i1] += fs[0];
+		f[i2] += fs[1];
+		f[i3] += fs[2];
+	}
+}
+
+void b3ClothForceBatch::ApplyShearForces(const b3TriangleForceBatch* batch, const b3ClothForceSolverData* data, u32 begin, u32 end)
+{
+	const b3DenseVec3& x = *data->x;
+	const b3DenseVec3& v = *data->v;
+	b3DenseVec3& f = *data->f;
+	b3Mat33* dfdx = data->dfdx->values;
+	b3Mat33* dfdv = data->dfdv->values;
+
+	for (u32 index = begin; index < end; ++index)
+	{
+		u32 i1 = batch->v1[index];
+		u32 i2 = batch->v2[index];
+		u32 i3 = batch->v3[index];
+
+		const u32* blocks = batch->blocks + 9 * index;
+
+		float32 alpha = batch->alpha[index];
+		float32 du1 = batch->du1[index];
+		float32 dv1 = batch->dv1[index];
+		float32 du2 = batch->du2[index];
+		float32 dv2 = batch->dv2[index];
+		float32 inv_det = batch->inv_det[index];
+
+		float32 ks = batch->ks[index];
+		float32 kd = batch->kd[index];
+
+		b3Vec3 x1 = x[i1];
+		b3Vec3 x2 = x[i2];
+		b3Vec3 x3 = x[i3];
+
+		b3Vec3 vs[3] = { v[i1], v[i2], v[i3] };
+
+		b3Vec3 dx1 = x2 - x1;
+		b3Vec3 dx2 = x3 - x1;
+
+		b3Vec3 wu = inv_det * (dv2 * dx1 - dv1 * dx2);
+		b3Vec3 wv = inv_det * (-du2 * dx1 + du1 * dx2);
+
+		b3Vec3 dwudx;
+		dwudx[0] = inv_det * (dv1 - dv2);
+		dwudx[1] = inv_det * dv2;
+		dwudx[2] = -inv_det * dv1;
+
+		b3Vec3 dwvdx;
+		dwvdx[0] = inv_det * (du2 - du1);
+		dwvdx[1] = -inv_det * du2;
+		dwvdx[2] = inv_det * du1;
+
+		// Jacobian
+		b3Vec3 dCdx[3];
+		for (u32 i = 0; i < 3; ++i)
+		{
+			dCdx[i] = alpha * (dwudx[i] * wv + dwvdx[i] * wu);
+		}
+
+		b3Vec3 fs[3];
+		fs[0].SetZero();
+		fs[1].SetZero();
+		fs[2].SetZero();
+
+		if (ks > 0.0f)
+		{
+			float32 C = alpha * b3Dot(wu, wv);
+
+			// Force
+			for (u32 i = 0; i < 3; ++i)
+			{
+				fs[i] += -ks * C * dCdx[i];
+			}
+
+			// Force derivative
+			b3Mat33 K[3][3];
+			for (u32 i = 0; i < 3; ++i)
+			{
+				for (u32 j = 0; j < 3; ++j)
+				{
+					K[i][j] = -ks * b3Outer(dCdx[i], dCdx[j]);
+				}
+			}
+
+			b3AddBlocks(dfdx, blocks, K);
+		}
+
+		if (kd > 0.0f)
+		{
+			float32 dCdt = 0.0f;
+			for (u32 i = 0; i < 3; ++i)
+			{
+				dCdt += b3Dot(dCdx[i], vs[i]);
+			}
+
+			// Force
+			for (u32 i = 0; i < 3; ++i)
+			{
+				fs[i] += -kd * dCdt * dCdx[i];
+			}
+
+			// Force derivative
+			b3Mat33 K[3][3];
+			for (u32 i = 0; i < 3; ++i)
+			{
+				for (u32 j = 0; j < 3; ++j)
+				{
+					K[i][j] = -kd * b3Outer(dCdx[i], dCdx[j]);
+				}
+			}
+
+			b3AddBlocks(dfdv, blocks, K);
+		}
+
+		b3ShearForce* force = (b3ShearForce*)batch->forces[index];
+		force->m_f1 = fs[0];
+		force->m_f2 = fs[1];
+		force->m_f3 = fs[2];
+
+		f[i1] += fs[0];
+		f[i2] += fs[1];
+		f[i3] += fs[2];
+	}
+}
+
+void b3ClothForceBatch::ApplySpringForces(const b3SpringForceBatch* batch, const b3ClothForceSolverData* data, u32 begin, u32 end)
+{
+	const b3DenseVec3& x = *data->x;
+	const b3DenseVec3& v = *data->v;
+	b3DenseVec3& f = *data->f;
+	b3Mat33* dfdx = data->dfdx->values;
+	b3Mat33* dfdv = data->dfdv->values;
+
+	b3Mat33 I; I.SetIdentity();
+
+	for (u32 index = begin; index < end; ++index)
+	{
+		u32 i1 = batch->v1[index];
+		u32 i2 = batch->v2[index];
+
+		const u32* blocks = batch->blocks + 4 * index;
+
+		float32 L0 = batch->L0[index];
+		float32 ks = batch->ks[index];
+		float32 kd = batch->kd[index];
+
+		b3Vec3 fs;
+		fs.SetZero();
+
+		if (ks > 0.0f)
+		{
+			b3Vec3 dx = x[i1] - x[i2];
+
+			float32 L = b3Length(dx);
+
+			if (L > L0)
+			{
+				// Jacobian
+				b3Vec3 dCdx = dx / L;
+
+				fs += -ks * (L - L0) * dCdx;
+
+				// Force derivative
+				b3Mat33 K[2][2];
+				K[0][0] = -ks * (b3Outer(dx, dx) + (1.0f - L0 / L) * (I - b3Outer(dx, dx)));
+				K[0][1] = -K[0][0];
+				K[1][0] = K[0][1];
+				K[1][1] = K[0][0];
+
+				b3AddBlocks(dfdx, blocks, K);
+			}
+		}
+
+		if (kd > 0.0f)
+		{
+			// C * J
+			b3Vec3 dv = v[i1] - v[i2];
+
+			fs += -kd * dv;
+
+			b3Mat33 K[2][2];
+			K[0][0] = -kd * I;
+			K[0][1] = -K[0][0];
+			K[1][0] = K[0][1];
+			K[1][1] = K[0][0];
+
+			b3AddBlocks(dfdv, blocks, K);
+		}
+
+		b3SpringForce* force = (b3SpringForce*)batch->forces[index];
+		force->m_f = fs;
+
+		f[i1] += fs;
+		f[i2] -= fs;
+	}
+}
+
+void b3ClothForceBatch::ProjectStrechConstraints(b3TriangleForceBatch* batch, const b3ClothPositionSolverData* data, u32 begin, u32 end)
+{
+	b3DenseVec3& x = *data->x;
+	const b3DenseVec3& x0 = *data->x0;
+	const float32* invMasses = data->invMasses;
+	float32 h = data->h;
+	float32 inv_h2 = 1.0f / (h * h);
+
+	for (u32 index = begin; index < end; ++index)
+	{
+		u32 is[3];
+		is[0] = batch->v1[index];
+		is[1] = batch->v2[index];
+		is[2] = batch->v3[index];
+
+		float32 ws[3];
+		ws[0] = invMasses[is[0]];
+		ws[1] = invMasses[is[1]];
+		ws[2] = invMasses[is[2]];
+
+		float32 alpha = batch->alpha[index];
+		float32 du1 = batch->du1[index];
+		float32 dv1 = batch->dv1[index];
+		float32 du2 = batch->du2[index];
+		float32 dv2 = batch->dv2[index];
+		float32 inv_det = batch->inv_det[index];
+
+		float32 ks = batch->ks[index];
+		float32 kd = batch->kd[index];
+
+		b3Vec3 dwdxs[2];
+		dwdxs[0].Set(inv_det * (dv1 - dv2), inv_det * dv2, -inv_det * dv1);
+		dwdxs[1].Set(inv_det * (du2 - du1), -inv_det * du2, inv_det * du1);
+
+		float32 bs[2] = { batch->bu[index], batch->bv[index] };
+		float32* lambdas[2] = { batch->lambda1 + index, batch->lambda2 + index };
+
+		b3Vec3 fs[3];
+		fs[0].SetZero();
+		fs[1].SetZero();
+		fs[2].SetZero();
+
+		// The u and v directions are projected one after the other
+		for (u32 k = 0; k < 2; ++k)
+		{
+			b3Vec3 dx1 = x[is[1]] - x[is[0]];
+			b3Vec3 dx2 = x[is[2]] - x[is[0]];
+
+			b3Vec3 w;
+			if (k == 0)
+			{
+				w = inv_det * (dv2 * dx1 - dv1 * dx2);
+			}
+			else
+			{
+				w = inv_det * (-du2 * dx1 + du1 * dx2);
+			}
+
+			const b3Vec3& dwdx = dwdxs[k];
+
+			float32 len_w = b3Length(w);
+			if (len_w == 0.0f)
+			{
+				continue;
+			}
+
+			b3Vec3 n_w = w / len_w;
+
+			// Jacobian
+			b3Vec3 dCdx[3];
+			for (u32 i = 0; i < 3; ++i)
+			{
+				dCdx[i] = alpha * dwdx[i] * n_w;
+			}
+
+			float32& lambda = *lambdas[k];
+
+			// The constraint only resists streching
+			if (ks > 0.0f && len_w > bs[k])
+			{
+				float32 C = alpha * (len_w - bs[k]);
+
+				float32 dCdt0 = 0.0f;
+				float32 invMass = 0.0f;
+				for (u32 i = 0; i < 3; ++i)
+				{
+					dCdt0 += b3Dot(dCdx[i], x[is[i]] - x0[is[i]]);
+					invMass += ws[i] * b3Dot(dCdx[i], dCdx[i]);
+				}
+
+				float32 dLambda = b3ComputeMultiplierIncrement(C, dCdt0, invMass, lambda, ks, kd, h);
+				lambda += dLambda;
+
+				for (u32 i = 0; i < 3; ++i)
+				{
+					x[is[i]] += (ws[i] * dLambda) * dCdx[i];
+				}
+			}
+
+			// Force
+			for (u32 i = 0; i < 3; ++i)
+			{
+				fs[i] += (lambda * inv_h2) * dCdx[i];
+			}
+		}
+
+		b3StrechForce* force = (b3StrechForce*)batch->forces[index];
+		force->m_f1 = fs[0];
+		force->m_f2 = fs[1];
+		force->m_f3 = fs[2];
+	}
+}
+
+void b3ClothForceBatch::ProjectShearConstraints(b3TriangleForceBatch* batch, const b3ClothPositionSolverData* data, u32 begin, u32 end)
+{
+	b3DenseVec3& x = *data->x;
+	const b3DenseVec3& x0 = *data->x0;
+	const float32* invMasses = data->invMasses;
+	float32 h = data->h;
+	float32 inv_h2 = 1.0f / (h * h);
+
+	for (u32 index = begin; index < end; ++index)
+	{
+		u32 is[3];
+		is[0] = batch->v1[index];
+		is[1] = batch->v2[index];
+		is[2] = batch->v3[index];
+
+		float32 alpha = batch->alpha[index];
+		float32 du1 = batch->du1[index];
+		float32 dv1 = batch->dv1[index];
+		float32 du2 = batch->du2[index];
+		float32 dv2 = batch->dv2[index];
+		float32 inv_det = batch->inv_det[index];
+
+		float32 ks = batch->ks[index];
+		float32 kd = batch->kd[index];
+
+		b3Vec3 dx1 = x[is[1]] - x[is[0]];
+		b3Vec3 dx2 = x[is[2]] - x[is[0]];
+
+		b3Vec3 wu = inv_det * (dv2 * dx1 - dv1 * dx2);
+		b3Vec3 wv = inv_det * (-du2 * dx1 + du1 * dx2);
+
+		b3Vec3 dwudx;
+		dwudx[0] = inv_det * (dv1 - dv2);
+		dwudx[1] = inv_det * dv2;
+		dwudx[2] = -inv_det * dv1;
+
+		b3Vec3 dwvdx;
+		dwvdx[0] = inv_det * (du2 - du1);
+		dwvdx[1] = -inv_det * du2;
+		dwvdx[2] = inv_det * du1;
+
+		// Jacobian
+		b3Vec3 dCdx[3];
+		for (u32 i = 0; i < 3; ++i)
+		{
+			dCdx[i] = alpha * (dwudx[i] * wv + dwvdx[i] * wu);
+		}
+
+		float32& lambda = batch->lambda1[index];
+
+		if (ks > 0.0f)
+		{
+			float32 C = alpha * b3Dot(wu, wv);
+
+			float32 dCdt0 = 0.0f;
+			float32 invMass = 0.0f;
+			for (u32 i = 0; i < 3; ++i)
+			{
+				dCdt0 += b3Dot(dCdx[i], x[is[i]] - x0[is[i]]);
+				invMass += invMasses[is[i]] * b3Dot(dCdx[i], dCdx[i]);
+			}
+
+			float32 dLambda = b3ComputeMultiplierIncrement(C, dCdt0, invMass, lambda, ks, kd, h);
+			lambda += dLambda;
+
+			for (u32 i = 0; i < 3; ++i)
+			{
+				x[is[i]] += (invMasses[is[i]] * dLambda) * dCdx[i];
+			}
+		}
+
+		b3ShearForce* force = (b3ShearForce*)batch->forces[index];
+		force->m_f1 = (lambda * inv_h2) * dCdx[0];
+		force->m_f2 = (lambda * inv_h2) * dCdx[1];
+		force->m_f3 = (lambda * inv_h2) * dCdx[2];
+	}
+}
+
+void b3ClothForceBatch::ProjectSpringConstraints(b3SpringForceBatch* batch, const b3ClothPositionSolverData* data, u32 begin, u32 end)
+{
+	b3DenseVec3& x = *data->x;
+	const b3DenseVec3& x0 = *data->x0;
+	const float32* invMasses = data->invMasses;
+	float32 h = data->h;
+	float32 inv_h2 = 1.0f / (h * h);
+
+	for (u32 index = begin; index < end; ++index)
+	{
+		u32 i1 = batch->v1[index];
+		u32 i2 = batch->v2[index];
+
+		float32 w1 = invMasses[i1];
+		float32 w2 = invMasses[i2];
+
+		float32 L0 = batch->L0[index];
+		float32 ks = batch->ks[index];
+		float32 kd = batch->kd[index];
+
+		float32& lambda = batch->lambda[index];
+
+		b3Vec3 dx = x[i1] - x[i2];
+
+		float32 L = b3Length(dx);
+		if (L == 0.0f)
+		{
+			continue;
+		}
+
+		// Jacobian
+		b3Vec3 dCdx = dx / L;
+
+		// The constraint only resists streching
+		if (ks > 0.0f && L > L0)
+		{
+			float32 C = L - L0;
+
+			float32 dCdt0 = b3Dot(dCdx, (x[i1] - x0[i1]) - (x[i2] - x0[i2]));
+			float32 invMass = w1 + w2;
+
+			float32 dLambda = b3ComputeMultiplierIncrement(C, dCdt0, invMass, lambda, ks, kd, h);
+			lambda += dLambda;
+
+			x[i1] += (w1 * dLambda) * dCdx;
+			x[i2] -= (w2 * dLambda) * dCdx;
+		}
+
+		b3SpringForce* force = (b3SpringForce*)batch->forces[index];
+		force->m_f = (lambda * inv_h2) * dCdx;
+	}
+}
+
+// A task applying or projecting a range of forces of the same color.
+// The batch type is const when applying forces. The projection writes the multipliers.
+template<class T, class D>
+struct b3ForceBatchTask
+{
+	typedef void (*b3ApplyFcn)(T* batch, const D* data, u32 begin, u32 end);
+
+	void Execute(u32 index, u32 threadIndex)
+	{
+		B3_NOT_USED(threadIndex);
+
+		u32 first = begin + index * b3_forceBatchTaskSize;
+		u32 last = b3Min(first + b3_forceBatchTaskSize, end);
+
+		fcn(batch, data, first, last);
+	}
+
+	b3ApplyFcn fcn;
+	T* batch;
+	const D* data;
+	u32 begin;
+	u32 end;
+};
+
+template<class T, class D>
+static void b3ApplyBatch(T* batch, typename b3ForceBatchTask<T, D>::b3ApplyFcn fcn, 
+	const D* data, b3ThreadPool* threadPool)
+{
+	for (u32 i = 0; i < batch->colorCount; ++i)
+	{
+		u32 begin = batch->colorOffsets[i];
+		u32 end = batch->colorOffsets[i + 1];
+
+		u32 taskCount = (end - begin + b3_forceBatchTaskSize - 1) / b3_forceBatchTaskSize;
+
+		if (threadPool && taskCount > 1)
+		{
+			b3ForceBatchTask<T, D> task;
+			task.fcn = fcn;
+			task.batch = batch;
+			task.data = data;
+			task.begin = begin;
+			task.end = end;
+
+			threadPool->Run(&task, taskCount);
+		}
+		else
+		{
+			fcn(batch, data, begin, end);
+		}
+	}
+}
+
+b3ClothForceBatch::b3ClothForceBatch()
+{
+	b3SetEmpty(&m_strechBatch);
+	b3SetEmpty(&m_shearBatch);
+	b3SetEmpty(&m_springBatch);
+}
+
+b3ClothForceBatch::~b3ClothForceBatch()
+{
+	Destroy();
+}
+
+void b3ClothForceBatch::Create(const b3List2<b3Force>& forces, u32 particleCount, const b3SparsePattern* pattern)
+{
+	Destroy();
+
+	CreateBatch(&m_strechBatch, e_strechForce, forces, particleCount, pattern);
+	CreateBatch(&m_shearBatch, e_shearForce, forces, particleCount, pattern);
+	CreateBatch(&m_springBatch, forces, particleCount, pattern);
+}
+
+void b3ClothForceBatch::Destroy()
+{
+	b3DestroyBatch(&m_strechBatch);
+	b3DestroyBatch(&m_shearBatch);
+	b3DestroyBatch(&m_springBatch);
+}
+
+void b3ClothForceBatch::Apply(const b3ClothForceSolverData* data, b3ThreadPool* threadPool) const
+{
+	b3ApplyBatch(&m_strechBatch, ApplyStrechForces, data, threadPool);
+	b3ApplyBatch(&m_shearBatch, ApplyShearForces, data, threadPool);
+	b3ApplyBatch(&m_springBatch, ApplySpringForces, data, threadPool);
+}
+
+void b3ClothForceBatch::ResetMultipliers()
+{
+	if (m_strechBatch.count > 0)
+	{
+		memset(m_strechBatch.lambda1, 0, m_strechBatch.count * sizeof(float32));
+		memset(m_strechBatch.lambda2, 0, m_strechBatch.count * sizeof(float32));
+	}
+
+	if (m_shearBatch.count > 0)
+	{
+		memset(m_shearBatch.lambda1, 0, m_shearBatch.count * sizeof(float32));
+	}
+
+	if (m_springBatch.count > 0)
+	{
+		memset(m_springBatch.lambda, 0, m_springBatch.count * sizeof(float32));
+	}
+}
+
+void b3ClothForceBatch::Project(const b3ClothPositionSolverData* data, b3ThreadPool* threadPool)
+{
+	b3ApplyBatch(&m_strechBatch, ProjectStrechConstraints, data, threadPool);
+	b3ApplyBatch(&m_shearBatch, ProjectShearConstraints, data, threadPool);
+	b3ApplyBatch(&m_springBatch, ProjectSpringConstraints, data, threadPool);
+}
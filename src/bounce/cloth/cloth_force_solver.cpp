@@ -17,12 +17,13 @@
 */
 
 #include <bounce/cloth/cloth_force_solver.h>
+#include <bounce/cloth/cloth_force_batch.h>
 #include <bounce/cloth/particle.h>
 #include <bounce/cloth/forces/force.h>
 #include <bounce/sparse/dense_vec3.h>
 #include <bounce/sparse/diag_mat33.h>
-#include <bounce/sparse/sparse_mat33.h>
-#include <bounce/sparse/sparse_mat33_view.h>
+#include <bounce/sparse/csr_mat33.h>
+#include <bounce/sparse/mpcg.h>
 #include <bounce/common/memory/stack_allocator.h>
 
 // Here, we solve Ax = b using the Modified Preconditioned Conjugate Gradient (MPCG) algorithm.
@@ -39,10 +40,21 @@ b3ClothForceSolver::b3ClothForceSolver(const b3ClothForceSolverDef& def)
 	m_allocator = def.stack;
 
 	m_particleCount = def.particleCount;
-	m_particles = def.particles;
+	m_positions = def.positions;
+	m_velocities = def.velocities;
+	m_externalForces = def.externalForces;
+	m_translations = def.translations;
+	m_solutions = def.solutions;
+	m_masses = def.masses;
+	m_types = def.types;
 
 	m_forceCount = def.forceCount;
 	m_forces = def.forces;
+
+	m_dfdx = def.dfdx;
+	m_dfdv = def.dfdv;
+	m_forceBatch = def.forceBatch;
+	m_workspace = def.workspace;
 }
 
 b3ClothForceSolver::~b3ClothForceSolver()
@@ -51,106 +63,84 @@ b3ClothForceSolver::~b3ClothForceSolver()
 
 void b3ClothForceSolver::ApplyForces()
 {
+	m_forceBatch->Apply(&m_solverData, m_workspace->threadPool);
+
 	for (u32 i = 0; i < m_forceCount; ++i)
 	{
-		m_forces[i]->Apply(&m_solverData);
+		b3Force* f = m_forces[i];
+
+		if (b3ClothForceBatch::IsBatched(f->m_type) == false)
+		{
+			f->Apply(&m_solverData);
+		}
 	}
 }
 
 // Solve Ax = b
-static void b3SolveMPCG(b3DenseVec3& x,
-	const b3SparseMat33View& A, const b3DenseVec3& b,
+static void b3SolveMPCG(b3DenseVec3& x, b3MPCGWorkspace* workspace,
+	const b3CSRMat33& A, const b3DenseVec3& b,
 	const b3DiagMat33& S, const b3DenseVec3& z,
-	const b3DenseVec3& y, const b3DiagMat33& I, u32 maxIterations = 20)
+	const b3DenseVec3& y, u32 maxIterations = 20)
 {
 	B3_PROFILE("Cloth Solve MPCG");
 
-	// Jacobi preconditioner 
-	// P = diag(A)
-	b3DiagMat33 inv_P(A.rowCount);
-	for (u32 i = 0; i < A.rowCount; ++i)
-	{
-		b3Mat33 a = A(i, i);
-
-		// Sylvester Criterion to ensure PD-ness
-		B3_ASSERT(b3Det(a.x, a.y, a.z) > 0.0f);
-
-		B3_ASSERT(a.x.x > 0.0f);
-		float32 xx = 1.0f / a.x.x;
-
-		B3_ASSERT(a.y.y > 0.0f);
-		float32 yy = 1.0f / a.y.y;
-
-		B3_ASSERT(a.z.z > 0.0f);
-		float32 zz = 1.0f / a.z.z;
-
-		inv_P[i] = b3Diagonal(xx, yy, zz);
-	}
-
-	x = (S * y) + (I - S) * z;
+	workspace->Resize(A.rowCount);
 
-	b3DenseVec3 b_hat = S * (b - A * ((I - S) * z));
+	b3DenseVec3& r = workspace->r;
+	b3DenseVec3& s = workspace->s;
+	b3DenseVec3& h = workspace->h;
 
-	float32 b_delta = b3Dot(b_hat, inv_P * b_hat);
+	b3ComputePreconditioner(workspace, A);
 
-	b3DenseVec3 r = S * (b - A * x);
-
-	b3DenseVec3 p = S * (inv_P * r);
-
-	float32 delta_new = b3Dot(r, p);
-
-	u32 iteration = 0;
-	for (;;)
+	// x = S * y + (I - S) * z
+	// h = (I - S) * z
+	for (u32 i = 0; i < A.rowCount; ++i)
 	{
-		if (iteration == maxIterations)
-		{
-			break;
-		}
-
-		if (delta_new <= B3_EPSILON * B3_EPSILON * b_delta)
-		{
-			break;
-		}
-
-		b3DenseVec3 s = S * (A * p);
-
-		float32 alpha = delta_new / b3Dot(p, s);
-
-		x = x + alpha * p;
-		r = r - alpha * s;
-
-		b3DenseVec3 h = inv_P * r;
-
-		float32 delta_old = delta_new;
+		h[i] = z[i] - S[i] * z[i];
+		x[i] = S[i] * y[i] + h[i];
+	}
 
-		delta_new = b3Dot(r, h);
+	// b_hat = S * (b - A * ((I - S) * z))
+	b3ParallelMul(workspace, s, A, h);
+	b3MulSub(r, S, b, s);
 
-		float32 beta = delta_new / delta_old;
+	float32 b_delta = b3ApplyPreconditioner(workspace);
 
-		p = S * (h + beta * p);
+	// r = S * (b - A * x)
+	b3ParallelMul(workspace, s, A, x);
+	b3MulSub(r, S, b, s);
 
-		++iteration;
-	}
+	u32 iteration = b3IterateMPCG(workspace, x, A, S, B3_EPSILON * B3_EPSILON * b_delta, maxIterations);
 
 	b3_clothSolverIterations = iteration;
 }
 
 void b3ClothForceSolver::Solve(float32 dt, const b3Vec3& gravity)
 {
+	B3_PROFILE("Cloth Solve Forces");
+
 	float32 h = dt;
 
-	b3DenseVec3 sx(m_particleCount);
-	b3DenseVec3 sv(m_particleCount);
-	b3DenseVec3 sf(m_particleCount);
-	b3DenseVec3 sy(m_particleCount);
+	// The state is read and written in place.
+	// The applied external forces are cleared by the cloth after the step.
+	// Therefore the forces can be accumulated over them.
+	b3DenseVec3& sx = *m_positions;
+	b3DenseVec3& sv = *m_velocities;
+	b3DenseVec3& sf = *m_externalForces;
+	b3DenseVec3& sy = *m_translations;
+	b3DenseVec3& x = *m_solutions;
 	b3DenseVec3 sz(m_particleCount);
-	b3DenseVec3 sx0(m_particleCount);
-	b3SparseMat33 M(m_particleCount);
-	b3SparseMat33 dfdx(m_particleCount);
-	b3SparseMat33 dfdv(m_particleCount);
+	b3DiagMat33 M(m_particleCount);
 	b3DiagMat33 S(m_particleCount);
-	b3DiagMat33 I(m_particleCount);
-	I.SetIdentity();
+
+	B3_ASSERT(sx.n == m_particleCount);
+	B3_ASSERT(m_dfdx->rowCount == m_particleCount);
+	B3_ASSERT(m_dfdv->rowCount == m_particleCount);
+
+	b3CSRMat33& dfdx = *m_dfdx;
+	b3CSRMat33& dfdv = *m_dfdv;
+	dfdx.SetZero();
+	dfdv.SetZero();
 
 	m_solverData.x = &sx;
 	m_solverData.v = &sv;
@@ -163,28 +153,20 @@ void b3ClothForceSolver::Solve(float32 dt, const b3Vec3& gravity)
 
 	for (u32 i = 0; i < m_particleCount; ++i)
 	{
-		b3Particle* p = m_particles[i];
+		M[i] = b3Diagonal(m_masses[i]);
 
-		M(i, i) = b3Diagonal(p->m_mass);
-		
-		sx[i] = p->m_position;
-		sv[i] = p->m_velocity;
-		sf[i] = p->m_force;
 		sz[i].SetZero();
 
-		if (p->m_type == e_dynamicParticle)
+		if (m_types[i] == e_dynamicParticle)
 		{
 			// Apply weight
-			sf[i] += p->m_mass * gravity;
+			sf[i] += m_masses[i] * gravity;
 			S[i].SetIdentity();
 		}
 		else
 		{
 			S[i].SetZero();
 		}
-
-		sy[i] = p->m_translation;
-		sx0[i] = p->m_x;
 	}
 
 	// Apply internal forces
@@ -194,30 +176,40 @@ void b3ClothForceSolver::Solve(float32 dt, const b3Vec3& gravity)
 	// A = M - h * dfdv - h * h * dfdx
 	// b = h * (f0 + h * dfdx * v0 + dfdx * y) 
 	
-	// A
-	b3SparseMat33 A = M - h * dfdv - (h * h) * dfdx;
-
-	// View for A
-	b3SparseMat33View viewA(A);
-
 	// b
-	b3DenseVec3 b = h * (sf + h * (dfdx * sv) + dfdx * sy);
-
-	// x
-	b3DenseVec3 x(m_particleCount);
-	b3SolveMPCG(x, viewA, b, S, sz, sx0, I);
-
-	// Velocity update
-	sv = sv + x;
-	sx = sx + sy;
+	b3DenseVec3 b(m_particleCount);
+	b3DenseVec3 dfdx_y(m_particleCount);
+	
+	b3Mul(b, dfdx, sv);
+	b3Mul(dfdx_y, dfdx, sy);
+	for (u32 i = 0; i < m_particleCount; ++i)
+	{
+		b[i] = h * (sf[i] + h * b[i] + dfdx_y[i]);
+	}
 
-	// Copy state buffers back to the particle
+	// A
+	// The Jacobians share the same pattern. 
+	// Therefore A can be written over dfdx.
+	b3CSRMat33& A = dfdx;
+	const b3SparsePattern* pattern = A.pattern;
 	for (u32 i = 0; i < m_particleCount; ++i)
 	{
-		b3Particle* p = m_particles[i];
+		for (u32 k = pattern->rowOffsets[i]; k < pattern->rowOffsets[i + 1]; ++k)
+		{
+			A.values[k] = -h * dfdv.values[k] - (h * h) * dfdx.values[k];
 
-		p->m_x = x[i];
-		p->m_position = sx[i];
-		p->m_velocity = sv[i];
+			if (pattern->columns[k] == i)
+			{
+				A.values[k] += M[i];
+			}
+		}
 	}
-}
\ No newline at end of file
+
+	// x
+	// The previous solution is the initial guess.
+	b3SolveMPCG(x, m_workspace, A, b, S, sz, x);
+
+	// Velocity update
+	b3Axpy(sv, 1.0f, x);
+	b3Axpy(sx, 1.0f, sy);
+}
@@ -0,0 +1,142 @@
+/*
+* Copyright (c) 2016-2019 Irlan Robson https://irlanrobson.github.io
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+#include <bounce/cloth/cloth_position_solver.h>
+#include <bounce/cloth/cloth_force_batch.h>
+#include <bounce/cloth/particle.h>
+#include <bounce/cloth/forces/force.h>
+#include <bounce/sparse/dense_vec3.h>
+#include <bounce/sparse/mpcg.h>
+#include <bounce/common/memory/stack_allocator.h>
+
+// Here, we solve the internal dynamics using the algorithm described in the paper:
+// "XPBD: Position-Based Simulation of Compliant Constrained Dynamics - Miles Macklin, Matthias Muller, Nuttapong Chentanez".
+
+b3ClothPositionSolver::b3ClothPositionSolver(const b3ClothPositionSolverDef& def)
+{
+	m_allocator = def.stack;
+
+	m_particleCount = def.particleCount;
+	m_positions = def.positions;
+	m_velocities = def.velocities;
+	m_externalForces = def.externalForces;
+	m_translations = def.translations;
+	m_invMasses = def.invMasses;
+	m_types = def.types;
+
+	m_forceCount = def.forceCount;
+	m_forces = def.forces;
+
+	m_forceBatch = def.forceBatch;
+	m_workspace = def.workspace;
+	m_threadPool = def.threadPool;
+
+	m_iterations = def.iterations;
+}
+
+b3ClothPositionSolver::~b3ClothPositionSolver()
+{
+}
+
+void b3ClothPositionSolver::Solve(float32 dt, const b3Vec3& gravity)
+{
+	B3_PROFILE("Cloth Solve Constraints");
+
+	float32 h = dt;
+
+	b3DenseVec3& sx = *m_positions;
+	b3DenseVec3& sv = *m_velocities;
+	const b3DenseVec3& sf = *m_externalForces;
+	const b3DenseVec3& sy = *m_translations;
+
+	B3_ASSERT(sx.n == m_particleCount);
+
+	// Predicted positions.
+	// The linear solver isn't used by this solver, so these are kept in its workspace.
+	b3DenseVec3& sp = m_workspace->s;
+	sp.Resize(m_particleCount);
+
+	float32* invMasses = (float32*)m_allocator->Allocate(m_particleCount * sizeof(float32));
+
+	for (u32 i = 0; i < m_particleCount; ++i)
+	{
+		// Apply translation
+		sx[i] += sy[i];
+
+		if (m_types[i] == e_dynamicParticle)
+		{
+			invMasses[i] = m_invMasses[i];
+
+			// Integrate external forces and weight
+			sv[i] += h * (gravity + m_invMasses[i] * sf[i]);
+		}
+		else
+		{
+			invMasses[i] = 0.0f;
+		}
+
+		sp[i] = sx[i] + h * sv[i];
+	}
+
+	b3ClothPositionSolverData data;
+	data.x = &sp;
+	data.x0 = &sx;
+	data.invMasses = invMasses;
+	data.h = h;
+
+	m_forceBatch->ResetMultipliers();
+
+	for (u32 i = 0; i < m_forceCount; ++i)
+	{
+		b3Force* f = m_forces[i];
+
+		if (b3ClothForceBatch::IsBatched(f->m_type) == false)
+		{
+			f->ResetMultipliers();
+		}
+	}
+
+	for (u32 iteration = 0; iteration < m_iterations; ++iteration)
+	{
+		m_forceBatch->Project(&data, m_threadPool);
+
+		for (u32 i = 0; i < m_forceCount; ++i)
+		{
+			b3Force* f = m_forces[i];
+
+			if (b3ClothForceBatch::IsBatched(f->m_type) == false)
+			{
+				f->Project(&data);
+			}
+		}
+	}
+
+	// Velocity update
+	// The positions are integrated by the contact solver.
+	float32 inv_h = 1.0f / h;
+	for (u32 i = 0; i < m_particleCount; ++i)
+	{
+		if (m_types[i] == e_dynamicParticle)
+		{
+			sv[i] = inv_h * (sp[i] - sx[i]);
+		}
+	}
+
+	m_allocator->Free(invMasses);
+}
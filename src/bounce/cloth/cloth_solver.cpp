@@ -18,9 +18,11 @@
 
 #include <bounce/cloth/cloth_solver.h>
 #include <bounce/cloth/cloth_force_solver.h>
+#include <bounce/cloth/cloth_position_solver.h>
 #include <bounce/cloth/contacts/cloth_contact_solver.h>
 #include <bounce/cloth/cloth.h>
 #include <bounce/cloth/particle.h>
+#include <bounce/sparse/mpcg.h>
 #include <bounce/dynamics/shapes/shape.h>
 #include <bounce/dynamics/body.h>
 #include <bounce/common/memory/stack_allocator.h>
@@ -29,9 +31,23 @@ b3ClothSolver::b3ClothSolver(const b3ClothSolverDef& def)
 {
 	m_allocator = def.stack;
 
-	m_particleCapacity = def.particleCapacity;
-	m_particleCount = 0;
-	m_particles = (b3Particle**)m_allocator->Allocate(m_particleCapacity * sizeof(b3Particle*));
+	m_type = def.type;
+	m_positionBasedIterations = def.positionBasedIterations;
+
+	m_dfdx = def.dfdx;
+	m_dfdv = def.dfdv;
+	m_forceBatch = def.forceBatch;
+	m_workspace = def.workspace;
+
+	m_particleCount = def.particleCount;
+	m_positions = def.positions;
+	m_velocities = def.velocities;
+	m_externalForces = def.externalForces;
+	m_translations = def.translations;
+	m_solutions = def.solutions;
+	m_masses = def.masses;
+	m_invMasses = def.invMasses;
+	m_types = def.types;
 
 	m_forceCapacity = def.forceCapacity;
 	m_forceCount = 0;
@@ -51,13 +67,6 @@ b3ClothSolver::~b3ClothSolver()
 	m_allocator->Free(m_triangleContacts);
 	m_allocator->Free(m_bodyContacts);
 	m_allocator->Free(m_forces);
-	m_allocator->Free(m_particles);
-}
-
-void b3ClothSolver::Add(b3Particle* p)
-{
-	p->m_solverId = m_particleCount;
-	m_particles[m_particleCount++] = p;
 }
 
 void b3ClothSolver::Add(b3Force* f)
@@ -77,28 +86,57 @@ void b3ClothSolver::Add(b3ParticleTriangleContact* c)
 
 void b3ClothSolver::Solve(float32 dt, const b3Vec3& gravity, u32 velocityIterations, u32 positionIterations)
 {
+	if (m_type == e_positionBasedSolver)
+	{
+		// Solve internal dynamics
+		b3ClothPositionSolverDef positionSolverDef;
+		positionSolverDef.stack = m_allocator;
+		positionSolverDef.particleCount = m_particleCount;
+		positionSolverDef.positions = m_positions;
+		positionSolverDef.velocities = m_velocities;
+		positionSolverDef.externalForces = m_externalForces;
+		positionSolverDef.translations = m_translations;
+		positionSolverDef.invMasses = m_invMasses;
+		positionSolverDef.types = m_types;
+		positionSolverDef.forceCount = m_forceCount;
+		positionSolverDef.forces = m_forces;
+		positionSolverDef.forceBatch = m_forceBatch;
+		positionSolverDef.workspace = m_workspace;
+		positionSolverDef.threadPool = m_workspace->threadPool;
+		positionSolverDef.iterations = m_positionBasedIterations;
+
+		b3ClothPositionSolver positionSolver(positionSolverDef);
+
+		positionSolver.Solve(dt, gravity);
+	}
+	else
 	{
 		// Solve internal dynamics
 		b3ClothForceSolverDef forceSolverDef;
 		forceSolverDef.stack = m_allocator;
 		forceSolverDef.particleCount = m_particleCount;
-		forceSolverDef.particles = m_particles;
+		forceSolverDef.positions = m_positions;
+		forceSolverDef.velocities = m_velocities;
+		forceSolverDef.externalForces = m_externalForces;
+		forceSolverDef.translations = m_translations;
+		forceSolverDef.solutions = m_solutions;
+		forceSolverDef.masses = m_masses;
+		forceSolverDef.types = m_types;
 		forceSolverDef.forceCount = m_forceCount;
 		forceSolverDef.forces = m_forces;
+		forceSolverDef.dfdx = m_dfdx;
+		forceSolverDef.dfdv = m_dfdv;
+		forceSolverDef.forceBatch = m_forceBatch;
+		forceSolverDef.workspace = m_workspace;
 
 		b3ClothForceSolver forceSolver(forceSolverDef);
 
 		forceSolver.Solve(dt, gravity);
 	}
-	
-	// Copy particle state to state buffer
-	b3Vec3* positions = (b3Vec3*)m_allocator->Allocate(m_particleCount * sizeof(b3Vec3));
-	b3Vec3* velocities = (b3Vec3*)m_allocator->Allocate(m_particleCount * sizeof(b3Vec3));
-	for (u32 i = 0; i < m_particleCount; ++i)
-	{
-		positions[i] = m_particles[i]->m_position;
-		velocities[i] = m_particles[i]->m_velocity;
-	}
+
+	// The constraints are solved directly on the particle state.
+	b3Vec3* positions = m_positions->v;
+	b3Vec3* velocities = m_velocities->v;
 
 	{
 		// Solve constraints
@@ -106,6 +144,8 @@ void b3ClothSolver::Solve(float32 dt, const b3Vec3& gravity, u32 velocityIterati
 		contactSolverDef.allocator = m_allocator;
 		contactSolverDef.positions = positions;
 		contactSolverDef.velocities = velocities;
+		contactSolverDef.invMasses = m_invMasses;
+		contactSolverDef.types = m_types;
 		contactSolverDef.bodyContactCount = m_bodyContactCount;
 		contactSolverDef.bodyContacts = m_bodyContacts;
 		contactSolverDef.triangleContactCount = m_triangleContactCount;
@@ -180,14 +220,4 @@ void b3ClothSolver::Solve(float32 dt, const b3Vec3& gravity, u32 velocityIterati
 			body->SynchronizeShapes();
 		}
 	}
-
-	// Copy state buffers back to the particles
-	for (u32 i = 0; i < m_particleCount; ++i)
-	{
-		m_particles[i]->m_position = positions[i];
-		m_particles[i]->m_velocity = velocities[i];
-	}
-
-	m_allocator->Free(velocities);
-	m_allocator->Free(positions);
 }
\ No newline at end of file
@@ -25,13 +25,9 @@ void b3ClothTriangle::Synchronize(const b3Vec3& displacement)
 {
 	b3ClothMeshTriangle* triangle = m_cloth->m_mesh->triangles + m_triangle;
 
-	b3Particle* p1 = m_cloth->m_particles[triangle->v1];
-	b3Particle* p2 = m_cloth->m_particles[triangle->v2];
-	b3Particle* p3 = m_cloth->m_particles[triangle->v3];
-
-	b3Vec3 x1 = p1->m_position;
-	b3Vec3 x2 = p2->m_position;
-	b3Vec3 x3 = p3->m_position;
+	b3Vec3 x1 = m_cloth->m_positions[triangle->v1];
+	b3Vec3 x2 = m_cloth->m_positions[triangle->v2];
+	b3Vec3 x3 = m_cloth->m_positions[triangle->v3];
 
 	b3AABB3 aabb;
 	aabb.Set(x1, x2, x3);
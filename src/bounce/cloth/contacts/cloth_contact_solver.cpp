@@ -30,6 +30,8 @@ b3ClothContactSolver::b3ClothContactSolver(const b3ClothContactSolverDef& def)
 	
 	m_positions = def.positions;
 	m_velocities = def.velocities;
+	m_invMasses = def.invMasses;
+	m_types = def.types;
 	
 	m_bodyContactCount = def.bodyContactCount;
 	m_bodyContacts = def.bodyContacts;
@@ -62,7 +64,7 @@ void b3ClothContactSolver::InitializeBodyContactConstraints()
 		vc->indexA = c->m_p1->m_solverId;
 		vc->bodyB = c->m_s2->GetBody();
 
-		vc->invMassA = c->m_p1->m_type == e_staticParticle ? 0.0f : c->m_p1->m_invMass;
+		vc->invMassA = m_types[vc->indexA] == e_staticParticle ? 0.0f : m_invMasses[vc->indexA];
 		vc->invMassB = vc->bodyB->GetInverseMass();
 
 		vc->invIA.SetZero();
@@ -73,7 +75,7 @@ void b3ClothContactSolver::InitializeBodyContactConstraints()
 		pc->indexA = c->m_p1->m_solverId;
 		pc->bodyB = vc->bodyB;
 
-		pc->invMassA = c->m_p1->m_type == e_staticParticle ? 0.0f : c->m_p1->m_invMass;
+		pc->invMassA = m_types[pc->indexA] == e_staticParticle ? 0.0f : m_invMasses[pc->indexA];
 		pc->invMassB = vc->bodyB->m_invMass;
 
 		pc->invIA.SetZero();
@@ -185,29 +187,29 @@ void b3ClothContactSolver::InitializeTriangleContactConstraints()
 		b3ClothSolverTriangleContactPositionConstraint* pc = m_trianglePositionConstraints + i;
 
 		vc->indexA = c->m_p1->m_solverId;
-		vc->invMassA = c->m_p1->m_type == e_staticParticle ? 0.0f : c->m_p1->m_invMass;
+		vc->invMassA = m_types[vc->indexA] == e_staticParticle ? 0.0f : m_invMasses[vc->indexA];
 
 		vc->indexB = c->m_p2->m_solverId;
-		vc->invMassB = c->m_p2->m_type == e_staticParticle ? 0.0f : c->m_p2->m_invMass;
+		vc->invMassB = m_types[vc->indexB] == e_staticParticle ? 0.0f : m_invMasses[vc->indexB];
 
 		vc->indexC = c->m_p3->m_solverId;
-		vc->invMassC = c->m_p3->m_type == e_staticParticle ? 0.0f : c->m_p3->m_invMass;
+		vc->invMassC = m_types[vc->indexC] == e_staticParticle ? 0.0f : m_invMasses[vc->indexC];
 
 		vc->indexD = c->m_p4->m_solverId;
-		vc->invMassD = c->m_p4->m_type == e_staticParticle ? 0.0f : c->m_p4->m_invMass;
+		vc->invMassD = m_types[vc->indexD] == e_staticParticle ? 0.0f : m_invMasses[vc->indexD];
 
 		pc->indexA = c->m_p1->m_solverId;
-		pc->invMassA = c->m_p1->m_type == e_staticParticle ? 0.0f : c->m_p1->m_invMass;
+		pc->invMassA = m_types[pc->indexA] == e_staticParticle ? 0.0f : m_invMasses[pc->indexA];
 		pc->radiusA = c->m_p1->m_radius;
 
 		pc->indexB = c->m_p2->m_solverId;
-		pc->invMassB = c->m_p2->m_type == e_staticParticle ? 0.0f : c->m_p2->m_invMass;
+		pc->invMassB = m_types[pc->indexB] == e_staticParticle ? 0.0f : m_invMasses[pc->indexB];
 
 		pc->indexC = c->m_p3->m_solverId;
-		pc->invMassC = c->m_p3->m_type == e_staticParticle ? 0.0f : c->m_p3->m_invMass;
+		pc->invMassC = m_types[pc->indexC] == e_staticParticle ? 0.0f : m_invMasses[pc->indexC];
 
 		pc->indexD = c->m_p4->m_solverId;
-		pc->invMassD = c->m_p4->m_type == e_staticParticle ? 0.0f : c->m_p4->m_invMass;
+		pc->invMassD = m_types[pc->indexD] == e_staticParticle ? 0.0f : m_invMasses[pc->indexD];
 
 		pc->triangleRadius = c->m_t2->m_radius;
 
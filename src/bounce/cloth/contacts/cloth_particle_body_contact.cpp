@@ -18,6 +18,7 @@
 
 #include <bounce/cloth/contacts/cloth_particle_body_contact.h>
 #include <bounce/cloth/particle.h>
+#include <bounce/cloth/cloth.h>
 #include <bounce/dynamics/shapes/shape.h>
 #include <bounce/dynamics/body.h>
 
@@ -25,7 +26,7 @@ void b3ParticleBodyContact::Update()
 {
 	b3Sphere sphere;
 	sphere.radius = m_p1->m_radius;
-	sphere.vertex = m_p1->m_position;
+	sphere.vertex = m_p1->GetPosition();
 
 	b3Shape* shape = m_s2;
 	b3Body* body = shape->GetBody();
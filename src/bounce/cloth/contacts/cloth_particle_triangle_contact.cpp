@@ -120,9 +120,9 @@ static void b3Solve3(float32 out[3],
 
 void b3ParticleTriangleContact::Update()
 {
-	b3Vec3 A = m_p2->m_position;
-	b3Vec3 B = m_p3->m_position;
-	b3Vec3 C = m_p4->m_position;
+	b3Vec3 A = m_p2->GetPosition();
+	b3Vec3 B = m_p3->GetPosition();
+	b3Vec3 C = m_p4->GetPosition();
 
 	b3Vec3 N = b3Cross(B - A, C - A);
 	float32 len = N.Normalize();
@@ -139,7 +139,7 @@ void b3ParticleTriangleContact::Update()
 
 	float32 totalRadius = r1 + r2;
 
-	b3Vec3 P1 = m_p1->m_position;
+	b3Vec3 P1 = m_p1->GetPosition();
 
 	float32 distance = b3Dot(N, P1 - A);
 
@@ -22,8 +22,9 @@
 #include <bounce/cloth/cloth.h>
 #include <bounce/cloth/cloth_mesh.h>
 #include <bounce/cloth/cloth_force_solver.h>
+#include <bounce/cloth/cloth_position_solver.h>
 #include <bounce/sparse/dense_vec3.h>
-#include <bounce/sparse/sparse_mat33.h>
+#include <bounce/sparse/csr_mat33.h>
 
 b3MouseForce::b3MouseForce(const b3MouseForceDef* def)
 {
@@ -39,6 +40,7 @@ b3MouseForce::b3MouseForce(const b3MouseForceDef* def)
 	m_f2.SetZero();
 	m_f3.SetZero();
 	m_f4.SetZero();
+	m_lambda = 0.0f;
 }
 
 b3MouseForce::~b3MouseForce()
@@ -59,6 +61,20 @@ bool b3MouseForce::HasParticle(const b3Particle* particle) const
 	return m_particle == particle || p1 == particle || p2 == particle || p3 == particle;
 }
 
+u32 b3MouseForce::GetParticles(b3Particle** particles) const
+{
+	b3Cloth* cloth = m_triangle->m_cloth;
+	u32 triangleIndex = m_triangle->m_triangle;
+	b3ClothMeshTriangle* triangle = cloth->m_mesh->triangles + triangleIndex;
+
+	particles[0] = m_particle;
+	particles[1] = cloth->m_particles[triangle->v1];
+	particles[2] = cloth->m_particles[triangle->v2];
+	particles[3] = cloth->m_particles[triangle->v3];
+
+	return 4;
+}
+
 void b3MouseForce::Apply(const b3ClothForceSolverData* data)
 {
 	b3Cloth* cloth = m_triangle->m_cloth;
@@ -78,8 +94,8 @@ void b3MouseForce::Apply(const b3ClothForceSolverData* data)
 	b3DenseVec3& x = *data->x;
 	b3DenseVec3& v = *data->v;
 	b3DenseVec3& f = *data->f;
-	b3SparseMat33& dfdx = *data->dfdx;
-	b3SparseMat33& dfdv = *data->dfdv;
+	b3CSRMat33& dfdx = *data->dfdx;
+	b3CSRMat33& dfdv = *data->dfdv;
 
 	b3Vec3 x1 = x[i1];
 	b3Vec3 x2 = x[i2];
@@ -225,4 +241,80 @@ void b3MouseForce::Apply(const b3ClothForceSolverData* data)
 	f[i2] += m_f2;
 	f[i3] += m_f3;
 	f[i4] += m_f4;
-}
\ No newline at end of file
+}
+
+void b3MouseForce::ResetMultipliers()
+{
+	m_lambda = 0.0f;
+}
+
+void b3MouseForce::Project(const b3ClothPositionSolverData* data)
+{
+	b3Cloth* cloth = m_triangle->m_cloth;
+	u32 triangleIndex = m_triangle->m_triangle;
+	b3ClothMeshTriangle* triangle = cloth->m_mesh->triangles + triangleIndex;
+
+	u32 is[4];
+	is[0] = m_particle->m_solverId;
+	is[1] = cloth->m_particles[triangle->v1]->m_solverId;
+	is[2] = cloth->m_particles[triangle->v2]->m_solverId;
+	is[3] = cloth->m_particles[triangle->v3]->m_solverId;
+
+	b3DenseVec3& x = *data->x;
+	const b3DenseVec3& x0 = *data->x0;
+	const float32* invMasses = data->invMasses;
+
+	m_f1.SetZero();
+	m_f2.SetZero();
+	m_f3.SetZero();
+	m_f4.SetZero();
+
+	if (m_km == 0.0f)
+	{
+		return;
+	}
+
+	b3Vec3 c2 = m_w2 * x[is[1]] + m_w3 * x[is[2]] + m_w4 * x[is[3]];
+
+	b3Vec3 d = x[is[0]] - c2;
+	float32 len = b3Length(d);
+
+	if (len == 0.0f)
+	{
+		return;
+	}
+
+	b3Vec3 n = d / len;
+
+	// Jacobian
+	b3Vec3 dCdx[4];
+	dCdx[0] = n;
+	dCdx[1] = -m_w2 * n;
+	dCdx[2] = -m_w3 * n;
+	dCdx[3] = -m_w4 * n;
+
+	float32 C = len;
+
+	float32 dCdt0 = 0.0f;
+	float32 invMass = 0.0f;
+	for (u32 i = 0; i < 4; ++i)
+	{
+		dCdt0 += b3Dot(dCdx[i], x[is[i]] - x0[is[i]]);
+		invMass += invMasses[is[i]] * b3Dot(dCdx[i], dCdx[i]);
+	}
+
+	float32 dLambda = b3ComputeMultiplierIncrement(C, dCdt0, invMass, m_lambda, m_km, m_kd, data->h);
+	m_lambda += dLambda;
+
+	for (u32 i = 0; i < 4; ++i)
+	{
+		x[is[i]] += (invMasses[is[i]] * dLambda) * dCdx[i];
+	}
+
+	// Force
+	float32 s = m_lambda / (data->h * data->h);
+	m_f1 = s * dCdx[0];
+	m_f2 = s * dCdx[1];
+	m_f3 = s * dCdx[2];
+	m_f4 = s * dCdx[3];
+}
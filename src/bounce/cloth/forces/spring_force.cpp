@@ -18,9 +18,7 @@
 
 #include <bounce/cloth/forces/spring_force.h>
 #include <bounce/cloth/particle.h>
-#include <bounce/cloth/cloth_force_solver.h>
-#include <bounce/sparse/dense_vec3.h>
-#include <bounce/sparse/sparse_mat33.h>
+#include <bounce/cloth/cloth.h>
 
 void b3SpringForceDef::Initialize(b3Particle* particle1, b3Particle* particle2, float32 structuralStiffness, float32 dampingStiffness)
 {
@@ -49,72 +47,3 @@ b3SpringForce::~b3SpringForce()
 {
 
 }
-
-void b3SpringForce::Apply(const b3ClothForceSolverData* data)
-{
-	b3DenseVec3& x = *data->x;
-	b3DenseVec3& v = *data->v;
-	b3DenseVec3& f = *data->f;
-	b3SparseMat33& dfdx = *data->dfdx;
-	b3SparseMat33& dfdv = *data->dfdv;
-
-	u32 i1 = m_p1->m_solverId;
-	u32 i2 = m_p2->m_solverId;
-
-	b3Vec3 x1 = x[i1];
-	b3Vec3 v1 = v[i1];
-
-	b3Vec3 x2 = x[i2];
-	b3Vec3 v2 = v[i2];
-
-	b3Mat33 I; I.SetIdentity();
-
-	m_f.SetZero();
-
-	if (m_ks > 0.0f)
-	{
-		b3Vec3 dx = x1 - x2;
-
-		float32 L = b3Length(dx);
-
-		if (L > m_L0)
-		{
-			// Jacobian
-			b3Vec3 dCdx = dx / L;
-
-			m_f += -m_ks * (L - m_L0) * dCdx;
-
-			// Force derivative
-			b3Mat33 K11 = -m_ks * (b3Outer(dx, dx) + (1.0f - m_L0 / L) * (I - b3Outer(dx, dx)));
-			b3Mat33 K12 = -K11;
-			b3Mat33 K21 = K12;
-			b3Mat33 K22 = K11;
-
-			dfdx(i1, i1) += K11;
-			dfdx(i1, i2) += K12;
-			dfdx(i2, i1) += K21;
-			dfdx(i2, i2) += K22;
-		}
-	}
-
-	if (m_kd > 0.0f)
-	{
-		// C * J
-		b3Vec3 dv = v1 - v2;
-
-		m_f += -m_kd * dv;
-		
-		b3Mat33 K11 = -m_kd * I;
-		b3Mat33 K12 = -K11;
-		b3Mat33 K21 = K12;
-		b3Mat33 K22 = K11;
-
-		dfdv(i1, i1) += K11;
-		dfdv(i1, i2) += K12;
-		dfdv(i2, i1) += K21;
-		dfdv(i2, i2) += K22;
-	}
-
-	f[i1] += m_f;
-	f[i2] -= m_f;
-}
\ No newline at end of file
@@ -21,32 +21,37 @@
 #include <bounce/cloth/cloth_mesh.h>
 #include <bounce/cloth/cloth_triangle.h>
 
-b3Particle::b3Particle(const b3ParticleDef& def, b3Cloth* cloth)
+b3Particle::b3Particle(const b3ParticleDef& def, b3Cloth* cloth, u32 solverId)
 {
 	m_cloth = cloth;
-	m_type = def.type;
-	m_position = def.position;
-	m_velocity = def.velocity;
-	m_force = def.force;
-	m_translation.SetZero();
-	m_mass = def.mass;
-
-	if (m_mass == 0.0f)
+	m_solverId = solverId;
+
+	u32 i = m_solverId;
+
+	float32 mass = def.mass;
+	
+	if (mass == 0.0f)
 	{
-		m_type = e_staticParticle;
-		m_mass = 1.0f;
-		m_invMass = 1.0f;
+		cloth->m_types[i] = e_staticParticle;
+		cloth->m_masses[i] = 1.0f;
+		cloth->m_invMasses[i] = 1.0f;
 	}
 	else
 	{
-		m_type = e_dynamicParticle;
-		m_invMass = 1.0f / m_mass;
+		cloth->m_types[i] = e_dynamicParticle;
+		cloth->m_masses[i] = mass;
+		cloth->m_invMasses[i] = 1.0f / mass;
 	}
 
+	cloth->m_positions[i] = def.position;
+	cloth->m_velocities[i] = def.velocity;
+	cloth->m_externalForces[i] = def.force;
+	cloth->m_translations[i].SetZero();
+	cloth->m_solutions[i].SetZero();
+
 	m_radius = def.radius;
 	m_friction = def.friction;
 	m_userData = nullptr;
-	m_x.SetZero();
 	m_vertex = ~0;
 }
 
@@ -58,7 +63,7 @@ b3Particle::~b3Particle()
 void b3Particle::Synchronize(const b3Vec3& displacement)
 {
 	b3AABB3 aabb;
-	aabb.Set(m_position, m_radius);
+	aabb.Set(m_cloth->m_positions[m_solverId], m_radius);
 
 	m_cloth->m_contactManager.m_broadPhase.MoveProxy(m_broadPhaseId, aabb, displacement);
 }
@@ -85,53 +90,44 @@ void b3Particle::DestroyContacts()
 {
 	{
 		// Destroy body contacts
-		b3ParticleBodyContact* c = m_cloth->m_contactManager.m_particleBodyContactList.m_head;
-		while (c)
+		b3ParticleBodyContactEdge* ce = m_bodyContactEdges.m_head;
+		while (ce)
 		{
-			if (c->m_p1 == this)
-			{
-				b3ParticleBodyContact* quack = c;
-				c = c->m_next;
-				m_cloth->m_contactManager.Destroy(quack);
-				continue;
-			}
-
-			c = c->m_next;
+			b3ParticleBodyContactEdge* quack = ce;
+			ce = ce->m_next;
+			m_cloth->m_contactManager.Destroy(quack->contact);
 		}
 	}
 
 	{
 		// Destroy triangle contacts
-		b3ParticleTriangleContact* c = m_cloth->m_contactManager.m_particleTriangleContactList.m_head;
-		while (c)
+		b3ParticleTriangleContactEdge* ce = m_triangleContactEdges.m_head;
+		while (ce)
 		{
-			if (c->m_p1 == this)
-			{
-				b3ParticleTriangleContact* quack = c;
-				c = c->m_next;
-				m_cloth->m_contactManager.Destroy(quack);
-				continue;
-			}
-
-			c = c->m_next;
+			b3ParticleTriangleContactEdge* quack = ce;
+			ce = ce->m_next;
+			m_cloth->m_contactManager.Destroy(quack->contact);
 		}
 	}
 }
 
 void b3Particle::SetType(b3ParticleType type)
 {
-	if (m_type == type)
+	u32 i = m_solverId;
+
+	if (m_cloth->m_types[i] == type)
 	{
 		return;
 	}
 
-	m_type = type;
-	m_force.SetZero();
+	m_cloth->m_types[i] = type;
+	m_cloth->m_externalForces[i].SetZero();
+	m_cloth->WakeParticle(i);
 
 	if (type == e_staticParticle)
 	{
-		m_velocity.SetZero();
-		m_translation.SetZero();
+		m_cloth->m_velocities[i].SetZero();
+		m_cloth->m_translations[i].SetZero();
 
 		Synchronize(b3Vec3_zero);
 		SynchronizeTriangles();
@@ -141,4 +137,14 @@ void b3Particle::SetType(b3ParticleType type)
 
 	// Move the proxy so new contacts can be created.
 	m_cloth->m_contactManager.m_broadPhase.TouchProxy(m_broadPhaseId);
-}
\ No newline at end of file
+}
+
+bool b3Particle::IsAwake() const
+{
+	return m_cloth->IsParticleAwake(m_solverId);
+}
+
+void b3Particle::SetAwake()
+{
+	m_cloth->WakeParticle(m_solverId);
+}
@@ -31,6 +31,10 @@ b3BroadPhase::b3BroadPhase()
 	m_pairs = (b3Pair*)b3Alloc(m_pairCapacity * sizeof(b3Pair));
 	memset(m_pairs, 0, m_pairCapacity * sizeof(b3Pair));
 	m_pairCount = 0;
+
+	m_refitEnabled = false;
+	m_treeDirty = false;
+	m_rebuildAreaRatio = 0.0f;
 }
 
 b3BroadPhase::~b3BroadPhase() 
@@ -86,6 +90,11 @@ u32 b3BroadPhase::CreateProxy(const b3AABB3& aabb, void* userData)
 	
 	BufferMove(proxyId);
 
+	if (m_refitEnabled)
+	{
+		m_treeDirty = true;
+	}
+
 	return proxyId;
 }
 
@@ -94,6 +103,11 @@ void b3BroadPhase::DestroyProxy(u32 proxyId)
 	UnbufferMove(proxyId);
 	--m_proxyCount;
 	m_tree.RemoveNode(proxyId);
+
+	if (m_refitEnabled)
+	{
+		m_treeDirty = true;
+	}
 }
 
 bool b3BroadPhase::MoveProxy(u32 proxyId, const b3AABB3& aabb, const b3Vec3& displacement)
@@ -139,7 +153,15 @@ bool b3BroadPhase::MoveProxy(u32 proxyId, const b3AABB3& aabb, const b3Vec3& dis
 	}
 
 	// Update proxy with the extented AABB.
-	m_tree.UpdateNode(proxyId, fatAABB);
+	if (m_refitEnabled)
+	{
+		m_tree.RefitNode(proxyId, fatAABB);
+		m_treeDirty = true;
+	}
+	else
+	{
+		m_tree.UpdateNode(proxyId, fatAABB);
+	}
 	
 	// Buffer the moved proxy.
 	BufferMove(proxyId);
@@ -153,6 +175,33 @@ void b3BroadPhase::TouchProxy(u32 proxyId)
 	BufferMove(proxyId);
 }
 
+void b3BroadPhase::SetRefitEnabled(bool flag)
+{
+	m_refitEnabled = flag;
+	m_treeDirty = flag;
+	m_rebuildAreaRatio = 0.0f;
+}
+
+void b3BroadPhase::UpdateTree()
+{
+	if (m_treeDirty == false)
+	{
+		return;
+	}
+
+	m_treeDirty = false;
+
+	m_tree.Refit();
+
+	float32 areaRatio = m_tree.GetAreaRatio();
+	if (m_rebuildAreaRatio == 0.0f || areaRatio > B3_AABB_REBUILD_RATIO * m_rebuildAreaRatio)
+	{
+		// The tree quality has degraded.
+		m_tree.Rebuild();
+		m_rebuildAreaRatio = m_tree.GetAreaRatio();
+	}
+}
+
 bool b3BroadPhase::Report(u32 proxyId) 
 {
 	if (proxyId == m_queryProxyId) 
@@ -0,0 +1,203 @@
+/*
+* Copyright (c) 2016-2019 Irlan Robson https://irlanrobson.github.io
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include <bounce/collision/shapes/height_field.h>
+
+void b3HeightField::ComputeBounds()
+{
+	B3_ASSERT(rowCount > 0 && columnCount > 0);
+
+	minHeight = heights[0];
+	maxHeight = heights[0];
+
+	u32 vertexCount = GetVertexCount();
+	for (u32 i = 1; i < vertexCount; ++i)
+	{
+		minHeight = b3Min(minHeight, heights[i]);
+		maxHeight = b3Max(maxHeight, heights[i]);
+	}
+}
+
+bool b3HeightField::RayCastCell(b3RayCastOutput* output, u32* triangleIndex, b3RayCastInput* input, u32 i, u32 j) const
+{
+	u32 cell = i * columnCount + j;
+
+	bool hit = false;
+	for (u32 k = 0; k < 2; ++k)
+	{
+		u32 index = 2 * cell + k;
+
+		b3Vec3 v1, v2, v3;
+		GetTriangle(index, v1, v2, v3);
+
+		b3RayCastOutput subOutput;
+		if (b3RayCast(&subOutput, input, v1, v2, v3))
+		{
+			// Keep the closest intersection.
+			hit = true;
+			input->maxFraction = subOutput.fraction;
+			*output = subOutput;
+			*triangleIndex = index;
+		}
+	}
+
+	return hit;
+}
+
+bool b3HeightField::RayCast(b3RayCastOutput* output, u32* triangleIndex, const b3RayCastInput& input) const
+{
+	b3Vec3 p1 = input.p1;
+	b3Vec3 p2 = input.p2;
+	float32 maxFraction = input.maxFraction;
+
+	// Put the segment into grid coordinates.
+	float32 x0 = -0.5f * float32(columnCount) * cellWidth;
+	float32 z0 = -0.5f * float32(rowCount) * cellDepth;
+
+	float32 u1 = (p1.x - x0) / cellWidth;
+	float32 v1 = (p1.z - z0) / cellDepth;
+	float32 du = (p2.x - p1.x) / cellWidth;
+	float32 dv = (p2.z - p1.z) / cellDepth;
+	float32 dy = p2.y - p1.y;
+
+	// Clip the segment against the grid bounds.
+	float32 lower = 0.0f;
+	float32 upper = maxFraction;
+
+	float32 origins[3] = { u1, p1.y, v1 };
+	float32 directions[3] = { du, dy, dv };
+	float32 mins[3] = { 0.0f, minHeight, 0.0f };
+	float32 maxs[3] = { float32(columnCount), maxHeight, float32(rowCount) };
+
+	for (u32 i = 0; i < 3; ++i)
+	{
+		if (directions[i] == 0.0f)
+		{
+			if (origins[i] < mins[i] || origins[i] > maxs[i])
+			{
+				return false;
+			}
+		}
+		else
+		{
+			float32 inv = 1.0f / directions[i];
+			float32 t1 = (mins[i] - origins[i]) * inv;
+			float32 t2 = (maxs[i] - origins[i]) * inv;
+			if (t1 > t2)
+			{
+				b3Swap(t1, t2);
+			}
+
+			lower = b3Max(lower, t1);
+			upper = b3Min(upper, t2);
+
+			if (lower > upper)
+			{
+				return false;
+			}
+		}
+	}
+
+	// Find the first cell.
+	float32 u = u1 + lower * du;
+	float32 v = v1 + lower * dv;
+
+	i32 j = b3Clamp(i32(u), 0, i32(columnCount) - 1);
+	i32 i = b3Clamp(i32(v), 0, i32(rowCount) - 1);
+
+	// Setup the 2D DDA.
+	i32 stepJ = du > 0.0f ? 1 : -1;
+	i32 stepI = dv > 0.0f ? 1 : -1;
+
+	float32 nextJ = du != 0.0f ? (float32(j + (du > 0.0f ? 1 : 0)) - u1) / du : B3_MAX_FLOAT;
+	float32 nextI = dv != 0.0f ? (float32(i + (dv > 0.0f ? 1 : 0)) - v1) / dv : B3_MAX_FLOAT;
+
+	float32 deltaJ = du != 0.0f ? b3Abs(1.0f / du) : B3_MAX_FLOAT;
+	float32 deltaI = dv != 0.0f ? b3Abs(1.0f / dv) : B3_MAX_FLOAT;
+
+	b3RayCastInput subInput;
+	subInput.p1 = p1;
+	subInput.p2 = p2;
+	subInput.maxFraction = maxFraction;
+
+	// A segment parallel to a grid line and lying on it touches the cells on both sides.
+	bool onLineJ = du == 0.0f && j > 0 && float32(j) == u;
+	bool onLineI = dv == 0.0f && i > 0 && float32(i) == v;
+
+	for (;;)
+	{
+		// Cells are visited in order along the ray.
+		// Therefore the first cell containing an intersection
+		// contains the closest intersection.
+		bool hit = RayCastCell(output, triangleIndex, &subInput, u32(i), u32(j));
+
+		if (onLineJ)
+		{
+			hit = RayCastCell(output, triangleIndex, &subInput, u32(i), u32(j - 1)) || hit;
+		}
+
+		if (onLineI)
+		{
+			hit = RayCastCell(output, triangleIndex, &subInput, u32(i - 1), u32(j)) || hit;
+		}
+
+		if (onLineJ && onLineI)
+		{
+			hit = RayCastCell(output, triangleIndex, &subInput, u32(i - 1), u32(j - 1)) || hit;
+		}
+
+		if (hit)
+		{
+			return true;
+		}
+
+		// Step to the next cell.
+		if (nextJ < nextI)
+		{
+			if (nextJ > upper)
+			{
+				break;
+			}
+
+			j += stepJ;
+			if (j < 0 || j >= i32(columnCount))
+			{
+				break;
+			}
+
+			nextJ += deltaJ;
+		}
+		else
+		{
+			if (nextI > upper)
+			{
+				break;
+			}
+
+			i += stepI;
+			if (i < 0 || i >= i32(rowCount))
+			{
+				break;
+			}
+
+			nextI += deltaI;
+		}
+	}
+
+	return false;
+}
@@ -56,7 +56,7 @@ void b3Hull::Validate(const b3Face* face) const
 
 void b3Hull::Validate(const b3HalfEdge* e) const 
 {
-	u8 edgeIndex = (u8)(e - edges);
+	u32 edgeIndex = u32(e - edges);
 	
 	const b3HalfEdge* twin = edges + e->twin;
 
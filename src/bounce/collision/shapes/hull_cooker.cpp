@@ -0,0 +1,262 @@
+/*
+* Copyright (c) 2016-2019 Irlan Robson https://irlanrobson.github.io
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+#include <bounce/collision/shapes/hull_cooker.h>
+#include <bounce/collision/shapes/qhull.h>
+#include <bounce/common/memory/frame_allocator.h>
+
+// Round up a given size to a multiple of 16 bytes.
+static B3_FORCE_INLINE u32 b3AlignPack(u32 size)
+{
+	return (size + 15) & ~15;
+}
+
+b3Hull* b3ReadHullPack(void* buffer, u32 size, u32* hullCount)
+{
+	if (size < sizeof(b3HullPackHeader))
+	{
+		return nullptr;
+	}
+
+	// Ensure proper alignment.
+	if (((size_t)buffer & 15) != 0)
+	{
+		return nullptr;
+	}
+
+	u8* base = (u8*)buffer;
+	const b3HullPackHeader* header = (b3HullPackHeader*)base;
+
+	if (header->magic != B3_HULL_PACK_MAGIC || header->version != B3_HULL_PACK_VERSION)
+	{
+		return nullptr;
+	}
+
+	if (header->pointerSize != sizeof(void*) || header->size > size)
+	{
+		return nullptr;
+	}
+
+	u64 recordEnd = u64(header->recordOffset) + u64(header->hullCount) * sizeof(b3HullPackRecord);
+	u64 hullEnd = u64(header->hullOffset) + u64(header->hullCount) * sizeof(b3Hull);
+	if (recordEnd > header->size || hullEnd > header->size)
+	{
+		return nullptr;
+	}
+
+	const b3HullPackRecord* records = (b3HullPackRecord*)(base + header->recordOffset);
+	b3Hull* hulls = (b3Hull*)(base + header->hullOffset);
+
+	for (u32 i = 0; i < header->hullCount; ++i)
+	{
+		const b3HullPackRecord* record = records + i;
+		
+		// Ensure every section is inside the buffer. 
+		// The data inside the sections is trusted.
+		u64 vertexEnd = u64(record->vertexOffset) + u64(record->vertexCount) * sizeof(b3Vec3);
+		u64 edgeEnd = u64(record->edgeOffset) + u64(record->edgeCount) * sizeof(b3HalfEdge);
+		u64 faceEnd = u64(record->faceOffset) + u64(record->faceCount) * sizeof(b3Face);
+		u64 planeEnd = u64(record->planeOffset) + u64(record->faceCount) * sizeof(b3Plane);
+		if (vertexEnd > header->size || edgeEnd > header->size || faceEnd > header->size || planeEnd > header->size)
+		{
+			return nullptr;
+		}
+
+		// The records are kept intact. 
+		// Therefore a pack can be read more than once.
+		b3Hull* hull = hulls + i;
+		hull->centroid = record->centroid;
+		hull->vertexCount = record->vertexCount;
+		hull->vertices = (b3Vec3*)(base + record->vertexOffset);
+		hull->edgeCount = record->edgeCount;
+		hull->edges = (b3HalfEdge*)(base + record->edgeOffset);
+		hull->faceCount = record->faceCount;
+		hull->faces = (b3Face*)(base + record->faceOffset);
+		hull->planes = (b3Plane*)(base + record->planeOffset);
+	}
+
+	*hullCount = header->hullCount;
+	return hulls;
+}
+
+// Builds one hull per task.
+struct b3HullCookTask
+{
+	void Execute(u32 index, u32 threadIndex)
+	{
+		const b3HullCookDef& def = defs[index];
+		b3FrameAllocator* scratchAllocator = scratchAllocators + threadIndex;
+		b3FrameAllocator* hullAllocator = hullAllocators + threadIndex;
+
+		b3Hull* out = hulls + index;
+
+		b3Hull hull;
+		if (def.vertexCount >= 4 && b3CreateHull(&hull, scratchAllocator, def.vertexStride, def.vertexBase, def.vertexCount, def.simplify))
+		{
+			// Move the hull out of the scratch memory.
+			out->centroid = hull.centroid;
+			
+			out->vertexCount = hull.vertexCount;
+			out->vertices = (b3Vec3*)hullAllocator->Allocate(hull.vertexCount * sizeof(b3Vec3));
+			memcpy(out->vertices, hull.vertices, hull.vertexCount * sizeof(b3Vec3));
+
+			out->edgeCount = hull.edgeCount;
+			out->edges = (b3HalfEdge*)hullAllocator->Allocate(hull.edgeCount * sizeof(b3HalfEdge));
+			memcpy(out->edges, hull.edges, hull.edgeCount * sizeof(b3HalfEdge));
+
+			out->faceCount = hull.faceCount;
+			out->faces = (b3Face*)hullAllocator->Allocate(hull.faceCount * sizeof(b3Face));
+			memcpy(out->faces, hull.faces, hull.faceCount * sizeof(b3Face));
+
+			out->planes = (b3Plane*)hullAllocator->Allocate(hull.faceCount * sizeof(b3Plane));
+			memcpy(out->planes, hull.planes, hull.faceCount * sizeof(b3Plane));
+		}
+		else
+		{
+			out->centroid.SetZero();
+			out->vertexCount = 0;
+			out->vertices = nullptr;
+			out->edgeCount = 0;
+			out->edges = nullptr;
+			out->faceCount = 0;
+			out->faces = nullptr;
+			out->planes = nullptr;
+		}
+
+		scratchAllocator->Reset();
+	}
+
+	const b3HullCookDef* defs;
+	b3Hull* hulls;
+	b3FrameAllocator* scratchAllocators;
+	b3FrameAllocator* hullAllocators;
+};
+
+b3HullCooker::b3HullCooker(u32 threadCount) : m_threadPool(threadCount)
+{
+	u32 count = m_threadPool.GetThreadCount();
+
+	m_scratchAllocators = (b3FrameAllocator*)b3Alloc(count * sizeof(b3FrameAllocator));
+	m_hullAllocators = (b3FrameAllocator*)b3Alloc(count * sizeof(b3FrameAllocator));
+	for (u32 i = 0; i < count; ++i)
+	{
+		new (m_scratchAllocators + i) b3FrameAllocator();
+		new (m_hullAllocators + i) b3FrameAllocator();
+	}
+}
+
+b3HullCooker::~b3HullCooker()
+{
+	u32 count = m_threadPool.GetThreadCount();
+	for (u32 i = 0; i < count; ++i)
+	{
+		m_scratchAllocators[i].~b3FrameAllocator();
+		m_hullAllocators[i].~b3FrameAllocator();
+	}
+	b3Free(m_scratchAllocators);
+	b3Free(m_hullAllocators);
+}
+
+void* b3HullCooker::Cook(u32* packSize, const b3HullCookDef* defs, u32 count)
+{
+	b3Hull* hulls = (b3Hull*)b3Alloc(count * sizeof(b3Hull));
+
+	b3HullCookTask task;
+	task.defs = defs;
+	task.hulls = hulls;
+	task.scratchAllocators = m_scratchAllocators;
+	task.hullAllocators = m_hullAllocators;
+
+	m_threadPool.Run(&task, count);
+
+	// Compute the pack size.
+	u32 size = 0;
+	size += b3AlignPack(sizeof(b3HullPackHeader));
+	size += b3AlignPack(count * sizeof(b3HullPackRecord));
+	size += b3AlignPack(count * sizeof(b3Hull));
+	for (u32 i = 0; i < count; ++i)
+	{
+		const b3Hull* hull = hulls + i;
+		size += b3AlignPack(hull->vertexCount * sizeof(b3Vec3));
+		size += b3AlignPack(hull->edgeCount * sizeof(b3HalfEdge));
+		size += b3AlignPack(hull->faceCount * sizeof(b3Face));
+		size += b3AlignPack(hull->faceCount * sizeof(b3Plane));
+	}
+
+	// Write the pack.
+	u8* base = (u8*)b3Alloc(size);
+
+	b3HullPackHeader* header = (b3HullPackHeader*)base;
+	header->magic = B3_HULL_PACK_MAGIC;
+	header->version = B3_HULL_PACK_VERSION;
+	header->size = size;
+	header->pointerSize = sizeof(void*);
+	header->hullCount = count;
+
+	u32 offset = b3AlignPack(sizeof(b3HullPackHeader));
+	
+	header->recordOffset = offset;
+	b3HullPackRecord* records = (b3HullPackRecord*)(base + offset);
+	offset += b3AlignPack(count * sizeof(b3HullPackRecord));
+	
+	// The hulls are set when the pack is read.
+	header->hullOffset = offset;
+	memset(base + offset, 0, count * sizeof(b3Hull));
+	offset += b3AlignPack(count * sizeof(b3Hull));
+
+	for (u32 i = 0; i < count; ++i)
+	{
+		const b3Hull* hull = hulls + i;
+		b3HullPackRecord* record = records + i;
+
+		record->centroid = hull->centroid;
+
+		record->vertexCount = hull->vertexCount;
+		record->vertexOffset = offset;
+		memcpy(base + offset, hull->vertices, hull->vertexCount * sizeof(b3Vec3));
+		offset += b3AlignPack(hull->vertexCount * sizeof(b3Vec3));
+
+		record->edgeCount = hull->edgeCount;
+		record->edgeOffset = offset;
+		memcpy(base + offset, hull->edges, hull->edgeCount * sizeof(b3HalfEdge));
+		offset += b3AlignPack(hull->edgeCount * sizeof(b3HalfEdge));
+
+		record->faceCount = hull->faceCount;
+		record->faceOffset = offset;
+		memcpy(base + offset, hull->faces, hull->faceCount * sizeof(b3Face));
+		offset += b3AlignPack(hull->faceCount * sizeof(b3Face));
+
+		record->planeOffset = offset;
+		memcpy(base + offset, hull->planes, hull->faceCount * sizeof(b3Plane));
+		offset += b3AlignPack(hull->faceCount * sizeof(b3Plane));
+	}
+
+	B3_ASSERT(offset == size);
+
+	b3Free(hulls);
+
+	u32 threadCount = m_threadPool.GetThreadCount();
+	for (u32 i = 0; i < threadCount; ++i)
+	{
+		m_hullAllocators[i].Reset();
+	}
+
+	*packSize = size;
+	return base;
+}
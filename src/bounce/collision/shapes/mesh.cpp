@@ -0,0 +1,125 @@
+/*
+* Copyright (c) 2016-2019 Irlan Robson https://irlanrobson.github.io
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include <bounce/collision/shapes/mesh.h>
+
+// Round up a given size to a multiple of 16 bytes.
+static B3_FORCE_INLINE u32 b3AlignBinary(u32 size)
+{
+	return (size + 15) & ~15;
+}
+
+u32 b3Mesh::GetBinarySize() const
+{
+	u32 size = 0;
+	size += b3AlignBinary(sizeof(b3MeshBinaryHeader));
+	size += b3AlignBinary(vertexCount * sizeof(b3Vec3));
+	size += b3AlignBinary(triangleCount * sizeof(b3Triangle));
+	size += b3AlignBinary(tree.GetNodeDataSize());
+	return size;
+}
+
+void b3Mesh::WriteBinary(void* buffer) const
+{
+	B3_ASSERT(tree.GetNodeCount() > 0);
+
+	u8* base = (u8*)buffer;
+	
+	b3MeshBinaryHeader* header = (b3MeshBinaryHeader*)base;
+	header->magic = B3_MESH_BINARY_MAGIC;
+	header->version = B3_MESH_BINARY_VERSION;
+	header->size = GetBinarySize();
+	
+	u32 offset = b3AlignBinary(sizeof(b3MeshBinaryHeader));
+
+	header->vertexCount = vertexCount;
+	header->vertexOffset = offset;
+	memcpy(base + offset, vertices, vertexCount * sizeof(b3Vec3));
+	offset += b3AlignBinary(vertexCount * sizeof(b3Vec3));
+
+	header->triangleCount = triangleCount;
+	header->triangleOffset = offset;
+	memcpy(base + offset, triangles, triangleCount * sizeof(b3Triangle));
+	offset += b3AlignBinary(triangleCount * sizeof(b3Triangle));
+
+	header->nodeCount = tree.GetNodeCount();
+	header->nodeOffset = offset;
+	tree.WriteNodes(base + offset);
+	offset += b3AlignBinary(tree.GetNodeDataSize());
+
+	B3_ASSERT(offset == header->size);
+}
+
+bool b3Mesh::ReadBinary(const void* buffer, u32 size)
+{
+	if (size < sizeof(b3MeshBinaryHeader))
+	{
+		return false;
+	}
+
+	// Ensure proper alignment.
+	if (((size_t)buffer & 15) != 0)
+	{
+		return false;
+	}
+
+	const u8* base = (const u8*)buffer;
+	const b3MeshBinaryHeader* header = (const b3MeshBinaryHeader*)base;
+
+	if (header->magic != B3_MESH_BINARY_MAGIC || header->version != B3_MESH_BINARY_VERSION)
+	{
+		return false;
+	}
+
+	if (header->size > size)
+	{
+		return false;
+	}
+
+	// A tree built from n triangles has 2 * n - 1 nodes.
+	if (header->triangleCount == 0 || header->nodeCount != 2 * header->triangleCount - 1)
+	{
+		return false;
+	}
+
+	// Ensure every section is aligned.
+	if ((header->vertexOffset & 15) != 0 || (header->triangleOffset & 15) != 0 || (header->nodeOffset & 15) != 0)
+	{
+		return false;
+	}
+
+	// Ensure every section is inside the buffer. 
+	// The data inside the sections is trusted.
+	u64 vertexEnd = u64(header->vertexOffset) + u64(header->vertexCount) * sizeof(b3Vec3);
+	u64 triangleEnd = u64(header->triangleOffset) + u64(header->triangleCount) * sizeof(b3Triangle);
+	u64 nodeEnd = u64(header->nodeOffset) + u64(header->nodeCount) * b3StaticTree::GetNodeDataSize(1);
+	if (vertexEnd > header->size || triangleEnd > header->size || nodeEnd > header->size)
+	{
+		return false;
+	}
+
+	vertexCount = header->vertexCount;
+	vertices = (b3Vec3*)(base + header->vertexOffset);
+	
+	triangleCount = header->triangleCount;
+	triangles = (b3Triangle*)(base + header->triangleOffset);
+
+	tree.SetNodes(base + header->nodeOffset, header->nodeCount);
+
+	return true;
+}
@@ -18,32 +18,185 @@
 
 #include <bounce/collision/shapes/qhull.h>
 #include <bounce/quickhull/qh_hull.h>
+#include <bounce/common/template/hash_map.h>
+#include <bounce/common/memory/frame_allocator.h>
 
 #include <bounce/meshgen/sphere_mesh.h>
 #include <bounce/meshgen/cylinder_mesh.h>
 
-template <class T>
-struct b3UniqueStackArray
+static void* b3AllocScratch(b3FrameAllocator* allocator, u32 size)
 {
-	u32 PushBack(const T& e)
+	if (allocator)
 	{
-		for (u32 i = 0; i < elements.Count(); ++i)
+		return allocator->Allocate(size);
+	}
+	return b3Alloc(size);
+}
+
+static void b3FreeScratch(b3FrameAllocator* allocator, void* p)
+{
+	if (allocator == NULL)
+	{
+		b3Free(p);
+	}
+}
+
+// A cell of a uniform grid.
+struct b3GridCell
+{
+	i32 x, y, z;
+};
+
+// A uniform grid of indexed points hashed into buckets.
+// Each bucket points to a singly-linked list of point indices.
+// Two points closer than the cell size are in the same or in adjacent cells.
+struct b3PointGrid
+{
+	b3PointGrid(const b3Vec3* _points, u32 capacity, float32 cellSize, b3FrameAllocator* _allocator)
+	{
+		points = _points;
+		inverseCellSize = 1.0f / cellSize;
+		allocator = _allocator;
+
+		bucketCount = 16;
+		while (bucketCount < capacity)
+		{
+			bucketCount *= 2;
+		}
+
+		buckets = (u32*)b3AllocScratch(allocator, (bucketCount + capacity) * sizeof(u32));
+		next = buckets + bucketCount;
+		memset(buckets, 0xFF, bucketCount * sizeof(u32));
+	}
+
+	~b3PointGrid()
+	{
+		b3FreeScratch(allocator, buckets);
+	}
+
+	b3GridCell GetCell(const b3Vec3& p) const
+	{
+		b3GridCell cell;
+		cell.x = i32(floor(p.x * inverseCellSize));
+		cell.y = i32(floor(p.y * inverseCellSize));
+		cell.z = i32(floor(p.z * inverseCellSize));
+		return cell;
+	}
+
+	u32 GetBucket(const b3GridCell& cell) const
+	{
+		u32 hash = b3Hash(u32(cell.x) * 73856093 ^ u32(cell.y) * 19349663 ^ u32(cell.z) * 83492791);
+		return hash & (bucketCount - 1);
+	}
+
+	void Add(u32 index)
+	{
+		u32 bucket = GetBucket(GetCell(points[index]));
+		next[index] = buckets[bucket];
+		buckets[bucket] = index;
+	}
+
+	void Remove(u32 index)
+	{
+		u32* link = buckets + GetBucket(GetCell(points[index]));
+		while (*link != index)
 		{
-			if (elements[i] == e)
+			B3_ASSERT(*link != B3_MAX_U32);
+			link = next + *link;
+		}
+		*link = next[index];
+	}
+
+	// Return the smallest index of the points in the cells adjacent to 
+	// a given point for which the predicate returns true.
+	// Return B3_MAX_U32 if there is no such point.
+	template<class T>
+	u32 Find(const b3Vec3& p, const T& predicate) const
+	{
+		b3GridCell center = GetCell(p);
+
+		u32 result = B3_MAX_U32;
+
+		b3GridCell cell;
+		for (cell.x = center.x - 1; cell.x <= center.x + 1; ++cell.x)
+		{
+			for (cell.y = center.y - 1; cell.y <= center.y + 1; ++cell.y)
 			{
-				return i;
+				for (cell.z = center.z - 1; cell.z <= center.z + 1; ++cell.z)
+				{
+					// Buckets may be shared by other cells. 
+					// The predicate rejects the points that are too far.
+					for (u32 i = buckets[GetBucket(cell)]; i != B3_MAX_U32; i = next[i])
+					{
+						if (i < result && predicate(points[i]))
+						{
+							result = i;
+						}
+					}
+				}
 			}
 		}
+		
+		return result;
+	}
+
+	const b3Vec3* points;
+	float32 inverseCellSize;
+	b3FrameAllocator* allocator;
+	u32 bucketCount;
+	u32* buckets;
+	u32* next;
+};
 
-		elements.PushBack(e);
-		return elements.Count() - 1;
+struct b3WeldPredicate
+{
+	bool operator()(const b3Vec3& q) const
+	{
+		return b3DistanceSquared(p, q) <= B3_LINEAR_SLOP * B3_LINEAR_SLOP;
 	}
 
-	b3StackArray<T, 256> elements;
+	b3Vec3 p;
+};
+
+// Weld the points in place. 
+// A point is kept only if it is not close to any previously kept point.
+// Return the number of kept points.
+static u32 b3WeldPoints(b3Vec3* points, u32 count, b3FrameAllocator* allocator)
+{
+	b3PointGrid grid(points, count, B3_LINEAR_SLOP, allocator);
+
+	u32 keptCount = 0;
+	for (u32 i = 0; i < count; ++i)
+	{
+		b3WeldPredicate predicate;
+		predicate.p = points[i];
+
+		if (grid.Find(predicate.p, predicate) == B3_MAX_U32)
+		{
+			points[keptCount] = predicate.p;
+			grid.Add(keptCount);
+			++keptCount;
+		}
+	}
+
+	return keptCount;
+}
+
+struct b3NormalPredicate
+{
+	bool operator()(const b3Vec3& q) const
+	{
+		// ~45 degrees
+		const float32 kTol = 0.7f;
+
+		return b3Dot(n, q) > kTol;
+	}
+
+	b3Vec3 n;
 };
 
 //
-static b3Vec3 b3ComputeCentroid(b3QHull* hull)
+static b3Vec3 b3ComputeCentroid(const b3Hull* hull)
 {
 	// M. Kallay - "Computing the Moment of Inertia of a Solid Defined by a Triangle Mesh"
 	
@@ -101,14 +254,18 @@ static b3Vec3 b3ComputeCentroid(b3QHull* hull)
 	return centroid;
 }
 
-void b3QHull::Set(u32 vtxStride, const void* vtxBase, u32 vtxCount, bool simplify)
+// Create a convex hull from vertex data.
+// The features are stored in a single block of memory. 
+// The block and the temporary memory are allocated from the given allocator 
+// or using b3Alloc if the allocator is NULL.
+// Return the block or NULL if the creation has failed.
+static void* b3CreateHullFromPoints(b3Hull* out, u32 vtxStride, const void* vtxBase, u32 vtxCount, bool simplify, b3FrameAllocator* allocator)
 {
 	B3_ASSERT(vtxStride >= sizeof(b3Vec3));
 	B3_ASSERT(vtxCount >= 4);
 
 	// Copy vertices into local buffer, perform welding.
-	u32 vs0Count = 0;
-	b3Vec3* vs0 = (b3Vec3*)b3Alloc(vtxCount * sizeof(b3Vec3));
+	b3Vec3* vs0 = (b3Vec3*)b3AllocScratch(allocator, vtxCount * sizeof(b3Vec3));
 	for (u32 i = 0; i < vtxCount; ++i)
 	{
 		b3Vec3 v = *(b3Vec3*)((u8*)vtxBase + vtxStride * i);
@@ -117,38 +274,26 @@ void b3QHull::Set(u32 vtxStride, const void* vtxBase, u32 vtxCount, bool simplif
 		B3_ASSERT(b3IsValid(v.y));
 		B3_ASSERT(b3IsValid(v.z));
 
-		bool unique = true;
-
-		for (u32 j = 0; j < vs0Count; ++j)
-		{
-			if (b3DistanceSquared(v, vs0[j]) <= B3_LINEAR_SLOP * B3_LINEAR_SLOP)
-			{
-				unique = false;
-				break;
-			}
-		}
-
-		if (unique)
-		{
-			vs0[vs0Count++] = v;
-		}
+		vs0[i] = v;
 	}
 
+	u32 vs0Count = b3WeldPoints(vs0, vtxCount, allocator);
+
 	if (vs0Count < 4)
 	{
 		// Polyhedron is degenerate.
-		b3Free(vs0);
-		return;
+		b3FreeScratch(allocator, vs0);
+		return NULL;
 	}
 
 	// Create a convex hull.
-	qhHull hull;
+	qhHull hull(allocator);
 
 	if (simplify == true)
 	{
-		qhHull primary;
+		qhHull primary(allocator);
 		primary.Construct(vs0, vs0Count);
-		b3Free(vs0);
+		b3FreeScratch(allocator, vs0);
 
 		// Simplify the constructed hull.
 
@@ -163,96 +308,88 @@ void b3QHull::Set(u32 vtxStride, const void* vtxBase, u32 vtxCount, bool simplif
 
 		primary.Translate(-s);
 
-		// Build the dual hull 
+		// Build the dual hull.
+		// Faces with similar normals are merged into the face with the largest area.
+		// The normals are binned into a grid. Two unit normals within ~45 degrees 
+		// are closer than 0.8 and therefore are in the same or in adjacent cells.
+		u32 faceCount = primary.GetFaceList().count;
+
 		u32 dvCount = 0;
-		qhFace** dfs = (qhFace**)b3Alloc(primary.GetFaceList().count * sizeof(qhFace*));
-		b3Vec3* dvs = (b3Vec3*)b3Alloc(primary.GetFaceList().count * sizeof(b3Vec3));
+		qhFace** dfs = (qhFace**)b3AllocScratch(allocator, faceCount * sizeof(qhFace*));
+		b3Vec3* dvs = (b3Vec3*)b3AllocScratch(allocator, faceCount * sizeof(b3Vec3));
+		b3Vec3* dns = (b3Vec3*)b3AllocScratch(allocator, faceCount * sizeof(b3Vec3));
 
-		for (qhFace* f = primary.GetFaceList().head; f; f = f->next)
 		{
-			b3Plane plane = f->plane;
-			B3_ASSERT(plane.offset > 0.0f);
-			b3Vec3 v = plane.normal / plane.offset;
-			b3Vec3 vn = plane.normal;
+			b3PointGrid grid(dns, faceCount, 0.8f, allocator);
 
-			bool unique = true;
-
-			for (u32 j = 0; j < dvCount; ++j)
+			for (qhFace* f = primary.GetFaceList().head; f; f = f->next)
 			{
-				qhFace*& df = dfs[j];
-				b3Vec3& dv = dvs[j];
-				b3Vec3 dvn = b3Normalize(dv);
+				b3Plane plane = f->plane;
+				B3_ASSERT(plane.offset > 0.0f);
+				b3Vec3 v = plane.normal / plane.offset;
+
+				b3NormalPredicate predicate;
+				predicate.n = plane.normal;
 
-				// ~45 degrees
-				const float32 kTol = 0.7f;
+				u32 j = grid.Find(predicate.n, predicate);
 
-				if (b3Dot(vn, dvn) > kTol)
+				if (j != B3_MAX_U32)
 				{
-					if (f->area > df->area)
+					if (f->area > dfs[j]->area)
 					{
-						df = f;
-						dv = v;
-					}
+						grid.Remove(j);
 
-					unique = false;
-					break;
-				}
-			}
+						dfs[j] = f;
+						dvs[j] = v;
+						dns[j] = b3Normalize(v);
 
-			if (unique)
-			{
-				dfs[dvCount] = f;
-				dvs[dvCount] = v;
-				++dvCount;
+						grid.Add(j);
+					}
+				}
+				else
+				{
+					dfs[dvCount] = f;
+					dvs[dvCount] = v;
+					dns[dvCount] = b3Normalize(v);
+					grid.Add(dvCount);
+					++dvCount;
+				}
 			}
 		}
 
-		b3Free(dfs);
+		b3FreeScratch(allocator, dns);
+		b3FreeScratch(allocator, dfs);
 
 		if (dvCount < 4)
 		{
-			b3Free(dvs);
-			return;
+			b3FreeScratch(allocator, dvs);
+			return NULL;
 		}
 
-		qhHull dual;
+		qhHull dual(allocator);
 		dual.Construct(dvs, dvCount);
-		b3Free(dvs);
+		b3FreeScratch(allocator, dvs);
 
 		// Recover the simplified hull in primary space. 
 		u32 pvCount = 0;
-		b3Vec3* pvs = (b3Vec3*)b3Alloc(dual.GetFaceList().count * sizeof(b3Vec3));
+		b3Vec3* pvs = (b3Vec3*)b3AllocScratch(allocator, dual.GetFaceList().count * sizeof(b3Vec3));
 		for (qhFace* f = dual.GetFaceList().head; f; f = f->next)
 		{
 			b3Plane plane = f->plane;
 			B3_ASSERT(plane.offset > 0.0f);
-			b3Vec3 v = plane.normal / plane.offset;
-
-			bool unique = true;
-
-			for (u32 j = 0; j < pvCount; ++j)
-			{
-				if (b3DistanceSquared(v, pvs[j]) <= B3_LINEAR_SLOP * B3_LINEAR_SLOP)
-				{
-					unique = false;
-					break;
-				}
-			}
-
-			if (unique)
-			{
-				pvs[pvCount++] = v;
-			}
+			pvs[pvCount++] = plane.normal / plane.offset;
 		}
 
+		pvCount = b3WeldPoints(pvs, pvCount, allocator);
+
 		if (pvCount < 4)
 		{
-			b3Free(pvs);
-			return;
+			b3FreeScratch(allocator, pvs);
+			return NULL;
 		}
 
 		hull.Construct(pvs, pvCount);
-		b3Free(pvs);
+		b3FreeScratch(allocator, pvs);
 
 		// Translate the hull back to the origin
 		hull.Translate(s);
@@ -260,77 +397,91 @@ void b3QHull::Set(u32 vtxStride, const void* vtxBase, u32 vtxCount, bool simplif
 	else
 	{
 		hull.Construct(vs0, vs0Count);
-		b3Free(vs0);
+		b3FreeScratch(allocator, vs0);
 	}
 
 	// Convert the constructed hull into a run-time hull.
-	b3UniqueStackArray<qhVertex*> vs;
-	b3UniqueStackArray<qhHalfEdge*> es;
+	b3HashMap<const qhVertex*, u32> vs;
+	b3HashMap<const qhHalfEdge*, u32> es;
+
+	vs.Reserve(hull.GetVertexList().count);
 
 	// Add vertices to the map
+	u32 hullVertexCount = 0;
 	for (qhVertex* vertex = hull.GetVertexList().head; vertex != NULL; vertex = vertex->next)
 	{
-		vs.PushBack(vertex);
+		vs.Insert(vertex, hullVertexCount++);
 	}
 
 	// Add half-edges to the map
+	u32 hullEdgeCount = 0;
+	u32 hullFaceCount = 0;
 	for (qhFace* face = hull.GetFaceList().head; face != NULL; face = face->next)
 	{
-		// Add half-edges 
 		qhHalfEdge* begin = face->edge;
 		qhHalfEdge* edge = begin;
 		do
 		{
-			// Add half-edge
-			u32 iedge = es.PushBack(edge);
-
-			// Add half-edge just after its twin
-			u32 itwin = es.PushBack(edge->twin);
+			if (es.Find(edge) == NULL)
+			{
+				// Add half-edge just before its twin
+				es.Insert(edge, hullEdgeCount++);
+				es.Insert(edge->twin, hullEdgeCount++);
+			}
 
 			edge = edge->next;
 		} while (edge != begin);
+
+		++hullFaceCount;
 	}
 
-	hullVertices.Resize(hull.GetVertexList().count);
-	hullEdges.Resize(es.elements.Count());
-	hullFaces.Resize(hull.GetFaceList().count);
-	hullPlanes.Resize(hull.GetFaceList().count);
+	// Allocate a single block sized to the hull.
+	u32 hullSize = 0;
+	hullSize += hullFaceCount * sizeof(b3Plane);
+	hullSize += hullVertexCount * sizeof(b3Vec3);
+	hullSize += hullEdgeCount * sizeof(b3HalfEdge);
+	hullSize += hullFaceCount * sizeof(b3Face);
+
+	u8* hullBuffer = (u8*)b3AllocScratch(allocator, hullSize);
+
+	b3Plane* hullPlanes = (b3Plane*)hullBuffer;
+	b3Vec3* hullVertices = (b3Vec3*)(hullPlanes + hullFaceCount);
+	b3HalfEdge* hullEdges = (b3HalfEdge*)(hullVertices + hullVertexCount);
+	b3Face* hullFaces = (b3Face*)(hullEdges + hullEdgeCount);
 
 	// Build and link the features
 	u32 iface = 0;
 	for (qhFace* face = hull.GetFaceList().head; face != NULL; face = face->next)
 	{
 		// Build and link the half-edges 
-		b3Face* hface = hullFaces.Get(iface);
+		b3Face* hface = hullFaces + iface;
 
 		hullPlanes[iface] = face->plane;
 
 		qhHalfEdge* begin = face->edge;
-		hface->edge = es.PushBack(begin);
+		hface->edge = *es.Find(begin);
 
 		qhHalfEdge* edge = begin;
 		do
 		{
 			qhVertex* v = edge->tail;
-			u32 iv = vs.PushBack(v);
+			u32 iv = *vs.Find(v);
 			hullVertices[iv] = v->position;
 
-			u32 iedge = es.PushBack(edge);
-			b3HalfEdge* hedge = hullEdges.Get(iedge);
+			u32 iedge = *es.Find(edge);
+			b3HalfEdge* hedge = hullEdges + iedge;
 			hedge->face = iface;
 			hedge->origin = iv;
 
 			qhHalfEdge* twin = edge->twin;
-			u32 itwin = es.PushBack(twin);
-			b3HalfEdge* htwin = hullEdges.Get(itwin);
+			u32 itwin = *es.Find(twin);
+			b3HalfEdge* htwin = hullEdges + itwin;
 			htwin->twin = iedge;
 
 			hedge->twin = itwin;
 
 			qhHalfEdge* next = edge->next;
-			u32 inext = es.PushBack(next);
-
-			hullEdges[iedge].next = inext;
+			hedge->next = *es.Find(next);
 
 			edge = next;
 		} while (edge != begin);
@@ -338,19 +489,49 @@ void b3QHull::Set(u32 vtxStride, const void* vtxBase, u32 vtxCount, bool simplif
 		++iface;
 	}
 
-	vertices = hullVertices.Begin();
-	vertexCount = hullVertices.Count();
-	edges = hullEdges.Begin();
-	edgeCount = hullEdges.Count();
-	faces = hullFaces.Begin();
-	planes = hullPlanes.Begin();
-	faceCount = hullFaces.Count();
+	out->vertices = hullVertices;
+	out->vertexCount = hullVertexCount;
+	out->edges = hullEdges;
+	out->edgeCount = hullEdgeCount;
+	out->faces = hullFaces;
+	out->planes = hullPlanes;
+	out->faceCount = hullFaceCount;
 
 	// Validate
-	Validate();
+	out->Validate();
 
 	// Compute the centroid.
-	centroid = b3ComputeCentroid(this);
+	out->centroid = b3ComputeCentroid(out);
+
+	return hullBuffer;
+}
+
+bool b3CreateHull(b3Hull* hull, b3FrameAllocator* allocator, u32 vtxStride, const void* vtxBase, u32 vtxCount, bool simplify)
+{
+	B3_ASSERT(allocator != NULL);
+	return b3CreateHullFromPoints(hull, vtxStride, vtxBase, vtxCount, simplify, allocator) != NULL;
+}
+
+void b3QHull::Set(u32 vtxStride, const void* vtxBase, u32 vtxCount, bool simplify)
+{
+	b3Hull hull;
+	void* hullBuffer = b3CreateHullFromPoints(&hull, vtxStride, vtxBase, vtxCount, simplify, NULL);
+	if (hullBuffer == NULL)
+	{
+		return;
+	}
+
+	b3Free(buffer);
+	buffer = hullBuffer;
+
+	vertices = hull.vertices;
+	vertexCount = hull.vertexCount;
+	edges = hull.edges;
+	edgeCount = hull.edgeCount;
+	faces = hull.faces;
+	planes = hull.planes;
+	faceCount = hull.faceCount;
+	centroid = hull.centroid;
 }
 
 void b3QHull::SetAsSphere(float32 radius)
@@ -32,10 +32,14 @@ b3DynamicTree::b3DynamicTree()
 	// Link the allocated nodes and make the first node 
 	// available the the next allocation.
 	AddToFreeList(m_nodeCount);
+
+	m_scratch = nullptr;
+	m_scratchCapacity = 0;
 }
 
 b3DynamicTree::~b3DynamicTree() 
 {
+	b3Free(m_scratch);
 	b3Free(m_nodes);
 }
 
@@ -141,6 +145,240 @@ void b3DynamicTree::UpdateNode(u32 proxyId, const b3AABB3& aabb)
 	InsertLeaf(proxyId);
 }
 
+void b3DynamicTree::RefitNode(u32 proxyId, const b3AABB3& aabb)
+{
+	B3_ASSERT(m_root != B3_NULL_NODE_D);
+	B3_ASSERT(m_nodes[proxyId].IsLeaf());
+
+	m_nodes[proxyId].aabb = aabb;
+
+	u32 node = m_nodes[proxyId].parent;
+	while (node != B3_NULL_NODE_D)
+	{
+		if (m_nodes[node].aabb.Contains(aabb))
+		{
+			// The remaining ancestors contain this node.
+			break;
+		}
+
+		m_nodes[node].aabb = b3Combine(m_nodes[node].aabb, aabb);
+
+		node = m_nodes[node].parent;
+	}
+}
+
+u32* b3DynamicTree::GetScratch(u32 count)
+{
+	if (count > m_scratchCapacity)
+	{
+		// The old indices aren't needed.
+		b3Free(m_scratch);
+		m_scratchCapacity = b3Max(count, m_nodeCapacity);
+		m_scratch = (u32*)b3Alloc(m_scratchCapacity * sizeof(u32));
+	}
+	return m_scratch;
+}
+
+void b3DynamicTree::Refit()
+{
+	if (m_root == B3_NULL_NODE_D)
+	{
+		return;
+	}
+
+	// Sort the internal nodes in pre-order. 
+	// A reverse pass visits the children of a node before the node.
+	u32* nodes = GetScratch(m_nodeCount);
+	u32 nodeCount = 0;
+
+	b3Stack<u32, 256> stack;
+	stack.Push(m_root);
+
+	while (stack.IsEmpty() == false)
+	{
+		u32 node = stack.Top();
+		stack.Pop();
+
+		if (m_nodes[node].IsLeaf())
+		{
+			continue;
+		}
+
+		nodes[nodeCount++] = node;
+
+		stack.Push(m_nodes[node].child1);
+		stack.Push(m_nodes[node].child2);
+	}
+
+	for (u32 i = nodeCount; i > 0; --i)
+	{
+		b3Node* node = m_nodes + nodes[i - 1];
+
+		node->aabb = b3Combine(m_nodes[node->child1].aabb, m_nodes[node->child2].aabb);
+	}
+}
+
+void b3DynamicTree::PartitionLeaves(u32* leaves, u32 count, u32 axis) const
+{
+	u32 middle = count / 2;
+	u32 left = 0;
+	u32 right = count - 1;
+
+	while (left < right)
+	{
+		// Partition around the element in the middle of the range.
+		// The centroids are compared as the sums of the AABB bounds.
+		const b3AABB3& pivotAABB = m_nodes[leaves[left + (right - left) / 2]].aabb;
+		float32 pivot = pivotAABB.m_lower[axis] + pivotAABB.m_upper[axis];
+
+		// Split the range into the leaves less than, equal to, and greater than the pivot.
+		// Keeping the equal leaves together avoids quadratic time when many leaves share 
+		// the same centroid.
+		u32 less = left;
+		u32 greater = right + 1;
+		u32 i = left;
+		while (i < greater)
+		{
+			const b3AABB3& aabb = m_nodes[leaves[i]].aabb;
+			float32 key = aabb.m_lower[axis] + aabb.m_upper[axis];
+			
+			if (key < pivot)
+			{
+				b3Swap(leaves[i], leaves[less]);
+				++less;
+				++i;
+			}
+			else if (key > pivot)
+			{
+				--greater;
+				b3Swap(leaves[i], leaves[greater]);
+			}
+			else
+			{
+				++i;
+			}
+		}
+
+		if (middle < less)
+		{
+			right = less - 1;
+		}
+		else if (middle >= greater)
+		{
+			left = greater;
+		}
+		else
+		{
+			return;
+		}
+	}
+}
+
+u32 b3DynamicTree::BuildNode(u32* leaves, u32 count)
+{
+	B3_ASSERT(count > 0);
+
+	if (count == 1)
+	{
+		return leaves[0];
+	}
+
+	// Split the leaves at the median centroid along the longest axis of the centroid bounds.
+	b3AABB3 centerAABB;
+	centerAABB.m_lower = m_nodes[leaves[0]].aabb.Centroid();
+	centerAABB.m_upper = centerAABB.m_lower;
+	for (u32 i = 1; i < count; ++i)
+	{
+		b3Vec3 center = m_nodes[leaves[i]].aabb.Centroid();
+		centerAABB.m_lower = b3Min(centerAABB.m_lower, center);
+		centerAABB.m_upper = b3Max(centerAABB.m_upper, center);
+	}
+
+	u32 axis = centerAABB.GetLongestAxisIndex();
+
+	PartitionLeaves(leaves, count, axis);
+
+	u32 middle = count / 2;
+
+	u32 child1 = BuildNode(leaves, middle);
+	u32 child2 = BuildNode(leaves + middle, count - middle);
+
+	u32 node = AllocateNode();
+	m_nodes[node].child1 = child1;
+	m_nodes[node].child2 = child2;
+	m_nodes[node].aabb = b3Combine(m_nodes[child1].aabb, m_nodes[child2].aabb);
+	m_nodes[node].height = 1 + b3Max(m_nodes[child1].height, m_nodes[child2].height);
+	m_nodes[child1].parent = node;
+	m_nodes[child2].parent = node;
+
+	return node;
+}
+
+void b3DynamicTree::Rebuild()
+{
+	if (m_root == B3_NULL_NODE_D)
+	{
+		return;
+	}
+
+	// Collect the leaves and free the internal nodes.
+	u32* leaves = GetScratch(m_nodeCount);
+	u32 leafCount = 0;
+
+	for (u32 i = 0; i < m_nodeCapacity; ++i)
+	{
+		if (m_nodes[i].height < 0)
+		{
+			// Free node
+			continue;
+		}
+
+		if (m_nodes[i].IsLeaf())
+		{
+			m_nodes[i].parent = B3_NULL_NODE_D;
+			leaves[leafCount++] = i;
+		}
+		else
+		{
+			FreeNode(i);
+		}
+	}
+
+	m_root = BuildNode(leaves, leafCount);
+	m_nodes[m_root].parent = B3_NULL_NODE_D;
+}
+
+float32 b3DynamicTree::GetAreaRatio() const
+{
+	float32 internalArea = 0.0f;
+	float32 leafArea = 0.0f;
+	for (u32 i = 0; i < m_nodeCapacity; ++i)
+	{
+		const b3Node* node = m_nodes + i;
+		if (node->height < 0)
+		{
+			// Free node
+			continue;
+		}
+
+		if (node->IsLeaf())
+		{
+			leafArea += node->aabb.SurfaceArea();
+		}
+		else
+		{
+			internalArea += node->aabb.SurfaceArea();
+		}
+	}
+
+	if (leafArea == 0.0f)
+	{
+		return 0.0f;
+	}
+
+	return internalArea / leafArea;
+}
+
 u32 b3DynamicTree::FindBest(const b3AABB3& leafAABB) const 
 {
 	u32 index = m_root;
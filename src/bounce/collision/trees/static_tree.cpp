@@ -24,11 +24,15 @@ b3StaticTree::b3StaticTree()
 {
 	m_nodes = NULL;
 	m_nodeCount = 0;
+	m_ownsNodes = false;
 }
 
 b3StaticTree::~b3StaticTree()
 {
-	b3Free(m_nodes);
+	if (m_ownsNodes)
+	{
+		b3Free(m_nodes);
+	}
 }
 
 static B3_FORCE_INLINE bool b3SortPredicate(const b3AABB3* set, u32 axis, u32 a, u32 b)
@@ -167,8 +171,14 @@ void b3StaticTree::Build(const b3AABB3* set, u32 count)
 	u32 internalCount = 0;
 	u32 leafCount = 0;
 
+	if (m_ownsNodes)
+	{
+		b3Free(m_nodes);
+	}
+
 	m_nodes = (b3Node*)b3Alloc(nodeCapacity * sizeof(b3Node));
 	m_nodeCount = 1;
+	m_ownsNodes = true;
 
 	Build(set, m_nodes, ids, count, kMinObjectsPerLeaf, nodeCapacity, leafCount, internalCount);
 
@@ -179,6 +189,24 @@ void b3StaticTree::Build(const b3AABB3* set, u32 count)
 	B3_ASSERT(m_nodeCount == nodeCapacity);
 }
 
+void b3StaticTree::WriteNodes(void* buffer) const
+{
+	memcpy(buffer, m_nodes, m_nodeCount * sizeof(b3Node));
+}
+
+void b3StaticTree::SetNodes(const void* nodes, u32 nodeCount)
+{
+	if (m_ownsNodes)
+	{
+		b3Free(m_nodes);
+	}
+
+	// The nodes are borrowed. They are read-only and must not be refit.
+	m_nodes = (b3Node*)nodes;
+	m_nodeCount = nodeCount;
+	m_ownsNodes = false;
+}
+
 void b3StaticTree::Draw() const
 {
 	if (m_nodeCount == 0)
@@ -0,0 +1,94 @@
+/*
+* Copyright (c) 2016-2019 Irlan Robson https://irlanrobson.github.io
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include <bounce/common/memory/frame_allocator.h>
+#include <bounce/common/math/math.h>
+
+// The chunk header is padded to keep the allocations aligned.
+const u32 b3_chunkHeaderSize = (sizeof(void*) + sizeof(u32) + 15) & ~15;
+
+b3FrameAllocator::b3FrameAllocator(u32 chunkSize)
+{
+	m_chunks = nullptr;
+	m_chunkSize = chunkSize;
+	m_offset = 0;
+	m_allocatedSize = 0;
+}
+
+b3FrameAllocator::~b3FrameAllocator()
+{
+	b3Chunk* c = m_chunks;
+	while (c)
+	{
+		b3Chunk* c0 = c;
+		c = c->next;
+		b3Free(c0);
+	}
+}
+
+b3FrameAllocator::b3Chunk* b3FrameAllocator::AllocateChunk(u32 size)
+{
+	b3Chunk* chunk = (b3Chunk*)b3Alloc(b3_chunkHeaderSize + size);
+	chunk->next = m_chunks;
+	chunk->size = size;
+	m_chunks = chunk;
+	m_offset = 0;
+	return chunk;
+}
+
+void* b3FrameAllocator::Allocate(u32 size)
+{
+	size = (size + 15) & ~15;
+
+	if (m_chunks == nullptr || m_offset + size > m_chunks->size)
+	{
+		// Grow geometrically.
+		u32 chunkSize = m_chunks ? 2 * m_chunks->size : m_chunkSize;
+		AllocateChunk(b3Max(chunkSize, size));
+	}
+
+	u8* p = (u8*)m_chunks + b3_chunkHeaderSize + m_offset;
+	m_offset += size;
+	m_allocatedSize += size;
+	return p;
+}
+
+void b3FrameAllocator::Reset()
+{
+	if (m_chunks && m_chunks->next)
+	{
+		// Merge the chunks into a single chunk 
+		// so that the next frame doesn't need to allocate.
+		u32 size = 0;
+		b3Chunk* c = m_chunks;
+		while (c)
+		{
+			size += c->size;
+			
+			b3Chunk* c0 = c;
+			c = c->next;
+			b3Free(c0);
+		}
+		
+		m_chunks = nullptr;
+		AllocateChunk(size);
+	}
+
+	m_offset = 0;
+	m_allocatedSize = 0;
+}
@@ -21,16 +21,21 @@
 #include <stdio.h>
 #include <stdarg.h>
 #include <stdlib.h>
+#include <atomic>
 
-u32 b3_allocCalls = 0;
-u32 b3_maxAllocCalls = 0;
+// The allocation counters are atomic because b3Alloc can be called from worker threads.
+std::atomic<u32> b3_allocCalls(0);
+std::atomic<u32> b3_maxAllocCalls(0);
 
 b3Version b3_version = { 1, 0, 0 };
 
 void* b3Alloc(u32 size) 
 {
-	++b3_allocCalls;
-	b3_maxAllocCalls = b3Max(b3_maxAllocCalls, b3_allocCalls);
+	u32 calls = b3_allocCalls.fetch_add(1, std::memory_order_relaxed) + 1;
+	u32 maxCalls = b3_maxAllocCalls.load(std::memory_order_relaxed);
+	while (calls > maxCalls && b3_maxAllocCalls.compare_exchange_weak(maxCalls, calls, std::memory_order_relaxed) == false)
+	{
+	}
 	return malloc(size);
 }
 
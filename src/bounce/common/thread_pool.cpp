@@ -0,0 +1,184 @@
+/*
+* Copyright (c) 2016-2019 Irlan Robson https://irlanrobson.github.io
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include <bounce/common/thread_pool.h>
+#include <bounce/common/math/math.h>
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+struct b3ThreadPoolData
+{
+	std::thread* workers;
+
+	std::mutex mutex;
+	std::condition_variable wakeCondition;
+	std::condition_variable doneCondition;
+
+	// Incremented for each batch of tasks
+	u32 generation;
+	bool quit;
+
+	// The current batch of tasks
+	b3TaskFcn fcn;
+	void* data;
+	u32 count;
+	std::atomic<u32> next;
+
+	// Number of workers still running the current batch
+	u32 busyCount;
+};
+
+// Run the tasks of the current batch until there are none left.
+static void b3RunTasks(b3ThreadPoolData* data, u32 threadIndex)
+{
+	for (;;)
+	{
+		u32 index = data->next.fetch_add(1);
+		if (index >= data->count)
+		{
+			break;
+		}
+
+		data->fcn(data->data, index, threadIndex);
+	}
+}
+
+static void b3WorkerMain(b3ThreadPoolData* data, u32 threadIndex)
+{
+	u32 generation = 0;
+
+	for (;;)
+	{
+		{
+			std::unique_lock<std::mutex> lock(data->mutex);
+			while (data->quit == false && data->generation == generation)
+			{
+				data->wakeCondition.wait(lock);
+			}
+
+			if (data->quit)
+			{
+				return;
+			}
+
+			generation = data->generation;
+		}
+
+		b3RunTasks(data, threadIndex);
+
+		{
+			std::unique_lock<std::mutex> lock(data->mutex);
+			if (--data->busyCount == 0)
+			{
+				data->doneCondition.notify_one();
+			}
+		}
+	}
+}
+
+b3ThreadPool::b3ThreadPool(u32 threadCount)
+{
+	if (threadCount == 0)
+	{
+		threadCount = std::thread::hardware_concurrency();
+	}
+
+	m_threadCount = b3Max(threadCount, 1u);
+
+	void* mem = b3Alloc(sizeof(b3ThreadPoolData));
+	m_data = new (mem) b3ThreadPoolData();
+	m_data->generation = 0;
+	m_data->quit = false;
+	m_data->fcn = nullptr;
+	m_data->data = nullptr;
+	m_data->count = 0;
+	m_data->next = 0;
+	m_data->busyCount = 0;
+
+	// The calling thread is the thread 0.
+	u32 workerCount = m_threadCount - 1;
+	m_data->workers = (std::thread*)b3Alloc(workerCount * sizeof(std::thread));
+	for (u32 i = 0; i < workerCount; ++i)
+	{
+		new (m_data->workers + i) std::thread(b3WorkerMain, m_data, i + 1);
+	}
+}
+
+b3ThreadPool::~b3ThreadPool()
+{
+	{
+		std::unique_lock<std::mutex> lock(m_data->mutex);
+		m_data->quit = true;
+	}
+	m_data->wakeCondition.notify_all();
+
+	u32 workerCount = m_threadCount - 1;
+	for (u32 i = 0; i < workerCount; ++i)
+	{
+		m_data->workers[i].join();
+		m_data->workers[i].~thread();
+	}
+	b3Free(m_data->workers);
+
+	m_data->~b3ThreadPoolData();
+	b3Free(m_data);
+}
+
+void b3ThreadPool::Run(b3TaskFcn fcn, void* data, u32 count)
+{
+	if (count == 0)
+	{
+		return;
+	}
+
+	u32 workerCount = m_threadCount - 1;
+
+	if (workerCount == 0 || count == 1)
+	{
+		// Run serially.
+		for (u32 i = 0; i < count; ++i)
+		{
+			fcn(data, i, 0);
+		}
+		return;
+	}
+
+	{
+		std::unique_lock<std::mutex> lock(m_data->mutex);
+		m_data->fcn = fcn;
+		m_data->data = data;
+		m_data->count = count;
+		m_data->next = 0;
+		m_data->busyCount = workerCount;
+		++m_data->generation;
+	}
+	m_data->wakeCondition.notify_all();
+
+	// Help the workers.
+	b3RunTasks(m_data, 0);
+
+	// Wait for the workers.
+	std::unique_lock<std::mutex> lock(m_data->mutex);
+	while (m_data->busyCount > 0)
+	{
+		m_data->doneCondition.wait(lock);
+	}
+}
@@ -244,7 +244,7 @@ b3Contact* b3ContactManager::Create(b3Shape* shapeA, b3Shape* shapeB)
 	B3_ASSERT(typeA <= typeB);
 
 	b3Contact* c = NULL;
-	if (typeA != e_meshShape && typeB != e_meshShape) 
+	if (typeB != e_meshShape && typeB != e_heightFieldShape) 
 	{
 		void* block = m_convexBlocks.Allocate();
 		b3ConvexContact* cxc = new (block) b3ConvexContact(shapeA, shapeB);
@@ -252,7 +252,7 @@ b3Contact* b3ContactManager::Create(b3Shape* shapeA, b3Shape* shapeB)
 	}
 	else 
 	{
-		if (typeB == e_meshShape) 
+		if (typeA != e_meshShape && typeA != e_heightFieldShape) 
 		{
 			void* block = m_meshBlocks.Allocate();
 			b3MeshContact* mxc = new (block) b3MeshContact(shapeA, shapeB);
@@ -260,7 +260,7 @@ b3Contact* b3ContactManager::Create(b3Shape* shapeA, b3Shape* shapeB)
 		}
 		else 
 		{
-			// Collisions between meshes are not implemented.
+			// Collisions between meshes and height fields are not implemented.
 			return NULL;
 		}
 	}
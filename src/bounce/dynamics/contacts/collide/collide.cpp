@@ -21,10 +21,12 @@
 #include <bounce/dynamics/shapes/capsule_shape.h>
 #include <bounce/dynamics/shapes/hull_shape.h>
 #include <bounce/dynamics/shapes/mesh_shape.h>
+#include <bounce/dynamics/shapes/height_field_shape.h>
 #include <bounce/collision/shapes/sphere.h>
 #include <bounce/collision/shapes/capsule.h>
 #include <bounce/collision/shapes/hull.h>
 #include <bounce/collision/shapes/mesh.h>
+#include <bounce/collision/shapes/height_field.h>
 #include <bounce/collision/collision.h>
 
 void b3ShapeGJKProxy::Set(const b3Shape* shape, u32 index)
@@ -73,6 +75,19 @@ void b3ShapeGJKProxy::Set(const b3Shape* shape, u32 index)
 		radius = mesh->m_radius;
 		break;
 	}
+	case e_heightFieldShape:
+	{
+		const b3HeightFieldShape* heightField = (b3HeightFieldShape*)shape;
+
+		B3_ASSERT(index < heightField->m_heightField->GetTriangleCount());
+
+		heightField->m_heightField->GetTriangle(index, vertexBuffer[0], vertexBuffer[1], vertexBuffer[2]);
+
+		vertexCount = 3;
+		vertices = vertexBuffer;
+		radius = heightField->m_radius;
+		break;
+	}
 	default:
 	{
 		B3_ASSERT(false);
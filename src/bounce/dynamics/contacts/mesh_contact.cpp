@@ -20,10 +20,12 @@
 #include <bounce/dynamics/contacts/contact_cluster.h>
 #include <bounce/dynamics/shapes/shape.h>
 #include <bounce/dynamics/shapes/mesh_shape.h>
+#include <bounce/dynamics/shapes/height_field_shape.h>
 #include <bounce/dynamics/world.h>
 #include <bounce/dynamics/body.h>
 #include <bounce/dynamics/shapes/hull_shape.h>
 #include <bounce/collision/shapes/mesh.h>
+#include <bounce/collision/shapes/height_field.h>
 #include <bounce/collision/shapes/triangle_hull.h>
 #include <bounce/common/memory/stack_allocator.h>
 
@@ -137,6 +139,18 @@ bool b3MeshContact::MoveAABB(const b3AABB3& aabb, const b3Vec3& displacement)
 	return true;
 }
 
+// Height field callback. 
+// The height field reports triangle indices directly.
+struct b3HeightFieldContactQueryCallback
+{
+	bool Report(u32 triangleIndex)
+	{
+		return contact->AddTriangle(triangleIndex);
+	}
+
+	b3MeshContact* contact;
+};
+
 void b3MeshContact::FindNewPairs()
 {
 	// Reuse the overlapping buffer if the AABB didn't move
@@ -149,7 +163,21 @@ void b3MeshContact::FindNewPairs()
 	// Clear the index cache.
 	m_triangleCount = 0;
 
-	const b3MeshShape* meshShapeB = (b3MeshShape*)GetShapeB();
+	const b3Shape* shapeB = GetShapeB();
+	
+	if (shapeB->GetType() == e_heightFieldShape)
+	{
+		const b3HeightFieldShape* heightFieldShapeB = (b3HeightFieldShape*)shapeB;
+		const b3HeightField* heightFieldB = heightFieldShapeB->m_heightField;
+
+		// Query the cells overlapping the AABB. There is no tree.
+		b3HeightFieldContactQueryCallback callback;
+		callback.contact = this;
+		heightFieldB->QueryAABB(&callback, m_aabbA);
+		return;
+	}
+
+	const b3MeshShape* meshShapeB = (b3MeshShape*)shapeB;
 	const b3Mesh* meshB = meshShapeB->m_mesh;
 	const b3StaticTree* tree = &meshB->tree;
 
@@ -165,6 +193,11 @@ bool b3MeshContact::Report(u32 proxyId)
 
 	u32 triangleIndex = treeB->GetUserData(proxyId);
 
+	return AddTriangle(triangleIndex);
+}
+
+bool b3MeshContact::AddTriangle(u32 triangleIndex)
+{
 	// Add the triangle to the overlapping buffer.
 	if (m_triangleCount == m_triangleCapacity)
 	{
@@ -188,6 +221,26 @@ bool b3MeshContact::Report(u32 proxyId)
 	return true;
 }
 
+void b3MeshContact::GetTriangle(u32 index, b3Vec3& v1, b3Vec3& v2, b3Vec3& v3) const
+{
+	const b3Shape* shapeB = GetShapeB();
+	
+	if (shapeB->GetType() == e_heightFieldShape)
+	{
+		const b3HeightFieldShape* heightFieldShapeB = (b3HeightFieldShape*)shapeB;
+		heightFieldShapeB->m_heightField->GetTriangle(index, v1, v2, v3);
+		return;
+	}
+
+	const b3MeshShape* meshShapeB = (b3MeshShape*)shapeB;
+	const b3Mesh* meshB = meshShapeB->m_mesh;
+	const b3Triangle* triangle = meshB->triangles + index;
+
+	v1 = meshB->vertices[triangle->v1];
+	v2 = meshB->vertices[triangle->v2];
+	v3 = meshB->vertices[triangle->v3];
+}
+
 bool b3MeshContact::TestOverlap()
 {
 	b3Shape* shapeA = GetShapeA();
@@ -224,7 +277,6 @@ void b3MeshContact::Collide()
 
 	b3Shape* shapeB = GetShapeB();
 	b3Body* bodyB = shapeB->GetBody();
-	b3MeshShape* meshShapeB = (b3MeshShape*)shapeB;
 	b3Transform xfB = bodyB->GetTransform();
 
 	b3World* world = bodyA->GetWorld();
@@ -234,16 +286,13 @@ void b3MeshContact::Collide()
 	b3Manifold* tempManifolds = (b3Manifold*)allocator->Allocate(m_triangleCount * sizeof(b3Manifold));
 	u32 tempCount = 0;
 
-	const b3Mesh* meshB = meshShapeB->m_mesh;
 	for (u32 i = 0; i < m_triangleCount; ++i)
 	{
 		b3TriangleCache* triangleCache = m_triangles + i;
 		u32 triangleIndex = triangleCache->index;
-		b3Triangle* triangle = meshB->triangles + triangleIndex;
 
-		b3Vec3 v1 = meshB->vertices[triangle->v1];
-		b3Vec3 v2 = meshB->vertices[triangle->v2];
-		b3Vec3 v3 = meshB->vertices[triangle->v3];
+		b3Vec3 v1, v2, v3;
+		GetTriangle(triangleIndex, v1, v2, v3);
 
 		b3TriangleHull hullB(v1, v2, v3);
 
@@ -195,6 +195,23 @@ void b3World::DrawShape(const b3Transform& xf, const b3Shape* shape, const b3Col
 		}
 		break;
 	}
+	case e_heightFieldShape:
+	{
+		const b3HeightFieldShape* hfs = (b3HeightFieldShape*)shape;
+		const b3HeightField* heightField = hfs->m_heightField;
+		for (u32 i = 0; i < heightField->GetTriangleCount(); ++i)
+		{
+			b3Vec3 v1, v2, v3;
+			heightField->GetTriangle(i, v1, v2, v3);
+
+			b3Vec3 p1 = xf * v1;
+			b3Vec3 p2 = xf * v2;
+			b3Vec3 p3 = xf * v3;
+
+			b3Draw_draw->DrawTriangle(p1, p2, p3, color);
+		}
+		break;
+	}
 	default:
 	{
 		break;
@@ -313,6 +330,30 @@ void b3World::DrawSolidShape(const b3Transform& xf, const b3Shape* shape, const
 
 		break;
 	}
+	case e_heightFieldShape:
+	{
+		const b3HeightFieldShape* heightFieldShape = (b3HeightFieldShape*)shape;
+
+		const b3HeightField* heightField = heightFieldShape->m_heightField;
+		for (u32 i = 0; i < heightField->GetTriangleCount(); ++i)
+		{
+			b3Vec3 v1, v2, v3;
+			heightField->GetTriangle(i, v1, v2, v3);
+
+			b3Vec3 p1 = xf * v1;
+			b3Vec3 p2 = xf * v2;
+			b3Vec3 p3 = xf * v3;
+
+			b3Vec3 n1 = b3Cross(p2 - p1, p3 - p1);
+			n1.Normalize();
+			b3Draw_draw->DrawSolidTriangle(n1, p1, p2, p3, color);
+
+			b3Vec3 n2 = -n1;
+			b3Draw_draw->DrawSolidTriangle(n2, p3, p2, p1, color);
+		}
+
+		break;
+	}
 	default:
 	{
 		break;
@@ -0,0 +1,113 @@
+/*
+* Copyright (c) 2016-2019 Irlan Robson https://irlanrobson.github.io
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include <bounce/dynamics/shapes/height_field_shape.h>
+#include <bounce/collision/shapes/height_field.h>
+
+b3HeightFieldShape::b3HeightFieldShape() 
+{
+	m_type = e_heightFieldShape;
+	m_radius = B3_HULL_RADIUS;
+	m_heightField = NULL;
+}
+
+b3HeightFieldShape::~b3HeightFieldShape() 
+{
+}
+
+void b3HeightFieldShape::Swap(const b3HeightFieldShape& other) 
+{
+	m_radius = other.m_radius;
+	m_heightField = other.m_heightField;
+}
+
+void b3HeightFieldShape::ComputeMass(b3MassData* massData, float32 density) const 
+{
+	B3_NOT_USED(density);
+	b3AABB3 aabb = m_heightField->GetAABB();
+	massData->center = aabb.Centroid();
+	massData->mass = 0.0f;
+	massData->I.SetZero();
+}
+
+void b3HeightFieldShape::ComputeAABB(b3AABB3* output, const b3Transform& xf) const 
+{
+	b3AABB3 aabb = m_heightField->GetAABB();
+
+	b3Vec3 vertices[8];
+	vertices[0].Set(aabb.m_lower.x, aabb.m_lower.y, aabb.m_lower.z);
+	vertices[1].Set(aabb.m_lower.x, aabb.m_lower.y, aabb.m_upper.z);
+	vertices[2].Set(aabb.m_lower.x, aabb.m_upper.y, aabb.m_lower.z);
+	vertices[3].Set(aabb.m_lower.x, aabb.m_upper.y, aabb.m_upper.z);
+	vertices[4].Set(aabb.m_upper.x, aabb.m_lower.y, aabb.m_lower.z);
+	vertices[5].Set(aabb.m_upper.x, aabb.m_lower.y, aabb.m_upper.z);
+	vertices[6].Set(aabb.m_upper.x, aabb.m_upper.y, aabb.m_lower.z);
+	vertices[7].Set(aabb.m_upper.x, aabb.m_upper.y, aabb.m_upper.z);
+
+	output->Set(vertices, 8, xf);
+	output->Extend(m_radius);
+}
+
+void b3HeightFieldShape::ComputeAABB(b3AABB3* output, const b3Transform& xf, u32 index) const
+{
+	b3Vec3 v1, v2, v3;
+	m_heightField->GetTriangle(index, v1, v2, v3);
+
+	v1 = b3Mul(xf, v1);
+	v2 = b3Mul(xf, v2);
+	v3 = b3Mul(xf, v3);
+
+	output->m_lower = b3Min(b3Min(v1, v2), v3);
+	output->m_upper = b3Max(b3Max(v1, v2), v3);
+	output->Extend(m_radius);
+}
+
+bool b3HeightFieldShape::TestSphere(const b3Sphere& sphere, const b3Transform& xf) const
+{
+	B3_NOT_USED(sphere);
+	B3_NOT_USED(xf);
+	return false;
+}
+
+bool b3HeightFieldShape::TestSphere(b3TestSphereOutput* output, const b3Sphere& sphere, const b3Transform& xf) const
+{
+	B3_NOT_USED(output);
+	B3_NOT_USED(sphere);
+	B3_NOT_USED(xf);
+	return false;
+}
+
+bool b3HeightFieldShape::RayCast(b3RayCastOutput* output, const b3RayCastInput& input, const b3Transform& xf) const 
+{
+	// Put the ray into the height field's frame of reference.
+	b3RayCastInput subInput;
+	subInput.p1 = b3MulT(xf, input.p1);
+	subInput.p2 = b3MulT(xf, input.p2);
+	subInput.maxFraction = input.maxFraction;
+
+	b3RayCastOutput subOutput;
+	u32 triangleIndex;
+	if (m_heightField->RayCast(&subOutput, &triangleIndex, subInput))
+	{
+		output->fraction = subOutput.fraction;
+		output->normal = xf.rotation * subOutput.normal;
+		return true;
+	}
+
+	return false;
+}
@@ -21,6 +21,7 @@
 #include <bounce/dynamics/shapes/capsule_shape.h>
 #include <bounce/dynamics/shapes/hull_shape.h>
 #include <bounce/dynamics/shapes/mesh_shape.h>
+#include <bounce/dynamics/shapes/height_field_shape.h>
 #include <bounce/dynamics/body.h>
 #include <bounce/dynamics/world.h>
 #include <bounce/dynamics/contacts/contact.h>
@@ -28,6 +29,7 @@
 #include <bounce/collision/shapes/capsule.h>
 #include <bounce/collision/shapes/hull.h>
 #include <bounce/collision/shapes/mesh.h>
+#include <bounce/collision/shapes/height_field.h>
 
 b3Shape::b3Shape() 
 {
@@ -187,6 +189,34 @@ void b3Shape::Dump(u32 bodyIndex) const
 		b3Log("		shape.m_radius = %f;\n", m_radius);
 		break;
 	}
+	case e_heightFieldShape:
+	{
+		b3HeightFieldShape* hfs = (b3HeightFieldShape*) this;
+		const b3HeightField* hf = hfs->m_heightField;
+
+		b3Log("		u8* marker = (u8*) b3Alloc(%d);\n", hf->GetSize());
+		b3Log("		\n");
+		b3Log("		b3HeightField* hf = (b3HeightField*)marker;\n");
+		b3Log("		marker += 1 * sizeof(b3HeightField);\n");
+		b3Log("		hf->heights = (float32*)marker;\n");
+		b3Log("		marker += %d * sizeof(float32);\n", hf->GetVertexCount());
+		b3Log("		\n");
+		b3Log("		hf->rowCount = %d;\n", hf->rowCount);
+		b3Log("		hf->columnCount = %d;\n", hf->columnCount);
+		b3Log("		hf->cellWidth = %f;\n", hf->cellWidth);
+		b3Log("		hf->cellDepth = %f;\n", hf->cellDepth);
+		for (u32 i = 0; i < hf->GetVertexCount(); ++i)
+		{
+			b3Log("		hf->heights[%d] = %f;\n", i, hf->heights[i]);
+		}
+		b3Log("		\n");
+		b3Log("		hf->ComputeBounds();\n");
+		b3Log("		\n");
+		b3Log("		b3HeightFieldShape shape;\n");
+		b3Log("		shape.m_heightField = hf;\n");
+		b3Log("		shape.m_radius = %f;\n", m_radius);
+		break;
+	}
 	default:
 	{
 		B3_ASSERT(false);
@@ -252,6 +282,17 @@ b3Shape* b3Shape::Create(const b3ShapeDef& def)
 		shape = mesh2;
 		break;
 	}
+	case e_heightFieldShape:
+	{
+		// Grab pointer to the specific memory.
+		b3HeightFieldShape* heightField1 = (b3HeightFieldShape*)def.shape;
+		void* block = b3Alloc(sizeof(b3HeightFieldShape));
+		b3HeightFieldShape* heightField2 = new (block) b3HeightFieldShape();
+		// Clone the height field.
+		heightField2->Swap(*heightField1);
+		shape = heightField2;
+		break;
+	}
 	default:
 	{
 		B3_ASSERT(false);
@@ -295,6 +336,13 @@ void b3Shape::Destroy(b3Shape* shape)
 		b3Free(shape);
 		break;
 	}
+	case e_heightFieldShape:
+	{
+		b3HeightFieldShape* heightField = (b3HeightFieldShape*)shape;
+		heightField->~b3HeightFieldShape();
+		b3Free(shape);
+		break;
+	}
 	default:
 	{
 		B3_ASSERT(false);
@@ -18,6 +18,7 @@
 
 #include <bounce/quickhull/qh_hull.h>
 #include <bounce/common/draw.h>
+#include <bounce/common/memory/frame_allocator.h>
 
 static float32 qhFindAABB(u32 iMin[3], u32 iMax[3], const b3Vec3* vs, u32 count)
 {
@@ -54,8 +55,100 @@ static float32 qhFindAABB(u32 iMin[3], u32 iMax[3], const b3Vec3* vs, u32 count)
 	return 3.0f * (b3Abs(max.x) + b3Abs(max.y) + b3Abs(max.z)) * B3_EPSILON;
 }
 
-qhHull::qhHull()
+// Copy the points that are not strictly inside the octahedron formed by 
+// the extreme points along the canonical axes. 
+// These points can't be in the hull.
+// Return the number of copied points.
+static u32 qhFilterPoints(b3Vec3* out, const b3Vec3* vs, u32 count)
 {
+	u32 iMin[3], iMax[3];
+	float32 tolerance = qhFindAABB(iMin, iMax, vs, count);
+
+	b3Vec3 ps[6];
+	b3Vec3 c;
+	c.SetZero();
+	for (u32 i = 0; i < 3; ++i)
+	{
+		ps[2 * i + 0] = vs[iMin[i]];
+		ps[2 * i + 1] = vs[iMax[i]];
+		
+		c += ps[2 * i + 0] + ps[2 * i + 1];
+	}
+	c /= 6.0f;
+
+	// One face per octant
+	b3Plane planes[8];
+	for (u32 i = 0; i < 8; ++i)
+	{
+		b3Vec3 A = ps[0 + ((i >> 0) & 1)];
+		b3Vec3 B = ps[2 + ((i >> 1) & 1)];
+		b3Vec3 C = ps[4 + ((i >> 2) & 1)];
+
+		b3Vec3 N = b3Cross(B - A, C - A);
+		
+		float32 len = b3Length(N);
+		
+		bool valid = len > B3_EPSILON;
+		
+		if (valid)
+		{
+			N /= len;
+
+			// Point the normal outwards.
+			if (b3Dot(N, A - c) < 0.0f)
+			{
+				N = -N;
+			}
+
+			planes[i] = b3Plane(N, A);
+
+			// Ensure the octahedron is convex.
+			for (u32 j = 0; j < 6; ++j)
+			{
+				if (b3Distance(ps[j], planes[i]) > tolerance)
+				{
+					valid = false;
+					break;
+				}
+			}
+		}
+
+		if (valid == false)
+		{
+			// Don't filter.
+			memcpy(out, vs, count * sizeof(b3Vec3));
+			return count;
+		}
+	}
+
+	u32 outCount = 0;
+	for (u32 i = 0; i < count; ++i)
+	{
+		b3Vec3 p = vs[i];
+
+		bool inside = true;
+		for (u32 j = 0; j < 8; ++j)
+		{
+			if (b3Distance(p, planes[j]) >= -tolerance)
+			{
+				inside = false;
+				break;
+			}
+		}
+
+		if (inside == false)
+		{
+			out[outCount++] = p;
+		}
+	}
+
+	return outCount;
+}
+
+qhHull::qhHull(b3FrameAllocator* allocator)
+{
+	m_allocator = allocator;
+
 	m_vertexList.head = NULL;
 	m_vertexList.count = 0;
 
@@ -108,14 +201,33 @@ qhHull::~qhHull()
 	B3_ASSERT(m_edgeCount == 0);
 	B3_ASSERT(m_faceCount == 0);
 
-	b3Free(m_buffer);
+	if (m_allocator == NULL)
+	{
+		b3Free(m_buffer);
+	}
 }
 
-void qhHull::Construct(const b3Vec3* vs, u32 count)
+void qhHull::Construct(const b3Vec3* vs, u32 count, bool prefilter)
 {
 	B3_ASSERT(m_buffer == NULL);
 	B3_ASSERT(count > 0 && count >= 4);
 
+	// Discard internal points early.
+	b3Vec3* filteredVertices = NULL;
+	if (prefilter)
+	{
+		if (m_allocator)
+		{
+			filteredVertices = (b3Vec3*)m_allocator->Allocate(count * sizeof(b3Vec3));
+		}
+		else
+		{
+			filteredVertices = (b3Vec3*)b3Alloc(count * sizeof(b3Vec3));
+		}
+		count = qhFilterPoints(filteredVertices, vs, count);
+		vs = filteredVertices;
+	}
+
 	// Compute memory buffer size for the worst case.
 	u32 size = 0;
 
@@ -143,8 +255,21 @@ void qhHull::Construct(const b3Vec3* vs, u32 count)
 	// One face per horizon edge
 	size += HE * sizeof(qhFace*);
 
+	// Visible faces
+	size += F * sizeof(qhFace*);
+
+	// Face heap
+	size += F * sizeof(qhFace*);
+
 	// Allocate memory buffer 
-	m_buffer = b3Alloc(size);
+	if (m_allocator)
+	{
+		m_buffer = m_allocator->Allocate(size);
+	}
+	else
+	{
+		m_buffer = b3Alloc(size);
+	}
 
 	// Initialize free lists
 	m_vertexCapacity = V;
@@ -178,6 +303,7 @@ void qhHull::Construct(const b3Vec3* vs, u32 count)
 		qhFace* f = faces + i;
 		f->conflictList.head = NULL;
 		f->conflictList.count = 0;
+		f->heapIndex = B3_NULL_U32;
 		f->active = true;
 		FreeFace(f);
 	}
@@ -194,10 +320,23 @@ void qhHull::Construct(const b3Vec3* vs, u32 count)
 	m_newFaces = (qhFace**)((u8*)m_conflictVertices + V * sizeof(qhVertex*));
 	m_newFaceCount = 0;
 
+	m_visibleFaces = (qhFace**)((u8*)m_newFaces + HE * sizeof(qhFace*));
+	m_visibleFaceCount = 0;
+
+	m_faceHeap = (qhFace**)((u8*)m_visibleFaces + F * sizeof(qhFace*));
+	m_faceHeapCount = 0;
+
 	m_iterations = 0;
 
 	// Build initial tetrahedron
-	if (!BuildInitialHull(vs, count))
+	bool ok = BuildInitialHull(vs, count);
+	
+	if (m_allocator == NULL)
+	{
+		b3Free(filteredVertices);
+	}
+	
+	if (!ok)
 	{
 		return;
 	}
@@ -206,8 +345,11 @@ void qhHull::Construct(const b3Vec3* vs, u32 count)
 	qhVertex* eye = FindEyeVertex();
 	while (eye)
 	{
+		// The validation is done over the whole hull.
+#ifndef NDEBUG
 		Validate();
 		ValidateConvexity();
+#endif
 
 		AddEyeVertex(eye);
 
@@ -418,29 +560,138 @@ bool qhHull::BuildInitialHull(const b3Vec3* vertices, u32 vertexCount)
 		}
 	}
 
+	for (qhFace* f = m_faceList.head; f != NULL; f = f->next)
+	{
+		AddConflictFace(f);
+	}
+
 	return true;
 }
 
 qhVertex* qhHull::FindEyeVertex() const
 {
+	// The furthest conflict point is the one of the face on the top of the heap.
+	if (m_faceHeapCount == 0)
+	{
+		return NULL;
+	}
+
+	return m_faceHeap[0]->furthestVertex;
+}
+
+void qhHull::AddConflictFace(qhFace* face)
+{
+	B3_ASSERT(face->heapIndex == B3_NULL_U32);
+
 	// Find the furthest conflict point.
 	float32 d0 = m_tolerance;
 	qhVertex* v0 = NULL;
 
-	for (qhFace* f = m_faceList.head; f != NULL; f = f->next)
+	for (qhVertex* v = face->conflictList.head; v != NULL; v = v->next)
 	{
-		for (qhVertex* v = f->conflictList.head; v != NULL; v = v->next)
+		float32 d = b3Distance(v->position, face->plane);
+		if (d > d0)
 		{
-			float32 d = b3Distance(v->position, f->plane);
-			if (d > d0)
-			{
-				d0 = d;
-				v0 = v;
-			}
+			d0 = d;
+			v0 = v;
 		}
 	}
 
-	return v0;
+	face->furthestVertex = v0;
+	face->furthestDistance = d0;
+
+	if (v0 == NULL)
+	{
+		return;
+	}
+
+	face->heapIndex = m_faceHeapCount;
+	m_faceHeap[m_faceHeapCount++] = face;
+	SiftUp(face->heapIndex);
+}
+
+void qhHull::RemoveConflictFace(qhFace* face)
+{
+	u32 index = face->heapIndex;
+	if (index == B3_NULL_U32)
+	{
+		return;
+	}
+
+	B3_ASSERT(m_faceHeap[index] == face);
+	face->heapIndex = B3_NULL_U32;
+
+	--m_faceHeapCount;
+	if (index == m_faceHeapCount)
+	{
+		return;
+	}
+
+	// Move the last face into the hole.
+	qhFace* last = m_faceHeap[m_faceHeapCount];
+	last->heapIndex = index;
+	m_faceHeap[index] = last;
+	
+	SiftUp(index);
+	SiftDown(last->heapIndex);
+}
+
+void qhHull::SiftUp(u32 index)
+{
+	qhFace* face = m_faceHeap[index];
+	while (index > 0)
+	{
+		u32 parentIndex = (index - 1) / 2;
+		qhFace* parent = m_faceHeap[parentIndex];
+		
+		if (parent->furthestDistance >= face->furthestDistance)
+		{
+			break;
+		}
+
+		parent->heapIndex = index;
+		m_faceHeap[index] = parent;
+		
+		index = parentIndex;
+	}
+
+	face->heapIndex = index;
+	m_faceHeap[index] = face;
+}
+
+void qhHull::SiftDown(u32 index)
+{
+	qhFace* face = m_faceHeap[index];
+	for (;;)
+	{
+		u32 childIndex = 2 * index + 1;
+		if (childIndex >= m_faceHeapCount)
+		{
+			break;
+		}
+
+		// Pick the largest child.
+		if (childIndex + 1 < m_faceHeapCount && 
+			m_faceHeap[childIndex + 1]->furthestDistance > m_faceHeap[childIndex]->furthestDistance)
+		{
+			++childIndex;
+		}
+
+		qhFace* child = m_faceHeap[childIndex];
+		
+		if (face->furthestDistance >= child->furthestDistance)
+		{
+			break;
+		}
+
+		child->heapIndex = index;
+		m_faceHeap[index] = child;
+
+		index = childIndex;
+	}
+
+	face->heapIndex = index;
+	m_faceHeap[index] = face;
 }
 
 void qhHull::AddEyeVertex(qhVertex* eye)
@@ -453,28 +704,46 @@ void qhHull::AddEyeVertex(qhVertex* eye)
 
 void qhHull::FindHorizon(qhVertex* eye)
 {
-	// Mark faces
-	for (qhFace* face = m_faceList.head; face != NULL; face = face->next)
+	// Mark the visible faces.
+	// Starting from the conflict face of the eye, only the 
+	// neighbours of visible faces need to be tested.
+	// Faces are marked invisible when they are created.
+	m_visibleFaceCount = 0;
+
+	qhFace* face0 = eye->conflictFace;
+	B3_ASSERT(b3Distance(eye->position, face0->plane) > m_tolerance);
+	face0->mark = qhFaceMark::e_visible;
+	m_visibleFaces[m_visibleFaceCount++] = face0;
+
+	for (u32 i = 0; i < m_visibleFaceCount; ++i)
 	{
-		float32 d = b3Distance(eye->position, face->plane);
-		if (d > m_tolerance)
-		{
-			face->mark = qhFaceMark::e_visible;
-		}
-		else
+		qhFace* face = m_visibleFaces[i];
+
+		qhHalfEdge* begin = face->edge;
+		qhHalfEdge* edge = begin;
+		do
 		{
-			face->mark = qhFaceMark::e_invisible;
-		}
+			qhFace* other = edge->twin->face;
+
+			if (other->mark == qhFaceMark::e_invisible)
+			{
+				float32 d = b3Distance(eye->position, other->plane);
+				if (d > m_tolerance)
+				{
+					other->mark = qhFaceMark::e_visible;
+					m_visibleFaces[m_visibleFaceCount++] = other;
+				}
+			}
+
+			edge = edge->next;
+		} while (edge != begin);
 	}
 
 	// Find the horizon 
 	m_horizonCount = 0;
-	for (qhFace* face = m_faceList.head; face != NULL; face = face->next)
+	for (u32 i = 0; i < m_visibleFaceCount; ++i)
 	{
-		if (face->mark == qhFaceMark::e_invisible)
-		{
-			continue;
-		}
+		qhFace* face = m_visibleFaces[i];
 
 		qhHalfEdge* begin = face->edge;
 		qhHalfEdge* edge = begin;
@@ -552,15 +821,9 @@ void qhHull::AddNewFaces(qhVertex* eye)
 	m_conflictCount = 0;
 
 	// Remove visible faces
-	qhFace* f = m_faceList.head;
-	while (f)
+	for (u32 i = 0; i < m_visibleFaceCount; ++i)
 	{
-		// Skip invisible faces.
-		if (f->mark == qhFaceMark::e_invisible)
-		{
-			f = f->next;
-			continue;
-		}
+		qhFace* f = m_visibleFaces[i];
 
 		qhVertex* v = f->conflictList.head;
 		while (v)
@@ -574,7 +837,7 @@ void qhHull::AddNewFaces(qhVertex* eye)
 		}
 
 		// Remove face
-		f = RemoveFace(f);
+		RemoveFace(f);
 	}
 
 	// Add new faces to the hull
@@ -588,6 +851,9 @@ void qhHull::AddNewFaces(qhVertex* eye)
 
 		m_newFaces[m_newFaceCount++] = AddFace(v1, v2, v3);
 	}
+
+	// The hull must be closed.
+	B3_ASSERT(m_freeEdgeMap.Count() == 0);
 }
 
 void qhHull::ResolveOrphans()
@@ -633,6 +899,19 @@ void qhHull::ResolveOrphans()
 			FreeVertex(v);
 		}
 	}
+
+	// Update the face heap
+	for (u32 i = 0; i < m_newFaceCount; ++i)
+	{
+		qhFace* nf = m_newFaces[i];
+
+		if (nf->active == false)
+		{
+			continue;
+		}
+
+		AddConflictFace(nf);
+	}
 }
 
 qhVertex* qhHull::AddVertex(const b3Vec3& position)
@@ -648,28 +927,19 @@ qhVertex* qhHull::AddVertex(const b3Vec3& position)
 
 qhHalfEdge* qhHull::FindHalfEdge(const qhVertex* v1, const qhVertex* v2) const
 {
-	for (qhFace* face = m_faceList.head; face != NULL; face = face->next)
-	{
-		qhHalfEdge* e = face->edge;
-		do
-		{
-			B3_ASSERT(e->active == true);
-			B3_ASSERT(e->twin != NULL);
-			B3_ASSERT(e->twin->active == true);
-
-			if (e->tail == v1 && e->twin->tail == v2)
-			{
-				return e;
-			}
+	// Only the half-edges without a face can be shared by a new face.
+	qhEdgeKey key;
+	key.v1 = v1;
+	key.v2 = v2;
 
-			if (e->tail == v2 && e->twin->tail == v1)
-			{
-				return e->twin;
-			}
-
-			e = e->next;
-		} while (e != face->edge);
+	qhHalfEdge* const* edge = m_freeEdgeMap.Find(key);
+	if (edge)
+	{
+		B3_ASSERT((*edge)->active == true);
+		B3_ASSERT((*edge)->face == NULL);
+		return *edge;
 	}
+
 	return NULL;
 }
 
@@ -820,6 +1090,7 @@ qhHalfEdge* qhHull::FixMerge(qhFace* face1, qhHalfEdge* ein)
 		}
 
 		// Remove face 3
+		RemoveConflictFace(face3);
 		m_faceList.Remove(face3);
 		FreeFace(face3);
 
@@ -940,6 +1211,7 @@ qhFace* qhHull::RemoveEdge(qhHalfEdge* edge)
 	}
 
 	// Remove face 2
+	RemoveConflictFace(face2);
 	m_faceList.Remove(face2);
 	FreeFace(face2);
 
@@ -1013,6 +1285,12 @@ qhFace* qhHull::AddFace(qhVertex* v1, qhVertex* v2, qhVertex* v3)
 		e1->twin->prev = NULL;
 		e1->twin->next = NULL;
 		e1->twin->twin = e1;
+
+		// The twin edge is free.
+		qhEdgeKey key;
+		key.v1 = v2;
+		key.v2 = v1;
+		m_freeEdgeMap.Insert(key, e1->twin);
 	}
 	else
 	{
@@ -1020,6 +1298,11 @@ qhFace* qhHull::AddFace(qhVertex* v1, qhVertex* v2, qhVertex* v3)
 		B3_ASSERT(e1->face == NULL);
 		e1->face = face;
 
+		qhEdgeKey key;
+		key.v1 = v1;
+		key.v2 = v2;
+		m_freeEdgeMap.Remove(key);
+
 		B3_ASSERT(e1->tail == v1);
 		B3_ASSERT(e1->twin != NULL);
 		B3_ASSERT(e1->twin->active == true);
@@ -1041,6 +1324,12 @@ qhFace* qhHull::AddFace(qhVertex* v1, qhVertex* v2, qhVertex* v3)
 		e2->twin->prev = NULL;
 		e2->twin->next = NULL;
 		e2->twin->twin = e2;
+
+		// The twin edge is free.
+		qhEdgeKey key;
+		key.v1 = v3;
+		key.v2 = v2;
+		m_freeEdgeMap.Insert(key, e2->twin);
 	}
 	else
 	{
@@ -1048,6 +1337,11 @@ qhFace* qhHull::AddFace(qhVertex* v1, qhVertex* v2, qhVertex* v3)
 		B3_ASSERT(e2->face == NULL);
 		e2->face = face;
 
+		qhEdgeKey key;
+		key.v1 = v2;
+		key.v2 = v3;
+		m_freeEdgeMap.Remove(key);
+
 		B3_ASSERT(e2->tail == v2);
 		B3_ASSERT(e2->twin != NULL);
 		B3_ASSERT(e2->twin->active == true);
@@ -1069,6 +1363,12 @@ qhFace* qhHull::AddFace(qhVertex* v1, qhVertex* v2, qhVertex* v3)
 		e3->twin->prev = NULL;
 		e3->twin->next = NULL;
 		e3->twin->twin = e3;
+
+		// The twin edge is free.
+		qhEdgeKey key;
+		key.v1 = v1;
+		key.v2 = v3;
+		m_freeEdgeMap.Insert(key, e3->twin);
 	}
 	else
 	{
@@ -1076,6 +1376,11 @@ qhFace* qhHull::AddFace(qhVertex* v1, qhVertex* v2, qhVertex* v3)
 		B3_ASSERT(e3->face == NULL);
 		e3->face = face;
 
+		qhEdgeKey key;
+		key.v1 = v3;
+		key.v2 = v1;
+		m_freeEdgeMap.Remove(key);
+
 		B3_ASSERT(e3->tail == v3);
 		B3_ASSERT(e3->twin != NULL);
 		B3_ASSERT(e3->twin->active == true);
@@ -1104,6 +1409,12 @@ qhFace* qhHull::AddFace(qhVertex* v1, qhVertex* v2, qhVertex* v3)
 	face->conflictList.head = NULL;
 	face->conflictList.count = 0;
 
+	face->furthestVertex = NULL;
+	face->furthestDistance = 0.0f;
+	face->heapIndex = B3_NULL_U32;
+
+	face->mark = qhFaceMark::e_invisible;
+
 	Validate(face);
 
 	m_faceList.PushFront(face);
@@ -1127,6 +1438,13 @@ qhFace* qhHull::RemoveFace(qhFace* face)
 		if (e0->twin->face == NULL)
 		{
 			// Edge is non-shared.
+			qhEdgeKey key;
+			key.v1 = e0->twin->tail;
+			key.v2 = e0->tail;
+			bool found = m_freeEdgeMap.Remove(key);
+			B3_ASSERT(found);
+			B3_NOT_USED(found);
+
 			FreeEdge(e0->twin);
 			FreeEdge(e0);
 		}
@@ -1139,11 +1457,17 @@ qhFace* qhHull::RemoveFace(qhFace* face)
 			e0->face = NULL;
 			e0->prev = NULL;
 			e0->next = NULL;
+
+			qhEdgeKey key;
+			key.v1 = e0->tail;
+			key.v2 = e0->twin->tail;
+			m_freeEdgeMap.Insert(key, e0);
 		}
 
 	} while (e != face->edge);
 
 	// Remove face 
+	RemoveConflictFace(face);
 	qhFace* nextFace = m_faceList.Remove(face);
 	FreeFace(face);
 
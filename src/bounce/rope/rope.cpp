@@ -17,95 +17,22 @@
 */
 
 #include <bounce/rope/rope.h>
-#include <bounce/rope/spatial.h>
+#include <bounce/rope/rope_body.h>
+#include <bounce/dynamics/world.h>
+#include <bounce/dynamics/world_listeners.h>
+#include <bounce/dynamics/body.h>
+#include <bounce/dynamics/shapes/sphere_shape.h>
+#include <bounce/dynamics/shapes/capsule_shape.h>
+#include <bounce/dynamics/shapes/hull_shape.h>
+#include <bounce/dynamics/shapes/mesh_shape.h>
+#include <bounce/dynamics/shapes/height_field_shape.h>
+#include <bounce/dynamics/contacts/collide/collide.h>
+#include <bounce/dynamics/contacts/manifold.h>
+#include <bounce/collision/shapes/mesh.h>
+#include <bounce/collision/shapes/height_field.h>
+#include <bounce/collision/shapes/triangle_hull.h>
 #include <bounce/common/draw.h>
 
-struct b3RopeBody
-{
-	b3RopeBody() { }
-
-	// J * v
-	b3MotionVec v_J() const
-	{
-		return m_S[0] * m_v[0] + m_S[1] * m_v[1] + m_S[2] * m_v[2];
-	}
-
-	// 
-	b3Transform X_J() const
-	{
-		// Rigid Body Dynamics Algorithms p. 86
-		// E = mat33(inv(p))
-		b3Quat E = b3Conjugate(m_p);
-
-		b3Transform X;
-		X.rotation = b3QuatMat33(E);
-		X.position.SetZero();
-		return X;
-	}
-
-	// Shared
-
-	// Body
-
-	//
-	float32 m_m, m_I;
-
-	// Joint
-
-	//
-	b3MotionVec m_S[3];
-
-	//
-	b3Transform m_X_i_J;
-
-	// 
-	b3Transform m_X_J_j;
-
-	//
-	b3Quat m_p;
-
-	//
-	b3Vec3 m_v;
-
-	// Temp
-
-	//
-	b3SpTransform m_X_i_j;
-
-	//
-	b3MotionVec m_sv;
-
-	//
-	b3MotionVec m_sc;
-
-	//
-	b3SpInertia m_I_A;
-
-	//
-	b3ForceVec m_F_A;
-
-	//
-	b3ForceVec m_U[3];
-
-	//
-	b3Mat33 m_invD;
-
-	//
-	b3Vec3 m_u;
-
-	//
-	b3Vec3 m_a;
-
-	//
-	b3MotionVec m_sa;
-
-	//
-	b3Transform m_invX;
-
-	//
-	b3Transform m_X;
-};
-
 b3Rope::b3Rope()
 {
 	m_gravity.SetZero();
@@ -113,6 +40,12 @@ b3Rope::b3Rope()
 	m_kd2 = 0.0f;
 	m_links = NULL;
 	m_count = 0;
+	m_radius = 0.0f;
+	m_friction = 0.0f;
+	m_contactFrequencyHz = 0.0f;
+	m_contactDampingRatio = 0.0f;
+	m_world = NULL;
+	m_touching = false;
 }
 
 b3Rope::~b3Rope()
@@ -127,6 +60,10 @@ void b3Rope::Initialize(const b3RopeDef& def)
 	m_gravity = def.gravity;
 	m_kd1 = def.linearDamping;
 	m_kd2 = def.angularDamping;
+	m_radius = def.radius;
+	m_friction = def.friction;
+	m_contactFrequencyHz = def.contactFrequencyHz;
+	m_contactDampingRatio = def.contactDampingRatio;
 	m_count = def.count;
 	m_links = (b3RopeBody*)b3Alloc(m_count * sizeof(b3RopeBody));
 
@@ -283,6 +220,16 @@ void b3Rope::Step(float32 h)
 		link->m_I_A.SetLocalInertia(link->m_m, I);
 		link->m_F_A = Pdot - (F + Fd);
 	}
+
+	// Apply the contact forces.
+	if (m_world && UpdateContacts(h))
+	{
+		for (u32 i = 0; i < m_count; ++i)
+		{
+			b3RopeBody* link = m_links + i;
+			link->m_F_A -= link->m_Fc;
+		}
+	}
 	
 	// Propagate up bias forces and inertias.
 	for (u32 j = m_count - 1; j >= 1; --j)
@@ -469,6 +416,340 @@ void b3Rope::Step(float32 h)
 	}
 }
 
+// The contact forces of a link against a shape.
+struct b3RopeLinkContact
+{
+	// Collide the link with a convex shape.
+	void Collide(const b3Shape* shapeB, const b3Transform& xfB)
+	{
+		const b3Shape* shapeA = linkShape;
+
+		// The link shape is in world coordinates.
+		b3Transform xfA;
+		xfA.SetIdentity();
+
+		b3ConvexCache cache;
+		cache.simplexCache.count = 0;
+		cache.featureCache.m_featurePair.state = b3SATCacheType::e_empty;
+
+		b3Manifold manifold;
+		manifold.Initialize();
+
+		// The shape types must be sorted.
+		bool flip = shapeA->GetType() > shapeB->GetType();
+		if (flip)
+		{
+			b3CollideShapeAndShape(manifold, xfB, shapeB, xfA, shapeA, &cache);
+		}
+		else
+		{
+			b3CollideShapeAndShape(manifold, xfA, shapeA, xfB, shapeB, &cache);
+		}
+
+		for (u32 i = 0; i < manifold.pointCount; ++i)
+		{
+			// Use the link radius without the speculative margin.
+			b3WorldManifoldPoint wp;
+			if (flip)
+			{
+				wp.Initialize(manifold.points + i, shapeB->m_radius, xfB, radius, xfA);
+				wp.normal = -wp.normal;
+			}
+			else
+			{
+				wp.Initialize(manifold.points + i, radius, xfA, shapeB->m_radius, xfB);
+			}
+
+			AddPoint(wp.point, wp.normal, wp.separation);
+		}
+	}
+
+	// Add the force of a contact point. 
+	// The normal points from the link to the shape.
+	void AddPoint(const b3Vec3& point, const b3Vec3& normal, float32 separation)
+	{
+		b3Vec3 r = point - x;
+		b3Vec3 dv = v + b3Cross(w, r) - body->GetPointVelocity(point);
+		float32 vn = b3Dot(dv, normal);
+
+		float32 fn;
+		if (separation < 0.0f)
+		{
+			// Spring
+			fn = -k * separation + c * vn;
+		}
+		else
+		{
+			// Speculative contact. 
+			// Remove the normal velocity that would close the gap in this step.
+			fn = m * (vn - separation * inv_h) * inv_h;
+		}
+
+		if (fn <= 0.0f)
+		{
+			return;
+		}
+
+		b3Vec3 f = -fn * normal;
+
+		// Friction
+		b3Vec3 vt = dv - vn * normal;
+		float32 vt_length = b3Length(vt);
+		if (vt_length > B3_EPSILON)
+		{
+			// Don't reverse the tangential velocity.
+			float32 ft = b3Min(friction * fn, m * vt_length * inv_h);
+			f -= (ft / vt_length) * vt;
+		}
+
+		force += f;
+		torque += b3Cross(r, f);
+		++pointCount;
+	}
+
+	// Link
+	const b3Shape* linkShape;
+	float32 radius;
+	b3Vec3 x, v, w;
+	float32 m;
+
+	// Shape
+	const b3Body* body;
+	float32 friction;
+
+	// Spring
+	float32 k, c;
+	float32 inv_h;
+
+	// Output
+	b3Vec3 force;
+	b3Vec3 torque;
+	u32 pointCount;
+};
+
+// Collide a link with the mesh triangles overlapping its AABB.
+struct b3RopeMeshQueryCallback
+{
+	bool Report(u32 proxyId)
+	{
+		u32 triangleIndex = mesh->tree.GetUserData(proxyId);
+		const b3Triangle* triangle = mesh->triangles + triangleIndex;
+
+		b3Vec3 v1 = mesh->vertices[triangle->v1];
+		b3Vec3 v2 = mesh->vertices[triangle->v2];
+		b3Vec3 v3 = mesh->vertices[triangle->v3];
+
+		b3TriangleHull hull(v1, v2, v3);
+
+		b3HullShape hullShape;
+		hullShape.m_hull = &hull;
+		hullShape.m_radius = B3_HULL_RADIUS;
+
+		contact->Collide(&hullShape, xf);
+
+		return true;
+	}
+
+	const b3Mesh* mesh;
+	b3Transform xf;
+	b3RopeLinkContact* contact;
+};
+
+// Collide a link with the height field triangles overlapping its AABB.
+struct b3RopeHeightFieldQueryCallback
+{
+	bool Report(u32 triangleIndex)
+	{
+		b3Vec3 v1, v2, v3;
+		heightField->GetTriangle(triangleIndex, v1, v2, v3);
+
+		b3TriangleHull hull(v1, v2, v3);
+
+		b3HullShape hullShape;
+		hullShape.m_hull = &hull;
+		hullShape.m_radius = B3_HULL_RADIUS;
+
+		contact->Collide(&hullShape, xf);
+
+		return true;
+	}
+
+	const b3HeightField* heightField;
+	b3Transform xf;
+	b3RopeLinkContact* contact;
+};
+
+void b3Rope::CollideShape(const b3Shape* shape, float32 h)
+{
+	if (shape->IsSensor())
+	{
+		return;
+	}
+
+	const b3Body* body = shape->GetBody();
+	b3Transform xf = body->GetTransform();
+	const b3AABB3& shapeAABB = shape->GetAABB();
+	b3ShapeType type = shape->GetType();
+
+	float32 omega = 2.0f * B3_PI * m_contactFrequencyHz;
+
+	b3RopeLinkContact contact;
+	contact.body = body;
+	contact.friction = b3Sqrt(m_friction * shape->GetFriction());
+	contact.inv_h = 1.0f / h;
+	contact.radius = m_radius;
+
+	for (u32 i = 0; i < m_count; ++i)
+	{
+		b3RopeBody* link = m_links + i;
+
+		if (link->m_m == 0.0f)
+		{
+			continue;
+		}
+
+		b3Vec3 x = link->m_X.position;
+		b3Vec3 v = link->m_X.rotation * link->m_sv.v;
+		b3Vec3 w = link->m_X.rotation * link->m_sv.w;
+
+		// The link capsule goes from the parent link to this link.
+		// The base is a sphere.
+		b3Vec3 x0 = i > 0 ? m_links[i - 1].m_X.position : x;
+		b3Vec3 v0 = v + b3Cross(w, x0 - x);
+
+		// Extend the radius by the link displacement in this step.
+		float32 margin = h * b3Sqrt(b3Max(b3LengthSquared(v), b3LengthSquared(v0)));
+		float32 radius = m_radius + margin;
+
+		b3AABB3 aabb;
+		aabb.m_lower = b3Min(x0, x);
+		aabb.m_upper = b3Max(x0, x);
+		aabb.Extend(radius);
+
+		if (b3TestOverlap(aabb, shapeAABB) == false)
+		{
+			continue;
+		}
+
+		b3SphereShape sphere;
+		sphere.m_center = x;
+		sphere.m_radius = radius;
+
+		b3CapsuleShape capsule;
+		capsule.m_centers[0] = x0;
+		capsule.m_centers[1] = x;
+		capsule.m_radius = radius;
+
+		contact.linkShape = i > 0 ? (b3Shape*)&capsule : (b3Shape*)&sphere;
+		contact.x = x;
+		contact.v = v;
+		contact.w = w;
+		contact.m = link->m_m;
+		contact.k = link->m_m * omega * omega;
+		contact.c = 2.0f * link->m_m * m_contactDampingRatio * omega;
+		contact.force.SetZero();
+		contact.torque.SetZero();
+		contact.pointCount = 0;
+
+		if (type == e_meshShape || type == e_heightFieldShape)
+		{
+			// Query the triangles in the frame of the shape.
+			b3Vec3 localX0 = b3MulT(xf, x0);
+			b3Vec3 localX = b3MulT(xf, x);
+
+			b3AABB3 localAABB;
+			localAABB.m_lower = b3Min(localX0, localX);
+			localAABB.m_upper = b3Max(localX0, localX);
+			localAABB.Extend(radius);
+
+			if (type == e_meshShape)
+			{
+				b3RopeMeshQueryCallback callback;
+				callback.mesh = ((b3MeshShape*)shape)->m_mesh;
+				callback.xf = xf;
+				callback.contact = &contact;
+				callback.mesh->tree.QueryAABB(&callback, localAABB);
+			}
+			else
+			{
+				b3RopeHeightFieldQueryCallback callback;
+				callback.heightField = ((b3HeightFieldShape*)shape)->m_heightField;
+				callback.xf = xf;
+				callback.contact = &contact;
+				callback.heightField->QueryAABB(&callback, localAABB);
+			}
+		}
+		else
+		{
+			contact.Collide(shape, xf);
+		}
+
+		if (contact.pointCount == 0)
+		{
+			continue;
+		}
+
+		// Share the contact spring between the points so that 
+		// the stiffness doesn't depend on the number of points.
+		float32 s = 1.0f / float32(contact.pointCount);
+
+		link->m_Fc.n += s * b3MulT(link->m_X.rotation, contact.force);
+		link->m_Fc.f += s * b3MulT(link->m_X.rotation, contact.torque);
+
+		m_touching = true;
+	}
+}
+
+struct b3RopeQueryListener : public b3QueryListener
+{
+	bool ReportShape(b3Shape* shape)
+	{
+		rope->CollideShape(shape, h);
+		return true;
+	}
+
+	b3Rope* rope;
+	float32 h;
+};
+
+bool b3Rope::UpdateContacts(float32 h)
+{
+	B3_ASSERT(m_world);
+
+	// Compute an AABB containing the links at the beginning and at the end of the step.
+	b3Vec3 lower = m_links->m_X.position;
+	b3Vec3 upper = m_links->m_X.position;
+
+	for (u32 i = 0; i < m_count; ++i)
+	{
+		b3RopeBody* link = m_links + i;
+
+		link->m_Fc.SetZero();
+
+		b3Vec3 x1 = link->m_X.position;
+		b3Vec3 x2 = x1 + h * (link->m_X.rotation * link->m_sv.v);
+
+		lower = b3Min(lower, b3Min(x1, x2));
+		upper = b3Max(upper, b3Max(x1, x2));
+	}
+
+	b3AABB3 aabb;
+	aabb.m_lower = lower;
+	aabb.m_upper = upper;
+	aabb.Extend(m_radius);
+
+	// Query the world once for all links.
+	m_touching = false;
+
+	b3RopeQueryListener listener;
+	listener.rope = this;
+	listener.h = h;
+
+	m_world->QueryAABB(&listener, aabb);
+
+	return m_touching;
+}
+
 void b3Rope::Draw() const
 {
 	if (m_count == 0)
@@ -480,7 +761,7 @@ void b3Rope::Draw() const
 		b3RopeBody* b = m_links;
 		
 		b3Draw_draw->DrawTransform(b->m_X);
-		b3Draw_draw->DrawSolidSphere(b->m_X.position, 0.2f, b->m_X.rotation, b3Color_green);
+		b3Draw_draw->DrawSolidSphere(b->m_X.position, m_radius, b->m_X.rotation, b3Color_green);
 	}
 
 	for (u32 i = 1; i < m_count; ++i)
@@ -498,6 +779,6 @@ void b3Rope::Draw() const
 		b3Draw_draw->DrawPoint(X_J0.position, 5.0f, b3Color_red);
 
 		b3Draw_draw->DrawTransform(b->m_X);
-		b3Draw_draw->DrawSolidSphere(b->m_X.position, 0.2f, b->m_X.rotation, b3Color_green);
+		b3Draw_draw->DrawSolidSphere(b->m_X.position, m_radius, b->m_X.rotation, b3Color_green);
 	}
 }
\ No newline at end of file
@@ -0,0 +1,777 @@
+/*
+* Copyright (c) 2016-2019 Irlan Robson https://irlanrobson.github.io
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+#include <bounce/rope/rope_group.h>
+#include <bounce/rope/rope.h>
+#include <bounce/rope/rope_body.h>
+#include <bounce/rope/spatial_lanes.h>
+#include <bounce/common/thread_pool.h>
+
+// The number of lane groups stepped by a task.
+const u32 b3_ropeTaskSize = 4;
+
+// A set of up to b3_spatialLaneCount ropes stepped together.
+// The ropes are sorted by decreasing link count.
+// The link count of the lane group is the one of the first rope.
+struct b3RopeLaneGroup
+{
+	b3Rope* ropes[b3_spatialLaneCount];
+	u32 ropeCount;
+	u32 linkCount;
+
+	// Index of the first link in the constant link data
+	u32 firstLink;
+};
+
+// The constant data of a link of a lane group.
+// A lane without a link at this index holds a padding link.
+// The padding link is a copy of the last link of the lane.
+struct b3RopeLaneLink
+{
+	b3LaneFloat m, I;
+	b3LaneMotionVec S[3];
+	b3LaneTransform X_i_J;
+	b3LaneTransform X_J_j;
+
+	// One for a rope link, zero for a padding link.
+	// This removes the padding links from the parent inertias and forces.
+	b3LaneFloat weight;
+};
+
+// The solver state of a link of a lane group. See b3RopeBody.
+struct b3RopeLaneLinkState
+{
+	b3LaneQuat p;
+	b3LaneVec3 v;
+	b3LaneSpTransform X_i_j;
+	b3LaneMotionVec sv;
+	b3LaneMotionVec sc;
+	b3LaneSpInertia I_A;
+	b3LaneForceVec F_A;
+	b3LaneForceVec U[3];
+	b3LaneMat33 invD;
+	b3LaneVec3 u;
+	b3LaneVec3 a;
+	b3LaneMotionVec sa;
+	b3LaneTransform invX;
+};
+
+b3RopeGroup::b3RopeGroup()
+{
+	m_ropeCapacity = 16;
+	m_ropes = (b3Rope**)b3Alloc(m_ropeCapacity * sizeof(b3Rope*));
+	m_ropeCount = 0;
+	m_laneGroupsDirty = false;
+	m_laneGroups = nullptr;
+	m_laneGroupCount = 0;
+	m_laneLinks = nullptr;
+	m_maxLinkCount = 0;
+	m_laneStates = nullptr;
+	m_laneStateCapacity = 0;
+	m_threadPool = nullptr;
+}
+
+b3RopeGroup::~b3RopeGroup()
+{
+	b3Free(m_ropes);
+	b3Free(m_laneGroups);
+	b3Free(m_laneLinks);
+	b3Free(m_laneStates);
+}
+
+void b3RopeGroup::AddRope(b3Rope* rope)
+{
+	if (m_ropeCount == m_ropeCapacity)
+	{
+		b3Rope** oldRopes = m_ropes;
+		m_ropeCapacity *= 2;
+		m_ropes = (b3Rope**)b3Alloc(m_ropeCapacity * sizeof(b3Rope*));
+		memcpy(m_ropes, oldRopes, m_ropeCount * sizeof(b3Rope*));
+		b3Free(oldRopes);
+	}
+
+	m_ropes[m_ropeCount++] = rope;
+	m_laneGroupsDirty = true;
+}
+
+void b3RopeGroup::RemoveRope(b3Rope* rope)
+{
+	for (u32 i = 0; i < m_ropeCount; ++i)
+	{
+		if (m_ropes[i] == rope)
+		{
+			m_ropes[i] = m_ropes[m_ropeCount - 1];
+			--m_ropeCount;
+			m_laneGroupsDirty = true;
+			return;
+		}
+	}
+
+	B3_ASSERT(false);
+}
+
+void b3RopeGroup::BuildLaneGroups()
+{
+	b3Free(m_laneGroups);
+	b3Free(m_laneLinks);
+	m_laneGroups = nullptr;
+	m_laneLinks = nullptr;
+	m_laneGroupCount = 0;
+	m_maxLinkCount = 0;
+
+	// A rope with a single link is stepped alone.
+	b3Rope** ropes = (b3Rope**)b3Alloc(m_ropeCount * sizeof(b3Rope*));
+	u32 ropeCount = 0;
+
+	for (u32 i = 0; i < m_ropeCount; ++i)
+	{
+		if (m_ropes[i]->m_count < 2)
+		{
+			continue;
+		}
+
+		// Insertion sort by decreasing link count
+		b3Rope* rope = m_ropes[i];
+		u32 j = ropeCount;
+		while (j > 0 && ropes[j - 1]->m_count < rope->m_count)
+		{
+			ropes[j] = ropes[j - 1];
+			--j;
+		}
+		ropes[j] = rope;
+		++ropeCount;
+	}
+
+	m_laneGroupCount = (ropeCount + b3_spatialLaneCount - 1) / b3_spatialLaneCount;
+	m_laneGroups = (b3RopeLaneGroup*)b3Alloc(m_laneGroupCount * sizeof(b3RopeLaneGroup));
+
+	u32 laneLinkCount = 0;
+	for (u32 i = 0; i < m_laneGroupCount; ++i)
+	{
+		b3RopeLaneGroup* group = m_laneGroups + i;
+
+		u32 first = i * b3_spatialLaneCount;
+		group->ropeCount = b3Min(b3_spatialLaneCount, ropeCount - first);
+		for (u32 k = 0; k < group->ropeCount; ++k)
+		{
+			group->ropes[k] = ropes[first + k];
+		}
+		group->linkCount = group->ropes[0]->m_count;
+		group->firstLink = laneLinkCount;
+
+		laneLinkCount += group->linkCount;
+		m_maxLinkCount = b3Max(m_maxLinkCount, group->linkCount);
+	}
+
+	b3Free(ropes);
+
+	m_laneLinks = (b3RopeLaneLink*)b3Alloc(laneLinkCount * sizeof(b3RopeLaneLink));
+
+	for (u32 i = 0; i < m_laneGroupCount; ++i)
+	{
+		b3RopeLaneGroup* group = m_laneGroups + i;
+
+		for (u32 k = 0; k < b3_spatialLaneCount; ++k)
+		{
+			// An empty lane steps a copy of the first rope.
+			bool empty = k >= group->ropeCount;
+			b3Rope* rope = empty ? group->ropes[0] : group->ropes[k];
+
+			for (u32 j = 0; j < group->linkCount; ++j)
+			{
+				b3RopeLaneLink* link = m_laneLinks + group->firstLink + j;
+
+				bool padding = j >= rope->m_count;
+				b3RopeBody* b = rope->m_links + (padding ? rope->m_count - 1 : j);
+
+				link->m.v[k] = b->m_m;
+				link->I.v[k] = b->m_I;
+				link->weight.v[k] = empty || padding ? 0.0f : 1.0f;
+
+				if (j == 0)
+				{
+					continue;
+				}
+
+				for (u32 l = 0; l < 3; ++l)
+				{
+					link->S[l].w.Set(k, b->m_S[l].w);
+					link->S[l].v.Set(k, b->m_S[l].v);
+				}
+
+				link->X_i_J.Set(k, b->m_X_i_J);
+				link->X_J_j.Set(k, b->m_X_J_j);
+			}
+		}
+	}
+
+	m_laneGroupsDirty = false;
+}
+
+// Joint transform. See b3RopeBody::X_J.
+static B3_FORCE_INLINE b3LaneTransform b3JointTransform(const b3LaneQuat& p)
+{
+	b3LaneQuat E = b3Conjugate(p);
+
+	b3LaneTransform X;
+	X.rotation = b3QuatMat33(E);
+	X.position.SetZero();
+	return X;
+}
+
+// The state of the base links of a lane group.
+struct b3RopeLaneBase
+{
+	b3LaneVec3 gravity;
+	b3LaneFloat kd1, kd2;
+	b3LaneVec3 v, w, p;
+	b3LaneQuat q;
+	b3LaneTransform X;
+};
+
+// The passes below are b3Rope::Step running on all the lanes at once.
+// They are separate functions so that the compiler inlines the lane operations in each one.
+
+// Propagate down velocities, bias forces and inertias.
+static void b3PropagateVelocities(b3RopeLaneBase* base, const b3RopeLaneLink* links, b3RopeLaneLinkState* states, u32 count)
+{
+	{
+		const b3RopeLaneLink* b = links;
+		b3RopeLaneLinkState* bs = states;
+		b3LaneMat33 I = b3Diagonal(b->I);
+
+		bs->invX = b3Inverse(base->X);
+
+		// Convert global velocity to local velocity.
+		bs->sv.w = bs->invX.rotation * base->w;
+		bs->sv.v = bs->invX.rotation * base->v;
+
+		// Uniform inertia results in zero angular momentum.
+		b3LaneForceVec Pdot;
+		Pdot.n = b3Cross(bs->sv.w, b->m * bs->sv.v);
+		Pdot.f.SetZero();
+
+		// Convert global force to local force.
+		b3LaneForceVec F;
+		F.n = bs->invX.rotation * base->gravity;
+		F.f.SetZero();
+
+		// Damping force
+		b3LaneForceVec Fd;
+		Fd.n = (-base->kd1 * b->m) * bs->sv.v;
+		Fd.f = (-base->kd2 * b->I) * bs->sv.w;
+
+		// The inertia and force of a base without mass are never used.
+		bs->I_A.SetLocalInertia(b->m, I);
+		bs->F_A = Pdot - (F + Fd);
+	}
+
+	for (u32 i = 1; i < count; ++i)
+	{
+		const b3RopeLaneLink* link = links + i;
+		b3RopeLaneLinkState* state = states + i;
+		b3RopeLaneLinkState* parent = state - 1;
+		b3LaneMat33 I = b3Diagonal(link->I);
+
+		b3LaneTransform X_J = b3JointTransform(state->p);
+		b3LaneTransform X_i_j = link->X_J_j * X_J * link->X_i_J;
+
+		state->invX = X_i_j * parent->invX;
+
+		state->X_i_j.E = X_i_j.rotation;
+		state->X_i_j.r = -X_i_j.position;
+
+		b3LaneMotionVec joint_v = link->S[0] * state->v.x + link->S[1] * state->v.y + link->S[2] * state->v.z;
+
+		b3LaneMotionVec parent_v = b3Mul(state->X_i_j, parent->sv);
+
+		state->sv = parent_v + joint_v;
+
+		// v x jv
+		state->sc.w = b3Cross(state->sv.w, joint_v.w);
+		state->sc.v = b3Cross(state->sv.v, joint_v.w) + b3Cross(state->sv.w, joint_v.v);
+
+		// Uniform inertia results in zero angular momentum.
+		b3LaneForceVec Pdot;
+		Pdot.n = b3Cross(state->sv.w, link->m * state->sv.v);
+		Pdot.f.SetZero();
+
+		// Damping force
+		b3LaneForceVec Fd;
+		Fd.n = (-base->kd1 * link->m) * state->sv.v;
+		Fd.f = (-base->kd2 * link->I) * state->sv.w;
+
+		// Convert global force to local force.
+		b3LaneForceVec F;
+		F.n = state->invX.rotation * base->gravity;
+		F.f.SetZero();
+
+		state->I_A.SetLocalInertia(link->m, I);
+		state->F_A = Pdot - (F + Fd);
+	}
+}
+
+// Propagate up bias forces and inertias.
+static void b3PropagateInertias(const b3RopeLaneLink* links, b3RopeLaneLinkState* states, u32 count)
+{
+	for (u32 j = count - 1; j >= 1; --j)
+	{
+		const b3RopeLaneLink* link = links + j;
+		b3RopeLaneLinkState* state = states + j;
+		b3RopeLaneLinkState* parent = state - 1;
+		const b3LaneMotionVec* S = link->S;
+		const b3LaneMotionVec& c = state->sc;
+
+		const b3LaneSpInertia& I_A = state->I_A;
+		const b3LaneForceVec& F_A = state->F_A;
+
+		b3LaneForceVec* U = state->U;
+		b3LaneVec3& u = state->u;
+
+		// U
+		U[0] = I_A * S[0];
+		U[1] = I_A * S[1];
+		U[2] = I_A * S[2];
+
+		// D = S^T * U
+		b3LaneMat33 D;
+
+		D.x.x = b3Dot(S[0], U[0]);
+		D.x.y = b3Dot(S[1], U[0]);
+		D.x.z = b3Dot(S[2], U[0]);
+
+		D.y.x = D.x.y;
+		D.y.y = b3Dot(S[1], U[1]);
+		D.y.z = b3Dot(S[2], U[1]);
+
+		D.z.x = D.x.z;
+		D.z.y = D.y.z;
+		D.z.z = b3Dot(S[2], U[2]);
+
+		// D^-1
+		b3LaneMat33 invD = b3SymInverse(D);
+		state->invD = invD;
+
+		// U * D^-1
+		b3LaneForceVec U_invD[3];
+		U_invD[0] = invD.x.x * U[0] + invD.x.y * U[1] + invD.x.z * U[2];
+		U_invD[1] = invD.y.x * U[0] + invD.y.y * U[1] + invD.y.z * U[2];
+		U_invD[2] = invD.z.x * U[0] + invD.z.y * U[1] + invD.z.z * U[2];
+
+		// I_a = I_A - U * D^-1 * U^T
+		b3LaneSpInertia M1 = b3Outer(U[0], U_invD[0]);
+		b3LaneSpInertia M2 = b3Outer(U[1], U_invD[1]);
+		b3LaneSpInertia M3 = b3Outer(U[2], U_invD[2]);
+
+		b3LaneSpInertia I_a = I_A;
+		I_a -= M1;
+		I_a -= M2;
+		I_a -= M3;
+
+		// u = tau - S^T * F_A
+		u.x = -b3Dot(S[0], F_A);
+		u.y = -b3Dot(S[1], F_A);
+		u.z = -b3Dot(S[2], F_A);
+
+		// U * D^-1 * u
+		b3LaneForceVec U_invD_u = U_invD[0] * u.x + U_invD[1] * u.y + U_invD[2] * u.z;
+
+		// F_a = F_A + I_a * c + U * D^-1 * u
+		b3LaneForceVec F_a = F_A + I_a * c + U_invD_u;
+
+		b3LaneSpInertia I_a_i = b3MulT(state->X_i_j, I_a);
+		b3LaneForceVec F_a_i = b3MulT(state->X_i_j, F_a);
+
+		parent->I_A += link->weight * I_a_i;
+		parent->F_A += link->weight * F_a_i;
+	}
+}
+
+// Propagate down accelerations.
+static void b3PropagateAccelerations(const b3RopeLaneLink* links, b3RopeLaneLinkState* states, u32 count)
+{
+	{
+		const b3RopeLaneLink* b = links;
+		b3RopeLaneLinkState* bs = states;
+
+		// a = I^-1 * F
+		bs->sa = bs->I_A.Solve(-bs->F_A);
+
+		// A base without mass doesn't move.
+		for (u32 k = 0; k < b3_spatialLaneCount; ++k)
+		{
+			if (b->m.v[k] == 0.0f)
+			{
+				bs->sa.w.Set(k, b3Vec3_zero);
+				bs->sa.v.Set(k, b3Vec3_zero);
+			}
+		}
+	}
+
+	for (u32 j = 1; j < count; ++j)
+	{
+		const b3RopeLaneLink* link = links + j;
+		b3RopeLaneLinkState* state = states + j;
+		b3RopeLaneLinkState* parent = state - 1;
+		const b3LaneMotionVec* S = link->S;
+		const b3LaneMotionVec& c = state->sc;
+		const b3LaneForceVec* U = state->U;
+		const b3LaneVec3& u = state->u;
+
+		b3LaneMotionVec parent_a = b3Mul(state->X_i_j, parent->sa);
+		b3LaneMotionVec a = parent_a + c;
+
+		// u - U^T * a
+		b3LaneVec3 b;
+		b.x = u.x - b3Dot(a, U[0]);
+		b.y = u.y - b3Dot(a, U[1]);
+		b.z = u.z - b3Dot(a, U[2]);
+
+		// D^-1 * b
+		state->a = state->invD * b;
+
+		b3LaneMotionVec joint_a = S[0] * state->a.x + S[1] * state->a.y + S[2] * state->a.z;
+
+		state->sa = a + joint_a;
+	}
+}
+
+// Integrate the base and the joints and propagate down transforms.
+static void b3Integrate(b3RopeLaneBase* base, const b3RopeLaneLink* links, b3RopeLaneLinkState* states, u32 count, float32 h)
+{
+	b3LaneFloat zero(0.0f);
+
+	float32 max_w = 8.0f * 2.0f * B3_PI;
+	b3LaneVec3 min(-max_w, -max_w, -max_w);
+	b3LaneVec3 max(max_w, max_w, max_w);
+
+	b3LaneFloat half(0.5f);
+	b3LaneFloat hs(h);
+
+	{
+		b3RopeLaneLinkState* bs = states;
+
+		// Convert local to global acceleration
+		b3LaneVec3 v_dot = b3Mul(base->q, bs->sa.v);
+		b3LaneVec3 w_dot = b3Mul(base->q, bs->sa.w);
+
+		// Integrate acceleration
+		base->v += hs * v_dot;
+		base->w += hs * w_dot;
+
+		// Integrate velocity
+		base->p += hs * base->v;
+
+		b3LaneQuat q_w(base->w.x, base->w.y, base->w.z, zero);
+		b3LaneQuat q_dot = half * q_w * base->q;
+		base->q += hs * q_dot;
+		base->q.Normalize();
+	}
+
+	for (u32 i = 1; i < count; ++i)
+	{
+		b3RopeLaneLinkState* state = states + i;
+
+		// Integrate acceleration
+		state->v += hs * state->a;
+
+		// Avoid numerical instability due to large velocities
+		state->v = b3Max(min, b3Min(state->v, max));
+
+		// Integrate velocity
+		b3LaneQuat q_w(state->v.x, state->v.y, state->v.z, zero);
+		b3LaneQuat q_dot = half * state->p * q_w;
+
+		state->p += hs * q_dot;
+		state->p.Normalize();
+	}
+
+	// Propagate down transforms
+	base->X.rotation = b3QuatMat33(base->q);
+	base->X.position = base->p;
+	states->invX = b3Inverse(base->X);
+
+	for (u32 j = 1; j < count; ++j)
+	{
+		const b3RopeLaneLink* link = links + j;
+		b3RopeLaneLinkState* state = states + j;
+		b3RopeLaneLinkState* parent = state - 1;
+
+		b3LaneTransform X_J = b3JointTransform(state->p);
+		b3LaneTransform X_i_j = link->X_J_j * X_J * link->X_i_J;
+
+		state->invX = X_i_j * parent->invX;
+	}
+}
+
+void b3RopeGroup::GatherLaneGroup(b3RopeLaneBase* base, b3RopeLaneLinkState* states, const b3RopeLaneGroup* group)
+{
+	u32 count = group->linkCount;
+
+	for (u32 k = 0; k < b3_spatialLaneCount; ++k)
+	{
+		const b3Rope* rope = group->ropes[k < group->ropeCount ? k : 0];
+
+		base->gravity.Set(k, rope->m_gravity);
+		base->kd1.v[k] = rope->m_kd1;
+		base->kd2.v[k] = rope->m_kd2;
+		base->v.Set(k, rope->m_v);
+		base->w.Set(k, rope->m_w);
+		base->p.Set(k, rope->m_p);
+		base->q.Set(k, rope->m_q);
+		base->X.Set(k, rope->m_links[0].m_X);
+
+		for (u32 j = 1; j < count; ++j)
+		{
+			b3RopeLaneLinkState* state = states + j;
+
+			if (j < rope->m_count)
+			{
+				state->p.Set(k, rope->m_links[j].m_p);
+				state->v.Set(k, rope->m_links[j].m_v);
+			}
+			else
+			{
+				state->p.Set(k, b3Quat_identity);
+				state->v.Set(k, b3Vec3_zero);
+			}
+		}
+	}
+}
+
+void b3RopeGroup::ComputeContactVelocities(const b3RopeLaneGroup* group, const b3RopeLaneLink* links, b3RopeLaneLinkState* states)
+{
+	bool hasWorld = false;
+	for (u32 k = 0; k < group->ropeCount; ++k)
+	{
+		hasWorld = hasWorld || group->ropes[k]->m_world != NULL;
+	}
+
+	if (hasWorld == false)
+	{
+		return;
+	}
+
+	u32 count = group->linkCount;
+
+	b3RopeLaneBase base;
+	GatherLaneGroup(&base, states, group);
+	b3PropagateVelocities(&base, links, states, count);
+
+	for (u32 k = 0; k < group->ropeCount; ++k)
+	{
+		b3Rope* rope = group->ropes[k];
+
+		if (rope->m_world == NULL)
+		{
+			continue;
+		}
+
+		// The contacts need the link velocities of this step.
+		for (u32 j = 0; j < rope->m_count; ++j)
+		{
+			b3RopeBody* b = rope->m_links + j;
+			b->m_sv.w = states[j].sv.w.Get(k);
+			b->m_sv.v = states[j].sv.v.Get(k);
+		}
+	}
+}
+
+void b3RopeGroup::StepLaneGroup(const b3RopeLaneGroup* group, const b3RopeLaneLink* links, b3RopeLaneLinkState* states, float32 h)
+{
+	u32 count = group->linkCount;
+
+	b3RopeLaneBase baseState;
+	b3RopeLaneBase* base = &baseState;
+
+	GatherLaneGroup(base, states, group);
+
+	b3PropagateVelocities(base, links, states, count);
+
+	// Apply the contact forces. See b3Rope::Step.
+	// These were computed before the lane groups were stepped.
+	for (u32 k = 0; k < group->ropeCount; ++k)
+	{
+		b3Rope* rope = group->ropes[k];
+
+		if (rope->m_world == NULL || rope->m_touching == false)
+		{
+			continue;
+		}
+
+		for (u32 j = 0; j < rope->m_count; ++j)
+		{
+			b3RopeLaneLinkState* state = states + j;
+			const b3RopeBody* b = rope->m_links + j;
+
+			state->F_A.n.Set(k, state->F_A.n.Get(k) - b->m_Fc.n);
+			state->F_A.f.Set(k, state->F_A.f.Get(k) - b->m_Fc.f);
+		}
+	}
+
+	b3PropagateInertias(links, states, count);
+	b3PropagateAccelerations(links, states, count);
+	b3Integrate(base, links, states, count, h);
+
+	// Scatter the rope states
+	for (u32 k = 0; k < group->ropeCount; ++k)
+	{
+		b3Rope* rope = group->ropes[k];
+
+		rope->m_v = base->v.Get(k);
+		rope->m_w = base->w.Get(k);
+		rope->m_p = base->p.Get(k);
+		rope->m_q = base->q.Get(k);
+
+		rope->m_links[0].m_X = base->X.Get(k);
+		rope->m_links[0].m_invX = states[0].invX.Get(k);
+
+		for (u32 j = 1; j < rope->m_count; ++j)
+		{
+			b3RopeBody* b = rope->m_links + j;
+			const b3RopeLaneLinkState* state = states + j;
+
+			b->m_p = state->p.Get(k);
+			b->m_v = state->v.Get(k);
+			b->m_invX = state->invX.Get(k);
+			b->m_X = b3Inverse(b->m_invX);
+		}
+	}
+}
+
+// A task stepping b3_ropeTaskSize lane groups.
+struct b3RopeGroupTask
+{
+	void Execute(u32 index, u32 threadIndex)
+	{
+		b3RopeLaneLinkState* threadStates = states + threadIndex * maxLinkCount;
+
+		u32 begin = index * b3_ropeTaskSize;
+		u32 end = b3Min(begin + b3_ropeTaskSize, laneGroupCount);
+
+		for (u32 i = begin; i < end; ++i)
+		{
+			const b3RopeLaneGroup* group = laneGroups + i;
+
+			if (contactVelocities)
+			{
+				b3RopeGroup::ComputeContactVelocities(group, links + group->firstLink, threadStates);
+			}
+			else
+			{
+				b3RopeGroup::StepLaneGroup(group, links + group->firstLink, threadStates, h);
+			}
+		}
+	}
+
+	// Only compute the link velocities used by the contacts?
+	bool contactVelocities;
+	const b3RopeLaneGroup* laneGroups;
+	u32 laneGroupCount;
+	const b3RopeLaneLink* links;
+	b3RopeLaneLinkState* states;
+	u32 maxLinkCount;
+	float32 h;
+};
+
+void b3RopeGroup::Step(float32 dt)
+{
+	if (m_laneGroupsDirty)
+	{
+		BuildLaneGroups();
+	}
+
+	// The ropes with a single link aren't in the lane groups.
+	for (u32 i = 0; i < m_ropeCount; ++i)
+	{
+		if (m_ropes[i]->m_count < 2)
+		{
+			m_ropes[i]->Step(dt);
+		}
+	}
+
+	if (m_laneGroupCount == 0)
+	{
+		return;
+	}
+
+	u32 threadCount = m_threadPool ? m_threadPool->GetThreadCount() : 1;
+
+	u32 stateCount = threadCount * m_maxLinkCount;
+	if (stateCount > m_laneStateCapacity)
+	{
+		b3Free(m_laneStates);
+		m_laneStateCapacity = stateCount;
+		m_laneStates = (b3RopeLaneLinkState*)b3Alloc(m_laneStateCapacity * sizeof(b3RopeLaneLinkState));
+	}
+
+	b3RopeGroupTask task;
+	task.contactVelocities = false;
+	task.laneGroups = m_laneGroups;
+	task.laneGroupCount = m_laneGroupCount;
+	task.links = m_laneLinks;
+	task.states = m_laneStates;
+	task.maxLinkCount = m_maxLinkCount;
+	task.h = dt;
+
+	u32 taskCount = (m_laneGroupCount + b3_ropeTaskSize - 1) / b3_ropeTaskSize;
+
+	// The world queries aren't thread-safe. 
+	// Therefore the contact forces are computed on this thread before the lane groups are stepped.
+	// They need the link velocities of this step, which are computed by the lane groups.
+	bool hasWorld = false;
+	for (u32 i = 0; i < m_ropeCount; ++i)
+	{
+		hasWorld = hasWorld || (m_ropes[i]->m_count > 1 && m_ropes[i]->m_world != NULL);
+	}
+
+	if (hasWorld)
+	{
+		task.contactVelocities = true;
+		RunTask(&task, taskCount);
+		task.contactVelocities = false;
+
+		for (u32 i = 0; i < m_ropeCount; ++i)
+		{
+			b3Rope* rope = m_ropes[i];
+
+			if (rope->m_count > 1 && rope->m_world != NULL)
+			{
+				rope->UpdateContacts(dt);
+			}
+		}
+	}
+
+	RunTask(&task, taskCount);
+}
+
+void b3RopeGroup::RunTask(b3RopeGroupTask* task, u32 taskCount)
+{
+	if (m_threadPool && taskCount > 1)
+	{
+		m_threadPool->Run(task, taskCount);
+	}
+	else
+	{
+		for (u32 i = 0; i < taskCount; ++i)
+		{
+			task->Execute(i, 0);
+		}
+	}
+}
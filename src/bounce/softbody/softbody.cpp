@@ -20,7 +20,12 @@
 #include <bounce/softbody/softbody_mesh.h>
 #include <bounce/softbody/softbody_node.h>
 #include <bounce/softbody/softbody_solver.h>
+#include <bounce/sparse/vertex_ordering.h>
 #include <bounce/collision/collision.h>
+#include <bounce/dynamics/world.h>
+#include <bounce/dynamics/world_listeners.h>
+#include <bounce/dynamics/shapes/shape.h>
+#include <bounce/dynamics/body.h>
 #include <bounce/common/draw.h>
 
 // C = A * B
@@ -443,16 +448,60 @@ static B3_FORCE_INLINE void b3SetK(b3Mat33 K[16], float32 Ke[144])
 	k44.z.z = Ke[11 + 12 * 11];
 }
 
+// Return the smallest vertex of a triangle.
+static B3_FORCE_INLINE u32 b3GetMinVertex(const b3SoftBodyTriangle* t)
+{
+	return b3Min(t->v1, b3Min(t->v2, t->v3));
+}
+
+// Return true if two triangles have the same vertices.
+static B3_FORCE_INLINE bool b3AreTrianglesEqual(const b3SoftBodyTriangle* t1, const b3SoftBodyTriangle* t2)
+{
+	u32 vs[3] = { t2->v1, t2->v2, t2->v3 };
+	for (u32 i = 0; i < 3; ++i)
+	{
+		if (t1->v1 != vs[i] && t1->v2 != vs[i] && t1->v3 != vs[i])
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
 b3SoftBody::b3SoftBody(const b3SoftBodyDef& def)
 {
-	B3_ASSERT(def.mesh);
-	B3_ASSERT(def.density > 0.0f);
+	B3_ASSERT(def.mesh || def.cache);
+
+	m_mesh = def.cache ? &def.cache->mesh : def.mesh;
+	m_orderedMesh.vertexCount = 0;
+	m_orderedMesh.vertices = nullptr;
+	m_orderedMesh.tetrahedronCount = 0;
+	m_orderedMesh.tetrahedrons = nullptr;
+	m_vertexIndices = nullptr;
+	m_originalVertices = nullptr;
+	m_tetrahedronIndices = nullptr;
+	m_originalTetrahedrons = nullptr;
+
+	if (def.reorderMesh && def.cache == nullptr)
+	{
+		ReorderMesh(def.mesh);
+		m_mesh = &m_orderedMesh;
+	}
 
-	m_mesh = def.mesh;
-	m_density = def.density;
+	m_density = def.cache ? def.cache->density : def.density;
+	B3_ASSERT(m_density > 0.0f);
 	m_gravity.SetZero();
 	m_world = nullptr;
 	m_contactManager.m_body = this;
+	m_contactManager.m_broadPhase.SetRefitEnabled(def.refitBroadPhase);
+	m_solverWorkspace.preconditioner = def.preconditioner;
+	m_matrixFree = def.matrixFree;
+	m_nodeElementOffsets = nullptr;
+	m_nodeElements = nullptr;
+	m_allowSleep = def.allowSleep;
+	m_awake = true;
+	m_sleepTime = 0.0f;
+	m_timeToSleep = def.timeToSleep;
 
 	const b3SoftBodyMesh* m = m_mesh;
 
@@ -460,7 +509,7 @@ b3SoftBody::b3SoftBody(const b3SoftBodyDef& def)
 	m_nodes = (b3SoftBodyNode*)b3Alloc(m->vertexCount * sizeof(b3SoftBodyNode));
 	for (u32 i = 0; i < m->vertexCount; ++i)
 	{
-		b3SoftBodyNode* n = m_nodes + i;
+		b3SoftBodyNode* n = new (m_nodes + i) b3SoftBodyNode();
 
 		n->m_body = this;
 		n->m_type = e_dynamicSoftBodyNode;
@@ -482,10 +531,268 @@ b3SoftBody::b3SoftBody(const b3SoftBodyDef& def)
 	}
 
 	// Compute mass
-	ComputeMass();
+	if (def.cache)
+	{
+		for (u32 i = 0; i < m->vertexCount; ++i)
+		{
+			b3SoftBodyNode* n = m_nodes + i;
+			n->m_mass = def.cache->masses[i];
+			B3_ASSERT(n->m_mass > 0.0f);
+			n->m_invMass = 1.0f / n->m_mass;
+		}
+	}
+	else
+	{
+		ComputeMass();
+	}
 
 	// Initialize elements
 	m_elements = (b3SoftBodyElement*)b3Alloc(m->tetrahedronCount * sizeof(b3SoftBodyElement));
+	m_elementStiffness = (b3Mat33*)b3Alloc(b3_elementBlockCount * m->tetrahedronCount * sizeof(b3Mat33));
+	m_elementInvE = (b3Mat33*)b3Alloc(m->tetrahedronCount * sizeof(b3Mat33));
+	m_elementRotations = (b3Quat*)b3Alloc(m->tetrahedronCount * sizeof(b3Quat));
+
+	if (def.cache)
+	{
+		CopyElements(def.cache);
+	}
+	else
+	{
+		ComputeElements(def);
+	}
+
+	if (m_matrixFree)
+	{
+		// Build the node incidences.
+		m_nodeElementOffsets = (u32*)b3Alloc((m->vertexCount + 1) * sizeof(u32));
+		m_nodeElements = (u32*)b3Alloc(4 * m->tetrahedronCount * sizeof(u32));
+
+		for (u32 i = 0; i <= m->vertexCount; ++i)
+		{
+			m_nodeElementOffsets[i] = 0;
+		}
+
+		for (u32 ei = 0; ei < m->tetrahedronCount; ++ei)
+		{
+			b3SoftBodyMeshTetrahedron* mt = m->tetrahedrons + ei;
+
+			++m_nodeElementOffsets[mt->v1 + 1];
+			++m_nodeElementOffsets[mt->v2 + 1];
+			++m_nodeElementOffsets[mt->v3 + 1];
+			++m_nodeElementOffsets[mt->v4 + 1];
+		}
+
+		for (u32 i = 0; i < m->vertexCount; ++i)
+		{
+			m_nodeElementOffsets[i + 1] += m_nodeElementOffsets[i];
+		}
+
+		u32* next = (u32*)m_stackAllocator.Allocate(m->vertexCount * sizeof(u32));
+		memcpy(next, m_nodeElementOffsets, m->vertexCount * sizeof(u32));
+
+		for (u32 ei = 0; ei < m->tetrahedronCount; ++ei)
+		{
+			b3SoftBodyMeshTetrahedron* mt = m->tetrahedrons + ei;
+
+			u32 vs[4] = { mt->v1, mt->v2, mt->v3, mt->v4 };
+
+			for (u32 i = 0; i < 4; ++i)
+			{
+				m_nodeElements[next[vs[i]]++] = 4 * ei + i;
+			}
+		}
+
+		m_stackAllocator.Free(next);
+	}
+	else
+	{
+		// Build the stiffness matrix pattern.
+		// Each element couples its four nodes.
+		u32 entryCount = 12 * m->tetrahedronCount;
+		b3SparseEntry* entries = (b3SparseEntry*)m_stackAllocator.Allocate(entryCount * sizeof(b3SparseEntry));
+		
+		b3SparseEntry* entry = entries;
+		for (u32 ei = 0; ei < m->tetrahedronCount; ++ei)
+		{
+			b3SoftBodyMeshTetrahedron* mt = m->tetrahedrons + ei;
+
+			u32 vs[4] = { mt->v1, mt->v2, mt->v3, mt->v4 };
+
+			for (u32 i = 0; i < 4; ++i)
+			{
+				for (u32 j = 0; j < 4; ++j)
+				{
+					if (i != j)
+					{
+						entry->row = vs[i];
+						entry->column = vs[j];
+						++entry;
+					}
+				}
+			}
+		}
+
+		m_stiffnessPattern.Create(m->vertexCount, entries, entryCount);
+		m_K.Create(&m_stiffnessPattern);
+
+		m_stackAllocator.Free(entries);
+	}
+
+	// Initialize triangles
+	u32 faceCount = 4 * m->tetrahedronCount;
+	b3SoftBodyTriangle* faces = (b3SoftBodyTriangle*)m_stackAllocator.Allocate(faceCount * sizeof(b3SoftBodyTriangle));
+	for (u32 i = 0; i < m->tetrahedronCount; ++i)
+	{
+		b3SoftBodyMeshTetrahedron* mt = m->tetrahedrons + i;
+
+		u32 v1 = mt->v1;
+		u32 v2 = mt->v2;
+		u32 v3 = mt->v3;
+		u32 v4 = mt->v4;
+
+		b3SoftBodyTriangle* t1 = faces + 4 * i + 0;
+		b3SoftBodyTriangle* t2 = faces + 4 * i + 1;
+		b3SoftBodyTriangle* t3 = faces + 4 * i + 2;
+		b3SoftBodyTriangle* t4 = faces + 4 * i + 3;
+
+		t1->v1 = v1;
+		t1->v2 = v2;
+		t1->v3 = v3;
+		t1->tetrahedron = i;
+
+		t2->v1 = v1;
+		t2->v2 = v3;
+		t2->v3 = v4;
+		t2->tetrahedron = i;
+
+		t3->v1 = v1;
+		t3->v2 = v4;
+		t3->v3 = v2;
+		t3->tetrahedron = i;
+
+		t4->v1 = v2;
+		t4->v2 = v4;
+		t4->v3 = v3;
+		t4->tetrahedron = i;
+	}
+
+	// Keep the faces that aren't shared.
+	// Shared faces have the same smallest vertex. 
+	// Therefore only the faces in the same bucket are compared.
+	// Non-manifold meshes aren't supported. A face shared by more than 
+	// two tetrahedrons is treated as an interior face.
+	{
+		u32* bucketOffsets = (u32*)m_stackAllocator.Allocate((m->vertexCount + 1) * sizeof(u32));
+		u32* bucketFaces = (u32*)m_stackAllocator.Allocate(faceCount * sizeof(u32));
+		bool* shared = (bool*)m_stackAllocator.Allocate(faceCount * sizeof(bool));
+
+		for (u32 i = 0; i <= m->vertexCount; ++i)
+		{
+			bucketOffsets[i] = 0;
+		}
+
+		for (u32 i = 0; i < faceCount; ++i)
+		{
+			++bucketOffsets[b3GetMinVertex(faces + i) + 1];
+			shared[i] = false;
+		}
+
+		for (u32 i = 0; i < m->vertexCount; ++i)
+		{
+			bucketOffsets[i + 1] += bucketOffsets[i];
+		}
+
+		for (u32 i = 0; i < faceCount; ++i)
+		{
+			bucketFaces[bucketOffsets[b3GetMinVertex(faces + i)]++] = i;
+		}
+
+		// The offsets were shifted by one bucket while filling.
+		for (u32 i = m->vertexCount; i > 0; --i)
+		{
+			bucketOffsets[i] = bucketOffsets[i - 1];
+		}
+		bucketOffsets[0] = 0;
+
+		for (u32 i = 0; i < m->vertexCount; ++i)
+		{
+			for (u32 j = bucketOffsets[i]; j < bucketOffsets[i + 1]; ++j)
+			{
+				u32 f1 = bucketFaces[j];
+
+				for (u32 k = j + 1; k < bucketOffsets[i + 1]; ++k)
+				{
+					u32 f2 = bucketFaces[k];
+
+					if (b3AreTrianglesEqual(faces + f1, faces + f2))
+					{
+						shared[f1] = true;
+						shared[f2] = true;
+					}
+				}
+			}
+		}
+
+		m_triangleCount = 0;
+		for (u32 i = 0; i < faceCount; ++i)
+		{
+			if (shared[i] == false)
+			{
+				++m_triangleCount;
+			}
+		}
+
+		m_triangles = (b3SoftBodyTriangle*)b3Alloc(m_triangleCount * sizeof(b3SoftBodyTriangle));
+
+		u32 triangleCount = 0;
+		for (u32 i = 0; i < faceCount; ++i)
+		{
+			if (shared[i] == false)
+			{
+				m_triangles[triangleCount++] = faces[i];
+			}
+		}
+
+		m_stackAllocator.Free(shared);
+		m_stackAllocator.Free(bucketFaces);
+		m_stackAllocator.Free(bucketOffsets);
+	}
+
+	m_stackAllocator.Free(faces);
+
+	// Build the triangle tree
+	if (m_triangleCount > 0)
+	{
+		b3AABB3* aabbs = (b3AABB3*)m_stackAllocator.Allocate(m_triangleCount * sizeof(b3AABB3));
+		for (u32 i = 0; i < m_triangleCount; ++i)
+		{
+			b3SoftBodyTriangle* t = m_triangles + i;
+
+			aabbs[i].Set(m_nodes[t->v1].m_position, m_nodes[t->v2].m_position, m_nodes[t->v3].m_position);
+		}
+
+		m_triangleTree.Build(aabbs, m_triangleCount);
+
+		m_stackAllocator.Free(aabbs);
+	}
+
+	m_triangleTreeDirty = false;
+}
+
+void b3SoftBody::ComputeElements(const b3SoftBodyDef& def)
+{
+	const b3SoftBodyMesh* m = m_mesh;
+
+	// An element is elastic only if it can't accumulate plastic strain.
+	bool plastic = def.c_yield < B3_MAX_FLOAT && def.c_creep > 0.0f && def.c_max > 0.0f;
+
+	m_plasticElementCount = plastic ? m->tetrahedronCount : 0;
+	m_elementPlasticity = nullptr;
+	if (m_plasticElementCount > 0)
+	{
+		m_elementPlasticity = (b3SoftBodyElementPlasticity*)b3Alloc(m_plasticElementCount * sizeof(b3SoftBodyElementPlasticity));
+	}
+
 	for (u32 ei = 0; ei < m->tetrahedronCount; ++ei)
 	{
 		b3SoftBodyMeshTetrahedron* mt = m->tetrahedrons + ei;
@@ -496,6 +803,7 @@ b3SoftBody::b3SoftBody(const b3SoftBodyDef& def)
 		e->c_yield = def.c_yield;
 		e->c_creep = def.c_creep;
 		e->c_max = def.c_max;
+		e->plasticIndex = plastic ? ei : B3_MAX_U32;
 
 		u32 v1 = mt->v1;
 		u32 v2 = mt->v2;
@@ -517,15 +825,16 @@ b3SoftBody::b3SoftBody(const b3SoftBodyDef& def)
 
 		b3Mat33 E(e1, e2, e3);
 
-		e->invE = b3Inverse(E);
+		b3Mat33 invE = b3Inverse(E);
+		m_elementInvE[ei] = invE;
 
 		// 6 x 6
 		float32 D[36];
 		b3ComputeD(D, e->E, e->nu);
 
 		// 6 x 12
-		float32* B = e->B;
-		b3ComputeB(B, e->invE);
+		float32 B[72];
+		b3ComputeB(B, invE);
 
 		// 12 x 6
 		float32 BT[72];
@@ -543,109 +852,444 @@ b3SoftBody::b3SoftBody(const b3SoftBodyDef& def)
 			BT_D_B[i] *= V;
 		}
 
-		b3SetK(e->K, BT_D_B);
+		b3Mat33 K[16];
+		b3SetK(K, BT_D_B);
 
-		// 12 x 6
-		float32* P = e->P;
-		b3Mul(P, BT, 12, 6, D, 6, 6);
-		for (u32 i = 0; i < 72; ++i)
+		// Keep the upper triangle blocks
+		b3Mat33* Ke = m_elementStiffness + b3_elementBlockCount * ei;
+		for (u32 i = 0; i < 4; ++i)
 		{
-			P[i] *= V;
+			for (u32 j = i; j < 4; ++j)
+			{
+				Ke[b3GetElementBlockIndex(i, j)] = K[i + 4 * j];
+			}
 		}
 
-		for (u32 i = 0; i < 6; ++i)
+		if (plastic)
 		{
-			e->epsilon_plastic[i] = 0.0f;
+			b3SoftBodyElementPlasticity* ep = m_elementPlasticity + e->plasticIndex;
+
+			// The columns of B for node i are built from (b_i, c_i, d_i).
+			for (u32 i = 0; i < 4; ++i)
+			{
+				ep->gradients[i].Set(B[18 * i + 0], B[18 * i + 3], B[18 * i + 4]);
+			}
+
+			ep->volume = V;
+			ep->lambda = D[1];
+			ep->mu = D[21];
+
+			for (u32 i = 0; i < 6; ++i)
+			{
+				ep->epsilon_plastic[i] = 0.0f;
+			}
 		}
+
+		// Initial guess for the rotation extraction
+		m_elementRotations[ei].SetIdentity();
 	}
+}
 
-	// Initialize triangles
-	m_triangles = (b3SoftBodyTriangle*)b3Alloc(4 * m_mesh->tetrahedronCount * sizeof(b3SoftBodyTriangle));
-	for (u32 i = 0; i < m_mesh->tetrahedronCount; ++i)
+void b3SoftBody::CopyElements(const b3SoftBodyCache* cache)
+{
+	const b3SoftBodyMesh* m = m_mesh;
+
+	m_plasticElementCount = cache->plasticElementCount;
+	m_elementPlasticity = nullptr;
+	if (m_plasticElementCount > 0)
 	{
-		b3SoftBodyMeshTetrahedron* mt = m_mesh->tetrahedrons + i;
+		m_elementPlasticity = (b3SoftBodyElementPlasticity*)b3Alloc(m_plasticElementCount * sizeof(b3SoftBodyElementPlasticity));
+		memcpy(m_elementPlasticity, cache->elementPlasticity, m_plasticElementCount * sizeof(b3SoftBodyElementPlasticity));
+	}
 
-		u32 v1 = mt->v1;
-		u32 v2 = mt->v2;
-		u32 v3 = mt->v3;
-		u32 v4 = mt->v4;
+	memcpy(m_elements, cache->elements, m->tetrahedronCount * sizeof(b3SoftBodyElement));
+	memcpy(m_elementStiffness, cache->elementStiffness, b3_elementBlockCount * m->tetrahedronCount * sizeof(b3Mat33));
+	memcpy(m_elementInvE, cache->elementInvE, m->tetrahedronCount * sizeof(b3Mat33));
 
-		b3SoftBodyTriangle* t1 = m_triangles + 4 * i + 0;
-		b3SoftBodyTriangle* t2 = m_triangles + 4 * i + 1;
-		b3SoftBodyTriangle* t3 = m_triangles + 4 * i + 2;
-		b3SoftBodyTriangle* t4 = m_triangles + 4 * i + 3;
+	for (u32 i = 0; i < m->tetrahedronCount; ++i)
+	{
+		// Initial guess for the rotation extraction
+		m_elementRotations[i].SetIdentity();
+	}
 
-		t1->v1 = v1;
-		t1->v2 = v2;
-		t1->v3 = v3;
-		t1->tetrahedron = i;
+	// Restore the index maps of a reordered mesh.
+	if (cache->vertexIndices)
+	{
+		m_vertexIndices = (u32*)b3Alloc(m->vertexCount * sizeof(u32));
+		m_originalVertices = (u32*)b3Alloc(m->vertexCount * sizeof(u32));
+		for (u32 i = 0; i < m->vertexCount; ++i)
+		{
+			m_vertexIndices[i] = cache->vertexIndices[i];
+			m_originalVertices[m_vertexIndices[i]] = i;
+		}
 
-		t2->v1 = v1;
-		t2->v2 = v3;
-		t2->v3 = v4;
-		t2->tetrahedron = i;
+		m_tetrahedronIndices = (u32*)b3Alloc(m->tetrahedronCount * sizeof(u32));
+		m_originalTetrahedrons = (u32*)b3Alloc(m->tetrahedronCount * sizeof(u32));
+		for (u32 i = 0; i < m->tetrahedronCount; ++i)
+		{
+			m_tetrahedronIndices[i] = cache->tetrahedronIndices[i];
+			m_originalTetrahedrons[m_tetrahedronIndices[i]] = i;
+		}
+	}
+}
 
-		t3->v1 = v1;
-		t3->v2 = v4;
-		t3->v3 = v2;
-		t3->tetrahedron = i;
+// Round up a given size to a multiple of 16 bytes.
+static B3_FORCE_INLINE u32 b3AlignBinary(u32 size)
+{
+	return (size + 15) & ~15;
+}
 
-		t4->v1 = v2;
-		t4->v2 = v4;
-		t4->v3 = v3;
-		t4->tetrahedron = i;
+u32 b3SoftBody::GetCacheBinarySize() const
+{
+	u32 size = 0;
+	size += b3AlignBinary(sizeof(b3SoftBodyCacheBinaryHeader));
+	size += b3AlignBinary(m_mesh->vertexCount * sizeof(b3Vec3));
+	size += b3AlignBinary(m_mesh->tetrahedronCount * sizeof(b3SoftBodyMeshTetrahedron));
+	size += b3AlignBinary(m_mesh->vertexCount * sizeof(float32));
+	size += b3AlignBinary(m_mesh->tetrahedronCount * sizeof(b3SoftBodyElement));
+	size += b3AlignBinary(b3_elementBlockCount * m_mesh->tetrahedronCount * sizeof(b3Mat33));
+	size += b3AlignBinary(m_mesh->tetrahedronCount * sizeof(b3Mat33));
+	size += b3AlignBinary(m_plasticElementCount * sizeof(b3SoftBodyElementPlasticity));
+	if (m_vertexIndices)
+	{
+		size += b3AlignBinary(m_mesh->vertexCount * sizeof(u32));
+		size += b3AlignBinary(m_mesh->tetrahedronCount * sizeof(u32));
 	}
+	return size;
+}
+
+void b3SoftBody::WriteCacheBinary(void* buffer) const
+{
+	const b3SoftBodyMesh* m = m_mesh;
+
+	u8* base = (u8*)buffer;
+
+	b3SoftBodyCacheBinaryHeader* header = (b3SoftBodyCacheBinaryHeader*)base;
+	header->magic = B3_SOFT_BODY_CACHE_BINARY_MAGIC;
+	header->version = B3_SOFT_BODY_CACHE_BINARY_VERSION;
+	header->size = GetCacheBinarySize();
+	header->density = m_density;
+
+	u32 offset = b3AlignBinary(sizeof(b3SoftBodyCacheBinaryHeader));
+
+	header->vertexCount = m->vertexCount;
+	header->vertexOffset = offset;
+	memcpy(base + offset, m->vertices, m->vertexCount * sizeof(b3Vec3));
+	offset += b3AlignBinary(m->vertexCount * sizeof(b3Vec3));
+
+	header->tetrahedronCount = m->tetrahedronCount;
+	header->tetrahedronOffset = offset;
+	memcpy(base + offset, m->tetrahedrons, m->tetrahedronCount * sizeof(b3SoftBodyMeshTetrahedron));
+	offset += b3AlignBinary(m->tetrahedronCount * sizeof(b3SoftBodyMeshTetrahedron));
+
+	header->massOffset = offset;
+	float32* masses = (float32*)(base + offset);
+	for (u32 i = 0; i < m->vertexCount; ++i)
+	{
+		masses[i] = m_nodes[i].m_mass;
+	}
+	offset += b3AlignBinary(m->vertexCount * sizeof(float32));
+
+	header->elementOffset = offset;
+	memcpy(base + offset, m_elements, m->tetrahedronCount * sizeof(b3SoftBodyElement));
+	offset += b3AlignBinary(m->tetrahedronCount * sizeof(b3SoftBodyElement));
+
+	header->stiffnessOffset = offset;
+	memcpy(base + offset, m_elementStiffness, b3_elementBlockCount * m->tetrahedronCount * sizeof(b3Mat33));
+	offset += b3AlignBinary(b3_elementBlockCount * m->tetrahedronCount * sizeof(b3Mat33));
+
+	header->invEOffset = offset;
+	memcpy(base + offset, m_elementInvE, m->tetrahedronCount * sizeof(b3Mat33));
+	offset += b3AlignBinary(m->tetrahedronCount * sizeof(b3Mat33));
+
+	header->plasticElementCount = m_plasticElementCount;
+	header->plasticityOffset = offset;
+	b3SoftBodyElementPlasticity* plasticity = (b3SoftBodyElementPlasticity*)(base + offset);
+	for (u32 i = 0; i < m_plasticElementCount; ++i)
+	{
+		plasticity[i] = m_elementPlasticity[i];
+		
+		// Write the rest state.
+		for (u32 j = 0; j < 6; ++j)
+		{
+			plasticity[i].epsilon_plastic[j] = 0.0f;
+		}
+	}
+	offset += b3AlignBinary(m_plasticElementCount * sizeof(b3SoftBodyElementPlasticity));
+
+	// An offset of zero means the mesh wasn't reordered.
+	header->vertexIndexOffset = 0;
+	header->tetrahedronIndexOffset = 0;
+	if (m_vertexIndices)
+	{
+		header->vertexIndexOffset = offset;
+		memcpy(base + offset, m_vertexIndices, m->vertexCount * sizeof(u32));
+		offset += b3AlignBinary(m->vertexCount * sizeof(u32));
+
+		header->tetrahedronIndexOffset = offset;
+		memcpy(base + offset, m_tetrahedronIndices, m->tetrahedronCount * sizeof(u32));
+		offset += b3AlignBinary(m->tetrahedronCount * sizeof(u32));
+	}
+
+	B3_ASSERT(offset == header->size);
+}
+
+bool b3SoftBodyCache::ReadBinary(const void* buffer, u32 size)
+{
+	if (size < sizeof(b3SoftBodyCacheBinaryHeader))
+	{
+		return false;
+	}
+
+	// Ensure proper alignment.
+	if (((size_t)buffer & 15) != 0)
+	{
+		return false;
+	}
+
+	const u8* base = (const u8*)buffer;
+	const b3SoftBodyCacheBinaryHeader* header = (const b3SoftBodyCacheBinaryHeader*)base;
+
+	if (header->magic != B3_SOFT_BODY_CACHE_BINARY_MAGIC || header->version != B3_SOFT_BODY_CACHE_BINARY_VERSION)
+	{
+		return false;
+	}
+
+	if (header->size > size)
+	{
+		return false;
+	}
+
+	if (header->vertexCount == 0 || header->tetrahedronCount == 0)
+	{
+		return false;
+	}
+
+	if (header->plasticElementCount > header->tetrahedronCount)
+	{
+		return false;
+	}
+
+	// Ensure every section is aligned.
+	if ((header->vertexOffset & 15) != 0 || (header->tetrahedronOffset & 15) != 0 || (header->massOffset & 15) != 0 ||
+		(header->elementOffset & 15) != 0 || (header->stiffnessOffset & 15) != 0 || (header->invEOffset & 15) != 0 || 
+		(header->plasticityOffset & 15) != 0 || (header->vertexIndexOffset & 15) != 0 || (header->tetrahedronIndexOffset & 15) != 0)
+	{
+		return false;
+	}
+
+	// Ensure every section is inside the buffer.
+	// The data inside the sections is trusted.
+	u64 vertexEnd = u64(header->vertexOffset) + u64(header->vertexCount) * sizeof(b3Vec3);
+	u64 tetrahedronEnd = u64(header->tetrahedronOffset) + u64(header->tetrahedronCount) * sizeof(b3SoftBodyMeshTetrahedron);
+	u64 massEnd = u64(header->massOffset) + u64(header->vertexCount) * sizeof(float32);
+	u64 elementEnd = u64(header->elementOffset) + u64(header->tetrahedronCount) * sizeof(b3SoftBodyElement);
+	u64 stiffnessEnd = u64(header->stiffnessOffset) + u64(header->tetrahedronCount) * b3_elementBlockCount * sizeof(b3Mat33);
+	u64 invEEnd = u64(header->invEOffset) + u64(header->tetrahedronCount) * sizeof(b3Mat33);
+	u64 plasticityEnd = u64(header->plasticityOffset) + u64(header->plasticElementCount) * sizeof(b3SoftBodyElementPlasticity);
+	if (vertexEnd > header->size || tetrahedronEnd > header->size || massEnd > header->size ||
+		elementEnd > header->size || stiffnessEnd > header->size || invEEnd > header->size || plasticityEnd > header->size)
+	{
+		return false;
+	}
+
+	// The index maps are either both present or both absent.
+	if ((header->vertexIndexOffset == 0) != (header->tetrahedronIndexOffset == 0))
+	{
+		return false;
+	}
+
+	if (header->vertexIndexOffset != 0)
+	{
+		u64 vertexIndexEnd = u64(header->vertexIndexOffset) + u64(header->vertexCount) * sizeof(u32);
+		u64 tetrahedronIndexEnd = u64(header->tetrahedronIndexOffset) + u64(header->tetrahedronCount) * sizeof(u32);
+		if (vertexIndexEnd > header->size || tetrahedronIndexEnd > header->size)
+		{
+			return false;
+		}
+	}
+
+	mesh.vertexCount = header->vertexCount;
+	mesh.vertices = (b3Vec3*)(base + header->vertexOffset);
+	mesh.tetrahedronCount = header->tetrahedronCount;
+	mesh.tetrahedrons = (b3SoftBodyMeshTetrahedron*)(base + header->tetrahedronOffset);
+
+	density = header->density;
+	masses = (const float32*)(base + header->massOffset);
+	elements = (const b3SoftBodyElement*)(base + header->elementOffset);
+	elementStiffness = (const b3Mat33*)(base + header->stiffnessOffset);
+	elementInvE = (const b3Mat33*)(base + header->invEOffset);
+	plasticElementCount = header->plasticElementCount;
+	elementPlasticity = (const b3SoftBodyElementPlasticity*)(base + header->plasticityOffset);
+	vertexIndices = nullptr;
+	tetrahedronIndices = nullptr;
+	if (header->vertexIndexOffset != 0)
+	{
+		vertexIndices = (const u32*)(base + header->vertexIndexOffset);
+		tetrahedronIndices = (const u32*)(base + header->tetrahedronIndexOffset);
+	}
+
+	return true;
 }
 
 b3SoftBody::~b3SoftBody()
 {
 	b3Free(m_nodes);
 	b3Free(m_elements);
+	b3Free(m_elementStiffness);
+	b3Free(m_elementInvE);
+	b3Free(m_elementRotations);
+	b3Free(m_elementPlasticity);
 	b3Free(m_triangles);
+	b3Free(m_nodeElementOffsets);
+	b3Free(m_nodeElements);
+	b3Free(m_orderedMesh.vertices);
+	b3Free(m_orderedMesh.tetrahedrons);
+	b3Free(m_vertexIndices);
+	b3Free(m_originalVertices);
+	b3Free(m_tetrahedronIndices);
+	b3Free(m_originalTetrahedrons);
 }
 
-bool b3SoftBody::RayCastSingle(b3SoftBodyRayCastSingleOutput* output, const b3Vec3& p1, const b3Vec3& p2) const
+void b3SoftBody::ReorderMesh(const b3SoftBodyMesh* mesh)
 {
-	b3RayCastInput input;
-	input.p1 = p1;
-	input.p2 = p2;
-	input.maxFraction = 1.0f;
+	u32 vertexCount = mesh->vertexCount;
+	u32 tetrahedronCount = mesh->tetrahedronCount;
 
-	u32 triangle = ~0;
-	u32 tetrahedron = ~0;
+	const u32* tetrahedrons = (const u32*)mesh->tetrahedrons;
 
-	b3RayCastOutput output0;
-	output0.fraction = B3_MAX_FLOAT;
+	m_originalVertices = (u32*)b3Alloc(vertexCount * sizeof(u32));
+	b3ComputeVertexOrder(m_originalVertices, vertexCount, tetrahedrons, tetrahedronCount, 4);
 
-	for (u32 i = 0; i < 4 * m_mesh->tetrahedronCount; ++i)
+	m_vertexIndices = (u32*)b3Alloc(vertexCount * sizeof(u32));
+	for (u32 i = 0; i < vertexCount; ++i)
 	{
-		b3SoftBodyTriangle* t = m_triangles + i;
+		m_vertexIndices[m_originalVertices[i]] = i;
+	}
 
-		b3Vec3 v1 = m_nodes[t->v1].m_position;
-		b3Vec3 v2 = m_nodes[t->v2].m_position;
-		b3Vec3 v3 = m_nodes[t->v3].m_position;
+	m_originalTetrahedrons = (u32*)b3Alloc(tetrahedronCount * sizeof(u32));
+	b3ComputeElementOrder(m_originalTetrahedrons, vertexCount, m_vertexIndices, tetrahedrons, tetrahedronCount, 4);
+
+	m_tetrahedronIndices = (u32*)b3Alloc(tetrahedronCount * sizeof(u32));
+	for (u32 i = 0; i < tetrahedronCount; ++i)
+	{
+		m_tetrahedronIndices[m_originalTetrahedrons[i]] = i;
+	}
+
+	// Copy the mesh.
+	m_orderedMesh.vertexCount = vertexCount;
+	m_orderedMesh.vertices = (b3Vec3*)b3Alloc(vertexCount * sizeof(b3Vec3));
+	for (u32 i = 0; i < vertexCount; ++i)
+	{
+		m_orderedMesh.vertices[i] = mesh->vertices[m_originalVertices[i]];
+	}
+
+	m_orderedMesh.tetrahedronCount = tetrahedronCount;
+	m_orderedMesh.tetrahedrons = (b3SoftBodyMeshTetrahedron*)b3Alloc(tetrahedronCount * sizeof(b3SoftBodyMeshTetrahedron));
+	for (u32 i = 0; i < tetrahedronCount; ++i)
+	{
+		const b3SoftBodyMeshTetrahedron* t = mesh->tetrahedrons + m_originalTetrahedrons[i];
+
+		b3SoftBodyMeshTetrahedron* orderedTetrahedron = m_orderedMesh.tetrahedrons + i;
+		orderedTetrahedron->v1 = m_vertexIndices[t->v1];
+		orderedTetrahedron->v2 = m_vertexIndices[t->v2];
+		orderedTetrahedron->v3 = m_vertexIndices[t->v3];
+		orderedTetrahedron->v4 = m_vertexIndices[t->v4];
+	}
+}
+
+struct b3SoftBodyTriangleRefitCallback
+{
+	b3AABB3 ComputeAABB(u32 index) const
+	{
+		const b3SoftBodyTriangle* t = triangles + index;
+
+		b3AABB3 aabb;
+		aabb.Set(nodes[t->v1].GetPosition(), nodes[t->v2].GetPosition(), nodes[t->v3].GetPosition());
+		return aabb;
+	}
+
+	const b3SoftBodyTriangle* triangles;
+	const b3SoftBodyNode* nodes;
+};
+
+void b3SoftBody::RefitTriangleTree() const
+{
+	B3_PROFILE("Soft Body Refit Triangle Tree");
+
+	b3SoftBodyTriangleRefitCallback callback;
+	callback.triangles = m_triangles;
+	callback.nodes = m_nodes;
+
+	m_triangleTree.Refit(&callback);
+
+	m_triangleTreeDirty = false;
+}
+
+struct b3SoftBodyRayCastSingleCallback
+{
+	float32 Report(const b3RayCastInput& input, u32 proxyId)
+	{
+		u32 index = tree->GetUserData(proxyId);
+		const b3SoftBodyTriangle* t = triangles + index;
+
+		b3Vec3 v1 = nodes[t->v1].GetPosition();
+		b3Vec3 v2 = nodes[t->v2].GetPosition();
+		b3Vec3 v3 = nodes[t->v3].GetPosition();
 
 		b3RayCastOutput subOutput;
 		if (b3RayCast(&subOutput, &input, v1, v2, v3))
 		{
 			if (subOutput.fraction < output0.fraction)
 			{
-				triangle = i;
-				tetrahedron = t->tetrahedron;
+				triangle0 = index;
 				output0.fraction = subOutput.fraction;
 				output0.normal = subOutput.normal;
 			}
 		}
+
+		// Continue search from where we stopped.
+		return input.maxFraction;
 	}
 
-	if (tetrahedron != ~0)
+	const b3StaticTree* tree;
+	const b3SoftBodyTriangle* triangles;
+	const b3SoftBodyNode* nodes;
+	u32 triangle0;
+	b3RayCastOutput output0;
+};
+
+bool b3SoftBody::RayCastSingle(b3SoftBodyRayCastSingleOutput* output, const b3Vec3& p1, const b3Vec3& p2) const
+{
+	b3RayCastInput input;
+	input.p1 = p1;
+	input.p2 = p2;
+	input.maxFraction = 1.0f;
+
+	if (m_triangleTreeDirty)
 	{
-		output->tetrahedron = tetrahedron;
-		output->v1 = m_triangles[triangle].v1;
-		output->v2 = m_triangles[triangle].v2;
-		output->v3 = m_triangles[triangle].v3;
-		output->fraction = output0.fraction;
-		output->normal = output0.normal;
+		RefitTriangleTree();
+	}
+
+	b3SoftBodyRayCastSingleCallback callback;
+	callback.tree = &m_triangleTree;
+	callback.triangles = m_triangles;
+	callback.nodes = m_nodes;
+	callback.triangle0 = ~0;
+	callback.output0.fraction = B3_MAX_FLOAT;
+
+	m_triangleTree.RayCast(&callback, input);
+
+	if (callback.triangle0 != ~0)
+	{
+		b3SoftBodyTriangle* t = m_triangles + callback.triangle0;
+
+		output->tetrahedron = t->tetrahedron;
+		output->v1 = t->v1;
+		output->v2 = t->v2;
+		output->v3 = t->v3;
+		output->fraction = callback.output0.fraction;
+		output->normal = callback.output0.normal;
 
 		return true;
 	}
@@ -744,10 +1388,137 @@ void b3SoftBody::Solve(float32 dt, const b3Vec3& gravity, u32 velocityIterations
 	solver.Solve(dt, gravity, velocityIterations, positionIterations);
 }
 
+void b3SoftBody::SetSleepingAllowed(bool flag)
+{
+	m_allowSleep = flag;
+	if (flag == false)
+	{
+		SetAwake(true);
+	}
+}
+
+void b3SoftBody::SetAwake(bool flag)
+{
+	if (flag)
+	{
+		m_awake = true;
+		m_sleepTime = 0.0f;
+		return;
+	}
+
+	if (m_awake == false)
+	{
+		return;
+	}
+
+	m_awake = false;
+	m_sleepTime = 0.0f;
+	PutToSleep();
+}
+
+void b3SoftBody::PutToSleep()
+{
+	m_sleepAABB.m_lower = m_nodes[0].m_position;
+	m_sleepAABB.m_upper = m_nodes[0].m_position;
+
+	float32 maxRadius = 0.0f;
+	for (u32 i = 0; i < m_mesh->vertexCount; ++i)
+	{
+		b3SoftBodyNode* n = m_nodes + i;
+
+		n->m_velocity.SetZero();
+		n->m_force.SetZero();
+
+		m_sleepAABB.m_lower = b3Min(m_sleepAABB.m_lower, n->m_position);
+		m_sleepAABB.m_upper = b3Max(m_sleepAABB.m_upper, n->m_position);
+
+		maxRadius = b3Max(maxRadius, n->m_radius);
+	}
+
+	m_sleepAABB.Extend(maxRadius);
+}
+
+class b3SoftBodyWakeUpQueryListener : public b3QueryListener
+{
+public:
+	virtual bool ReportShape(b3Shape* s)
+	{
+		b3Body* b = s->GetBody();
+
+		if (b->GetType() != e_staticBody && b->IsAwake())
+		{
+			touching = true;
+
+			// Stop the query
+			return false;
+		}
+
+		// Keep looking for overlaps
+		return true;
+	}
+
+	bool touching;
+};
+
+void b3SoftBody::WakeUp()
+{
+	if (m_world == nullptr)
+	{
+		return;
+	}
+
+	b3SoftBodyWakeUpQueryListener listener;
+	listener.touching = false;
+
+	m_world->QueryAABB(&listener, m_sleepAABB);
+
+	if (listener.touching)
+	{
+		SetAwake(true);
+	}
+}
+
+void b3SoftBody::UpdateSleep(float32 dt)
+{
+	if (m_allowSleep == false)
+	{
+		m_sleepTime = 0.0f;
+		return;
+	}
+
+	for (u32 i = 0; i < m_mesh->vertexCount; ++i)
+	{
+		if (b3LengthSquared(m_nodes[i].m_velocity) > B3_SLEEP_LINEAR_TOL)
+		{
+			m_sleepTime = 0.0f;
+			return;
+		}
+	}
+
+	m_sleepTime += dt;
+
+	if (m_sleepTime >= m_timeToSleep)
+	{
+		SetAwake(false);
+	}
+}
+
 void b3SoftBody::Step(float32 dt, u32 velocityIterations, u32 positionIterations)
 {
 	B3_PROFILE("Soft Body Step");
 
+	// Wake up if touched by a moving body
+	if (m_awake == false)
+	{
+		WakeUp();
+	}
+
+	// A sleeping soft body costs nothing.
+	if (m_awake == false)
+	{
+		return;
+	}
+
 	// Update contacts
 	m_contactManager.UpdateBodyContacts();
 
@@ -778,6 +1549,21 @@ void b3SoftBody::Step(float32 dt, u32 velocityIterations, u32 positionIterations
 		n->Synchronize(displacement);
 	}
 
+	// Refit the triangle tree
+	if (m_triangleTreeDirty)
+	{
+		RefitTriangleTree();
+	}
+
+	// Refit the broad-phase tree
+	m_contactManager.m_broadPhase.UpdateTree();
+
+	// Put the soft body to sleep if the nodes are resting
+	if (dt > 0.0f)
+	{
+		UpdateSleep(dt);
+	}
+
 	// Find new contacts
 	m_contactManager.FindNewBodyContacts();
 }
@@ -797,6 +1583,8 @@ void b3SoftBody::SetWorld(b3World* world)
 	}
 
 	m_world = world;
+
+	SetAwake(true);
 }
 
 void b3SoftBody::Draw() const
@@ -20,6 +20,7 @@
 #include <bounce/softbody/softbody.h>
 #include <bounce/softbody/softbody_mesh.h>
 #include <bounce/softbody/softbody_node.h>
+#include <bounce/common/template/array.h>
 #include <bounce/dynamics/world.h>
 #include <bounce/dynamics/world_listeners.h>
 #include <bounce/dynamics/shapes/shape.h>
@@ -34,16 +35,34 @@ b3SoftBodyContactManager::b3SoftBodyContactManager() :
 class b3SoftBodyContactManagerFindNewBodyContactsQueryListener : public b3QueryListener
 {
 public:
-	virtual bool ReportShape(b3Shape* s2)
+	virtual bool ReportShape(b3Shape* s)
 	{
-		cm->AddNSPair(n1, s2);
+		shapes->PushBack(s);
+
+		// Keep looking for overlaps
+		return true;
+	}
+
+	b3Array<b3Shape*>* shapes;
+};
+
+struct b3SoftBodyContactManagerFindNewBodyContactsQueryCallback
+{
+	bool Report(u32 proxyId)
+	{
+		b3SoftBodyNode* n1 = (b3SoftBodyNode*)cm->m_broadPhase.GetUserData(proxyId);
+
+		if (n1->GetType() == e_dynamicSoftBodyNode)
+		{
+			cm->AddNSPair(n1, s2);
+		}
 
 		// Keep looking for overlaps
 		return true;
 	}
 
 	b3SoftBodyContactManager* cm;
-	b3SoftBodyNode* n1;
+	b3Shape* s2;
 };
 
 void b3SoftBodyContactManager::FindNewBodyContacts()
@@ -56,6 +75,9 @@ void b3SoftBodyContactManager::FindNewBodyContacts()
 		return;
 	}
 
+	// Compute the bounds of the dynamic nodes.
+	bool empty = true;
+	b3AABB3 bodyAABB;
 	for (u32 i = 0; i < m_body->m_mesh->vertexCount; ++i)
 	{
 		b3SoftBodyNode* n = m_body->m_nodes + i;
@@ -65,22 +87,52 @@ void b3SoftBodyContactManager::FindNewBodyContacts()
 			continue;
 		}
 
-		b3AABB3 aabb = m_broadPhase.GetAABB(n->m_broadPhaseId);
+		const b3AABB3& aabb = m_broadPhase.GetAABB(n->m_broadPhaseId);
+
+		if (empty)
+		{
+			bodyAABB = aabb;
+			empty = false;
+		}
+		else
+		{
+			bodyAABB = b3Combine(bodyAABB, aabb);
+		}
+	}
+
+	if (empty)
+	{
+		return;
+	}
+
+	// Gather the shapes overlapping the body with a single world query.
+	b3StackArray<b3Shape*, 256> shapes;
 
-		b3SoftBodyContactManagerFindNewBodyContactsQueryListener listener;
-		listener.cm = this;
-		listener.n1 = n;
+	b3SoftBodyContactManagerFindNewBodyContactsQueryListener listener;
+	listener.shapes = &shapes;
 
-		m_body->m_world->QueryAABB(&listener, aabb);
+	m_body->m_world->QueryAABB(&listener, bodyAABB);
+
+	// Find the nodes overlapping each shape using the body tree.
+	for (u32 i = 0; i < shapes.Count(); ++i)
+	{
+		b3Shape* s2 = shapes[i];
+
+		b3SoftBodyContactManagerFindNewBodyContactsQueryCallback callback;
+		callback.cm = this;
+		callback.s2 = s2;
+
+		m_broadPhase.QueryAABB(&callback, s2->GetAABB());
 	}
 }
 
 void b3SoftBodyContactManager::AddNSPair(b3SoftBodyNode* n1, b3Shape* s2)
 {
 	// Check if there is a contact between the two entities.
-	for (b3NodeBodyContact* c = m_nodeBodyContactList.m_head; c; c = c->m_next)
+	// Only the contacts of the node need to be searched.
+	for (b3NodeBodyContactEdge* ce = n1->m_contactEdges.m_head; ce; ce = ce->m_next)
 	{
-		if (c->m_n1 == n1 && c->m_s2 == s2)
+		if (ce->other == s2)
 		{
 			// A contact already exists.
 			return;
@@ -107,6 +159,11 @@ void b3SoftBodyContactManager::AddNSPair(b3SoftBodyNode* n1, b3Shape* s2)
 
 	// Add the contact to the body contact list.
 	m_nodeBodyContactList.PushFront(c);
+
+	// Add the contact to the node contact list.
+	c->m_edge1.other = s2;
+	c->m_edge1.contact = c;
+	n1->m_contactEdges.PushFront(&c->m_edge1);
 }
 
 void b3SoftBodyContactManager::UpdateBodyContacts()
@@ -158,6 +215,7 @@ b3NodeBodyContact* b3SoftBodyContactManager::CreateNodeBodyContact()
 void b3SoftBodyContactManager::Destroy(b3NodeBodyContact* c)
 {
 	m_nodeBodyContactList.Remove(c);
+	c->m_n1->m_contactEdges.Remove(&c->m_edge1);
 
 	c->~b3NodeBodyContact();
 
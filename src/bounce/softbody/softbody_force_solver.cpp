@@ -20,8 +20,15 @@
 #include <bounce/softbody/softbody_mesh.h>
 #include <bounce/softbody/softbody_node.h>
 #include <bounce/softbody/softbody.h>
-#include <bounce/sparse/sparse_mat33.h>
-#include <bounce/sparse/sparse_mat33_view.h>
+#include <bounce/sparse/diag_mat33.h>
+#include <bounce/sparse/csr_mat33.h>
+#include <bounce/sparse/mpcg.h>
+#include <bounce/common/thread_pool.h>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define B3_SIMD_SSE
+#include <xmmintrin.h>
+#endif
 
 // This work is based on the paper "Interactive Virtual Materials" written by 
 // Matthias Mueller Fischer
@@ -34,6 +41,9 @@
 // Number of MPCG iterations, a value that is normally small when small time steps are taken.
 u32 b3_softBodySolverIterations = 0;
 
+// Average number of rotation extraction iterations per element.
+float32 b3_softBodyRotationIterations = 0.0f;
+
 // Enables the stiffness warping solver.
 bool b3_enableStiffnessWarping = true;
 
@@ -51,138 +61,558 @@ b3SoftBodyForceSolver::~b3SoftBodyForceSolver()
 
 }
 
-// Extract rotation from deformation
+// out = Ke * v, where Ke is an element stiffness matrix. See b3GetElementBlockIndex.
+static B3_FORCE_INLINE void b3MulElement(b3Vec3 out[4], const b3Mat33* Ke, const b3Vec3 v[4])
+{
+	for (u32 i = 0; i < 4; ++i)
+	{
+		out[i] = Ke[b3GetElementBlockIndex(i, i)] * v[i];
+	}
+
+	// The lower triangle blocks are the transposes of the upper triangle blocks.
+	for (u32 i = 0; i < 4; ++i)
+	{
+		for (u32 j = i + 1; j < 4; ++j)
+		{
+			const b3Mat33& Kij = Ke[b3GetElementBlockIndex(i, j)];
+
+			out[i] += Kij * v[j];
+			out[j] += b3MulT(Kij, v[i]);
+		}
+	}
+}
+
+// The number of elements whose rotations are extracted together.
+// The lanes are mapped to the 4 floats of a SSE register.
+const u32 b3_rotationLaneCount = 4;
+
+// The number of lane groups processed by a rotation task.
+const u32 b3_rotationTaskSize = 16;
+
+// The maximum number of rotation extraction iterations.
+const u32 b3_maxRotationIterations = 20;
+
+// A lane stops iterating when its rotation increment is smaller than this angle (radians).
+// With a warm start the rotations are within about 1e-6 radians of the exact ones.
+// A smaller tolerance is almost never reached in float precision and then all the iterations are run.
+const float32 b3_rotationTolerance = 1.0e-6f;
+
+// Extract the rotations from up to b3_rotationLaneCount deformations.
+// Each lane is warm-started from its quaternion and stops when its rotation increment is small.
+// The increment omega is applied as the normalized quaternion (omega / 2, 1). 
+// This rotates by 2 * atan(|omega| / 2) instead of |omega|, which doesn't change the fixed point 
+// and avoids sin and cos.
+// Return the sum of the iterations of the lanes.
 // https://animation.rwth-aachen.de/media/papers/2016-MIG-StableRotation.pdf
-static void b3ExtractRotation(b3Mat33& out, b3Quat& q, const b3Mat33& A, u32 maxIterations = 20)
+static u32 b3ExtractRotations(b3Mat33* out, b3Quat* qs, const b3Mat33* As, u32 count)
 {
-	for (u32 iteration = 0; iteration < maxIterations; ++iteration)
+	B3_ASSERT(count <= b3_rotationLaneCount);
+
+	const u32 L = b3_rotationLaneCount;
+
+	// Lanes stored as a structure of arrays.
+	// The unused lanes are identities and marked as done.
+	float32 a[9][L];
+	float32 qx[L], qy[L], qz[L], qw[L];
+
+	for (u32 k = 0; k < L; ++k)
+	{
+		b3Mat33 A;
+		b3Quat q;
+		if (k < count)
+		{
+			A = As[k];
+			q = qs[k];
+		}
+		else
+		{
+			A.SetIdentity();
+			q.SetIdentity();
+		}
+
+		for (u32 i = 0; i < 9; ++i)
+		{
+			a[i][k] = (&A.x.x)[i];
+		}
+
+		qx[k] = q.x;
+		qy[k] = q.y;
+		qz[k] = q.z;
+		qw[k] = q.w;
+	}
+
+	const float32 tolerance = b3_rotationTolerance * b3_rotationTolerance;
+
+	u32 iterations = 0;
+
+#ifdef B3_SIMD_SSE
+	B3_ASSERT(L == 4);
+
+	__m128 A[9];
+	for (u32 i = 0; i < 9; ++i)
 	{
-		b3Mat33 R = b3QuatMat33(q);
+		A[i] = _mm_loadu_ps(a[i]);
+	}
+
+	__m128 x = _mm_loadu_ps(qx);
+	__m128 y = _mm_loadu_ps(qy);
+	__m128 z = _mm_loadu_ps(qz);
+	__m128 w = _mm_loadu_ps(qw);
+
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 half = _mm_set1_ps(0.5f);
+	const __m128 epsilon = _mm_set1_ps(1.0e-9f);
+	const __m128 signMask = _mm_set1_ps(-0.0f);
+	const __m128 tol = _mm_set1_ps(tolerance);
 
-		float32 s = b3Abs(b3Dot(R.x, A.x) + b3Dot(R.y, A.y) + b3Dot(R.z, A.z));
+	// The unused lanes are done.
+	__m128 done = _mm_cmpge_ps(_mm_set_ps(3.0f, 2.0f, 1.0f, 0.0f), _mm_set1_ps(float32(count)));
+	u32 doneMask = u32(_mm_movemask_ps(done));
 
-		if (s == 0.0f)
+	for (u32 iteration = 0; iteration < b3_maxRotationIterations; ++iteration)
+	{
+		if (doneMask == 0xF)
 		{
 			break;
 		}
 
-		float32 inv_s = 1.0f / s + 1.0e-9f;
+		iterations += 4 - ((doneMask & 1) + ((doneMask >> 1) & 1) + ((doneMask >> 2) & 1) + ((doneMask >> 3) & 1));
+
+		// R = b3QuatMat33(q)
+		__m128 x2 = _mm_add_ps(x, x), y2 = _mm_add_ps(y, y), z2 = _mm_add_ps(z, z);
+		__m128 xx = _mm_mul_ps(x, x2), xy = _mm_mul_ps(x, y2), xz = _mm_mul_ps(x, z2);
+		__m128 yy = _mm_mul_ps(y, y2), yz = _mm_mul_ps(y, z2), zz = _mm_mul_ps(z, z2);
+		__m128 wx = _mm_mul_ps(w, x2), wy = _mm_mul_ps(w, y2), wz = _mm_mul_ps(w, z2);
+
+		__m128 r[9];
+		r[0] = _mm_sub_ps(one, _mm_add_ps(yy, zz));
+		r[1] = _mm_add_ps(xy, wz);
+		r[2] = _mm_sub_ps(xz, wy);
+		r[3] = _mm_sub_ps(xy, wz);
+		r[4] = _mm_sub_ps(one, _mm_add_ps(xx, zz));
+		r[5] = _mm_add_ps(yz, wx);
+		r[6] = _mm_add_ps(xz, wy);
+		r[7] = _mm_sub_ps(yz, wx);
+		r[8] = _mm_sub_ps(one, _mm_add_ps(xx, yy));
+
+		// s = |R.x * A.x + R.y * A.y + R.z * A.z|
+		__m128 s = _mm_setzero_ps();
+		for (u32 i = 0; i < 9; ++i)
+		{
+			s = _mm_add_ps(s, _mm_mul_ps(r[i], A[i]));
+		}
+		s = _mm_andnot_ps(signMask, s);
+
+		// v = R.x x A.x + R.y x A.y + R.z x A.z
+		__m128 vx = _mm_setzero_ps(), vy = _mm_setzero_ps(), vz = _mm_setzero_ps();
+		for (u32 c = 0; c < 9; c += 3)
+		{
+			vx = _mm_add_ps(vx, _mm_sub_ps(_mm_mul_ps(r[c + 1], A[c + 2]), _mm_mul_ps(r[c + 2], A[c + 1])));
+			vy = _mm_add_ps(vy, _mm_sub_ps(_mm_mul_ps(r[c + 2], A[c + 0]), _mm_mul_ps(r[c + 0], A[c + 2])));
+			vz = _mm_add_ps(vz, _mm_sub_ps(_mm_mul_ps(r[c + 0], A[c + 1]), _mm_mul_ps(r[c + 1], A[c + 0])));
+		}
+
+		// inv_s = s > 0 ? 1 / s + epsilon : 0
+		__m128 inv_s = _mm_and_ps(_mm_cmpgt_ps(s, _mm_setzero_ps()), _mm_add_ps(_mm_div_ps(one, s), epsilon));
+
+		__m128 ox = _mm_mul_ps(inv_s, vx), oy = _mm_mul_ps(inv_s, vy), oz = _mm_mul_ps(inv_s, vz);
+
+		__m128 angleSquared = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ox, ox), _mm_mul_ps(oy, oy)), _mm_mul_ps(oz, oz));
+
+		done = _mm_or_ps(done, _mm_cmplt_ps(angleSquared, tol));
+
+		// q = (omega / 2, 1) * q
+		__m128 px = _mm_mul_ps(half, ox), py = _mm_mul_ps(half, oy), pz = _mm_mul_ps(half, oz);
 
-		b3Vec3 v = b3Cross(R.x, A.x) + b3Cross(R.y, A.y) + b3Cross(R.z, A.z);
+		__m128 nx = _mm_add_ps(x, _mm_sub_ps(_mm_add_ps(_mm_mul_ps(px, w), _mm_mul_ps(py, z)), _mm_mul_ps(pz, y)));
+		__m128 ny = _mm_add_ps(y, _mm_sub_ps(_mm_add_ps(_mm_mul_ps(py, w), _mm_mul_ps(pz, x)), _mm_mul_ps(px, z)));
+		__m128 nz = _mm_add_ps(z, _mm_sub_ps(_mm_add_ps(_mm_mul_ps(pz, w), _mm_mul_ps(px, y)), _mm_mul_ps(py, x)));
+		__m128 nw = _mm_sub_ps(w, _mm_add_ps(_mm_add_ps(_mm_mul_ps(px, x), _mm_mul_ps(py, y)), _mm_mul_ps(pz, z)));
 
-		b3Vec3 omega = inv_s * v;
+		// The length is at least the length of q. Therefore the division is safe.
+		__m128 lengthSquared = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, nx), _mm_mul_ps(ny, ny)), _mm_add_ps(_mm_mul_ps(nz, nz), _mm_mul_ps(nw, nw)));
+		__m128 inv_length = _mm_div_ps(one, _mm_sqrt_ps(lengthSquared));
 
-		float32 w = b3Length(omega);
+		// Keep the quaternion of the lanes that are done.
+		x = _mm_or_ps(_mm_and_ps(done, x), _mm_andnot_ps(done, _mm_mul_ps(inv_length, nx)));
+		y = _mm_or_ps(_mm_and_ps(done, y), _mm_andnot_ps(done, _mm_mul_ps(inv_length, ny)));
+		z = _mm_or_ps(_mm_and_ps(done, z), _mm_andnot_ps(done, _mm_mul_ps(inv_length, nz)));
+		w = _mm_or_ps(_mm_and_ps(done, w), _mm_andnot_ps(done, _mm_mul_ps(inv_length, nw)));
 
-		if (w < 1.0e-9f)
+		doneMask = u32(_mm_movemask_ps(done));
+	}
+
+	_mm_storeu_ps(qx, x);
+	_mm_storeu_ps(qy, y);
+	_mm_storeu_ps(qz, z);
+	_mm_storeu_ps(qw, w);
+#else
+	bool done[L];
+	for (u32 k = 0; k < L; ++k)
+	{
+		done[k] = k >= count;
+	}
+
+	for (u32 iteration = 0; iteration < b3_maxRotationIterations; ++iteration)
+	{
+		u32 activeCount = 0;
+		for (u32 k = 0; k < L; ++k)
+		{
+			activeCount += done[k] ? 0 : 1;
+		}
+
+		if (activeCount == 0)
 		{
 			break;
 		}
 
-		b3Quat omega_q(omega / w, w);
+		iterations += activeCount;
+
+		for (u32 k = 0; k < L; ++k)
+		{
+			// R = b3QuatMat33(q)
+			float32 x = qx[k], y = qy[k], z = qz[k], w = qw[k];
+			float32 x2 = x + x, y2 = y + y, z2 = z + z;
+			float32 xx = x * x2, xy = x * y2, xz = x * z2;
+			float32 yy = y * y2, yz = y * z2, zz = z * z2;
+			float32 wx = w * x2, wy = w * y2, wz = w * z2;
+
+			float32 r[9] =
+			{
+				1.0f - (yy + zz), xy + wz, xz - wy,
+				xy - wz, 1.0f - (xx + zz), yz + wx,
+				xz + wy, yz - wx, 1.0f - (xx + yy)
+			};
+
+			// s = |R.x * A.x + R.y * A.y + R.z * A.z|
+			float32 s = 0.0f;
+			for (u32 i = 0; i < 9; ++i)
+			{
+				s += r[i] * a[i][k];
+			}
+			s = b3Abs(s);
+
+			// v = R.x x A.x + R.y x A.y + R.z x A.z
+			float32 vx = 0.0f, vy = 0.0f, vz = 0.0f;
+			for (u32 c = 0; c < 9; c += 3)
+			{
+				vx += r[c + 1] * a[c + 2][k] - r[c + 2] * a[c + 1][k];
+				vy += r[c + 2] * a[c + 0][k] - r[c + 0] * a[c + 2][k];
+				vz += r[c + 0] * a[c + 1][k] - r[c + 1] * a[c + 0][k];
+			}
+
+			float32 inv_s = s > 0.0f ? 1.0f / s + 1.0e-9f : 0.0f;
+
+			float32 ox = inv_s * vx, oy = inv_s * vy, oz = inv_s * vz;
+
+			bool stop = done[k] || ox * ox + oy * oy + oz * oz < tolerance;
+
+			// q = (omega / 2, 1) * q
+			float32 px = 0.5f * ox, py = 0.5f * oy, pz = 0.5f * oz;
 
-		q = omega_q * q;
-		q.Normalize();
+			float32 nx = x + px * w + py * z - pz * y;
+			float32 ny = y + py * w + pz * x - px * z;
+			float32 nz = z + pz * w + px * y - py * x;
+			float32 nw = w - px * x - py * y - pz * z;
+
+			// The length is at least the length of q. Therefore the division is safe.
+			float32 inv_length = 1.0f / b3Sqrt(nx * nx + ny * ny + nz * nz + nw * nw);
+
+			qx[k] = stop ? x : inv_length * nx;
+			qy[k] = stop ? y : inv_length * ny;
+			qz[k] = stop ? z : inv_length * nz;
+			qw[k] = stop ? w : inv_length * nw;
+
+			done[k] = stop;
+		}
 	}
+#endif
 
-	out = b3QuatMat33(q);
+	for (u32 k = 0; k < count; ++k)
+	{
+		qs[k].Set(qx[k], qy[k], qz[k], qw[k]);
+		out[k] = b3QuatMat33(qs[k]);
+	}
+
+	return iterations;
+}
+
+// A task extracting the rotations of b3_rotationTaskSize groups of elements.
+struct b3SoftBodyRotationTask
+{
+	void Execute(u32 index, u32 threadIndex)
+	{
+		B3_NOT_USED(threadIndex);
+
+		u32 begin = index * b3_rotationTaskSize * b3_rotationLaneCount;
+		u32 end = b3Min(begin + b3_rotationTaskSize * b3_rotationLaneCount, mesh->tetrahedronCount);
+
+		u32 taskIterations = 0;
+		for (u32 ei = begin; ei < end; ei += b3_rotationLaneCount)
+		{
+			u32 count = b3Min(b3_rotationLaneCount, end - ei);
+
+			b3Mat33 As[b3_rotationLaneCount];
+
+			for (u32 k = 0; k < count; ++k)
+			{
+				const b3SoftBodyMeshTetrahedron* mt = mesh->tetrahedrons + ei + k;
+
+				b3Vec3 p1 = (*p)[mt->v1];
+				b3Vec3 p2 = (*p)[mt->v2];
+				b3Vec3 p3 = (*p)[mt->v3];
+				b3Vec3 p4 = (*p)[mt->v4];
+
+				b3Mat33 E(p2 - p1, p3 - p1, p4 - p1);
+
+				As[k] = E * invEs[ei + k];
+			}
+
+			taskIterations += b3ExtractRotations(rotations + ei, qs + ei, As, count);
+		}
+
+		iterations[index] = taskIterations;
+	}
+
+	const b3SoftBodyMesh* mesh;
+	const b3Mat33* invEs;
+	b3Quat* qs;
+	const b3DenseVec3* p;
+	b3Mat33* rotations;
+	u32* iterations;
+};
+
+// Return v * (P * v), where P is the preconditioner built from a diagonal block of A.
+static B3_FORCE_INLINE float32 b3PreconditionedDot(const b3Mat33& a, const b3Vec3& v, bool blockDiagonal)
+{
+	if (blockDiagonal)
+	{
+		return b3Dot(v, a * v);
+	}
+	return a.x.x * v.x * v.x + a.y.y * v.y * v.y + a.z.z * v.z * v.z;
 }
 
 // Solve A * x = b
-static void b3SolveMPCG(b3DenseVec3& x,
-	const b3SparseMat33View& A, const b3DenseVec3& b,
+static void b3SolveMPCG(b3DenseVec3& x, b3MPCGWorkspace* workspace,
+	const b3CSRMat33& A, const b3DenseVec3& b,
 	const b3DenseVec3& z, const b3DiagMat33& S, u32 maxIterations = 20)
 {
 	B3_PROFILE("Soft Body Solve MPCG");
 
-	// Jacobi preconditioner
-	// P = diag(A) 
-	b3DiagMat33 P(A.rowCount);
-	b3DiagMat33 invP(A.rowCount);
+	workspace->Resize(A.rowCount);
+
+	b3DenseVec3& r = workspace->r;
+	b3DenseVec3& q = workspace->s;
+
+	b3ComputePreconditioner(workspace, A);
+
+	// delta_0 = (S * b) * (P * (S * b))
+	// The block preconditioners use the diagonal blocks of A for P.
+	bool blockDiagonal = workspace->preconditioner != e_jacobiPreconditioner;
+
+	float32 delta_0 = 0.0f;
 	for (u32 i = 0; i < A.rowCount; ++i)
 	{
-		b3Mat33 a = A(i, i);
+		const b3Mat33& a = A.values[A.pattern->GetBlock(i, i)];
 
-		// Sylvester Criterion to ensure PD-ness
-		B3_ASSERT(b3Det(a.x, a.y, a.z) > 0.0f);
+		delta_0 += b3PreconditionedDot(a, S[i] * b[i], blockDiagonal);
+	}
 
-		B3_ASSERT(a.x.x > 0.0f);
-		float32 xx = 1.0f / a.x.x;
+	x = z;
+
+	// r = S * (b - A * x)
+	b3ParallelMul(workspace, q, A, x);
+	b3MulSub(r, S, b, q);
+
+	u32 iteration = b3IterateMPCG(workspace, x, A, S, B3_EPSILON * B3_EPSILON * delta_0, maxIterations);
 
-		B3_ASSERT(a.y.y > 0.0f);
-		float32 yy = 1.0f / a.y.y;
+	b3_softBodySolverIterations = iteration;
+}
+
+// Solve A * x = b, where A is given as an operator and its diagonal blocks D.
+static void b3SolveMPCG(b3DenseVec3& x, b3MPCGWorkspace* workspace,
+	const b3MPCGOperator& A, const b3DiagMat33& D, const b3DenseVec3& b,
+	const b3DenseVec3& z, const b3DiagMat33& S, u32 maxIterations = 20)
+{
+	B3_PROFILE("Soft Body Solve MPCG");
 
-		B3_ASSERT(a.z.z > 0.0f);
-		float32 zz = 1.0f / a.z.z;
+	workspace->Resize(D.n);
 
-		P[i] = b3Diagonal(a.x.x, a.y.y, a.z.z);
-		invP[i] = b3Diagonal(xx, yy, zz);
+	b3DenseVec3& r = workspace->r;
+	b3DenseVec3& q = workspace->s;
+
+	b3ComputePreconditioner(workspace, D);
+
+	// The SSOR preconditioner is replaced by block Jacobi.
+	bool blockDiagonal = workspace->preconditioner != e_jacobiPreconditioner;
+
+	float32 delta_0 = 0.0f;
+	for (u32 i = 0; i < D.n; ++i)
+	{
+		delta_0 += b3PreconditionedDot(D[i], S[i] * b[i], blockDiagonal);
 	}
 
 	x = z;
 
-	float32 delta_0 = b3Dot(S * b, P * (S * b));
+	// r = S * (b - A * x)
+	A.Mul(q, x);
+	b3MulSub(r, S, b, q);
 
-	b3DenseVec3 r = S * (b - A * x);
-	b3DenseVec3 c = S * (invP * r);
+	u32 iteration = b3IterateMPCG(workspace, x, A, S, B3_EPSILON * B3_EPSILON * delta_0, maxIterations);
 
-	float32 delta_new = b3Dot(r, c);
+	b3_softBodySolverIterations = iteration;
+}
 
-	u32 iteration = 0;
-	for (;;)
-	{
-		if (iteration == maxIterations)
-		{
-			break;
-		}
+// The number of elements or nodes processed by a task of the element operator.
+const u32 b3_elementOperatorTaskSize = 256;
 
-		if (delta_new <= B3_EPSILON * B3_EPSILON * delta_0)
-		{
-			break;
-		}
+// The matrix D + scale * K, where K is the warped stiffness matrix.
+// The product by a vector is computed element by element in two passes.
+// The first pass computes the element forces R * Ke * RT * v independently.
+// The second pass gathers the element forces of each node.
+// Both passes run in parallel and the results don't depend on the number of threads.
+class b3SoftBodyElementOperator : public b3MPCGOperator
+{
+public:
+	void Mul(b3DenseVec3& out, const b3DenseVec3& v) const;
 
-		b3DenseVec3 q = S * (A * c);
+	// Element pass over elements [begin, end)
+	void ComputeElementForces(const b3DenseVec3& v, u32 begin, u32 end) const;
 
-		float32 alpha = delta_new / b3Dot(c, q);
+	// Node pass over nodes [begin, end)
+	void GatherElementForces(b3DenseVec3& out, const b3DenseVec3& v, u32 begin, u32 end) const;
 
-		x = x + alpha * c;
-		r = r - alpha * q;
+	const b3SoftBodyMesh* mesh;
 
-		b3DenseVec3 s = invP * r;
+	// Element stiffness matrices
+	const b3Mat33* stiffness;
 
-		float32 delta_old = delta_new;
+	// Element rotations
+	const b3Mat33* rotations;
 
-		delta_new = b3Dot(r, s);
+	// Node incidences. See b3SoftBody.
+	const u32* nodeElementOffsets;
+	const u32* nodeElements;
 
-		float32 beta = delta_new / delta_old;
+	// Four forces per element
+	b3Vec3* elementForces;
 
-		c = S * (s + beta * c);
+	// Diagonal blocks. This can be null.
+	const b3Mat33* D;
+	float32 scale;
 
-		++iteration;
-	}
+	b3ThreadPool* threadPool;
+};
 
-	b3_softBodySolverIterations = iteration;
+void b3SoftBodyElementOperator::ComputeElementForces(const b3DenseVec3& v, u32 begin, u32 end) const
+{
+	for (u32 ei = begin; ei < end; ++ei)
+	{
+		const b3SoftBodyMeshTetrahedron* mt = mesh->tetrahedrons + ei;
+		const b3Mat33* Ke = stiffness + b3_elementBlockCount * ei;
+
+		const b3Mat33& R = rotations[ei];
+		b3Mat33 RT = b3Transpose(R);
+
+		b3Vec3 us[4];
+		us[0] = RT * v[mt->v1];
+		us[1] = RT * v[mt->v2];
+		us[2] = RT * v[mt->v3];
+		us[3] = RT * v[mt->v4];
+
+		b3Vec3 Kus[4];
+		b3MulElement(Kus, Ke, us);
+
+		b3Vec3* fs = elementForces + 4 * ei;
+		for (u32 i = 0; i < 4; ++i)
+		{
+			fs[i] = R * Kus[i];
+		}
+	}
 }
 
-// C = A * B
-static B3_FORCE_INLINE void b3Mul(float32* C, float32* A, u32 AM, u32 AN, float32* B, u32 BM, u32 BN)
+void b3SoftBodyElementOperator::GatherElementForces(b3DenseVec3& out, const b3DenseVec3& v, u32 begin, u32 end) const
 {
-	B3_ASSERT(AN == BM);
+	for (u32 i = begin; i < end; ++i)
+	{
+		b3Vec3 f(0.0f, 0.0f, 0.0f);
+		for (u32 k = nodeElementOffsets[i]; k < nodeElementOffsets[i + 1]; ++k)
+		{
+			f += elementForces[nodeElements[k]];
+		}
+
+		out[i] = scale * f;
+
+		if (D)
+		{
+			out[i] += D[i] * v[i];
+		}
+	}
+}
 
-	for (u32 i = 0; i < AM; ++i)
+// A task running one of the passes of the element operator.
+struct b3SoftBodyElementOperatorTask
+{
+	void Execute(u32 index, u32 threadIndex)
 	{
-		for (u32 j = 0; j < BN; ++j)
+		B3_NOT_USED(threadIndex);
+
+		u32 begin = index * b3_elementOperatorTaskSize;
+		u32 end = b3Min(begin + b3_elementOperatorTaskSize, count);
+
+		if (out)
 		{
-			C[i + AM * j] = 0.0f;
+			op->GatherElementForces(*out, *v, begin, end);
+		}
+		else
+		{
+			op->ComputeElementForces(*v, begin, end);
+		}
+	}
 
-			for (u32 k = 0; k < AN; ++k)
-			{
-				C[i + AM * j] += A[i + AM * k] * B[k + BM * j];
-			}
+	const b3SoftBodyElementOperator* op;
+	b3DenseVec3* out;
+	const b3DenseVec3* v;
+	u32 count;
+};
+
+static void b3RunElementOperatorTask(b3SoftBodyElementOperatorTask* task, b3ThreadPool* threadPool)
+{
+	u32 taskCount = (task->count + b3_elementOperatorTaskSize - 1) / b3_elementOperatorTaskSize;
+
+	if (threadPool && taskCount > 1)
+	{
+		threadPool->Run(task, taskCount);
+	}
+	else
+	{
+		for (u32 i = 0; i < taskCount; ++i)
+		{
+			task->Execute(i, 0);
 		}
 	}
 }
 
+void b3SoftBodyElementOperator::Mul(b3DenseVec3& out, const b3DenseVec3& v) const
+{
+	B3_ASSERT(out.n == mesh->vertexCount);
+	B3_ASSERT(v.n == mesh->vertexCount);
+
+	b3SoftBodyElementOperatorTask task;
+	task.op = this;
+	task.v = &v;
+
+	// Element forces
+	task.out = nullptr;
+	task.count = mesh->tetrahedronCount;
+	b3RunElementOperatorTask(&task, threadPool);
+
+	// Node forces
+	task.out = &out;
+	task.count = mesh->vertexCount;
+	b3RunElementOperatorTask(&task, threadPool);
+}
+
 // ||v||
 static B3_FORCE_INLINE float32 b3Length(float32* v, u32 n)
 {
@@ -194,14 +624,126 @@ static B3_FORCE_INLINE float32 b3Length(float32* v, u32 n)
 	return b3Sqrt(result);
 }
 
+void b3SoftBodyForceSolver::ComputeRotations(b3Mat33* rotations, const b3DenseVec3& p)
+{
+	B3_PROFILE("Soft Body Extract Rotations");
+
+	u32 elementCount = m_mesh->tetrahedronCount;
+
+	if (b3_enableStiffnessWarping == false)
+	{
+		for (u32 i = 0; i < elementCount; ++i)
+		{
+			rotations[i].SetIdentity();
+		}
+		b3_softBodyRotationIterations = 0.0f;
+		return;
+	}
+
+	const u32 taskElementCount = b3_rotationTaskSize * b3_rotationLaneCount;
+	u32 taskCount = (elementCount + taskElementCount - 1) / taskElementCount;
+
+	u32* iterations = (u32*)m_allocator->Allocate(taskCount * sizeof(u32));
+
+	b3SoftBodyRotationTask task;
+	task.mesh = m_mesh;
+	task.invEs = m_body->m_elementInvE;
+	task.qs = m_body->m_elementRotations;
+	task.p = &p;
+	task.rotations = rotations;
+	task.iterations = iterations;
+
+	b3ThreadPool* threadPool = m_body->m_solverWorkspace.threadPool;
+	if (threadPool && taskCount > 1)
+	{
+		threadPool->Run(&task, taskCount);
+	}
+	else
+	{
+		for (u32 i = 0; i < taskCount; ++i)
+		{
+			task.Execute(i, 0);
+		}
+	}
+
+	// Sum in task order
+	u32 iterationCount = 0;
+	for (u32 i = 0; i < taskCount; ++i)
+	{
+		iterationCount += iterations[i];
+	}
+
+	m_allocator->Free(iterations);
+
+	b3_softBodyRotationIterations = elementCount > 0 ? float32(iterationCount) / float32(elementCount) : 0.0f;
+}
+
+// A dense vector whose elements are allocated from a stack allocator.
+// This is only used for the vectors passed to the solver.
+// These must be destroyed in the reverse order of creation.
+// The memory isn't owned by the base vector. Therefore this can't be copied or resized.
+// The destructor returns the memory to the stack allocator and leaves the base 
+// vector empty, just like a default constructed vector.
+class b3StackDenseVec3 : public b3DenseVec3
+{
+public:
+	b3StackDenseVec3(b3StackAllocator* allocator, u32 count)
+	{
+		m_allocator = allocator;
+		n = count;
+		v = (b3Vec3*)m_allocator->Allocate(n * sizeof(b3Vec3));
+	}
+
+	~b3StackDenseVec3()
+	{
+		m_allocator->Free(v);
+		v = nullptr;
+		n = 0;
+	}
+private:
+	b3StackDenseVec3(const b3StackDenseVec3&);
+	b3StackDenseVec3& operator=(const b3StackDenseVec3&);
+	b3StackDenseVec3& operator=(const b3DenseVec3&);
+	void Resize(u32 count);
+
+	b3StackAllocator* m_allocator;
+};
+
+// A diagonal matrix whose blocks are allocated from a stack allocator.
+// See b3StackDenseVec3.
+class b3StackDiagMat33 : public b3DiagMat33
+{
+public:
+	b3StackDiagMat33(b3StackAllocator* allocator, u32 count)
+	{
+		m_allocator = allocator;
+		n = count;
+		v = (b3Mat33*)m_allocator->Allocate(n * sizeof(b3Mat33));
+	}
+
+	~b3StackDiagMat33()
+	{
+		m_allocator->Free(v);
+		v = nullptr;
+		n = 0;
+	}
+private:
+	b3StackDiagMat33(const b3StackDiagMat33&);
+	b3StackDiagMat33& operator=(const b3StackDiagMat33&);
+	b3StackDiagMat33& operator=(const b3DiagMat33&);
+	void Resize(u32 count);
+
+	b3StackAllocator* m_allocator;
+};
+
 void b3SoftBodyForceSolver::Solve(float32 dt, const b3Vec3& gravity)
 {
 	float32 h = dt;
 	float32 inv_h = 1.0f / h;
 
-	b3SparseMat33 M(m_mesh->vertexCount);
-	b3SparseMat33 C(m_mesh->vertexCount);
-	b3SparseMat33 K(m_mesh->vertexCount);
+	b3DiagMat33 M(m_mesh->vertexCount);
+	b3DiagMat33 C(m_mesh->vertexCount);
+	b3CSRMat33& K = m_body->m_K;
 	b3DenseVec3 x(m_mesh->vertexCount);
 	b3DenseVec3 p(m_mesh->vertexCount);
 	b3DenseVec3 v(m_mesh->vertexCount);
@@ -215,12 +757,12 @@ void b3SoftBodyForceSolver::Solve(float32 dt, const b3Vec3& gravity)
 	{
 		b3SoftBodyNode* n = m_nodes + i;
 
-		M(i, i) = b3Diagonal(n->m_mass);
+		M[i] = b3Diagonal(n->m_mass);
 
 		// Rayleigh damping 
 		// C = alpha * M + beta * K
 		// Here the stiffness coefficient beta is zero
-		C(i, i) = b3Diagonal(n->m_massDamping * n->m_mass);
+		C[i] = b3Diagonal(n->m_massDamping * n->m_mass);
 
 		x[i] = m_mesh->vertices[i];
 		p[i] = n->m_position;
@@ -240,7 +782,33 @@ void b3SoftBodyForceSolver::Solve(float32 dt, const b3Vec3& gravity)
 		}
 	}
 
+	// In matrix-free mode K is never assembled.
+	// Only the element rotations and the diagonal blocks of K are kept.
+	bool matrixFree = m_body->m_matrixFree;
+
+	b3Mat33* Kd = nullptr;
+	if (matrixFree)
+	{
+		Kd = (b3Mat33*)m_allocator->Allocate(m_mesh->vertexCount * sizeof(b3Mat33));
+	}
+
+	// Element rotations
+	b3Mat33* Rs = (b3Mat33*)m_allocator->Allocate(m_mesh->tetrahedronCount * sizeof(b3Mat33));
+	ComputeRotations(Rs, p);
+
 	// Element assembly
+	if (matrixFree)
+	{
+		for (u32 i = 0; i < m_mesh->vertexCount; ++i)
+		{
+			Kd[i].SetZero();
+		}
+	}
+	else
+	{
+		K.SetZero();
+	}
+
 	f0.SetZero();
 	f_plastic.SetZero();
 
@@ -249,11 +817,7 @@ void b3SoftBodyForceSolver::Solve(float32 dt, const b3Vec3& gravity)
 		b3SoftBodyMeshTetrahedron* mt = m_mesh->tetrahedrons + ei;
 		b3SoftBodyElement* e = m_elements + ei;
 
-		b3Mat33* Ke = e->K;
-
-		float32* Be = e->B;
-		float32* Pe = e->P;
-		float32* epsilon_plastic = e->epsilon_plastic;
+		const b3Mat33* Ke = m_body->m_elementStiffness + b3_elementBlockCount * ei;
 
 		u32 v1 = mt->v1;
 		u32 v2 = mt->v2;
@@ -265,37 +829,37 @@ void b3SoftBodyForceSolver::Solve(float32 dt, const b3Vec3& gravity)
 		b3Vec3 p3 = p[v3];
 		b3Vec3 p4 = p[v4];
 
-		b3Mat33 R;
-		if (b3_enableStiffnessWarping)
-		{
-			b3Vec3 e1 = p2 - p1;
-			b3Vec3 e2 = p3 - p1;
-			b3Vec3 e3 = p4 - p1;
-
-			b3Mat33 E(e1, e2, e3);
+		const b3Mat33& R = Rs[ei];
+		b3Mat33 RT = b3Transpose(R);
 
-			b3Mat33 A = E * e->invE;
+		u32 vs[4] = { v1, v2, v3, v4 };
 
-			b3ExtractRotation(R, e->q, A);
+		if (matrixFree)
+		{
+			for (u32 i = 0; i < 4; ++i)
+			{
+				Kd[vs[i]] += R * Ke[b3GetElementBlockIndex(i, i)] * RT;
+			}
 		}
 		else
 		{
-			R.SetIdentity();
-		}
+			for (u32 i = 0; i < 4; ++i)
+			{
+				u32 vi = vs[i];
 
-		b3Mat33 RT = b3Transpose(R);
+				for (u32 j = i; j < 4; ++j)
+				{
+					u32 vj = vs[j];
 
-		u32 vs[4] = { v1, v2, v3, v4 };
+					b3Mat33 Kij = R * Ke[b3GetElementBlockIndex(i, j)] * RT;
 
-		for (u32 i = 0; i < 4; ++i)
-		{
-			u32 vi = vs[i];
+					K(vi, vj) += Kij;
 
-			for (u32 j = 0; j < 4; ++j)
-			{
-				u32 vj = vs[j];
-
-				K(vi, vj) += R * Ke[i + 4 * j] * RT;
+					if (j != i)
+					{
+						K(vj, vi) += b3Transpose(Kij);
+					}
+				}
 			}
 		}
 
@@ -308,15 +872,11 @@ void b3SoftBodyForceSolver::Solve(float32 dt, const b3Vec3& gravity)
 		b3Vec3 xs[4] = { x1, x2, x3, x4 };
 
 		b3Vec3 f0s[4];
+		b3MulElement(f0s, Ke, xs);
 
 		for (u32 i = 0; i < 4; ++i)
 		{
-			f0s[i].SetZero();
-
-			for (u32 j = 0; j < 4; ++j)
-			{
-				f0s[i] += R * Ke[i + 4 * j] * xs[j];
-			}
+			f0s[i] = R * f0s[i];
 		}
 
 		f0[v1] += f0s[0];
@@ -325,6 +885,15 @@ void b3SoftBodyForceSolver::Solve(float32 dt, const b3Vec3& gravity)
 		f0[v4] += f0s[3];
 
 		// Plasticity
+		if (e->plasticIndex == B3_MAX_U32)
+		{
+			continue;
+		}
+
+		b3SoftBodyElementPlasticity* ep = m_body->m_elementPlasticity + e->plasticIndex;
+
+		float32* epsilon_plastic = ep->epsilon_plastic;
+
 		b3Vec3 ps[4] = { p1, p2, p3, p4 };
 
 		b3Vec3 RT_x_x0[4];
@@ -333,9 +902,21 @@ void b3SoftBodyForceSolver::Solve(float32 dt, const b3Vec3& gravity)
 			RT_x_x0[i] = RT * ps[i] - xs[i];
 		}
 
+		// epsilon_total = B * (RT * x - x0)
 		// 6 x 1
-		float32 epsilon_total[6];
-		b3Mul(epsilon_total, Be, 6, 12, &RT_x_x0[0].x, 12, 1);
+		float32 epsilon_total[6] = { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f };
+		for (u32 i = 0; i < 4; ++i)
+		{
+			b3Vec3 g = ep->gradients[i];
+			b3Vec3 u = RT_x_x0[i];
+
+			epsilon_total[0] += g.x * u.x;
+			epsilon_total[1] += g.y * u.y;
+			epsilon_total[2] += g.z * u.z;
+			epsilon_total[3] += g.y * u.x + g.x * u.y;
+			epsilon_total[4] += g.z * u.x + g.x * u.z;
+			epsilon_total[5] += g.z * u.y + g.y * u.z;
+		}
 
 		// 6 x 1
 		float32 epsilon_elastic[6];
@@ -364,11 +945,30 @@ void b3SoftBodyForceSolver::Solve(float32 dt, const b3Vec3& gravity)
 			}
 		}
 
+		// sigma = V * D * epsilon_plastic
+		float32 lambda = ep->lambda;
+		float32 mu = ep->mu;
+		float32 trace = epsilon_plastic[0] + epsilon_plastic[1] + epsilon_plastic[2];
+
+		float32 sigma[6];
+		for (u32 i = 0; i < 3; ++i)
+		{
+			sigma[i] = ep->volume * (lambda * trace + 2.0f * mu * epsilon_plastic[i]);
+			sigma[i + 3] = ep->volume * mu * epsilon_plastic[i + 3];
+		}
+
+		// f_plastic = R * BT * sigma
 		b3Vec3 fs_plastic[4];
-		b3Mul(&fs_plastic[0].x, Pe, 12, 6, epsilon_plastic, 6, 1);
 		for (u32 i = 0; i < 4; ++i)
 		{
-			fs_plastic[i] = R * fs_plastic[i];
+			b3Vec3 g = ep->gradients[i];
+
+			b3Vec3 f;
+			f.x = g.x * sigma[0] + g.y * sigma[3] + g.z * sigma[4];
+			f.y = g.y * sigma[1] + g.x * sigma[3] + g.z * sigma[5];
+			f.z = g.z * sigma[2] + g.x * sigma[4] + g.y * sigma[5];
+
+			fs_plastic[i] = R * f;
 		}
 
 		f_plastic[v1] += fs_plastic[0];
@@ -377,16 +977,84 @@ void b3SoftBodyForceSolver::Solve(float32 dt, const b3Vec3& gravity)
 		f_plastic[v4] += fs_plastic[3];
 	}
 
-	f0 = -f0;
+	b3DenseVec3 sx(m_mesh->vertexCount);
 
-	b3SparseMat33 A = M + h * C + h * h * K;
+	if (matrixFree)
+	{
+		b3StackDenseVec3 b(m_allocator, m_mesh->vertexCount);
+		b3StackDiagMat33 Ad(m_allocator, m_mesh->vertexCount);
+		b3Mat33* MhC = (b3Mat33*)m_allocator->Allocate(m_mesh->vertexCount * sizeof(b3Mat33));
+		b3Vec3* elementForces = (b3Vec3*)m_allocator->Allocate(4 * m_mesh->tetrahedronCount * sizeof(b3Vec3));
+
+		b3SoftBodyElementOperator op;
+		op.mesh = m_mesh;
+		op.stiffness = m_body->m_elementStiffness;
+		op.rotations = Rs;
+		op.nodeElementOffsets = m_body->m_nodeElementOffsets;
+		op.nodeElements = m_body->m_nodeElements;
+		op.elementForces = elementForces;
+		op.threadPool = m_body->m_solverWorkspace.threadPool;
+
+		// b = M * v - h * (K * p - f0 - (f_plastic + fe))
+		op.D = nullptr;
+		op.scale = 1.0f;
+		op.Mul(b, p);
+		for (u32 i = 0; i < m_mesh->vertexCount; ++i)
+		{
+			b[i] = M[i] * v[i] - h * (b[i] - f0[i] - (f_plastic[i] + fe[i]));
+		}
 
-	b3SparseMat33View viewA(A);
+		// A = M + h * C + h * h * K 
+		for (u32 i = 0; i < m_mesh->vertexCount; ++i)
+		{
+			MhC[i] = M[i] + h * C[i];
+			Ad[i] = MhC[i] + (h * h) * Kd[i];
+		}
 
-	b3DenseVec3 b = M * v - h * (K * p + f0 - (f_plastic + fe));
+		op.D = MhC;
+		op.scale = h * h;
 
-	b3DenseVec3 sx(m_mesh->vertexCount);
-	b3SolveMPCG(sx, viewA, b, z, S);
+		b3SolveMPCG(sx, &m_body->m_solverWorkspace, op, Ad, b, z, S);
+
+		m_allocator->Free(elementForces);
+		m_allocator->Free(MhC);
+	}
+	else
+	{
+		// b = M * v - h * (K * p - f0 - (f_plastic + fe))
+		b3StackDenseVec3 b(m_allocator, m_mesh->vertexCount);
+		b3Mul(b, K, p);
+		for (u32 i = 0; i < m_mesh->vertexCount; ++i)
+		{
+			b[i] = M[i] * v[i] - h * (b[i] - f0[i] - (f_plastic[i] + fe[i]));
+		}
+
+		// A = M + h * C + h * h * K 
+		// K is no longer needed. Therefore A can be written over K.
+		b3CSRMat33& A = K;
+		const b3SparsePattern* pattern = A.pattern;
+		for (u32 i = 0; i < m_mesh->vertexCount; ++i)
+		{
+			for (u32 k = pattern->rowOffsets[i]; k < pattern->rowOffsets[i + 1]; ++k)
+			{
+				A.values[k] = (h * h) * K.values[k];
+
+				if (pattern->columns[k] == i)
+				{
+					A.values[k] += M[i] + h * C[i];
+				}
+			}
+		}
+
+		b3SolveMPCG(sx, &m_body->m_solverWorkspace, A, b, z, S);
+	}
+
+	m_allocator->Free(Rs);
+
+	if (matrixFree)
+	{
+		m_allocator->Free(Kd);
+	}
 
 	// Copy velocity back to the particle
 	for (u32 i = 0; i < m_mesh->vertexCount; ++i)
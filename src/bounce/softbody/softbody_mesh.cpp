@@ -19,6 +19,7 @@
 #include <bounce/softbody/softbody_mesh.h>
 #include <bounce/meshgen/sphere_mesh.h>
 #include <bounce/meshgen/cylinder_mesh.h>
+#include <bounce/collision/shapes/mesh.h>
 
 b3QSoftBodyMesh::b3QSoftBodyMesh()
 {
@@ -110,4 +111,472 @@ void b3QSoftBodyMesh::SetAsCylinder(float32 radius, float32 ey, u32 segments)
 		vertices[i].y *= height;
 		vertices[i].z *= radius;
 	}
+}
+
+// Test if a triangle overlaps a box given its center and half extents.
+// This is a separating axis test with the box axes, the triangle normal
+// and the cross products of the box axes and the triangle edges.
+static bool b3TestTriangleBox(const b3Vec3& center, const b3Vec3& h, const b3Vec3& A, const b3Vec3& B, const b3Vec3& C)
+{
+	b3Vec3 v[3] = { A - center, B - center, C - center };
+
+	// Box axes
+	for (u32 i = 0; i < 3; ++i)
+	{
+		float32 lower = b3Min(v[0][i], b3Min(v[1][i], v[2][i]));
+		float32 upper = b3Max(v[0][i], b3Max(v[1][i], v[2][i]));
+
+		if (lower > h[i] || upper < -h[i])
+		{
+			return false;
+		}
+	}
+
+	b3Vec3 e[3] = { v[1] - v[0], v[2] - v[1], v[0] - v[2] };
+
+	// Triangle normal
+	{
+		b3Vec3 n = b3Cross(e[0], e[1]);
+		float32 d = b3Dot(n, v[0]);
+		float32 r = h.x * b3Abs(n.x) + h.y * b3Abs(n.y) + h.z * b3Abs(n.z);
+
+		if (b3Abs(d) > r)
+		{
+			return false;
+		}
+	}
+
+	// Edge axes
+	b3Vec3 axes[3] = { b3Vec3_x, b3Vec3_y, b3Vec3_z };
+
+	for (u32 i = 0; i < 3; ++i)
+	{
+		for (u32 j = 0; j < 3; ++j)
+		{
+			b3Vec3 a = b3Cross(axes[i], e[j]);
+
+			float32 p0 = b3Dot(v[0], a);
+			float32 p1 = b3Dot(v[1], a);
+			float32 p2 = b3Dot(v[2], a);
+			float32 r = h.x * b3Abs(a.x) + h.y * b3Abs(a.y) + h.z * b3Abs(a.z);
+
+			if (b3Min(p0, b3Min(p1, p2)) > r || b3Max(p0, b3Max(p1, p2)) < -r)
+			{
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+// The corners of a cell are indexed by their offsets along the axes (x = 1, y = 2, z = 4).
+// A cell is split into six tetrahedrons sharing the diagonal from corner 0 to corner 7.
+// Every cell is split in the same way, so the faces of neighbour cells match.
+static const u32 b3_cellTetrahedrons[6][4] =
+{
+	{ 0, 1, 3, 7 },
+	{ 0, 1, 5, 7 },
+	{ 0, 2, 3, 7 },
+	{ 0, 2, 6, 7 },
+	{ 0, 4, 5, 7 },
+	{ 0, 4, 6, 7 }
+};
+
+// Return the number of cells needed to cover a given extent.
+static u32 b3GetCellCount(float32 extent, float32 h)
+{
+	u32 count = u32(extent / h);
+	if (float32(count) * h < extent)
+	{
+		++count;
+	}
+	return b3Max(count, 1u);
+}
+
+void b3QSoftBodyMesh::SetAsTriangleMesh(const b3Mesh* mesh, u32 resolution, b3SoftBodyMeshBinding* bindings)
+{
+	B3_ASSERT(vertexCount == 0);
+	B3_ASSERT(tetrahedronCount == 0);
+	B3_ASSERT(resolution > 0);
+	B3_ASSERT(mesh->vertexCount > 0 && mesh->triangleCount > 0);
+
+	b3AABB3 bounds;
+	bounds.Set(mesh->vertices, mesh->vertexCount);
+
+	b3Vec3 extents = bounds.m_upper - bounds.m_lower;
+	float32 maxExtent = b3Max(extents.x, b3Max(extents.y, extents.z));
+	B3_ASSERT(maxExtent > 0.0f);
+
+	float32 h = maxExtent / float32(resolution);
+
+	u32 nx = b3GetCellCount(extents.x, h);
+	u32 ny = b3GetCellCount(extents.y, h);
+	u32 nz = b3GetCellCount(extents.z, h);
+
+	// Center the grid on the mesh.
+	b3Vec3 origin = bounds.Centroid() - 0.5f * h * b3Vec3(float32(nx), float32(ny), float32(nz));
+
+	u32 cellCount = nx * ny * nz;
+	bool* cells = (bool*)b3Alloc(cellCount * sizeof(bool));
+	for (u32 i = 0; i < cellCount; ++i)
+	{
+		cells[i] = false;
+	}
+
+	// Find the cells inside the mesh.
+	// A row of cells along the x axis is inside between pairs of surface crossings.
+	// The rows are moved slightly off the cell centers so that they don't
+	// pass through the vertices and edges of regular meshes.
+	// Otherwise a crossing could be counted twice.
+	{
+		const float32 rowOffsetY = 0.5f + 1.237e-3f;
+		const float32 rowOffsetZ = 0.5f + 2.473e-3f;
+
+		u32 rowCount = ny * nz;
+		u32* rowOffsets = (u32*)b3Alloc((rowCount + 1) * sizeof(u32));
+		for (u32 i = 0; i <= rowCount; ++i)
+		{
+			rowOffsets[i] = 0;
+		}
+
+		float32* crossings = nullptr;
+
+		// The first pass counts the crossings of each row and the second pass stores them.
+		for (u32 pass = 0; pass < 2; ++pass)
+		{
+			for (u32 i = 0; i < mesh->triangleCount; ++i)
+			{
+				const b3Triangle* t = mesh->triangles + i;
+
+				b3Vec3 A = mesh->vertices[t->v1];
+				b3Vec3 B = mesh->vertices[t->v2];
+				b3Vec3 C = mesh->vertices[t->v3];
+
+				// The crossing is found in the y-z plane.
+				double d = double(B.y - A.y) * double(C.z - A.z) - double(C.y - A.y) * double(B.z - A.z);
+				if (d == 0.0)
+				{
+					continue;
+				}
+
+				float32 lowerY = b3Min(A.y, b3Min(B.y, C.y));
+				float32 upperY = b3Max(A.y, b3Max(B.y, C.y));
+				float32 lowerZ = b3Min(A.z, b3Min(B.z, C.z));
+				float32 upperZ = b3Max(A.z, b3Max(B.z, C.z));
+
+				i32 j1 = b3Max(i32(floorf((lowerY - origin.y) / h - rowOffsetY)), 0);
+				i32 j2 = b3Min(i32(floorf((upperY - origin.y) / h - rowOffsetY)) + 1, i32(ny) - 1);
+				i32 k1 = b3Max(i32(floorf((lowerZ - origin.z) / h - rowOffsetZ)), 0);
+				i32 k2 = b3Min(i32(floorf((upperZ - origin.z) / h - rowOffsetZ)) + 1, i32(nz) - 1);
+
+				for (i32 k = k1; k <= k2; ++k)
+				{
+					double z = double(origin.z) + (double(k) + rowOffsetZ) * double(h);
+
+					for (i32 j = j1; j <= j2; ++j)
+					{
+						double y = double(origin.y) + (double(j) + rowOffsetY) * double(h);
+
+						// Barycentric coordinates
+						double u = ((double(B.y) - y) * (double(C.z) - z) - (double(C.y) - y) * (double(B.z) - z)) / d;
+						double v = ((double(C.y) - y) * (double(A.z) - z) - (double(A.y) - y) * (double(C.z) - z)) / d;
+						double w = 1.0 - u - v;
+
+						if (u < 0.0 || v < 0.0 || w < 0.0)
+						{
+							continue;
+						}
+
+						u32 row = u32(j) + ny * u32(k);
+
+						if (pass == 0)
+						{
+							++rowOffsets[row + 1];
+						}
+						else
+						{
+							crossings[rowOffsets[row]++] = float32(u * A.x + v * B.x + w * C.x);
+						}
+					}
+				}
+			}
+
+			if (pass == 0)
+			{
+				for (u32 r = 0; r < rowCount; ++r)
+				{
+					rowOffsets[r + 1] += rowOffsets[r];
+				}
+
+				crossings = (float32*)b3Alloc(b3Max(rowOffsets[rowCount], 1u) * sizeof(float32));
+			}
+		}
+
+		// The offsets were shifted by one row while storing.
+		for (u32 r = rowCount; r > 0; --r)
+		{
+			rowOffsets[r] = rowOffsets[r - 1];
+		}
+		rowOffsets[0] = 0;
+
+		for (u32 r = 0; r < rowCount; ++r)
+		{
+			float32* xs = crossings + rowOffsets[r];
+			u32 count = rowOffsets[r + 1] - rowOffsets[r];
+
+			// Sort the crossings along the row.
+			for (u32 i = 1; i < count; ++i)
+			{
+				float32 x = xs[i];
+				u32 j = i;
+				while (j > 0 && xs[j - 1] > x)
+				{
+					xs[j] = xs[j - 1];
+					--j;
+				}
+				xs[j] = x;
+			}
+
+			// A cell center is inside if an odd number of crossings are before it.
+			u32 index = 0;
+			for (u32 i = 0; i < nx; ++i)
+			{
+				float32 x = origin.x + (float32(i) + 0.5f) * h;
+
+				while (index < count && xs[index] < x)
+				{
+					++index;
+				}
+
+				cells[i + nx * r] = (index & 1) != 0;
+			}
+		}
+
+		b3Free(crossings);
+		b3Free(rowOffsets);
+	}
+
+	// Add the cells touching the surface.
+	// The cells are shrunk a bit so that a face lying on a cell face
+	// doesn't add the cell in front of it.
+	{
+		b3Vec3 halfExtents;
+		halfExtents.Set(0.5f * h, 0.5f * h, 0.5f * h);
+		halfExtents *= 1.0f - 1.0e-4f;
+
+		for (u32 i = 0; i < mesh->triangleCount; ++i)
+		{
+			const b3Triangle* t = mesh->triangles + i;
+
+			b3Vec3 A = mesh->vertices[t->v1];
+			b3Vec3 B = mesh->vertices[t->v2];
+			b3Vec3 C = mesh->vertices[t->v3];
+
+			b3Vec3 lower = (b3Min(A, b3Min(B, C)) - origin) / h;
+			b3Vec3 upper = (b3Max(A, b3Max(B, C)) - origin) / h;
+
+			u32 i1 = u32(b3Clamp(i32(floorf(lower.x)), 0, i32(nx) - 1));
+			u32 i2 = u32(b3Clamp(i32(floorf(upper.x)), 0, i32(nx) - 1));
+			u32 j1 = u32(b3Clamp(i32(floorf(lower.y)), 0, i32(ny) - 1));
+			u32 j2 = u32(b3Clamp(i32(floorf(upper.y)), 0, i32(ny) - 1));
+			u32 k1 = u32(b3Clamp(i32(floorf(lower.z)), 0, i32(nz) - 1));
+			u32 k2 = u32(b3Clamp(i32(floorf(upper.z)), 0, i32(nz) - 1));
+
+			for (u32 ck = k1; ck <= k2; ++ck)
+			{
+				for (u32 cj = j1; cj <= j2; ++cj)
+				{
+					for (u32 ci = i1; ci <= i2; ++ci)
+					{
+						u32 cell = ci + nx * (cj + ny * ck);
+						if (cells[cell])
+						{
+							continue;
+						}
+
+						b3Vec3 center = origin + h * b3Vec3(float32(ci) + 0.5f, float32(cj) + 0.5f, float32(ck) + 0.5f);
+
+						cells[cell] = b3TestTriangleBox(center, halfExtents, A, B, C);
+					}
+				}
+			}
+		}
+	}
+
+	// Create a vertex for each grid point used by a cell
+	// and six tetrahedrons for each cell.
+	u32 px = nx + 1;
+	u32 py = ny + 1;
+	u32 pointCount = px * py * (nz + 1);
+	u32* pointVertices = (u32*)b3Alloc(pointCount * sizeof(u32));
+	for (u32 i = 0; i < pointCount; ++i)
+	{
+		pointVertices[i] = B3_MAX_U32;
+	}
+
+	// Index of the first tetrahedron of each cell
+	u32* cellTetrahedrons = (u32*)b3Alloc(cellCount * sizeof(u32));
+
+	for (u32 ck = 0; ck < nz; ++ck)
+	{
+		for (u32 cj = 0; cj < ny; ++cj)
+		{
+			for (u32 ci = 0; ci < nx; ++ci)
+			{
+				u32 cell = ci + nx * (cj + ny * ck);
+				if (cells[cell] == false)
+				{
+					cellTetrahedrons[cell] = B3_MAX_U32;
+					continue;
+				}
+
+				cellTetrahedrons[cell] = tetrahedronCount;
+				tetrahedronCount += 6;
+
+				for (u32 c = 0; c < 8; ++c)
+				{
+					u32 point = (ci + (c & 1)) + px * ((cj + ((c >> 1) & 1)) + py * (ck + ((c >> 2) & 1)));
+					if (pointVertices[point] == B3_MAX_U32)
+					{
+						pointVertices[point] = vertexCount++;
+					}
+				}
+			}
+		}
+	}
+
+	B3_ASSERT(tetrahedronCount > 0);
+
+	vertices = (b3Vec3*)b3Alloc(vertexCount * sizeof(b3Vec3));
+	tetrahedrons = (b3SoftBodyMeshTetrahedron*)b3Alloc(tetrahedronCount * sizeof(b3SoftBodyMeshTetrahedron));
+
+	for (u32 pk = 0; pk <= nz; ++pk)
+	{
+		for (u32 pj = 0; pj <= ny; ++pj)
+		{
+			for (u32 pi = 0; pi <= nx; ++pi)
+			{
+				u32 vertex = pointVertices[pi + px * (pj + py * pk)];
+				if (vertex != B3_MAX_U32)
+				{
+					vertices[vertex] = origin + h * b3Vec3(float32(pi), float32(pj), float32(pk));
+				}
+			}
+		}
+	}
+
+	for (u32 ck = 0; ck < nz; ++ck)
+	{
+		for (u32 cj = 0; cj < ny; ++cj)
+		{
+			for (u32 ci = 0; ci < nx; ++ci)
+			{
+				u32 cell = ci + nx * (cj + ny * ck);
+				if (cells[cell] == false)
+				{
+					continue;
+				}
+
+				u32 cv[8];
+				for (u32 c = 0; c < 8; ++c)
+				{
+					u32 point = (ci + (c & 1)) + px * ((cj + ((c >> 1) & 1)) + py * (ck + ((c >> 2) & 1)));
+					cv[c] = pointVertices[point];
+				}
+
+				for (u32 i = 0; i < 6; ++i)
+				{
+					b3SoftBodyMeshTetrahedron* t = tetrahedrons + cellTetrahedrons[cell] + i;
+
+					t->v1 = cv[b3_cellTetrahedrons[i][0]];
+					t->v2 = cv[b3_cellTetrahedrons[i][1]];
+					t->v3 = cv[b3_cellTetrahedrons[i][2]];
+					t->v4 = cv[b3_cellTetrahedrons[i][3]];
+
+					// Keep the vertex order of the other meshes.
+					// The last vertex is in front of the first face.
+					b3Vec3 p1 = vertices[t->v1];
+					b3Vec3 p2 = vertices[t->v2];
+					b3Vec3 p3 = vertices[t->v3];
+					b3Vec3 p4 = vertices[t->v4];
+
+					if (b3Det(p2 - p1, p3 - p1, p4 - p1) < 0.0f)
+					{
+						b3Swap(t->v3, t->v4);
+					}
+				}
+			}
+		}
+	}
+
+	if (bindings)
+	{
+		// Find the tetrahedron containing each mesh vertex.
+		// A vertex on a cell face can be in the cells on both sides of the face
+		// and only one of them might exist. Therefore the neighbour cells are searched as well.
+		for (u32 v = 0; v < mesh->vertexCount; ++v)
+		{
+			b3Vec3 p = mesh->vertices[v];
+			b3Vec3 q = (p - origin) / h;
+
+			i32 ci = b3Clamp(i32(floorf(q.x)), 0, i32(nx) - 1);
+			i32 cj = b3Clamp(i32(floorf(q.y)), 0, i32(ny) - 1);
+			i32 ck = b3Clamp(i32(floorf(q.z)), 0, i32(nz) - 1);
+
+			b3SoftBodyMeshBinding* binding = bindings + v;
+			binding->tetrahedron = B3_MAX_U32;
+
+			float32 bestWeight = -B3_MAX_FLOAT;
+
+			for (i32 k = b3Max(ck - 1, 0); k <= b3Min(ck + 1, i32(nz) - 1); ++k)
+			{
+				for (i32 j = b3Max(cj - 1, 0); j <= b3Min(cj + 1, i32(ny) - 1); ++j)
+				{
+					for (i32 i = b3Max(ci - 1, 0); i <= b3Min(ci + 1, i32(nx) - 1); ++i)
+					{
+						u32 cell = u32(i) + nx * (u32(j) + ny * u32(k));
+						if (cells[cell] == false)
+						{
+							continue;
+						}
+
+						for (u32 ti = 0; ti < 6; ++ti)
+						{
+							u32 index = cellTetrahedrons[cell] + ti;
+							const b3SoftBodyMeshTetrahedron* t = tetrahedrons + index;
+
+							b3Vec3 p1 = vertices[t->v1];
+							b3Vec3 p2 = vertices[t->v2];
+							b3Vec3 p3 = vertices[t->v3];
+							b3Vec3 p4 = vertices[t->v4];
+
+							b3Mat33 E(p2 - p1, p3 - p1, p4 - p1);
+							b3Vec3 w = b3Inverse(E) * (p - p1);
+
+							float32 weights[4] = { 1.0f - w.x - w.y - w.z, w.x, w.y, w.z };
+
+							// Keep the tetrahedron where the point is the deepest.
+							float32 minWeight = b3Min(b3Min(weights[0], weights[1]), b3Min(weights[2], weights[3]));
+							if (minWeight > bestWeight)
+							{
+								bestWeight = minWeight;
+								binding->tetrahedron = index;
+								for (u32 wi = 0; wi < 4; ++wi)
+								{
+									binding->weights[wi] = weights[wi];
+								}
+							}
+						}
+					}
+				}
+			}
+
+			B3_ASSERT(binding->tetrahedron != B3_MAX_U32);
+		}
+	}
+
+	b3Free(cellTetrahedrons);
+	b3Free(pointVertices);
+	b3Free(cells);
 }
\ No newline at end of file
@@ -25,22 +25,28 @@ void b3SoftBodyNode::Synchronize(const b3Vec3& displacement)
 	aabb.Set(m_position, m_radius);
 
 	m_body->m_contactManager.m_broadPhase.MoveProxy(m_broadPhaseId, aabb, displacement);
+
+	m_body->m_triangleTreeDirty = true;
+}
+
+bool b3SoftBodyNode::IsAwake() const
+{
+	return m_body->IsAwake();
+}
+
+void b3SoftBodyNode::SetAwake()
+{
+	m_body->SetAwake(true);
 }
 
 void b3SoftBodyNode::DestroyContacts()
 {
 	// Destroy body contacts
-	b3NodeBodyContact* c = m_body->m_contactManager.m_nodeBodyContactList.m_head;
-	while (c)
+	b3NodeBodyContactEdge* ce = m_contactEdges.m_head;
+	while (ce)
 	{
-		if (c->m_n1 == this)
-		{
-			b3NodeBodyContact* quack = c;
-			c = c->m_next;
-			m_body->m_contactManager.Destroy(quack);
-			continue;
-		}
-
-		c = c->m_next;
+		b3NodeBodyContactEdge* quack = ce;
+		ce = ce->m_next;
+		m_body->m_contactManager.Destroy(quack->contact);
 	}
 }
\ No newline at end of file
@@ -0,0 +1,169 @@
+/*
+* Copyright (c) 2016-2019 Irlan Robson https://irlanrobson.github.io
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+#include <bounce/sparse/dense_vec3.h>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define B3_SIMD_SSE
+#include <xmmintrin.h>
+#endif
+
+// The vectors are processed as flat arrays of 3 * n floats.
+// This assumes b3Vec3 is tightly packed.
+
+#ifdef B3_SIMD_SSE
+
+// Return the sum of the 4 components.
+static B3_FORCE_INLINE float32 b3HorizontalAdd(__m128 v)
+{
+	__m128 s = _mm_add_ps(v, _mm_movehl_ps(v, v));
+	s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 1));
+	return _mm_cvtss_f32(s);
+}
+
+#endif
+
+float32 b3Dot(const b3DenseVec3& a, const b3DenseVec3& b)
+{
+	return b3Dot(a, b, 0, a.n);
+}
+
+float32 b3Dot(const b3DenseVec3& a, const b3DenseVec3& b, u32 begin, u32 end)
+{
+	B3_ASSERT(a.n == b.n);
+	B3_ASSERT(begin <= end && end <= a.n);
+
+	const float32* pa = (const float32*)(a.v + begin);
+	const float32* pb = (const float32*)(b.v + begin);
+	u32 count = 3 * (end - begin);
+
+	u32 i = 0;
+	float32 result = 0.0f;
+
+#ifdef B3_SIMD_SSE
+	__m128 sum1 = _mm_setzero_ps();
+	__m128 sum2 = _mm_setzero_ps();
+	for (; i + 8 <= count; i += 8)
+	{
+		sum1 = _mm_add_ps(sum1, _mm_mul_ps(_mm_loadu_ps(pa + i), _mm_loadu_ps(pb + i)));
+		sum2 = _mm_add_ps(sum2, _mm_mul_ps(_mm_loadu_ps(pa + i + 4), _mm_loadu_ps(pb + i + 4)));
+	}
+	result = b3HorizontalAdd(_mm_add_ps(sum1, sum2));
+#endif
+
+	for (; i < count; ++i)
+	{
+		result += pa[i] * pb[i];
+	}
+
+	return result;
+}
+
+void b3Axpy(b3DenseVec3& y, float32 a, const b3DenseVec3& x)
+{
+	b3Axpy(y, a, x, 0, y.n);
+}
+
+void b3Axpy(b3DenseVec3& y, float32 a, const b3DenseVec3& x, u32 begin, u32 end)
+{
+	B3_ASSERT(y.n == x.n);
+	B3_ASSERT(begin <= end && end <= y.n);
+
+	float32* py = (float32*)(y.v + begin);
+	const float32* px = (const float32*)(x.v + begin);
+	u32 count = 3 * (end - begin);
+
+	u32 i = 0;
+
+#ifdef B3_SIMD_SSE
+	__m128 va = _mm_set1_ps(a);
+	for (; i + 4 <= count; i += 4)
+	{
+		_mm_storeu_ps(py + i, _mm_add_ps(_mm_loadu_ps(py + i), _mm_mul_ps(va, _mm_loadu_ps(px + i))));
+	}
+#endif
+
+	for (; i < count; ++i)
+	{
+		py[i] += a * px[i];
+	}
+}
+
+void b3Xpay(b3DenseVec3& y, const b3DenseVec3& x, float32 a)
+{
+	B3_ASSERT(y.n == x.n);
+
+	float32* py = (float32*)y.v;
+	const float32* px = (const float32*)x.v;
+	u32 count = 3 * y.n;
+
+	u32 i = 0;
+
+#ifdef B3_SIMD_SSE
+	__m128 va = _mm_set1_ps(a);
+	for (; i + 4 <= count; i += 4)
+	{
+		_mm_storeu_ps(py + i, _mm_add_ps(_mm_loadu_ps(px + i), _mm_mul_ps(va, _mm_loadu_ps(py + i))));
+	}
+#endif
+
+	for (; i < count; ++i)
+	{
+		py[i] = px[i] + a * py[i];
+	}
+}
+
+float32 b3ScaleDot(b3DenseVec3& out, const b3DenseVec3& d, const b3DenseVec3& v)
+{
+	return b3ScaleDot(out, d, v, 0, out.n);
+}
+
+float32 b3ScaleDot(b3DenseVec3& out, const b3DenseVec3& d, const b3DenseVec3& v, u32 begin, u32 end)
+{
+	B3_ASSERT(out.n == d.n && d.n == v.n);
+	B3_ASSERT(begin <= end && end <= out.n);
+
+	float32* po = (float32*)(out.v + begin);
+	const float32* pd = (const float32*)(d.v + begin);
+	const float32* pv = (const float32*)(v.v + begin);
+	u32 count = 3 * (end - begin);
+
+	u32 i = 0;
+	float32 result = 0.0f;
+
+#ifdef B3_SIMD_SSE
+	__m128 sum = _mm_setzero_ps();
+	for (; i + 4 <= count; i += 4)
+	{
+		__m128 x = _mm_loadu_ps(pv + i);
+		__m128 y = _mm_mul_ps(_mm_loadu_ps(pd + i), x);
+		_mm_storeu_ps(po + i, y);
+		sum = _mm_add_ps(sum, _mm_mul_ps(x, y));
+	}
+	result = b3HorizontalAdd(sum);
+#endif
+
+	for (; i < count; ++i)
+	{
+		po[i] = pd[i] * pv[i];
+		result += pv[i] * po[i];
+	}
+
+	return result;
+}
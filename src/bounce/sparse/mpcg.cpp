@@ -0,0 +1,544 @@
+/*
+* Copyright (c) 2016-2019 Irlan Robson https://irlanrobson.github.io
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+#include <bounce/sparse/mpcg.h>
+#include <bounce/sparse/csr_mat33.h>
+#include <bounce/common/thread_pool.h>
+
+b3MPCGWorkspace::b3MPCGWorkspace()
+{
+	threadPool = nullptr;
+	preconditioner = e_jacobiPreconditioner;
+	A = nullptr;
+	partitionCount = 0;
+	partitionCapacity = 0;
+	partialSums = nullptr;
+}
+
+b3MPCGWorkspace::~b3MPCGWorkspace()
+{
+	b3Free(partialSums);
+}
+
+void b3MPCGWorkspace::Resize(u32 n)
+{
+	r.Resize(n);
+	p.Resize(n);
+	s.Resize(n);
+	h.Resize(n);
+
+	partitionCount = (n + b3_mpcgPartitionSize - 1) / b3_mpcgPartitionSize;
+	if (partitionCount > partitionCapacity)
+	{
+		b3Free(partialSums);
+		partitionCapacity = partitionCount;
+		partialSums = (float32*)b3Alloc(partitionCapacity * sizeof(float32));
+	}
+}
+
+enum b3MPCGTaskType
+{
+	e_mulTask,
+	e_dotTask,
+	e_preconditionTask,
+	e_scaleDotTask,
+	e_startTask,
+	e_filterMulTask,
+	e_filterDotTask,
+	e_updateTask,
+	e_directionTask
+};
+
+// Return the preconditioner that is applied.
+// SSOR needs the matrix.
+static B3_FORCE_INLINE b3MPCGPreconditioner b3GetPreconditioner(const b3MPCGWorkspace* workspace)
+{
+	if (workspace->preconditioner == e_ssorPreconditioner && workspace->A == nullptr)
+	{
+		return e_blockJacobiPreconditioner;
+	}
+	return workspace->preconditioner;
+}
+
+// A kernel over one partition of rows. 
+// Each partition writes its partial sum to its own slot.
+struct b3MPCGTask
+{
+	// h = inv(P) * r for the Jacobi preconditioners
+	// Return r * h.
+	float32 Precondition(u32 begin, u32 end)
+	{
+		b3DenseVec3& r = workspace->r;
+		b3DenseVec3& h = workspace->h;
+
+		if (workspace->preconditioner == e_jacobiPreconditioner)
+		{
+			return b3ScaleDot(h, workspace->invP, r, begin, end);
+		}
+
+		B3_ASSERT(b3GetPreconditioner(workspace) == e_blockJacobiPreconditioner);
+
+		const b3DiagMat33& invD = workspace->invD;
+
+		float32 result = 0.0f;
+		for (u32 i = begin; i < end; ++i)
+		{
+			h[i] = invD[i] * r[i];
+			result += b3Dot(r[i], h[i]);
+		}
+		return result;
+	}
+
+	void Execute(u32 index, u32 threadIndex)
+	{
+		B3_NOT_USED(threadIndex);
+
+		u32 begin = index * b3_mpcgPartitionSize;
+		u32 end = b3Min(begin + b3_mpcgPartitionSize, workspace->r.n);
+
+		b3DenseVec3& r = workspace->r;
+		b3DenseVec3& p = workspace->p;
+		b3DenseVec3& s = workspace->s;
+		b3DenseVec3& h = workspace->h;
+
+		float32 sum = 0.0f;
+
+		switch (type)
+		{
+		case e_mulTask:
+		{
+			// out = A * v
+			b3Mul(*out, *A, *v, begin, end);
+			break;
+		}
+		case e_dotTask:
+		{
+			// a * v
+			sum = b3Dot(*a, *v, begin, end);
+			break;
+		}
+		case e_preconditionTask:
+		{
+			// h = inv(P) * r
+			sum = Precondition(begin, end);
+			break;
+		}
+		case e_scaleDotTask:
+		{
+			// h = alpha * h
+			for (u32 i = begin; i < end; ++i)
+			{
+				h[i] = alpha * h[i];
+			}
+			sum = b3Dot(r, h, begin, end);
+			break;
+		}
+		case e_startTask:
+		{
+			// p = S * h
+			for (u32 i = begin; i < end; ++i)
+			{
+				p[i] = (*S)[i] * h[i];
+			}
+			break;
+		}
+		case e_filterMulTask:
+		{
+			// s = S * (A * p)
+			// Since p is filtered p * s = p * (A * p)
+			sum = b3MulDot(s, *A, p, begin, end);
+			for (u32 i = begin; i < end; ++i)
+			{
+				s[i] = (*S)[i] * s[i];
+			}
+			break;
+		}
+		case e_filterDotTask:
+		{
+			// s = S * s
+			// Since p is filtered p * s = p * (A * p)
+			for (u32 i = begin; i < end; ++i)
+			{
+				s[i] = (*S)[i] * s[i];
+			}
+			sum = b3Dot(p, s, begin, end);
+			break;
+		}
+		case e_updateTask:
+		{
+			// x = x + alpha * p
+			// r = r - alpha * s
+			b3Axpy(*out, alpha, p, begin, end);
+			b3Axpy(r, -alpha, s, begin, end);
+			
+			// Fuse the Jacobi preconditioners
+			if (b3GetPreconditioner(workspace) != e_ssorPreconditioner)
+			{
+				// h = inv(P) * r
+				sum = Precondition(begin, end);
+			}
+			break;
+		}
+		case e_directionTask:
+		{
+			// p = S * (h + beta * p)
+			for (u32 i = begin; i < end; ++i)
+			{
+				p[i] = (*S)[i] * (h[i] + beta * p[i]);
+			}
+			break;
+		}
+		default:
+		{
+			B3_ASSERT(false);
+			break;
+		}
+		}
+
+		workspace->partialSums[index] = sum;
+	}
+
+	b3MPCGWorkspace* workspace;
+	b3MPCGTaskType type;
+	b3DenseVec3* out;
+	const b3DenseVec3* a;
+	const b3DenseVec3* v;
+	const b3CSRMat33* A;
+	const b3DiagMat33* S;
+	float32 alpha;
+	float32 beta;
+};
+
+// Run a task over all partitions and return the sum of the partial sums.
+static float32 b3RunTask(b3MPCGTask* task)
+{
+	b3MPCGWorkspace* workspace = task->workspace;
+	u32 count = workspace->partitionCount;
+
+	if (workspace->threadPool && count > 1)
+	{
+		workspace->threadPool->Run(task, count);
+	}
+	else
+	{
+		for (u32 i = 0; i < count; ++i)
+		{
+			task->Execute(i, 0);
+		}
+	}
+
+	// Add in a fixed order
+	float32 result = 0.0f;
+	for (u32 i = 0; i < count; ++i)
+	{
+		result += workspace->partialSums[i];
+	}
+	return result;
+}
+
+static void b3InitTask(b3MPCGTask* task, b3MPCGWorkspace* workspace, b3MPCGTaskType type)
+{
+	task->workspace = workspace;
+	task->type = type;
+	task->out = nullptr;
+	task->a = nullptr;
+	task->v = nullptr;
+	task->A = nullptr;
+	task->S = nullptr;
+	task->alpha = 0.0f;
+	task->beta = 0.0f;
+}
+
+void b3ParallelMul(b3MPCGWorkspace* workspace, b3DenseVec3& out, const b3CSRMat33& A, const b3DenseVec3& v)
+{
+	B3_ASSERT(workspace->r.n == A.rowCount);
+
+	b3MPCGTask task;
+	b3InitTask(&task, workspace, e_mulTask);
+	task.out = &out;
+	task.v = &v;
+	task.A = &A;
+
+	b3RunTask(&task);
+}
+
+float32 b3ParallelDot(b3MPCGWorkspace* workspace, const b3DenseVec3& a, const b3DenseVec3& b)
+{
+	B3_ASSERT(workspace->r.n == a.n);
+
+	b3MPCGTask task;
+	b3InitTask(&task, workspace, e_dotTask);
+	task.a = &a;
+	task.v = &b;
+
+	return b3RunTask(&task);
+}
+
+void b3ComputePreconditioner(b3MPCGWorkspace* workspace, const b3CSRMat33& A)
+{
+	B3_ASSERT(workspace->r.n == A.rowCount);
+
+	workspace->A = &A;
+
+	if (workspace->preconditioner == e_jacobiPreconditioner)
+	{
+		b3DenseVec3& invP = workspace->invP;
+		invP.Resize(A.rowCount);
+
+		// P = diag(A)
+		for (u32 i = 0; i < A.rowCount; ++i)
+		{
+			const b3Mat33& a = A.values[A.pattern->GetBlock(i, i)];
+
+			// Sylvester Criterion to ensure PD-ness
+			B3_ASSERT(b3Det(a.x, a.y, a.z) > 0.0f);
+
+			B3_ASSERT(a.x.x > 0.0f);
+			float32 xx = 1.0f / a.x.x;
+
+			B3_ASSERT(a.y.y > 0.0f);
+			float32 yy = 1.0f / a.y.y;
+
+			B3_ASSERT(a.z.z > 0.0f);
+			float32 zz = 1.0f / a.z.z;
+
+			invP[i].Set(xx, yy, zz);
+		}
+
+		return;
+	}
+
+	b3DiagMat33& invD = workspace->invD;
+	invD.Resize(A.rowCount);
+
+	// D = blockdiag(A)
+	for (u32 i = 0; i < A.rowCount; ++i)
+	{
+		const b3Mat33& a = A.values[A.pattern->GetBlock(i, i)];
+
+		// Sylvester Criterion to ensure PD-ness
+		B3_ASSERT(b3Det(a.x, a.y, a.z) > 0.0f);
+
+		invD[i] = b3Inverse(a);
+	}
+}
+
+void b3ComputePreconditioner(b3MPCGWorkspace* workspace, const b3DiagMat33& D)
+{
+	B3_ASSERT(workspace->r.n == D.n);
+
+	workspace->A = nullptr;
+
+	if (workspace->preconditioner == e_jacobiPreconditioner)
+	{
+		b3DenseVec3& invP = workspace->invP;
+		invP.Resize(D.n);
+
+		// P = diag(A)
+		for (u32 i = 0; i < D.n; ++i)
+		{
+			const b3Mat33& a = D[i];
+
+			B3_ASSERT(a.x.x > 0.0f);
+			B3_ASSERT(a.y.y > 0.0f);
+			B3_ASSERT(a.z.z > 0.0f);
+
+			invP[i].Set(1.0f / a.x.x, 1.0f / a.y.y, 1.0f / a.z.z);
+		}
+
+		return;
+	}
+
+	b3DiagMat33& invD = workspace->invD;
+	invD.Resize(D.n);
+
+	// D = blockdiag(A)
+	for (u32 i = 0; i < D.n; ++i)
+	{
+		const b3Mat33& a = D[i];
+
+		// Sylvester Criterion to ensure PD-ness
+		B3_ASSERT(b3Det(a.x, a.y, a.z) > 0.0f);
+
+		invD[i] = b3Inverse(a);
+	}
+}
+
+// Apply the SSOR preconditioner on the calling thread.
+// P = w / (2 - w) * (D / w + L) * inv(D / w) * (D / w + U)
+static void b3ApplySSOR(b3MPCGWorkspace* workspace)
+{
+	const b3CSRMat33& A = *workspace->A;
+	const b3DiagMat33& invD = workspace->invD;
+	const b3DenseVec3& r = workspace->r;
+	b3DenseVec3& h = workspace->h;
+
+	const u32* rowOffsets = A.pattern->rowOffsets;
+	const u32* columns = A.pattern->columns;
+
+	const float32 w = b3_ssorWeight;
+
+	// Forward substitution
+	// h = inv(D / w + L) * r
+	for (u32 i = 0; i < A.rowCount; ++i)
+	{
+		b3Vec3 sum = r[i];
+
+		// The columns are sorted 
+		for (u32 k = rowOffsets[i]; k < rowOffsets[i + 1]; ++k)
+		{
+			u32 j = columns[k];
+			if (j >= i)
+			{
+				break;
+			}
+
+			sum -= A.values[k] * h[j];
+		}
+
+		h[i] = w * (invD[i] * sum);
+	}
+
+	// Backward substitution
+	// h = inv(D / w + U) * (D / w) * h
+	for (u32 i = A.rowCount; i > 0; --i)
+	{
+		u32 row = i - 1;
+
+		b3Vec3 sum(0.0f, 0.0f, 0.0f);
+
+		for (u32 k = rowOffsets[row + 1]; k > rowOffsets[row]; --k)
+		{
+			u32 j = columns[k - 1];
+			if (j <= row)
+			{
+				break;
+			}
+
+			sum += A.values[k - 1] * h[j];
+		}
+
+		h[row] -= w * (invD[row] * sum);
+	}
+}
+
+float32 b3ApplyPreconditioner(b3MPCGWorkspace* workspace)
+{
+	b3MPCGTask task;
+
+	if (b3GetPreconditioner(workspace) == e_ssorPreconditioner)
+	{
+		b3ApplySSOR(workspace);
+
+		// The substitutions are sequential but the scaling and reduction aren't.
+		b3InitTask(&task, workspace, e_scaleDotTask);
+		task.alpha = (2.0f - b3_ssorWeight) / b3_ssorWeight;
+		return b3RunTask(&task);
+	}
+
+	b3InitTask(&task, workspace, e_preconditionTask);
+	return b3RunTask(&task);
+}
+
+// Run the MPCG iterations. 
+// The matrix is given either as a CSR matrix or as an operator.
+static u32 b3IterateMPCG(b3MPCGWorkspace* workspace, b3DenseVec3& x, 
+	const b3CSRMat33* A, const b3MPCGOperator* op, const b3DiagMat33& S, float32 tolerance, u32 maxIterations)
+{
+	// h = inv(P) * r
+	// Since r is filtered r * p = r * h
+	float32 delta_new = b3ApplyPreconditioner(workspace);
+
+	// p = S * h
+	b3MPCGTask task;
+	b3InitTask(&task, workspace, e_startTask);
+	task.out = &x;
+	task.A = A;
+	task.S = &S;
+	b3RunTask(&task);
+
+	u32 iteration = 0;
+	for (;;)
+	{
+		if (iteration == maxIterations)
+		{
+			break;
+		}
+
+		if (delta_new <= tolerance)
+		{
+			break;
+		}
+
+		float32 pAp;
+		if (op)
+		{
+			// s = A * p
+			op->Mul(workspace->s, workspace->p);
+
+			task.type = e_filterDotTask;
+			pAp = b3RunTask(&task);
+		}
+		else
+		{
+			task.type = e_filterMulTask;
+			pAp = b3RunTask(&task);
+		}
+
+		task.type = e_updateTask;
+		task.alpha = delta_new / pAp;
+
+		float32 delta_old = delta_new;
+		delta_new = b3RunTask(&task);
+
+		if (b3GetPreconditioner(workspace) == e_ssorPreconditioner)
+		{
+			delta_new = b3ApplyPreconditioner(workspace);
+		}
+
+		task.type = e_directionTask;
+		task.beta = delta_new / delta_old;
+		b3RunTask(&task);
+
+		++iteration;
+	}
+
+	return iteration;
+}
+
+u32 b3IterateMPCG(b3MPCGWorkspace* workspace, b3DenseVec3& x, 
+	const b3CSRMat33& A, const b3DiagMat33& S, float32 tolerance, u32 maxIterations)
+{
+	B3_ASSERT(workspace->A == &A);
+	B3_ASSERT(workspace->r.n == A.rowCount);
+	B3_ASSERT(x.n == A.rowCount);
+	B3_ASSERT(S.n == A.rowCount);
+
+	return b3IterateMPCG(workspace, x, &A, nullptr, S, tolerance, maxIterations);
+}
+
+u32 b3IterateMPCG(b3MPCGWorkspace* workspace, b3DenseVec3& x, 
+	const b3MPCGOperator& A, const b3DiagMat33& S, float32 tolerance, u32 maxIterations)
+{
+	B3_ASSERT(workspace->A == nullptr);
+	B3_ASSERT(x.n == workspace->r.n);
+	B3_ASSERT(S.n == workspace->r.n);
+
+	return b3IterateMPCG(workspace, x, nullptr, &A, S, tolerance, maxIterations);
+}
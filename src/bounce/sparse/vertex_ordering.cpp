@@ -0,0 +1,288 @@
+/*
+* Copyright (c) 2016-2019 Irlan Robson https://irlanrobson.github.io
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include <bounce/sparse/vertex_ordering.h>
+#include <bounce/common/math/math.h>
+
+// Find the vertices reachable from a given root in breadth-first order.
+// The vertices of the deepest level are at the end of the queue starting at lastLevel.
+// Return the number of reached vertices.
+static u32 b3BreadthFirstSearch(u32* queue, u32* lastLevel, u32* depth,
+	u32* marks, u32 mark, u32 root,
+	const u32* offsets, const u32* degrees, const u32* adjacency)
+{
+	queue[0] = root;
+	marks[root] = mark;
+
+	u32 levelBegin = 0;
+	u32 levelEnd = 1;
+	u32 count = 1;
+	u32 levelCount = 0;
+
+	for (;;)
+	{
+		for (u32 i = levelBegin; i < levelEnd; ++i)
+		{
+			u32 v = queue[i];
+			const u32* row = adjacency + offsets[v];
+			for (u32 j = 0; j < degrees[v]; ++j)
+			{
+				u32 w = row[j];
+				if (marks[w] != mark)
+				{
+					marks[w] = mark;
+					queue[count++] = w;
+				}
+			}
+		}
+
+		if (count == levelEnd)
+		{
+			break;
+		}
+
+		levelBegin = levelEnd;
+		levelEnd = count;
+		++levelCount;
+	}
+
+	*lastLevel = levelBegin;
+	*depth = levelCount;
+	return count;
+}
+
+void b3ComputeVertexOrder(u32* order, u32 vertexCount, const u32* elements, u32 elementCount, u32 elementSize)
+{
+	if (vertexCount == 0)
+	{
+		return;
+	}
+
+	// Build the adjacency lists.
+	// A pair of vertices can share many elements, so the lists contain duplicates at first.
+	u32* offsets = (u32*)b3Alloc((vertexCount + 1) * sizeof(u32));
+	for (u32 i = 0; i <= vertexCount; ++i)
+	{
+		offsets[i] = 0;
+	}
+
+	for (u32 i = 0; i < elementCount; ++i)
+	{
+		const u32* element = elements + i * elementSize;
+		for (u32 j = 0; j < elementSize; ++j)
+		{
+			B3_ASSERT(element[j] < vertexCount);
+			offsets[element[j] + 1] += elementSize - 1;
+		}
+	}
+
+	for (u32 i = 0; i < vertexCount; ++i)
+	{
+		offsets[i + 1] += offsets[i];
+	}
+
+	u32* adjacency = (u32*)b3Alloc(offsets[vertexCount] * sizeof(u32));
+	u32* degrees = (u32*)b3Alloc(vertexCount * sizeof(u32));
+	for (u32 i = 0; i < vertexCount; ++i)
+	{
+		degrees[i] = 0;
+	}
+
+	for (u32 i = 0; i < elementCount; ++i)
+	{
+		const u32* element = elements + i * elementSize;
+		for (u32 j = 0; j < elementSize; ++j)
+		{
+			u32 v = element[j];
+			for (u32 k = 0; k < elementSize; ++k)
+			{
+				u32 w = element[k];
+				if (w != v)
+				{
+					adjacency[offsets[v] + degrees[v]++] = w;
+				}
+			}
+		}
+	}
+
+	// Sort the lists and remove the duplicates.
+	for (u32 i = 0; i < vertexCount; ++i)
+	{
+		u32* row = adjacency + offsets[i];
+		u32 count = degrees[i];
+
+		for (u32 j = 1; j < count; ++j)
+		{
+			u32 w = row[j];
+			u32 k = j;
+			while (k > 0 && row[k - 1] > w)
+			{
+				row[k] = row[k - 1];
+				--k;
+			}
+			row[k] = w;
+		}
+
+		u32 uniqueCount = 0;
+		for (u32 j = 0; j < count; ++j)
+		{
+			if (uniqueCount == 0 || row[uniqueCount - 1] != row[j])
+			{
+				row[uniqueCount++] = row[j];
+			}
+		}
+
+		degrees[i] = uniqueCount;
+	}
+
+	u32* queue = (u32*)b3Alloc(vertexCount * sizeof(u32));
+	u32* marks = (u32*)b3Alloc(vertexCount * sizeof(u32));
+	bool* ordered = (bool*)b3Alloc(vertexCount * sizeof(bool));
+	for (u32 i = 0; i < vertexCount; ++i)
+	{
+		marks[i] = B3_MAX_U32;
+		ordered[i] = false;
+	}
+
+	u32 mark = 0;
+	u32 orderCount = 0;
+	for (u32 root = 0; root < vertexCount; ++root)
+	{
+		if (ordered[root])
+		{
+			continue;
+		}
+
+		// Find a pseudo-peripheral vertex of the component of the root.
+		// Start from a vertex of the deepest level of the current start
+		// while the number of levels increases.
+		u32 start = root;
+		u32 lastLevel, depth;
+		u32 count = b3BreadthFirstSearch(queue, &lastLevel, &depth, marks, mark++, start, offsets, degrees, adjacency);
+
+		for (;;)
+		{
+			// Pick the vertex of the deepest level with the lowest degree.
+			u32 candidate = queue[lastLevel];
+			for (u32 i = lastLevel + 1; i < count; ++i)
+			{
+				if (degrees[queue[i]] < degrees[candidate])
+				{
+					candidate = queue[i];
+				}
+			}
+
+			u32 candidateLastLevel, candidateDepth;
+			b3BreadthFirstSearch(queue, &candidateLastLevel, &candidateDepth, marks, mark++, candidate, offsets, degrees, adjacency);
+
+			if (candidateDepth <= depth)
+			{
+				break;
+			}
+
+			start = candidate;
+			lastLevel = candidateLastLevel;
+			depth = candidateDepth;
+		}
+
+		// Cuthill-McKee ordering of the component.
+		// The unordered neighbours of a vertex are appended in increasing degree.
+		u32 head = orderCount;
+		order[orderCount++] = start;
+		ordered[start] = true;
+
+		while (head < orderCount)
+		{
+			u32 v = order[head++];
+			u32 first = orderCount;
+
+			const u32* row = adjacency + offsets[v];
+			for (u32 j = 0; j < degrees[v]; ++j)
+			{
+				u32 w = row[j];
+				if (ordered[w] == false)
+				{
+					ordered[w] = true;
+
+					u32 k = orderCount++;
+					while (k > first && degrees[order[k - 1]] > degrees[w])
+					{
+						order[k] = order[k - 1];
+						--k;
+					}
+					order[k] = w;
+				}
+			}
+		}
+	}
+
+	B3_ASSERT(orderCount == vertexCount);
+
+	// Reverse the ordering.
+	for (u32 i = 0, j = vertexCount - 1; i < j; ++i, --j)
+	{
+		b3Swap(order[i], order[j]);
+	}
+
+	b3Free(ordered);
+	b3Free(marks);
+	b3Free(queue);
+	b3Free(degrees);
+	b3Free(adjacency);
+	b3Free(offsets);
+}
+
+void b3ComputeElementOrder(u32* order, u32 vertexCount, const u32* vertexIndices, const u32* elements, u32 elementCount, u32 elementSize)
+{
+	// Counting sort on the lowest vertex index.
+	// The sort is stable.
+	u32* keys = (u32*)b3Alloc(elementCount * sizeof(u32));
+	u32* offsets = (u32*)b3Alloc((vertexCount + 1) * sizeof(u32));
+	for (u32 i = 0; i <= vertexCount; ++i)
+	{
+		offsets[i] = 0;
+	}
+
+	for (u32 i = 0; i < elementCount; ++i)
+	{
+		const u32* element = elements + i * elementSize;
+
+		u32 key = vertexIndices[element[0]];
+		for (u32 j = 1; j < elementSize; ++j)
+		{
+			key = b3Min(key, vertexIndices[element[j]]);
+		}
+
+		B3_ASSERT(key < vertexCount);
+		keys[i] = key;
+		++offsets[key + 1];
+	}
+
+	for (u32 i = 0; i < vertexCount; ++i)
+	{
+		offsets[i + 1] += offsets[i];
+	}
+
+	for (u32 i = 0; i < elementCount; ++i)
+	{
+		order[offsets[keys[i]]++] = i;
+	}
+
+	b3Free(offsets);
+	b3Free(keys);
+}